@@ -74,7 +74,7 @@ np_array<dtype> initKmeansPlusPlus(const np_array_nfc<dtype> &data, std::size_t
     auto nFrames = static_cast<std::size_t>(data.shape(0));
 
     // random generator
-    auto generator = seed < 0 ? rnd::randomlySeededGenerator() : rnd::seededGenerator(seed);
+    auto generator = seed < 0 ? rnd::randomlySeededGenerator<std::mt19937>() : rnd::seededGenerator<std::mt19937>(seed);
     std::uniform_int_distribution<std::int64_t> uniform(0, nFrames - 1);
     std::uniform_real_distribution<double> uniformReal(0, 1);
 
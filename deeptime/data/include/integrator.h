@@ -60,7 +60,7 @@ private:
 // Euler-Maruyama integrator for stochastic differential equations
 //------------------------------------------------------------------------------
 
-template<typename State, std::size_t DIM, typename Value = double, typename Generator = std::mt19937>
+template<typename State, std::size_t DIM, typename Value = double, typename Generator = rnd::Philox4x32>
 class EulerMaruyama {
 public:
 
@@ -68,6 +68,12 @@ public:
         generator = seed < 0 ? rnd::randomlySeededGenerator<Generator>() : rnd::seededGenerator<Generator>(seed);
     }
 
+    /**
+     * Integrator drawing its noise from stream `stream` of a seed, e.g., one stream per test point.
+     */
+    EulerMaruyama(std::uint32_t seed, std::uint32_t stream)
+            : generator(rnd::seededGenerator<Generator>(seed, stream)) {}
+
     template<typename F, typename Sigma>
     State eval(F &&f, const Sigma& sigma, double h, std::size_t nSteps, const State &y0) {
         auto y = y0;
@@ -106,6 +112,6 @@ private:
     }
 
     Generator generator;       ///< random number generator
-    std::normal_distribution<Value> distribution;   ///< normal distribution
+    deeptime::rnd::normal_distribution<Value> distribution;   ///< normal distribution
 };
 }
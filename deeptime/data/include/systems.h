@@ -292,12 +292,19 @@ typename System::Integrator createIntegrator(std::int64_t seed, sde_tag) {
     return typename System::Integrator{seed};
 }
 
+template<typename System>
+typename System::Integrator createIntegrator(std::uint32_t /*seed*/, std::uint32_t /*stream*/, ode_tag) {
+    return typename System::Integrator{};
+}
+
+template<typename System>
+typename System::Integrator createIntegrator(std::uint32_t seed, std::uint32_t stream, sde_tag) {
+    return typename System::Integrator{seed, stream};
+}
+
 template<typename dtype, typename System>
 np_array_nfc<dtype> evaluateSystem(const System &system, const np_array_nfc<dtype> &x,
                                    std::int64_t seed = -1, int nThreads = -1) {
-    if (seed >= 0 && nThreads != 1) {
-        throw std::invalid_argument("Fixing the seed requires setting the number of threads to 1.");
-    }
     np_array_nfc<dtype> y({x.shape(0), x.shape(1)});
 
     auto xBuf = x.template unchecked<2>();
@@ -322,14 +329,16 @@ np_array_nfc<dtype> evaluateSystem(const System &system, const np_array_nfc<dtyp
     #endif
 
     typename System::State testPoint = {};
+    // each test point integrates with its own random stream, so the result does not depend on the number of threads
+    const auto streamSeed = static_cast<std::uint32_t>(seed < 0 ? deeptime::rnd::randomSeed() : seed);
 
     // for all test points
-    #pragma omp parallel default(none) firstprivate(system, nTestPoints, xBuf, yBuf, testPoint, seed)
+    #pragma omp parallel default(none) firstprivate(system, nTestPoints, xBuf, yBuf, testPoint, streamSeed)
     {
-        auto integrator = createIntegrator<System>(seed, typename System::system_type());
-
         #pragma omp for
         for (py::ssize_t i = 0; i < nTestPoints; ++i) {
+            auto integrator = createIntegrator<System>(streamSeed, static_cast<std::uint32_t>(i),
+                                                       typename System::system_type());
 
             // copy new test point into x vector
             for (std::size_t k = 0; k < System::DIM; ++k) {
@@ -0,0 +1,90 @@
+//
+// Raw Philox4x32 output and samples of the in-house distributions of distribution_utils.h, exposed for tests.
+//
+
+#pragma once
+
+#include "common.h"
+#include "distribution_utils.h"
+
+namespace detail {
+inline deeptime::rnd::Philox4x32 samplesGenerator(std::int64_t seed) {
+    return seed < 0 ? deeptime::rnd::randomlySeededGenerator()
+                    : deeptime::rnd::Philox4x32(static_cast<std::uint64_t>(seed));
+}
+}
+
+/**
+ * The Philox4x32-10 bijection of one counter block under a key, for checking against known-answer vectors.
+ */
+inline np_array<std::uint32_t> philox4x32Block(const np_array<std::uint32_t> &counter,
+                                               const np_array<std::uint32_t> &key) {
+    if (counter.size() != 4 || key.size() != 2) {
+        throw std::invalid_argument("Philox4x32 needs a counter of four and a key of two 32 bit words.");
+    }
+    auto block = deeptime::rnd::Philox4x32::block({counter.at(0), counter.at(1), counter.at(2), counter.at(3)},
+                                                  {key.at(0), key.at(1)});
+    np_array<std::uint32_t> result (std::vector<std::size_t>{block.size()});
+    std::copy(block.begin(), block.end(), result.mutable_data());
+    return result;
+}
+
+/**
+ * The first n outputs of the Philox4x32 generator of (seed, stream, substream).
+ */
+inline np_array<std::uint32_t> philox4x32Stream(std::size_t n, std::uint64_t seed, std::uint32_t stream,
+                                                std::uint32_t substream) {
+    np_array<std::uint32_t> result (std::vector<std::size_t>{n});
+    deeptime::rnd::Philox4x32 generator (seed, stream, substream);
+    std::generate(result.mutable_data(), result.mutable_data() + n, generator);
+    return result;
+}
+
+template<typename dtype>
+np_array<dtype> sampleNormal(std::size_t n, dtype mean, dtype stddev, std::int64_t seed) {
+    np_array<dtype> result (std::vector<std::size_t>{n});
+    auto generator = detail::samplesGenerator(seed);
+    deeptime::rnd::normal_distribution<dtype> distribution (mean, stddev);
+    distribution.fill(generator, result.mutable_data(), result.mutable_data() + n);
+    return result;
+}
+
+template<typename dtype>
+np_array<dtype> sampleGamma(std::size_t n, dtype alpha, dtype beta, std::int64_t seed) {
+    if (alpha < 0 || beta <= 0) {
+        throw std::invalid_argument("Gamma distribution needs non-negative shape and positive scale.");
+    }
+    np_array<dtype> result (std::vector<std::size_t>{n});
+    auto generator = detail::samplesGenerator(seed);
+    deeptime::rnd::gamma_distribution<dtype> distribution (alpha, beta);
+    distribution.fill(generator, result.mutable_data(), result.mutable_data() + n);
+    return result;
+}
+
+template<typename dtype>
+np_array<dtype> sampleBeta(std::size_t n, dtype a, dtype b, std::int64_t seed) {
+    if (a <= 0 || b <= 0) {
+        throw std::invalid_argument("Beta distribution needs positive parameters.");
+    }
+    np_array<dtype> result (std::vector<std::size_t>{n});
+    auto generator = detail::samplesGenerator(seed);
+    deeptime::rnd::beta_distribution<dtype> distribution (a, b);
+    distribution.fill(generator, result.mutable_data(), result.mutable_data() + n);
+    return result;
+}
+
+template<typename dtype>
+np_array<dtype> sampleDirichlet(std::size_t n, const np_array<dtype> &weights, std::int64_t seed) {
+    if (weights.ndim() != 1) {
+        throw std::invalid_argument("Dirichlet weights must be one-dimensional.");
+    }
+    const auto dim = static_cast<std::size_t>(weights.shape(0));
+    np_array<dtype> result (std::vector<std::size_t>{n, dim});
+    auto generator = detail::samplesGenerator(seed);
+    deeptime::rnd::dirichlet_distribution<dtype> distribution (weights.data(), weights.data() + dim);
+    auto *out = result.mutable_data();
+    for (std::size_t i = 0; i < n; ++i) {
+        distribution(generator, out + i * dim);
+    }
+    return result;
+}
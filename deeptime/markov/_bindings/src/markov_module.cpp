@@ -2,6 +2,7 @@
 
 #include "discrete_trajectories.h"
 #include "simulation.h"
+#include "sample_distributions.h"
 
 using namespace pybind11::literals;
 
@@ -16,4 +17,13 @@ PYBIND11_MODULE(_markov_bindings, m) {
         simMod.def("trajectory", &trajectory<float>, "N"_a, "start"_a, "P"_a, "stop"_a = py::none(), "seed"_a = -1);
         simMod.def("trajectory", &trajectory<double>, "N"_a, "start"_a, "P"_a, "stop"_a = py::none(), "seed"_a = -1);
     }
+    {
+        auto randomMod = m.def_submodule("random");
+        randomMod.def("philox4x32_block", &philox4x32Block, "counter"_a, "key"_a);
+        randomMod.def("philox4x32", &philox4x32Stream, "n"_a, "seed"_a, "stream"_a = 0, "substream"_a = 0);
+        randomMod.def("normal", &sampleNormal<double>, "n"_a, "mean"_a = 0., "stddev"_a = 1., "seed"_a = -1);
+        randomMod.def("gamma", &sampleGamma<double>, "n"_a, "alpha"_a, "beta"_a = 1., "seed"_a = -1);
+        randomMod.def("beta", &sampleBeta<double>, "n"_a, "a"_a, "b"_a, "seed"_a = -1);
+        randomMod.def("dirichlet", &sampleDirichlet<double>, "n"_a, "weights"_a, "seed"_a = -1);
+    }
 }
@@ -14,6 +14,7 @@ Output models
     OutputModel
     DiscreteOutputModel
     GaussianOutputModel
+    MultivariateGaussianOutputModel
 
 
 Maximum-likelihood estimation of HMMs
@@ -93,15 +94,17 @@ Utilities
     :template: class_nomodule.rst
 
     viterbi
+    viterbi_batch
+    observation_log_likelihoods
 
 References
 ----------
 .. footbibliography::
 """
 
-from ._hidden_markov_model import HiddenMarkovModel, viterbi
+from ._hidden_markov_model import HiddenMarkovModel, viterbi, viterbi_batch, observation_log_likelihoods
 from ._maximum_likelihood_hmm import MaximumLikelihoodHMM
 from ._bayesian_hmm import BayesianHMM, BayesianHMMPosterior
-from ._output_model import OutputModel, DiscreteOutputModel, GaussianOutputModel
+from ._output_model import OutputModel, DiscreteOutputModel, GaussianOutputModel, MultivariateGaussianOutputModel
 
 from . import init
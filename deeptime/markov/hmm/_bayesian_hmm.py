@@ -1,21 +1,16 @@
-import collections
-from copy import deepcopy
 from typing import Optional, Union, List
 
 import numpy as np
 
 from deeptime.markov.tools.analysis import is_connected
-from deeptime.markov.tools.estimation import sample_tmatrix, transition_matrix
 
 from deeptime.base import Estimator
 from deeptime.markov._base import BayesianPosterior, MembershipsChapmanKolmogorovValidator
-from deeptime.markov._transition_matrix import stationary_distribution
 from deeptime.markov.hmm import HiddenMarkovModel
-from ._output_model import DiscreteOutputModel
-from ._util import observations_in_state, sample_hidden_state_trajectory
+from ._output_model import DiscreteOutputModel, _discrete_observations
 from deeptime.markov.msm import MarkovStateModel
 from deeptime.markov import TransitionCountModel, compute_dtrajs_effective, number_of_states
-from deeptime.markov.hmm._hmm_bindings import util as _bd_util
+from deeptime.markov.hmm._hmm_bindings.output_models import discrete as _bd_discrete
 from deeptime.util.types import ensure_dtraj_list
 
 __author__ = 'noe, clonker'
@@ -247,11 +242,6 @@ class BayesianHMM(Estimator):
     .. footbibliography::
     """
 
-    _SampleStorage = collections.namedtuple(
-        '_SampleStorage', ['transition_matrix', 'output_model', 'stationary_distribution', 'initial_distribution',
-                           'counts', 'hidden_trajs']
-    )
-
     def __init__(self, initial_hmm: HiddenMarkovModel,
                  n_samples: int = 100,
                  n_transition_matrix_sampling_steps: int = 1000,
@@ -440,81 +430,9 @@ class BayesianHMM(Estimator):
             raise ValueError(f'Initial distribution prior mode undefined: {self.transition_matrix_prior}')
         return prior
 
-    def _update(self, model: _SampleStorage, observations, temp_alpha,
-                transition_matrix_prior, initial_distribution_prior):
-        """Update the current model using one round of Gibbs sampling."""
-        self._update_hidden_state_trajectories(model, observations, temp_alpha)
-        self._update_emission_probabilities(model, observations)
-        self._update_transition_matrix(model, transition_matrix_prior, initial_distribution_prior,
-                                       reversible=self.reversible, stationary=self.stationary,
-                                       n_sampling_steps=self.n_transition_matrix_sampling_steps)
-
-    @staticmethod
-    def _update_hidden_state_trajectories(model: _SampleStorage, observations, temp_alpha):
-        """Sample a new set of state trajectories from the conditional distribution P(S | T, E, O)"""
-        model.hidden_trajs.clear()
-        for obs in observations:
-            s_t = sample_hidden_state_trajectory(model.transition_matrix, model.output_model,
-                                                 model.initial_distribution, obs, temp_alpha)
-            model.hidden_trajs.append(s_t)
-
-    @staticmethod
-    def _update_emission_probabilities(model: _SampleStorage, observations):
-        """Sample a new set of emission probabilites from the conditional distribution P(E | S, O) """
-        observations_by_state = [observations_in_state(model.hidden_trajs, observations, state)
-                                 for state in range(model.transition_matrix.shape[0])]
-        model.output_model.sample(observations_by_state)
-
-    @staticmethod
-    def _update_transition_matrix(model: _SampleStorage, transition_matrix_prior,
-                                  initial_distribution_prior, reversible: bool = True, stationary: bool = False,
-                                  n_sampling_steps: int = 1000):
-        """ Updates the hidden-state transition matrix and the initial distribution """
-        C = _bd_util.count_matrix(model.hidden_trajs, 1, model.transition_matrix.shape[0])
-        model.counts[...] = C
-        C = C + transition_matrix_prior
-
-        # check if we work with these options
-        if reversible and not is_connected(C, directed=True):
-            raise NotImplementedError('Encountered disconnected count matrix with sampling option reversible:\n '
-                                      f'{C}\nUse prior to ensure connectivity or use reversible=False.')
-        # ensure consistent sparsity pattern (P0 might have additional zeros because of underflows)
-        # TODO: these steps work around a bug in msmtools. Should be fixed there
-        P0 = transition_matrix(C, reversible=reversible, maxiter=10000, warn_not_converged=False)
-        zeros = np.where(P0 + P0.T == 0)
-        C[zeros] = 0
-        # run sampler
-        Tij = sample_tmatrix(C, nsample=1, nsteps=n_sampling_steps, reversible=reversible)
-
-        # INITIAL DISTRIBUTION
-        if stationary:  # p0 is consistent with P
-            p0 = stationary_distribution(Tij, C=C)
-        else:
-            n0 = BayesianHMM._count_init(model.hidden_trajs, model.transition_matrix.shape[0])
-            first_timestep_counts_with_prior = n0 + initial_distribution_prior
-            positive = first_timestep_counts_with_prior > 0
-            p0 = np.zeros(n0.shape, dtype=model.transition_matrix.dtype)
-            p0[positive] = np.random.dirichlet(first_timestep_counts_with_prior[positive])  # sample p0 from posterior
-
-        # update HMM with new sample
-        model.transition_matrix[...] = Tij
-        model.stationary_distribution[...] = p0
-
-    @staticmethod
-    def _count_init(hidden_state_trajectories, n_hidden_states):
-        """Compute the counts at the first time step
-
-        Returns
-        -------
-        n : ndarray(nstates)
-            n[i] is the number of trajectories starting in state i
-
-        """
-        n = [traj[0] for traj in hidden_state_trajectories]
-        return np.bincount(n, minlength=n_hidden_states)
-
-    def fit(self, data, n_burn_in: int = 0, n_thin: int = 1, **kwargs):
-        r""" Sample from the posterior.
+    def fit(self, data, n_burn_in: int = 0, n_thin: int = 1, seed: int = -1, **kwargs):
+        r""" Sample from the posterior. The Gibbs sampler runs in native code, the hidden state trajectories are
+        sampled for all observation trajectories in parallel.
 
         Parameters
         ----------
@@ -524,6 +442,9 @@ class BayesianHMM(Estimator):
             The number of samples to discard to burn-in, following which :attr:`n_samples` samples will be generated.
         n_thin : int, optional, default=1
             The number of Gibbs sampling updates used to generate each returned sample.
+        seed : int, optional, default=-1
+            Seed of the sampler, a negative value draws a random seed. For a given seed the samples do not depend on
+            the number of threads.
         **kwargs
             Ignored kwargs for scikit-learn compatibility.
 
@@ -579,67 +500,52 @@ class BayesianHMM(Estimator):
         else:
             full_obs_probabilities = prior.output_probabilities
 
-        maxT = max(len(o) for o in dtrajs_lagged_strided)
+        has_all_obs_symbols = model.prior.n_observation_states == len(model.prior.observation_symbols_full)
 
-        # pre-construct hidden variables
-        temp_alpha = np.zeros((maxT, prior.n_hidden_states))
+        n_states = prior.n_hidden_states
+        output_model = DiscreteOutputModel(np.asarray(full_obs_probabilities, dtype=np.float64))
+        observations = _discrete_observations(dtrajs_lagged_strided)
+        lengths = [len(obs) for obs in observations]
+        transition_matrices = np.empty((self.n_samples, n_states, n_states))
+        stationary_distributions = np.empty((self.n_samples, n_states))
+        output_probabilities = np.empty((self.n_samples,) + output_model.output_probabilities.shape)
+        counts = np.empty((self.n_samples, n_states, n_states))
+        hidden_state_trajectories = np.empty((self.n_samples, sum(lengths)), dtype=np.int32) \
+            if self.store_hidden else None
+        _bd_discrete.gibbs_sample(
+            np.asarray(prior.transition_model.transition_matrix, dtype=np.float64),
+            np.asarray(prior.initial_distribution, dtype=np.float64), output_model.output_probabilities,
+            np.asarray(output_model.prior, dtype=np.float64), output_model.ignore_outliers, observations,
+            np.asarray(transition_matrix_prior, dtype=np.float64),
+            np.asarray(initial_distribution_prior, dtype=np.float64), self.reversible, self.stationary,
+            self.n_transition_matrix_sampling_steps, n_burn_in, n_thin, seed, transition_matrices,
+            stationary_distributions, output_probabilities, counts,
+            hidden_state_trajectories_out=hidden_state_trajectories
+        )
 
-        has_all_obs_symbols = model.prior.n_observation_states == len(model.prior.observation_symbols_full)
+        models = []
+        for i in range(self.n_samples):
+            hidden_trajs = np.split(hidden_state_trajectories[i], np.cumsum(lengths)[:-1]) \
+                if self.store_hidden else []
+            count_model = TransitionCountModel(counts[i], lagtime=prior.lagtime)
+            models.append(HiddenMarkovModel(
+                transition_model=MarkovStateModel(transition_matrices[i],
+                                                  stationary_distribution=stationary_distributions[i],
+                                                  reversible=self.reversible, count_model=count_model),
+                output_model=DiscreteOutputModel(output_probabilities[i]),
+                initial_distribution=prior.initial_distribution.copy(), hidden_state_trajectories=hidden_trajs
+            ))
 
-        try:
-            # sample model is basically copy of prior
-            sample_model = BayesianHMM._SampleStorage(
-                transition_matrix=prior.transition_model.transition_matrix.copy(),
-                output_model=DiscreteOutputModel(full_obs_probabilities.copy()),
-                initial_distribution=prior.initial_distribution.copy(),
-                stationary_distribution=prior.transition_model.stationary_distribution.copy(),
-                counts=prior.count_model.count_matrix.copy(),
-                hidden_trajs=[]
-            )
-
-            # Run burn-in.
-            for _ in range(n_burn_in):
-                self._update(sample_model, dtrajs_lagged_strided, temp_alpha, transition_matrix_prior,
-                             initial_distribution_prior)
-
-            # Collect data.
-            models = []
-            for _ in range(self.n_samples):
-                # Run a number of Gibbs sampling updates to generate each sample.
-                for _ in range(n_thin):
-                    self._update(sample_model, dtrajs_lagged_strided, temp_alpha, transition_matrix_prior,
-                                 initial_distribution_prior)
-                    sample_model.output_model.normalize()
-                self._append_sample(models, prior, sample_model)
-
-            if not has_all_obs_symbols:
-                models = [m.submodel(states=None, obs=model.prior.observation_symbols) for m in models]
-
-            model.samples = models
-        finally:
-            del temp_alpha
+        if not has_all_obs_symbols:
+            models = [m.submodel(states=None, obs=model.prior.observation_symbols) for m in models]
+
+        model.samples = models
 
         # set new model
         self._model = model
 
         return self
 
-    def _append_sample(self, models, prior, sample_model):
-        # Save a copy of the current model.
-        model_copy = deepcopy(sample_model)
-        # the Viterbi path is discarded, but is needed to get a new transition matrix for each model.
-        if not self.store_hidden:
-            model_copy.hidden_trajs.clear()
-        # potentially restrict sampled models to observed space
-        # since model_copy is defined on full space, observation_symbols are also observation states
-        count_model = TransitionCountModel(model_copy.counts, lagtime=prior.lagtime)
-        models.append(HiddenMarkovModel(
-            transition_model=MarkovStateModel(model_copy.transition_matrix,
-                                              stationary_distribution=model_copy.stationary_distribution,
-                                              reversible=self.reversible, count_model=count_model),
-            output_model=model_copy.output_model, initial_distribution=model_copy.initial_distribution,
-            hidden_state_trajectories=model_copy.hidden_trajs))
-
     def chapman_kolmogorov_validator(self, mlags=None, test_model: BayesianHMMPosterior = None):
         r"""Returns a Chapman-Kolmogorov validator based on this estimator and a test model.
 
@@ -0,0 +1,856 @@
+//
+// Baum-Welch expectation maximization with all stages of an iteration in native code.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "fixed_point_utils.h"
+#include "mle_trev.h"
+#include "utils.h"
+#include "OutputModelUtils.h"
+
+namespace hmm {
+namespace baum_welch {
+
+/**
+ * Counts below this value do not connect states, as in the maximum-likelihood HMM estimator.
+ */
+static constexpr double minCountConnectivity = 1e-16;
+
+/**
+ * Convergence criterion of the iterative reversible transition matrix estimators.
+ */
+static constexpr double transitionMatrixMaxErr = 1e-12;
+
+template<typename dtype>
+struct Options {
+    bool reversible {true};
+    bool stationary {false};
+    /**
+     * fixed stationary distribution or nullptr
+     */
+    const dtype *fixedStationaryDistribution {nullptr};
+    /**
+     * fixed initial distribution or nullptr
+     */
+    const dtype *fixedInitialDistribution {nullptr};
+    dtype accuracy {1e-3};
+    std::size_t maxIterations {1000};
+    std::size_t maxIterationsReversible {1000000};
+    bool parallelInTime {false};
+};
+
+/**
+ * Connected sets of the graph with an edge i -> j for every count C_ij >= threshold, strongly connected components if
+ * directed and weakly connected components otherwise. Sets are ordered by descending size, states within a set by
+ * index.
+ */
+template<typename dtype>
+std::vector<std::vector<std::size_t>> connectedSets(const dtype* const C, std::size_t n, dtype threshold,
+                                                    bool directed) {
+    auto edge = [C, n, threshold](std::size_t i, std::size_t j) {
+        return C[i * n + j] != 0 && !(C[i * n + j] < threshold);
+    };
+    std::vector<std::size_t> component(n, n);
+    std::size_t nComponents = 0;
+    if (directed) {
+        // iterative Tarjan
+        std::vector<std::size_t> index(n, n), lowLink(n, 0), stack, callStack, nextNeighbor(n, 0);
+        std::vector<bool> onStack(n, false);
+        std::size_t counter = 0;
+        for (std::size_t root = 0; root < n; ++root) {
+            if (index[root] != n) continue;
+            callStack.push_back(root);
+            while (!callStack.empty()) {
+                auto v = callStack.back();
+                if (index[v] == n) {
+                    index[v] = lowLink[v] = counter++;
+                    stack.push_back(v);
+                    onStack[v] = true;
+                }
+                auto &j = nextNeighbor[v];
+                while (j < n && !(edge(v, j) && (index[j] == n || onStack[j]))) {
+                    ++j;
+                }
+                if (j < n) {
+                    if (index[j] == n) {
+                        callStack.push_back(j);
+                    } else {
+                        lowLink[v] = std::min(lowLink[v], index[j]);
+                        ++j;
+                    }
+                    continue;
+                }
+                callStack.pop_back();
+                if (!callStack.empty()) {
+                    auto parent = callStack.back();
+                    lowLink[parent] = std::min(lowLink[parent], lowLink[v]);
+                    ++nextNeighbor[parent];
+                }
+                if (lowLink[v] == index[v]) {
+                    std::size_t w;
+                    do {
+                        w = stack.back();
+                        stack.pop_back();
+                        onStack[w] = false;
+                        component[w] = nComponents;
+                    } while (w != v);
+                    ++nComponents;
+                }
+            }
+        }
+    } else {
+        std::vector<std::size_t> queue;
+        for (std::size_t root = 0; root < n; ++root) {
+            if (component[root] != n) continue;
+            component[root] = nComponents;
+            queue.assign(1, root);
+            while (!queue.empty()) {
+                auto v = queue.back();
+                queue.pop_back();
+                for (std::size_t j = 0; j < n; ++j) {
+                    if (component[j] == n && (edge(v, j) || edge(j, v))) {
+                        component[j] = nComponents;
+                        queue.push_back(j);
+                    }
+                }
+            }
+            ++nComponents;
+        }
+    }
+    std::vector<std::vector<std::size_t>> sets(nComponents);
+    for (std::size_t i = 0; i < n; ++i) {
+        sets[component[i]].push_back(i);
+    }
+    std::stable_sort(sets.begin(), sets.end(), [](const auto &a, const auto &b) { return a.size() > b.size(); });
+    return sets;
+}
+
+/**
+ * Maximum likelihood estimate of the rows S of P which are reversible on the block (S, S) but have counts to states
+ * outside of S, see deeptime.markov._transition_matrix.transition_matrix_partial_rev.
+ */
+template<typename dtype>
+void transitionMatrixPartialRev(const dtype* const C, dtype* const P, std::size_t n,
+                                const std::vector<std::size_t> &set, std::size_t maxIterations, dtype maxErr) {
+    const auto m = set.size();
+    std::vector<bool> inSet(n, false);
+    for (auto i : set) inSet[i] = true;
+
+    // rows of the set over all n columns, X on the block (S, S) and Y on (S, ~S)
+    std::vector<dtype> numerators(m * n), Z(m * n), countSums(m, 0), rowSums(m), rowSumsNew(m), d(m);
+    for (std::size_t a = 0; a < m; ++a) {
+        for (std::size_t j = 0; j < n; ++j) {
+            countSums[a] += C[set[a] * n + j];
+            numerators[a * n + j] = inSet[j] ? C[set[a] * n + j] + C[j * n + set[a]] : C[set[a] * n + j];
+            Z[a * n + j] = inSet[j] ? static_cast<dtype>(.5) * numerators[a * n + j] : numerators[a * n + j];
+        }
+    }
+    auto normalizeAndSum = [&](std::vector<dtype> &sums) {
+        auto total = std::accumulate(Z.begin(), Z.end(), static_cast<dtype>(0));
+        for (std::size_t a = 0; a < m; ++a) {
+            dtype sum = 0;
+            for (std::size_t j = 0; j < n; ++j) {
+                Z[a * n + j] /= total;
+                sum += Z[a * n + j];
+            }
+            sums[a] = sum;
+        }
+    };
+    normalizeAndSum(rowSums);
+
+    std::vector<std::size_t> position(n, 0);
+    for (std::size_t a = 0; a < m; ++a) position[set[a]] = a;
+
+    dtype err = 1;
+    for (std::size_t it = 0; err > maxErr && it < maxIterations; ++it) {
+        for (std::size_t a = 0; a < m; ++a) {
+            d[a] = countSums[a] / rowSums[a];
+        }
+        for (std::size_t a = 0; a < m; ++a) {
+            for (std::size_t j = 0; j < n; ++j) {
+                Z[a * n + j] = inSet[j] ? numerators[a * n + j] / (d[a] + d[position[j]])
+                                        : numerators[a * n + j] / d[a];
+            }
+        }
+        normalizeAndSum(rowSumsNew);
+        err = 0;
+        for (std::size_t a = 0; a < m; ++a) {
+            err = std::max(err, std::abs(rowSumsNew[a] - rowSums[a]));
+        }
+        std::swap(rowSums, rowSumsNew);
+    }
+    for (std::size_t a = 0; a < m; ++a) {
+        const auto rowSum = std::accumulate(Z.begin() + a * n, Z.begin() + (a + 1) * n, static_cast<dtype>(0));
+        for (std::size_t j = 0; j < n; ++j) {
+            P[set[a] * n + j] = Z[a * n + j] / rowSum;
+        }
+    }
+}
+
+/**
+ * Maximum likelihood transition matrix for a general connectivity structure of the (n, n) count matrix C, see
+ * deeptime.markov._transition_matrix.estimate_P. Empty states keep a one on the diagonal. fixedStationaryDistribution
+ * may be nullptr.
+ */
+template<typename dtype>
+void estimateTransitionMatrix(const dtype* const C, dtype* const P, std::size_t n, bool reversible,
+                              const dtype* const fixedStationaryDistribution, std::size_t maxIterations) {
+    const auto maxErr = static_cast<dtype>(transitionMatrixMaxErr);
+    const auto threshold = static_cast<dtype>(minCountConnectivity);
+    std::fill(P, P + n * n, static_cast<dtype>(0));
+    for (std::size_t i = 0; i < n; ++i) {
+        P[i * n + i] = 1;
+    }
+
+    auto block = [C, n](const std::vector<std::size_t> &set) {
+        std::vector<dtype> result(set.size() * set.size());
+        for (std::size_t a = 0; a < set.size(); ++a) {
+            for (std::size_t b = 0; b < set.size(); ++b) {
+                result[a * set.size() + b] = C[set[a] * n + set[b]];
+            }
+        }
+        return result;
+    };
+    auto writeBlock = [P, n](const std::vector<std::size_t> &set, const std::vector<dtype> &values) {
+        for (std::size_t a = 0; a < set.size(); ++a) {
+            for (std::size_t b = 0; b < set.size(); ++b) {
+                P[set[a] * n + set[b]] = values[a * set.size() + b];
+            }
+        }
+    };
+
+    if (reversible && fixedStationaryDistribution == nullptr) {
+        // reversible with unknown stationary distribution: strongly connected sets
+        for (const auto &set : connectedSets(C, n, threshold, true)) {
+            std::vector<bool> inSet(n, false);
+            for (auto i : set) inSet[i] = true;
+            dtype outgoing = 0;
+            for (auto i : set) {
+                for (std::size_t j = 0; j < n; ++j) {
+                    if (!inSet[j]) outgoing += C[i * n + j];
+                }
+            }
+            if (outgoing > std::numeric_limits<dtype>::epsilon()) {
+                transitionMatrixPartialRev(C, P, n, set, maxIterations, maxErr);
+            } else if (set.size() > 1) {
+                const auto m = set.size();
+                auto Cs = block(set);
+                std::vector<dtype> CCt(m * m), sumC(m, 0), T(m * m), mu(m);
+                for (std::size_t a = 0; a < m; ++a) {
+                    for (std::size_t b = 0; b < m; ++b) {
+                        CCt[a * m + b] = Cs[a * m + b] + Cs[b * m + a];
+                        sumC[a] += Cs[a * m + b];
+                    }
+                }
+                mle_trev_dense_impl(T.data(), CCt.data(), sumC.data(), m, maxErr, maxIterations, mu.data(),
+                                    static_cast<dtype>(1e-15), deeptime::fixed_point::Acceleration::none);
+                writeBlock(set, T);
+            }
+        }
+    } else {
+        // nonreversible or given stationary distribution: weakly connected sets
+        for (const auto &set : connectedSets(C, n, threshold, false)) {
+            const auto m = set.size();
+            auto Cs = block(set);
+            std::vector<dtype> T(m * m);
+            if (!reversible) {
+                for (std::size_t a = 0; a < m; ++a) {
+                    auto rowSum = std::accumulate(Cs.begin() + a * m, Cs.begin() + (a + 1) * m, static_cast<dtype>(0));
+                    if (rowSum == 0) {
+                        Cs[a * m + a] = 1;
+                        rowSum = 1;
+                    }
+                    for (std::size_t b = 0; b < m; ++b) {
+                        T[a * m + b] = Cs[a * m + b] / rowSum;
+                    }
+                }
+            } else {
+                std::vector<dtype> mu(m);
+                for (std::size_t a = 0; a < m; ++a) {
+                    mu[a] = fixedStationaryDistribution[set[a]];
+                }
+                mle_trev_given_pi_dense_impl(T.data(), Cs.data(), mu.data(), m, maxErr, maxIterations,
+                                             deeptime::fixed_point::Acceleration::none);
+            }
+            writeBlock(set, T);
+        }
+    }
+}
+
+/**
+ * Stationary distribution of the (m, m) transition matrix P by inverse iteration on P^T - mu I, falling back to power
+ * iteration if that fails, see deeptime.markov.tools.analysis.dense.stationary_distribution. The shift mu lies nine
+ * units in the last place below one, which is 1 - 1e-15 in double precision and still below one in single precision.
+ * The tolerance on the inverse growth of the iterates scales with the shift accordingly.
+ */
+template<typename dtype>
+std::vector<dtype> stationaryVector(const std::vector<dtype> &P, std::size_t m) {
+    const auto mu = static_cast<dtype>(1) - 9 * std::numeric_limits<dtype>::epsilon() / 2;
+    // LU decomposition with partial pivoting of A = P^T - mu I
+    std::vector<dtype> A(m * m);
+    for (std::size_t i = 0; i < m; ++i) {
+        for (std::size_t j = 0; j < m; ++j) {
+            A[i * m + j] = P[j * m + i] - (i == j ? mu : static_cast<dtype>(0));
+        }
+    }
+    std::vector<std::size_t> pivots(m);
+    bool singular = false;
+    for (std::size_t k = 0; k < m; ++k) {
+        auto p = k;
+        for (std::size_t i = k + 1; i < m; ++i) {
+            if (std::abs(A[i * m + k]) > std::abs(A[p * m + k])) p = i;
+        }
+        pivots[k] = p;
+        if (A[p * m + k] == 0) {
+            singular = true;
+            break;
+        }
+        if (p != k) {
+            std::swap_ranges(A.begin() + k * m, A.begin() + (k + 1) * m, A.begin() + p * m);
+        }
+        for (std::size_t i = k + 1; i < m; ++i) {
+            A[i * m + k] /= A[k * m + k];
+            for (std::size_t j = k + 1; j < m; ++j) {
+                A[i * m + j] -= A[i * m + k] * A[k * m + j];
+            }
+        }
+    }
+
+    auto norm = [](const std::vector<dtype> &x) {
+        return std::sqrt(std::inner_product(x.begin(), x.end(), x.begin(), static_cast<dtype>(0)));
+    };
+    std::vector<dtype> y(m, static_cast<dtype>(1)), x(m);
+    bool converged = false;
+    if (!singular) {
+        auto r = 1 / norm(y);
+        for (auto &v : y) v *= r;
+        for (int it = 0; it < 100 && !converged; ++it) {
+            x = y;
+            for (std::size_t k = 0; k < m; ++k) {
+                std::swap(x[k], x[pivots[k]]);
+            }
+            for (std::size_t i = 0; i < m; ++i) {
+                for (std::size_t j = 0; j < i; ++j) x[i] -= A[i * m + j] * x[j];
+            }
+            for (std::size_t i = m; i-- > 0;) {
+                for (std::size_t j = i + 1; j < m; ++j) x[i] -= A[i * m + j] * x[j];
+                x[i] /= A[i * m + i];
+            }
+            r = 1 / norm(x);
+            for (std::size_t i = 0; i < m; ++i) y[i] = x[i] * r;
+            converged = std::isfinite(r) && r <= 10 * (1 - mu);
+        }
+    }
+    auto sum = std::accumulate(y.begin(), y.end(), static_cast<dtype>(0));
+    for (auto &v : y) v /= sum;
+    if (converged && std::all_of(y.begin(), y.end(), [](dtype v) { return v >= 0; })) {
+        return y;
+    }
+
+    // power iteration
+    std::vector<dtype> pi(m, static_cast<dtype>(1) / static_cast<dtype>(m)), piNew(m);
+    for (std::size_t it = 0; it < 100000; ++it) {
+        std::fill(piNew.begin(), piNew.end(), static_cast<dtype>(0));
+        for (std::size_t i = 0; i < m; ++i) {
+            for (std::size_t j = 0; j < m; ++j) piNew[j] += pi[i] * P[i * m + j];
+        }
+        dtype change = 0;
+        for (std::size_t i = 0; i < m; ++i) change = std::max(change, std::abs(piNew[i] - pi[i]));
+        std::swap(pi, piNew);
+        if (change < std::numeric_limits<dtype>::epsilon()) break;
+    }
+    for (auto &v : pi) v = std::max(v, static_cast<dtype>(0));
+    sum = std::accumulate(pi.begin(), pi.end(), static_cast<dtype>(0));
+    for (auto &v : pi) v /= sum;
+    return pi;
+}
+
+/**
+ * Stationary distribution of P on the weakly connected sets of C, each weighted by its share of the counts, see
+ * deeptime.markov._transition_matrix.stationary_distribution.
+ */
+template<typename dtype>
+void stationaryDistribution(const dtype* const P, const dtype* const C, dtype* const pi, std::size_t n) {
+    const auto total = std::accumulate(C, C + n * n, static_cast<dtype>(0));
+    std::fill(pi, pi + n, static_cast<dtype>(0));
+    for (const auto &set : connectedSets(C, n, static_cast<dtype>(minCountConnectivity), false)) {
+        const auto m = set.size();
+        std::vector<dtype> Ps(m * m);
+        dtype weight = 0;
+        for (std::size_t a = 0; a < m; ++a) {
+            weight += std::accumulate(C + set[a] * n, C + (set[a] + 1) * n, static_cast<dtype>(0));
+            for (std::size_t b = 0; b < m; ++b) {
+                Ps[a * m + b] = P[set[a] * n + set[b]];
+            }
+        }
+        auto piSet = stationaryVector(Ps, m);
+        for (std::size_t a = 0; a < m; ++a) {
+            pi[set[a]] = weight / total * piSet[a];
+        }
+    }
+    auto sum = std::accumulate(pi, pi + n, static_cast<dtype>(0));
+    std::transform(pi, pi + n, pi, [sum](dtype v) { return v / sum; });
+}
+
+/**
+ * Emission probabilities for run(), materialized as (T, N) state probability trajectories of all trajectories. They
+ * are refilled by pObsRow(k)(t, out) from the current output model before every E-step, in chunks of at most
+ * chunkSize time steps.
+ */
+template<typename dtype, typename PObsRowFactory>
+class MaterializedPObs {
+public:
+    MaterializedPObs(const std::vector<std::size_t> &lengths, std::size_t N, PObsRowFactory pObsRow)
+            : N(N), offsets(lengths.size() + 1, 0), pObsRow(std::move(pObsRow)) {
+        for (std::size_t k = 0; k < lengths.size(); ++k) {
+            offsets[k + 1] = offsets[k] + lengths[k];
+            for (std::size_t t0 = 0; t0 < lengths[k]; t0 += chunkSize) {
+                chunks.push_back({k, t0, std::min(t0 + chunkSize, lengths[k])});
+            }
+        }
+        pObs.resize(offsets.back() * N);
+    }
+
+    void update() {
+        const auto nChunks = static_cast<std::int64_t>(chunks.size());
+        auto* pObsPtr = pObs.data();
+        const auto n = N;
+        #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nChunks, pObsPtr, n) \
+                shared(chunks, offsets, pObsRow)
+        for (std::int64_t c = 0; c < nChunks; ++c) {
+            const auto k = chunks[c][0];
+            auto row = pObsRow(k);
+            for (auto t = chunks[c][1]; t < chunks[c][2]; ++t) {
+                row(t, pObsPtr + (offsets[k] + t) * n);
+            }
+        }
+    }
+
+    detail::DensePObs<dtype> operator()(std::size_t k) const {
+        return {pObs.data() + offsets[k] * N, N};
+    }
+
+private:
+    static constexpr std::size_t chunkSize = 4096;
+    std::size_t N;
+    std::vector<std::size_t> offsets;
+    std::vector<std::array<std::size_t, 3>> chunks;
+    std::vector<dtype> pObs;
+    PObsRowFactory pObsRow;
+};
+
+template<typename dtype, typename PObsRowFactory>
+MaterializedPObs<dtype, PObsRowFactory> materializedPObs(const std::vector<std::size_t> &lengths, std::size_t N,
+                                                         PObsRowFactory pObsRow) {
+    return {lengths, N, std::move(pObsRow)};
+}
+
+/**
+ * Emission probabilities for run() of a discrete output model, gathered per time step from the transposed output
+ * probabilities (see output_models::discrete::pObsTable). Before every E-step only the (M, N) table is rebuilt from
+ * the current output probabilities, nothing of size T is written.
+ */
+template<typename dtype, typename State>
+class GatheredPObsTable {
+public:
+    GatheredPObsTable(const dtype* outputProbabilities, const std::vector<const State*> &obsPtrs, std::size_t N,
+                      std::size_t M, bool ignoreOutliers)
+            : B(outputProbabilities), obsPtrs(obsPtrs), N(N), M(M), ignoreOutliers(ignoreOutliers) {}
+
+    void update() {
+        table = output_models::discrete::pObsTable(B, N, M, ignoreOutliers);
+    }
+
+    detail::GatheredPObs<dtype, State> operator()(std::size_t k) const {
+        return {table.data(), obsPtrs[k], N};
+    }
+
+private:
+    const dtype* B;
+    const std::vector<const State*> &obsPtrs;
+    std::size_t N, M;
+    bool ignoreOutliers;
+    std::vector<dtype> table;
+};
+
+/**
+ * Baum-Welch iteration, updating transitionMatrix, initialDistribution and (through updateOutputModel) the output
+ * model in place until the log-likelihood increases by less than options.accuracy or options.maxIterations is reached.
+ * All buffers are allocated once. Before every E-step, pObs.update() brings the emission probabilities up to date with
+ * the current output model and pObs(k) then yields those of trajectory k, see MaterializedPObs and GatheredPObsTable.
+ * emission accumulates nStats output model statistics (see forwardBackwardBatchImpl) from which
+ * updateOutputModel(stats) performs the output model update. progress(iteration, logLikelihood) is called after every
+ * iteration. The state probabilities of the last E-step are written to gammaPtrs, its transition and initial counts
+ * to counts and initialCounts. Returns the log-likelihood history.
+ */
+template<typename dtype, typename PObs, typename Emission, typename OutputUpdate, typename Progress>
+std::vector<dtype> run(dtype* const transitionMatrix, dtype* const initialDistribution, std::size_t N,
+                       const std::vector<std::size_t> &lengths, const std::vector<dtype*> &gammaPtrs,
+                       const Options<dtype> &options, PObs &&pObs, std::size_t nStats, Emission &&emission,
+                       OutputUpdate &&updateOutputModel, Progress &&progress, dtype* const counts,
+                       dtype* const initialCounts) {
+    const auto nTrajectories = lengths.size();
+
+    BatchArrays<dtype> batch;
+    batch.nStates = N;
+    batch.lengths = lengths;
+    batch.gammaPtrs = gammaPtrs;
+
+    std::vector<dtype> logprobs(nTrajectories), stats(nStats), likelihoods;
+    std::vector<bool> nonzeros(N * N);
+    auto nonzeroPattern = [transitionMatrix, N](std::vector<bool> &pattern) {
+        for (std::size_t ij = 0; ij < N * N; ++ij) {
+            pattern[ij] = transitionMatrix[ij] != 0;
+        }
+    };
+    nonzeroPattern(nonzeros);
+    auto nonzerosNew = nonzeros;
+
+    bool converged = false;
+    while (!converged && likelihoods.size() < options.maxIterations) {
+        // E-step
+        pObs.update();
+        forwardBackwardBatchImpl(static_cast<const dtype*>(transitionMatrix),
+                                 static_cast<const dtype*>(initialDistribution), batch, pObs, options.parallelInTime,
+                                 logprobs.data(), counts, initialCounts, nStats, stats.data(), emission);
+        auto logLikelihood = std::accumulate(logprobs.begin(), logprobs.end(), static_cast<dtype>(0));
+        if (!std::isfinite(logLikelihood)) {
+            throw std::runtime_error("Log-likelihood is not finite in iteration " +
+                                     std::to_string(likelihoods.size()) + ".");
+        }
+        if (!likelihoods.empty() && logLikelihood - likelihoods.back() < options.accuracy) {
+            converged = true;
+        }
+
+        // M-step
+        estimateTransitionMatrix(static_cast<const dtype*>(counts), transitionMatrix, N, options.reversible,
+                                 options.fixedStationaryDistribution, options.maxIterationsReversible);
+        if (options.stationary) {
+            if (options.fixedStationaryDistribution == nullptr) {
+                stationaryDistribution(static_cast<const dtype*>(transitionMatrix), static_cast<const dtype*>(counts),
+                                       initialDistribution, N);
+            } else {
+                std::copy(options.fixedStationaryDistribution, options.fixedStationaryDistribution + N,
+                          initialDistribution);
+            }
+        } else {
+            if (options.fixedInitialDistribution == nullptr) {
+                auto sum = std::accumulate(initialCounts, initialCounts + N, static_cast<dtype>(0));
+                std::transform(initialCounts, initialCounts + N, initialDistribution,
+                               [sum](dtype v) { return v / sum; });
+            } else {
+                std::copy(options.fixedInitialDistribution, options.fixedInitialDistribution + N,
+                          initialDistribution);
+            }
+        }
+        updateOutputModel(static_cast<const dtype*>(stats.data()));
+
+        // a change in connectivity makes the likelihood discontinuous, it then cannot be used for convergence
+        nonzeroPattern(nonzerosNew);
+        if (nonzerosNew != nonzeros) {
+            converged = false;
+            std::swap(nonzeros, nonzerosNew);
+        }
+
+        likelihoods.push_back(logLikelihood);
+        progress(likelihoods.size(), logLikelihood);
+    }
+    return likelihoods;
+}
+
+namespace bindings {
+
+template<typename dtype>
+const dtype* optionalArray(const py::object &obj, np_array<dtype> &storage, std::size_t N, const std::string &name) {
+    if (obj.is_none()) {
+        return nullptr;
+    }
+    storage = py::cast<np_array<dtype>>(obj);
+    if (storage.ndim() != 1 || static_cast<std::size_t>(storage.shape(0)) != N) {
+        throw std::invalid_argument(name + " must have length N = " + std::to_string(N) + ".");
+    }
+    return storage.data();
+}
+
+/**
+ * Validated copies of transition matrix and initial distribution, the options, and the gamma output arrays of a
+ * native Baum-Welch run.
+ */
+template<typename dtype>
+struct Arguments {
+    std::size_t nStates;
+    np_array<dtype> transitionMatrix;
+    np_array<dtype> initialDistribution;
+    np_array<dtype> fixedStationaryDistribution;
+    np_array<dtype> fixedInitialDistribution;
+    std::vector<np_array_nfc<dtype>> gammas;
+    std::vector<dtype*> gammaPtrs;
+    Options<dtype> options;
+};
+
+template<typename dtype>
+Arguments<dtype> arguments(const np_array<dtype> &transitionMatrix, const np_array<dtype> &initialDistribution,
+                           const std::vector<std::size_t> &lengths, const py::list &gammasOut, bool reversible,
+                           bool stationary, const py::object &fixedStationaryDistribution,
+                           const py::object &fixedInitialDistribution, dtype accuracy, std::size_t maxIterations,
+                           std::size_t maxIterationsReversible, bool parallelInTime) {
+    if (transitionMatrix.ndim() != 2 || transitionMatrix.shape(0) != transitionMatrix.shape(1)) {
+        throw std::invalid_argument("Transition matrix must be a square matrix.");
+    }
+    Arguments<dtype> args;
+    const auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
+    args.nStates = N;
+    if (initialDistribution.ndim() != 1 || static_cast<std::size_t>(initialDistribution.shape(0)) != N) {
+        throw std::invalid_argument("Initial distribution must have length N = " + std::to_string(N) + ".");
+    }
+    args.transitionMatrix = np_array<dtype>(std::vector<std::size_t>{N, N});
+    std::copy(transitionMatrix.data(), transitionMatrix.data() + N * N, args.transitionMatrix.mutable_data());
+    args.initialDistribution = np_array<dtype>(std::vector<std::size_t>{N});
+    std::copy(initialDistribution.data(), initialDistribution.data() + N, args.initialDistribution.mutable_data());
+
+    if (gammasOut.size() != lengths.size()) {
+        throw std::invalid_argument("There must be exactly one gamma output array per observation trajectory.");
+    }
+    for (std::size_t k = 0; k < lengths.size(); ++k) {
+        if (!py::isinstance<np_array_nfc<dtype>>(gammasOut[k])) {
+            throw std::invalid_argument("Gamma output array " + std::to_string(k) + " must be C-contiguous and "
+                                        "of the same dtype as the transition matrix.");
+        }
+        args.gammas.push_back(py::cast<np_array_nfc<dtype>>(gammasOut[k]));
+        const auto &gamma = args.gammas.back();
+        if (gamma.ndim() != 2 || static_cast<std::size_t>(gamma.shape(0)) != lengths[k] ||
+            static_cast<std::size_t>(gamma.shape(1)) != N) {
+            throw std::invalid_argument("Gamma output array " + std::to_string(k) + " must be of shape (T, N) "
+                                        "with T the length of its observation trajectory.");
+        }
+        args.gammaPtrs.push_back(args.gammas.back().mutable_data());
+    }
+
+    args.options.reversible = reversible;
+    args.options.stationary = stationary;
+    args.options.fixedStationaryDistribution = optionalArray(fixedStationaryDistribution,
+                                                             args.fixedStationaryDistribution, N,
+                                                             "Fixed stationary distribution");
+    args.options.fixedInitialDistribution = optionalArray(fixedInitialDistribution, args.fixedInitialDistribution, N,
+                                                          "Fixed initial distribution");
+    args.options.accuracy = accuracy;
+    args.options.maxIterations = maxIterations;
+    args.options.maxIterationsReversible = maxIterationsReversible;
+    args.options.parallelInTime = parallelInTime;
+    return args;
+}
+
+/**
+ * Progress hook calling callback(iteration, log_likelihood) with the GIL held, if callback is not None.
+ */
+template<typename dtype>
+auto progress(const py::object &callback) {
+    return [&callback](std::size_t iteration, dtype logLikelihood) {
+        if (!callback.is_none()) {
+            py::gil_scoped_acquire acquire;
+            callback(iteration, logLikelihood);
+        }
+    };
+}
+
+template<typename dtype>
+np_array<dtype> toArray(const std::vector<dtype> &values) {
+    np_array<dtype> result(std::vector<std::size_t>{values.size()});
+    std::copy(values.begin(), values.end(), result.mutable_data());
+    return result;
+}
+
+template<typename dtype>
+std::size_t checkCountMatrix(const np_array<dtype> &counts) {
+    if (counts.ndim() != 2 || counts.shape(0) != counts.shape(1)) {
+        throw std::invalid_argument("Count matrix must be a square matrix.");
+    }
+    return static_cast<std::size_t>(counts.shape(0));
+}
+
+/**
+ * Transition matrix of the M-step for the (n, n) count matrix, see estimateTransitionMatrix.
+ */
+template<typename dtype>
+np_array<dtype> estimateTransitionMatrix(const np_array<dtype> &counts, bool reversible,
+                                         const py::object &fixedStationaryDistribution,
+                                         std::size_t maxIterationsReversible) {
+    const auto n = checkCountMatrix(counts);
+    np_array<dtype> storage;
+    const auto *mu = optionalArray(fixedStationaryDistribution, storage, n, "Fixed stationary distribution");
+    np_array<dtype> P(std::vector<std::size_t>{n, n});
+    baum_welch::estimateTransitionMatrix(counts.data(), P.mutable_data(), n, reversible, mu, maxIterationsReversible);
+    return P;
+}
+
+/**
+ * Stationary distribution of the M-step for the (n, n) transition matrix and count matrix, see stationaryDistribution.
+ */
+template<typename dtype>
+np_array<dtype> stationaryDistribution(const np_array<dtype> &transitionMatrix, const np_array<dtype> &counts) {
+    const auto n = checkCountMatrix(counts);
+    if (transitionMatrix.ndim() != 2 || static_cast<std::size_t>(transitionMatrix.shape(0)) != n ||
+        static_cast<std::size_t>(transitionMatrix.shape(1)) != n) {
+        throw std::invalid_argument("Transition matrix must be of the same shape as the count matrix.");
+    }
+    np_array<dtype> pi(std::vector<std::size_t>{n});
+    baum_welch::stationaryDistribution(transitionMatrix.data(), counts.data(), pi.mutable_data(), n);
+    return pi;
+}
+
+}
+
+namespace discrete {
+
+/**
+ * Baum-Welch estimation of an HMM with discrete output model. Returns the transition matrix, initial distribution,
+ * output probabilities, log-likelihood history, and the transition and initial counts of the last E-step.
+ */
+template<typename dtype, typename State>
+std::tuple<np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>>
+baumWelch(const np_array<dtype> &transitionMatrix, const np_array<dtype> &initialDistribution,
+          const np_array<dtype> &outputProbabilities, bool ignoreOutliers,
+          const std::vector<np_array_nfc<State>> &observations, const py::list &gammasOut, bool reversible,
+          bool stationary, const py::object &fixedStationaryDistribution, const py::object &fixedInitialDistribution,
+          dtype accuracy, std::size_t maxIterations, std::size_t maxIterationsReversible, bool parallelInTime,
+          const py::object &callback) {
+    std::vector<std::size_t> lengths;
+    for (const auto &obs : observations) {
+        lengths.push_back(static_cast<std::size_t>(obs.ndim() == 1 ? obs.shape(0) : 0));
+    }
+    auto args = bindings::arguments(transitionMatrix, initialDistribution, lengths, gammasOut, reversible, stationary,
+                                    fixedStationaryDistribution, fixedInitialDistribution, accuracy, maxIterations,
+                                    maxIterationsReversible, parallelInTime);
+    const auto N = args.nStates;
+    if (outputProbabilities.ndim() != 2 || static_cast<std::size_t>(outputProbabilities.shape(0)) != N) {
+        throw std::invalid_argument("Output probabilities must be of shape (N, M) with N = " + std::to_string(N) +
+                                    ".");
+    }
+    const auto M = static_cast<std::size_t>(outputProbabilities.shape(1));
+    auto obsPtrs = output_models::discrete::observationPointers(observations, lengths, M);
+
+    np_array<dtype> B (std::vector<std::size_t>{N, M});
+    std::copy(outputProbabilities.data(), outputProbabilities.data() + N * M, B.mutable_data());
+    np_array<dtype> counts (std::vector<std::size_t>{N, N});
+    np_array<dtype> initialCounts (std::vector<std::size_t>{N});
+    auto* P = args.transitionMatrix.mutable_data();
+    auto* pi = args.initialDistribution.mutable_data();
+    auto* BPtr = B.mutable_data();
+    auto* countsPtr = counts.mutable_data();
+    auto* initialCountsPtr = initialCounts.mutable_data();
+
+    std::vector<dtype> likelihoods;
+    {
+        py::gil_scoped_release gil;
+        likelihoods = run(
+                P, pi, N, lengths, args.gammaPtrs, args.options,
+                GatheredPObsTable<dtype, State>(BPtr, obsPtrs, N, M, ignoreOutliers),
+                N * M, output_models::discrete::observationCounts<dtype>(obsPtrs, N, M),
+                [BPtr, N, M](const dtype* stats) {
+                    for (std::size_t i = 0; i < N; ++i) {
+                        const auto rowSum = std::accumulate(stats + i * M, stats + (i + 1) * M,
+                                                            static_cast<dtype>(0));
+                        for (std::size_t o = 0; o < M; ++o) {
+                            BPtr[i * M + o] = stats[i * M + o] / rowSum;
+                        }
+                    }
+                },
+                bindings::progress<dtype>(callback), countsPtr, initialCountsPtr);
+    }
+    return std::make_tuple(args.transitionMatrix, args.initialDistribution, B, bindings::toArray(likelihoods), counts,
+                           initialCounts);
+}
+
+}
+
+namespace gaussian {
+
+/**
+ * Baum-Welch estimation of an HMM with Gaussian output model. Returns the transition matrix, initial distribution,
+ * means, standard deviations, log-likelihood history, and the transition and initial counts of the last E-step.
+ */
+template<typename dtype>
+std::tuple<np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>,
+        np_array<dtype>>
+baumWelch(const np_array<dtype> &transitionMatrix, const np_array<dtype> &initialDistribution,
+          const np_array<dtype> &means, const np_array<dtype> &sigmas, bool ignoreOutliers,
+          const std::vector<np_array<dtype>> &observations, const py::list &gammasOut, bool reversible,
+          bool stationary, const py::object &fixedStationaryDistribution, const py::object &fixedInitialDistribution,
+          dtype accuracy, std::size_t maxIterations, std::size_t maxIterationsReversible, bool parallelInTime,
+          const py::object &callback) {
+    std::vector<std::size_t> lengths;
+    for (const auto &obs : observations) {
+        lengths.push_back(static_cast<std::size_t>(obs.ndim() == 1 ? obs.shape(0) : 0));
+    }
+    auto args = bindings::arguments(transitionMatrix, initialDistribution, lengths, gammasOut, reversible, stationary,
+                                    fixedStationaryDistribution, fixedInitialDistribution, accuracy, maxIterations,
+                                    maxIterationsReversible, parallelInTime);
+    const auto N = args.nStates;
+    if (means.ndim() != 1 || sigmas.ndim() != 1 || static_cast<std::size_t>(means.shape(0)) != N ||
+        static_cast<std::size_t>(sigmas.shape(0)) != N) {
+        throw std::invalid_argument("Means and sigmas must have one entry per hidden state.");
+    }
+    auto obsPtrs = output_models::gaussian::observationPointers(observations, lengths);
+
+    np_array<dtype> mus (std::vector<std::size_t>{N});
+    np_array<dtype> sigmasOut (std::vector<std::size_t>{N});
+    std::copy(means.data(), means.data() + N, mus.mutable_data());
+    std::copy(sigmas.data(), sigmas.data() + N, sigmasOut.mutable_data());
+    np_array<dtype> counts (std::vector<std::size_t>{N, N});
+    np_array<dtype> initialCounts (std::vector<std::size_t>{N});
+    auto* P = args.transitionMatrix.mutable_data();
+    auto* pi = args.initialDistribution.mutable_data();
+    auto* musPtr = mus.mutable_data();
+    auto* sigmasPtr = sigmasOut.mutable_data();
+    auto* countsPtr = counts.mutable_data();
+    auto* initialCountsPtr = initialCounts.mutable_data();
+
+    // moments are accumulated around the means of the current iteration
+    std::vector<dtype> shifts(musPtr, musPtr + N);
+    std::vector<dtype> likelihoods;
+    {
+        py::gil_scoped_release gil;
+        likelihoods = run(
+                P, pi, N, lengths, args.gammaPtrs, args.options,
+                materializedPObs<dtype>(lengths, N, [musPtr, sigmasPtr, &obsPtrs, N, ignoreOutliers](std::size_t k) {
+                    return output_models::gaussian::pObsRowFunction(obsPtrs[k], static_cast<const dtype*>(musPtr),
+                                                                    static_cast<const dtype*>(sigmasPtr), N,
+                                                                    ignoreOutliers);
+                }),
+                3 * N, output_models::gaussian::shiftedMoments(obsPtrs, static_cast<const dtype*>(shifts.data()), N),
+                [musPtr, sigmasPtr, &shifts, N](const dtype* stats) {
+                    for (std::size_t i = 0; i < N; ++i) {
+                        const auto meanShift = stats[N + i] / stats[i];
+                        const auto variance = std::max(stats[2 * N + i] / stats[i] - meanShift * meanShift,
+                                                       static_cast<dtype>(0));
+                        musPtr[i] = shifts[i] + meanShift;
+                        sigmasPtr[i] = std::sqrt(variance);
+                    }
+                    std::copy(musPtr, musPtr + N, shifts.begin());
+                    if (std::any_of(sigmasPtr, sigmasPtr + N, [](dtype sigma) {
+                        return sigma < std::numeric_limits<dtype>::epsilon();
+                    })) {
+                        throw std::runtime_error("at least one sigma is too small to continue.");
+                    }
+                },
+                bindings::progress<dtype>(callback), countsPtr, initialCountsPtr);
+    }
+    return std::make_tuple(args.transitionMatrix, args.initialDistribution, mus, sigmasOut,
+                           bindings::toArray(likelihoods), counts, initialCounts);
+}
+
+}
+
+}
+}
@@ -0,0 +1,470 @@
+//
+// Gibbs sampling of the posterior of HMMs with discrete output model, all stages of a sweep in native code.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "distribution_utils.h"
+#include "sampler.h"
+#include "utils.h"
+#include "OutputModelUtils.h"
+#include "BaumWelch.h"
+
+namespace hmm {
+namespace gibbs {
+
+/**
+ * Raised if the sampled hidden transition counts (plus prior) are not strongly connected in reversible sampling.
+ */
+struct DisconnectedCountMatrix : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Convergence criterion of the reversible maximum likelihood estimate which initializes the transition matrix sampler.
+ */
+static constexpr double transitionMatrixMaxErr = 1e-8;
+
+/**
+ * Maximum number of iterations of the reversible maximum likelihood estimate which initializes the transition matrix
+ * sampler.
+ */
+static constexpr std::size_t transitionMatrixMaxIter = 10000;
+
+template<typename dtype>
+struct Options {
+    bool reversible {true};
+    bool stationary {false};
+    bool ignoreOutliers {true};
+    std::size_t nTransitionMatrixSamplingSteps {1000};
+};
+
+/**
+ * State of the Gibbs sampler of an HMM with discrete output model. One sweep samples the hidden state trajectories
+ * given the parameters by forward filtering, backward sampling (trajectories in parallel), the output probabilities
+ * given hidden and observed trajectories, and the transition matrix and stationary distribution given the hidden
+ * transition counts. Every trajectory draws its random numbers from its own stream of the seed and emission, transition
+ * matrix and initial distribution updates from three further streams, so that the chain does not depend on the number
+ * of threads.
+ */
+template<typename dtype, typename State, typename Generator = deeptime::rnd::Philox4x32>
+class DiscreteSampler {
+public:
+    DiscreteSampler(const dtype* transitionMatrix, const dtype* initialDistribution, const dtype* outputProbabilities,
+                    const dtype* outputPrior, const dtype* transitionMatrixPrior, const dtype* initialPrior,
+                    std::size_t N, std::size_t M, std::vector<const State*> observations,
+                    std::vector<std::size_t> lengths, const Options<dtype> &options, std::uint32_t seed)
+            : N(N), M(M), options(options), observations(std::move(observations)), lengths(std::move(lengths)),
+              P(transitionMatrix, transitionMatrix + N * N), pi(initialDistribution, initialDistribution + N),
+              stationaryDistribution(N), B(outputProbabilities, outputProbabilities + N * M),
+              outputPrior(outputPrior, outputPrior + N * M),
+              transitionMatrixPrior(transitionMatrixPrior, transitionMatrixPrior + N * N),
+              initialPrior(initialPrior, initialPrior + N), counts(N * N), initialCounts(N), histogram(N * M),
+              transitionSampler(deeptime::rnd::seededGenerator<Generator>(seed, nStreams(0))),
+              emissionGenerator(deeptime::rnd::seededGenerator<Generator>(seed, nStreams(1))),
+              initialGenerator(deeptime::rnd::seededGenerator<Generator>(seed, nStreams(2))) {
+        offsets.resize(this->lengths.size() + 1, 0);
+        for (std::size_t k = 0; k < this->lengths.size(); ++k) {
+            offsets[k + 1] = offsets[k] + this->lengths[k];
+            generators.push_back(deeptime::rnd::seededGenerator<Generator>(seed, static_cast<std::uint32_t>(k)));
+        }
+        paths.resize(offsets.back());
+        maxLength = std::accumulate(this->lengths.begin(), this->lengths.end(), static_cast<std::size_t>(0),
+                                    [](auto a, auto b) { return std::max(a, b); });
+    }
+
+    /**
+     * One Gibbs sweep. The output probabilities are renormalized afterwards if normalizeOutput is true.
+     */
+    void sweep(bool normalizeOutput) {
+        sampleHiddenStateTrajectories();
+        countHiddenStateTrajectories();
+        sampleOutputProbabilities();
+        if (normalizeOutput) {
+            for (std::size_t i = 0; i < N; ++i) {
+                auto* row = B.data() + i * M;
+                const auto rowSum = std::accumulate(row, row + M, static_cast<dtype>(0));
+                std::transform(row, row + M, row, [rowSum](dtype p) { return p / rowSum; });
+            }
+        }
+        sampleTransitionMatrix();
+    }
+
+    const std::vector<dtype> &transitionMatrix() const { return P; }
+
+    const std::vector<dtype> &stationary() const { return stationaryDistribution; }
+
+    const std::vector<dtype> &outputProbabilities() const { return B; }
+
+    /**
+     * Hidden transition counts of the last sweep without prior.
+     */
+    const std::vector<dtype> &transitionCounts() const { return counts; }
+
+    /**
+     * Concatenated hidden state trajectories of the last sweep.
+     */
+    const std::vector<std::int32_t> &hiddenStateTrajectories() const { return paths; }
+
+private:
+    std::uint32_t nStreams(std::uint32_t offset) const {
+        return static_cast<std::uint32_t>(lengths.size()) + offset;
+    }
+
+    void sampleHiddenStateTrajectories() {
+        const auto transitionMatrixT = detail::transposed(P.data(), N);
+        const auto nTrajectories = static_cast<std::int64_t>(lengths.size());
+        const auto* PPtr = P.data();
+        const auto* PTPtr = transitionMatrixT.data();
+        const auto* piPtr = pi.data();
+        // emission probabilities are gathered per time step from the transposed output probabilities
+        const auto table = output_models::discrete::pObsTable(B.data(), N, M, options.ignoreOutliers);
+        const auto* tablePtr = table.data();
+        auto* pathsPtr = paths.data();
+        auto* gens = generators.data();
+        const auto* obsPtrs = observations.data();
+        const auto* lengthsPtr = lengths.data();
+        const auto* offsetsPtr = offsets.data();
+        const auto n = N;
+        const auto bufferSize = maxLength * N;
+
+        #pragma omp parallel default(none) firstprivate(nTrajectories, PPtr, PTPtr, piPtr, tablePtr, pathsPtr, gens, \
+                obsPtrs, lengthsPtr, offsetsPtr, n, bufferSize)
+        {
+            std::vector<dtype> alpha(bufferSize);
+            #pragma omp for schedule(dynamic)
+            for (std::int64_t k = 0; k < nTrajectories; ++k) {
+                const auto T = lengthsPtr[k];
+                if (T == 0) {
+                    continue;
+                }
+                const detail::GatheredPObs<dtype, State> pObs {tablePtr, obsPtrs[k], n};
+                detail::dispatchStates(n, [&](auto dim) {
+                    return detail::forward<decltype(dim)::value>(PTPtr, pObs, piPtr, alpha.data(), n, T);
+                });
+                samplePathImpl(alpha.data(), PPtr, n, T, gens[k], pathsPtr + offsetsPtr[k]);
+            }
+        }
+    }
+
+    void countHiddenStateTrajectories() {
+        std::fill(counts.begin(), counts.end(), static_cast<dtype>(0));
+        std::fill(initialCounts.begin(), initialCounts.end(), static_cast<dtype>(0));
+        std::fill(histogram.begin(), histogram.end(), static_cast<dtype>(0));
+        for (std::size_t k = 0; k < lengths.size(); ++k) {
+            const auto* path = paths.data() + offsets[k];
+            const auto* obs = observations[k];
+            if (lengths[k] > 0) {
+                ++initialCounts[path[0]];
+            }
+            for (std::size_t t = 0; t < lengths[k]; ++t) {
+                ++histogram[path[t] * M + obs[t]];
+                if (t + 1 < lengths[k]) {
+                    ++counts[path[t] * N + path[t + 1]];
+                }
+            }
+        }
+    }
+
+    /**
+     * Samples each row of the output probabilities from the Dirichlet posterior of the observation counts plus prior.
+     * Elements without positive posterior weight keep their previous value.
+     */
+    void sampleOutputProbabilities() {
+        deeptime::rnd::dirichlet_distribution<dtype> dirichlet;
+        std::vector<std::size_t> positives;
+        std::vector<dtype> weights;
+        for (std::size_t i = 0; i < N; ++i) {
+            positives.clear();
+            weights.clear();
+            for (std::size_t o = 0; o < M; ++o) {
+                const auto weight = histogram[i * M + o] + outputPrior[i * M + o];
+                if (weight > 0) {
+                    positives.push_back(o);
+                    weights.push_back(weight);
+                }
+            }
+            dirichlet.params(weights.begin(), weights.end());
+            dirichlet(emissionGenerator, weights.data());
+            for (std::size_t a = 0; a < positives.size(); ++a) {
+                B[i * M + positives[a]] = weights[a];
+            }
+        }
+    }
+
+    /**
+     * Samples the transition matrix given the hidden transition counts plus prior, reversible transition matrices by
+     * nTransitionMatrixSamplingSteps Gibbs sweeps starting from the maximum likelihood estimate, and the stationary
+     * distribution, either as stationary vector of the sample or from the Dirichlet posterior of the initial counts.
+     */
+    void sampleTransitionMatrix() {
+        std::vector<dtype> C(N * N);
+        std::transform(counts.begin(), counts.end(), transitionMatrixPrior.begin(), C.begin(), std::plus<>());
+
+        if (N == 1) {
+            P[0] = 1;
+        } else if (options.reversible) {
+            if (baum_welch::connectedSets(C.data(), N, static_cast<dtype>(0), true).size() > 1) {
+                throw DisconnectedCountMatrix("Encountered disconnected count matrix with sampling option "
+                                              "reversible. Use prior to ensure connectivity or use "
+                                              "reversible=False.");
+            }
+            sampleReversibleTransitionMatrix(C);
+        } else {
+            deeptime::rnd::gamma_distribution<dtype> gamma;
+            auto &generator = transitionSampler.rng();
+            for (std::size_t i = 0; i < N; ++i) {
+                auto* row = P.data() + i * N;
+                std::fill(row, row + N, static_cast<dtype>(0));
+                dtype sum = 0;
+                for (std::size_t j = 0; j < N; ++j) {
+                    if (C[i * N + j] > 0) {
+                        gamma.param(typename decltype(gamma)::param_type {C[i * N + j], 1});
+                        row[j] = gamma(generator);
+                        sum += row[j];
+                    }
+                }
+                if (sum > 0) {
+                    std::transform(row, row + N, row, [sum](dtype p) { return p / sum; });
+                }
+            }
+        }
+
+        if (options.stationary) {
+            baum_welch::stationaryDistribution(static_cast<const dtype*>(P.data()),
+                                               static_cast<const dtype*>(C.data()), stationaryDistribution.data(), N);
+        } else {
+            std::vector<std::size_t> positives;
+            std::vector<dtype> weights;
+            for (std::size_t i = 0; i < N; ++i) {
+                const auto weight = initialCounts[i] + initialPrior[i];
+                if (weight > 0) {
+                    positives.push_back(i);
+                    weights.push_back(weight);
+                }
+            }
+            std::fill(stationaryDistribution.begin(), stationaryDistribution.end(), static_cast<dtype>(0));
+            deeptime::rnd::dirichlet_distribution<dtype> dirichlet(weights.begin(), weights.end());
+            dirichlet(initialGenerator, weights.data());
+            for (std::size_t a = 0; a < positives.size(); ++a) {
+                stationaryDistribution[positives[a]] = weights[a];
+            }
+        }
+    }
+
+    void sampleReversibleTransitionMatrix(std::vector<dtype> &C) {
+        std::vector<dtype> CCt(N * N), sumC(N, 0), P0(N * N), mu(N);
+        for (std::size_t i = 0; i < N; ++i) {
+            for (std::size_t j = 0; j < N; ++j) {
+                CCt[i * N + j] = C[i * N + j] + C[j * N + i];
+                sumC[i] += C[i * N + j];
+            }
+        }
+        mle_trev_dense_impl(P0.data(), CCt.data(), sumC.data(), N, static_cast<dtype>(transitionMatrixMaxErr),
+                            transitionMatrixMaxIter, mu.data(), static_cast<dtype>(1e-15),
+                            deeptime::fixed_point::Acceleration::none);
+
+        // keep the sparsity patterns of counts and initial sample consistent if the estimate underflows
+        std::vector<int> I, J;
+        for (std::size_t i = 0; i < N; ++i) {
+            for (std::size_t j = 0; j < N; ++j) {
+                if (P0[i * N + j] + P0[j * N + i] == 0) {
+                    C[i * N + j] = 0;
+                }
+            }
+        }
+        std::fill(sumC.begin(), sumC.end(), static_cast<dtype>(0));
+        std::vector<dtype> X(N * N);
+        for (std::size_t i = 0; i < N; ++i) {
+            for (std::size_t j = 0; j < N; ++j) {
+                sumC[i] += C[i * N + j];
+                X[i * N + j] = mu[i] * P0[i * N + j];
+                if (C[i * N + j] + C[j * N + i] > 0) {
+                    I.push_back(static_cast<int>(i));
+                    J.push_back(static_cast<int>(j));
+                }
+            }
+        }
+        const auto n = static_cast<int>(N);
+        const auto nIndices = static_cast<int>(I.size());
+        std::vector<int> rowIndices(N + 1, 0);
+        RevSampler<dtype, Generator>::generateRowIndices(I.data(), n, nIndices, rowIndices.data());
+        std::vector<dtype> sumX(N);
+        transitionSampler.sweep(C.data(), sumC.data(), X.data(), I.data(), J.data(), rowIndices.data(), n, nIndices,
+                                static_cast<int>(options.nTransitionMatrixSamplingSteps), sumX.data());
+        for (std::size_t i = 0; i < N; ++i) {
+            const auto rowSum = std::accumulate(X.begin() + i * N, X.begin() + (i + 1) * N, static_cast<dtype>(0));
+            std::transform(X.begin() + i * N, X.begin() + (i + 1) * N, P.begin() + i * N,
+                           [rowSum](dtype x) { return x / rowSum; });
+        }
+    }
+
+    /**
+     * Reversible transition matrix sampler with access to its generator, which is shared with the non-reversible
+     * Dirichlet updates.
+     */
+    class TransitionSampler : public RevSampler<dtype, Generator> {
+    public:
+        explicit TransitionSampler(Generator generator) : RevSampler<dtype, Generator>(std::move(generator)) {}
+
+        Generator &rng() {
+            return this->RevSampler<dtype, Generator>::generator;
+        }
+    };
+
+    std::size_t N;
+    std::size_t M;
+    Options<dtype> options;
+    std::vector<const State*> observations;
+    std::vector<std::size_t> lengths;
+    std::vector<std::size_t> offsets;
+    std::size_t maxLength {0};
+
+    std::vector<dtype> P;
+    std::vector<dtype> pi;
+    std::vector<dtype> stationaryDistribution;
+    std::vector<dtype> B;
+    std::vector<dtype> outputPrior;
+    std::vector<dtype> transitionMatrixPrior;
+    std::vector<dtype> initialPrior;
+
+    std::vector<dtype> counts;
+    std::vector<dtype> initialCounts;
+    std::vector<dtype> histogram;
+    std::vector<std::int32_t> paths;
+
+    std::vector<Generator> generators;
+    TransitionSampler transitionSampler;
+    Generator emissionGenerator;
+    Generator initialGenerator;
+};
+
+namespace discrete {
+
+/**
+ * Runs nBurnIn Gibbs sweeps and then records one sample every nThin sweeps into the preallocated outputs, whose first
+ * dimension is the number of samples. The hidden state trajectories of the samples are written to
+ * hiddenStateTrajectoriesOut of shape (n_samples, sum_k T_k) unless it is None. A negative seed draws a random one.
+ */
+template<typename dtype, typename State>
+void sample(const np_array<dtype> &transitionMatrix, const np_array<dtype> &initialDistribution,
+            const np_array<dtype> &outputProbabilities, const np_array<dtype> &outputPrior, bool ignoreOutliers,
+            const std::vector<np_array_nfc<State>> &observations, const np_array<dtype> &transitionMatrixPrior,
+            const np_array<dtype> &initialDistributionPrior, bool reversible, bool stationary,
+            std::size_t nTransitionMatrixSamplingSteps, std::size_t nBurnIn, std::size_t nThin, int seed,
+            np_array_nfc<dtype> &transitionMatricesOut, np_array_nfc<dtype> &stationaryDistributionsOut,
+            np_array_nfc<dtype> &outputProbabilitiesOut, np_array_nfc<dtype> &countsOut,
+            const py::object &hiddenStateTrajectoriesOut) {
+    if (transitionMatrix.ndim() != 2 || transitionMatrix.shape(0) != transitionMatrix.shape(1)) {
+        throw std::invalid_argument("Transition matrix must be a square matrix.");
+    }
+    const auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
+    if (outputProbabilities.ndim() != 2 || static_cast<std::size_t>(outputProbabilities.shape(0)) != N) {
+        throw std::invalid_argument("Output probabilities must be of shape (N, M) with N = " + std::to_string(N) +
+                                    ".");
+    }
+    const auto M = static_cast<std::size_t>(outputProbabilities.shape(1));
+    if (initialDistribution.ndim() != 1 || static_cast<std::size_t>(initialDistribution.shape(0)) != N ||
+        initialDistributionPrior.ndim() != 1 || static_cast<std::size_t>(initialDistributionPrior.shape(0)) != N) {
+        throw std::invalid_argument("Initial distribution and its prior must have length N = " + std::to_string(N) +
+                                    ".");
+    }
+    if (transitionMatrixPrior.ndim() != 2 || static_cast<std::size_t>(transitionMatrixPrior.shape(0)) != N ||
+        static_cast<std::size_t>(transitionMatrixPrior.shape(1)) != N) {
+        throw std::invalid_argument("Transition matrix prior must be of shape (N, N).");
+    }
+    if (outputPrior.ndim() != 2 || static_cast<std::size_t>(outputPrior.shape(0)) != N ||
+        static_cast<std::size_t>(outputPrior.shape(1)) != M) {
+        throw std::invalid_argument("Output probability prior must be of the same shape as the output probabilities.");
+    }
+    if (nThin == 0) {
+        throw std::invalid_argument("Need at least one Gibbs sweep per sample.");
+    }
+
+    std::vector<std::size_t> lengths;
+    for (const auto &obs : observations) {
+        lengths.push_back(static_cast<std::size_t>(obs.ndim() == 1 ? obs.shape(0) : 0));
+    }
+    auto obsPtrs = output_models::discrete::observationPointers(observations, lengths, M);
+    const auto totalLength = std::accumulate(lengths.begin(), lengths.end(), static_cast<std::size_t>(0));
+
+    const auto nSamples = static_cast<std::size_t>(transitionMatricesOut.ndim() == 3 ?
+                                                   transitionMatricesOut.shape(0) : 0);
+    auto checkShape = [nSamples](const np_array_nfc<dtype> &arr, std::vector<std::size_t> shape,
+                                 const std::string &name) {
+        shape.insert(shape.begin(), nSamples);
+        bool valid = arr.ndim() == static_cast<ssize_t>(shape.size());
+        for (std::size_t d = 0; valid && d < shape.size(); ++d) {
+            valid = static_cast<std::size_t>(arr.shape(d)) == shape[d];
+        }
+        if (!valid) {
+            throw std::invalid_argument(name + " output has the wrong shape.");
+        }
+    };
+    checkShape(transitionMatricesOut, {N, N}, "Transition matrices");
+    checkShape(stationaryDistributionsOut, {N}, "Stationary distributions");
+    checkShape(outputProbabilitiesOut, {N, M}, "Output probabilities");
+    checkShape(countsOut, {N, N}, "Counts");
+    std::int32_t* hiddenPtr = nullptr;
+    np_array_nfc<std::int32_t> hidden;
+    if (!hiddenStateTrajectoriesOut.is_none()) {
+        if (!py::isinstance<np_array_nfc<std::int32_t>>(hiddenStateTrajectoriesOut)) {
+            throw std::invalid_argument("Hidden state trajectories output must be a C-contiguous int32 array.");
+        }
+        hidden = py::cast<np_array_nfc<std::int32_t>>(hiddenStateTrajectoriesOut);
+        if (hidden.ndim() != 2 || static_cast<std::size_t>(hidden.shape(0)) != nSamples ||
+            static_cast<std::size_t>(hidden.shape(1)) != totalLength) {
+            throw std::invalid_argument("Hidden state trajectories output must be of shape (n_samples, sum of "
+                                        "trajectory lengths).");
+        }
+        hiddenPtr = hidden.mutable_data();
+    }
+
+    Options<dtype> options;
+    options.reversible = reversible;
+    options.stationary = stationary;
+    options.ignoreOutliers = ignoreOutliers;
+    options.nTransitionMatrixSamplingSteps = nTransitionMatrixSamplingSteps;
+
+    auto* PSamples = transitionMatricesOut.mutable_data();
+    auto* piSamples = stationaryDistributionsOut.mutable_data();
+    auto* BSamples = outputProbabilitiesOut.mutable_data();
+    auto* countSamples = countsOut.mutable_data();
+    {
+        py::gil_scoped_release gil;
+        DiscreteSampler<dtype, State> sampler(
+                transitionMatrix.data(), initialDistribution.data(), outputProbabilities.data(), outputPrior.data(),
+                transitionMatrixPrior.data(), initialDistributionPrior.data(), N, M, obsPtrs, lengths, options,
+                static_cast<std::uint32_t>(seed < 0 ? deeptime::rnd::randomSeed() : static_cast<std::uint64_t>(seed)));
+        for (std::size_t it = 0; it < nBurnIn; ++it) {
+            sampler.sweep(false);
+        }
+        for (std::size_t s = 0; s < nSamples; ++s) {
+            for (std::size_t it = 0; it < nThin; ++it) {
+                sampler.sweep(true);
+            }
+            std::copy(sampler.transitionMatrix().begin(), sampler.transitionMatrix().end(), PSamples + s * N * N);
+            std::copy(sampler.stationary().begin(), sampler.stationary().end(), piSamples + s * N);
+            std::copy(sampler.outputProbabilities().begin(), sampler.outputProbabilities().end(),
+                      BSamples + s * N * M);
+            std::copy(sampler.transitionCounts().begin(), sampler.transitionCounts().end(), countSamples + s * N * N);
+            if (hiddenPtr) {
+                std::copy(sampler.hiddenStateTrajectories().begin(), sampler.hiddenStateTrajectories().end(),
+                          hiddenPtr + s * totalLength);
+            }
+        }
+    }
+}
+
+}
+
+}
+}
@@ -10,6 +10,7 @@
 
 #include "common.h"
 #include "thread_utils.h"
+#include "utils.h"
 
 namespace hmm {
 namespace output_models {
@@ -34,47 +35,243 @@ void handleOutliers(np_array_nfc<dtype> &outputProbabilityTrajectory) {
 }
 
 
+/**
+ * Validates the arguments of a checkpointed forward-backward pass and runs it without the GIL. pObsRow and emission
+ * must not touch Python objects. Returns the log-likelihood, the transition counts and the state probabilities of the
+ * first time step; the full state probability trajectory is only written if gammaOut is a (T, N) array.
+ */
+template<typename dtype, typename PObsRow, typename Emission>
+std::tuple<dtype, np_array<dtype>, np_array<dtype>>
+checkpointedForwardBackward(const np_array<dtype> &transitionMatrix, const np_array<dtype> &pi, std::size_t T,
+                            std::size_t checkpointInterval, const py::object &gammaOut, PObsRow &&pObsRow,
+                            Emission &&emission) {
+    if (transitionMatrix.ndim() != 2 || transitionMatrix.shape(0) != transitionMatrix.shape(1)) {
+        throw std::invalid_argument("Transition matrix must be a square matrix.");
+    }
+    auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
+    if (pi.ndim() != 1 || static_cast<std::size_t>(pi.shape(0)) != N) {
+        throw std::invalid_argument("Initial distribution must have length N = " + std::to_string(N) + ".");
+    }
+    dtype* gammaPtr = nullptr;
+    np_array_nfc<dtype> gamma;
+    if (!gammaOut.is_none()) {
+        if (!py::isinstance<np_array_nfc<dtype>>(gammaOut)) {
+            throw std::invalid_argument("Gamma output array must be C-contiguous and of the same dtype as the "
+                                        "transition matrix.");
+        }
+        gamma = py::cast<np_array_nfc<dtype>>(gammaOut);
+        if (gamma.ndim() != 2 || static_cast<std::size_t>(gamma.shape(0)) != T ||
+            static_cast<std::size_t>(gamma.shape(1)) != N) {
+            throw std::invalid_argument("Gamma output array must be of shape (T, N) = (" + std::to_string(T) + ", " +
+                                        std::to_string(N) + ").");
+        }
+        gammaPtr = gamma.mutable_data();
+    }
+
+    np_array<dtype> counts (std::vector<std::size_t>{N, N});
+    np_array<dtype> gamma0 (std::vector<std::size_t>{N});
+    auto* countsPtr = counts.mutable_data();
+    auto* gamma0Ptr = gamma0.mutable_data();
+    std::fill(countsPtr, countsPtr + N * N, static_cast<dtype>(0));
+    std::fill(gamma0Ptr, gamma0Ptr + N, static_cast<dtype>(0));
+
+    dtype logprob = 0;
+    if (T > 0) {
+        py::gil_scoped_release gil;
+        logprob = forwardBackwardCheckpointedImpl(transitionMatrix.data(), pi.data(), N, T, checkpointInterval,
+                                                  pObsRow, emission, countsPtr, gamma0Ptr, gammaPtr);
+    }
+    return std::make_tuple(logprob, counts, gamma0);
+}
+
+/**
+ * Log-likelihoods of K observation trajectories (of given lengths) under M candidate models as (M, K) array, using
+ * the forward recursion with O(N) memory per trajectory. pObsRow(m, k) returns the function evaluating the emission
+ * probabilities of model m for trajectory k one time step at a time, it is called without the GIL. The M * K
+ * evaluations are distributed over the threads.
+ */
+template<typename dtype, typename PObsRowFactory>
+np_array<dtype> scoreModels(const std::vector<np_array<dtype>> &transitionMatrices,
+                            const std::vector<np_array<dtype>> &initialDistributions,
+                            const std::vector<std::size_t> &lengths, PObsRowFactory &&pObsRow) {
+    auto nModels = transitionMatrices.size();
+    auto nTrajectories = lengths.size();
+    if (initialDistributions.size() != nModels) {
+        throw std::invalid_argument("There must be exactly one initial distribution per transition matrix.");
+    }
+    std::vector<std::size_t> nStates;
+    std::vector<const dtype*> transitionMatrixPtrs, piPtrs;
+    for (std::size_t m = 0; m < nModels; ++m) {
+        const auto &P = transitionMatrices[m];
+        const auto &pi = initialDistributions[m];
+        if (P.ndim() != 2 || P.shape(0) != P.shape(1)) {
+            throw std::invalid_argument("Transition matrix " + std::to_string(m) + " must be a square matrix.");
+        }
+        if (pi.ndim() != 1 || pi.shape(0) != P.shape(0)) {
+            throw std::invalid_argument("Initial distribution " + std::to_string(m) + " must have one entry per "
+                                        "hidden state.");
+        }
+        nStates.push_back(static_cast<std::size_t>(P.shape(0)));
+        transitionMatrixPtrs.push_back(P.data());
+        piPtrs.push_back(pi.data());
+    }
+
+    np_array<dtype> result (std::vector<std::size_t>{nModels, nTrajectories});
+    auto* resultPtr = result.mutable_data();
+    {
+        py::gil_scoped_release gil;
+
+        std::vector<std::vector<dtype>> transposedMatrices;
+        for (std::size_t m = 0; m < nModels; ++m) {
+            transposedMatrices.push_back(detail::transposed(transitionMatrixPtrs[m], nStates[m]));
+        }
+
+        auto nTasks = static_cast<std::int64_t>(nModels * nTrajectories);
+        #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nTasks, nTrajectories, resultPtr) \
+                shared(transposedMatrices, piPtrs, nStates, lengths, pObsRow)
+        for (std::int64_t task = 0; task < nTasks; ++task) {
+            auto m = static_cast<std::size_t>(task) / nTrajectories;
+            auto k = static_cast<std::size_t>(task) % nTrajectories;
+            resultPtr[task] = forwardLogprobImpl(transposedMatrices[m].data(), piPtrs[m], nStates[m], lengths[k],
+                                                 pObsRow(m, k));
+        }
+    }
+    return result;
+}
+
+/**
+ * Batched forward-backward pass (see forwardBackwardBatchImpl) which accumulates the sufficient statistics of an
+ * output model, an array of shape statsShape, in the same pass over the state probabilities. The emission
+ * probabilities of trajectory k are given by pObsRows(k). Returns the logprobs, transition counts, initial counts and
+ * the statistics.
+ */
+template<typename dtype, typename PObsRows, typename Emission>
+std::tuple<np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>>
+forwardBackwardBatchWithStatistics(const np_array<dtype> &transitionMatrix, const np_array<dtype> &pi,
+                                   const BatchArrays<dtype> &batch, PObsRows &&pObsRows, bool parallelInTime,
+                                   const std::vector<std::size_t> &statsShape, Emission &&emission) {
+    auto N = batch.nStates;
+    np_array<dtype> logprobs (std::vector<std::size_t>{batch.lengths.size()});
+    np_array<dtype> counts (std::vector<std::size_t>{N, N});
+    np_array<dtype> initialCounts (std::vector<std::size_t>{N});
+    np_array<dtype> stats (statsShape);
+    auto* logprobsPtr = logprobs.mutable_data();
+    auto* countsPtr = counts.mutable_data();
+    auto* initialCountsPtr = initialCounts.mutable_data();
+    auto* statsPtr = stats.mutable_data();
+    auto nStats = static_cast<std::size_t>(stats.size());
+    {
+        py::gil_scoped_release gil;
+        forwardBackwardBatchImpl(transitionMatrix.data(), pi.data(), batch, pObsRows, parallelInTime, logprobsPtr,
+                                 countsPtr, initialCountsPtr, nStats, statsPtr, emission);
+    }
+    return std::make_tuple(logprobs, counts, initialCounts, stats);
+}
+
+/**
+ * Batched forward-backward pass with statistics over the materialized state probability trajectories of batch, see
+ * above.
+ */
+template<typename dtype, typename Emission>
+std::tuple<np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>>
+forwardBackwardBatchWithStatistics(const np_array<dtype> &transitionMatrix, const np_array<dtype> &pi,
+                                   const BatchArrays<dtype> &batch, bool parallelInTime,
+                                   const std::vector<std::size_t> &statsShape, Emission &&emission) {
+    const auto &pObsPtrs = batch.pObsPtrs;
+    const auto N = batch.nStates;
+    return forwardBackwardBatchWithStatistics(transitionMatrix, pi, batch, [&pObsPtrs, N](std::size_t k) {
+        return detail::DensePObs<dtype>{pObsPtrs[k], N};
+    }, parallelInTime, statsShape, std::forward<Emission>(emission));
+}
+
+/**
+ * Stream of a seed reserved for generating observations, stream 0 being used for simulating the hidden states.
+ */
+static constexpr std::uint32_t observationStream = 1;
+
+/**
+ * Observations are drawn in chunks of this many time steps, chunk c from substream c of the observation stream. The
+ * chunks are distributed over the threads, but the random numbers of a time step only depend on the seed.
+ */
+static constexpr std::size_t observationChunkSize = 4096;
+
+/**
+ * Calls generateChunk(generator, begin, end) without the GIL for the chunks [begin, end) of nTimesteps time steps,
+ * each with the generator of its substream, see observationChunkSize. A negative seed draws a random seed.
+ * generateChunk must not throw.
+ */
+template<typename GenerateChunk>
+void generateInChunks(std::size_t nTimesteps, std::int64_t seed, GenerateChunk &&generateChunk) {
+    const auto streamSeed = seed < 0 ? deeptime::rnd::randomSeed() : static_cast<std::uint64_t>(seed);
+    const auto nChunks = (nTimesteps + observationChunkSize - 1) / observationChunkSize;
+    const auto nThreads = std::min(static_cast<std::size_t>(std::max(1u, std::thread::hardware_concurrency())),
+                                   nChunks);
+
+    py::gil_scoped_release gil;
+    std::vector<deeptime::thread::scoped_thread> threads;
+    threads.reserve(nThreads);
+    for (std::size_t thread = 0; thread < nThreads; ++thread) {
+        threads.emplace_back([&generateChunk, nTimesteps, nChunks, nThreads, thread, streamSeed] {
+            for (auto chunk = thread; chunk < nChunks; chunk += nThreads) {
+                auto generator = deeptime::rnd::seededGenerator(streamSeed, observationStream,
+                                                                static_cast<std::uint32_t>(chunk));
+                auto begin = chunk * observationChunkSize;
+                generateChunk(generator, begin, std::min(begin + observationChunkSize, nTimesteps));
+            }
+        });
+    }
+}
+
+/**
+ * Throws if the hidden state trajectory leaves [0, nStates).
+ */
+template<typename State>
+void checkHiddenStates(const State* const hiddenStates, std::size_t nTimesteps, std::size_t nStates) {
+    for (std::size_t t = 0; t < nTimesteps; ++t) {
+        if (!(hiddenStates[t] >= 0) || static_cast<std::size_t>(hiddenStates[t]) >= nStates) {
+            throw std::invalid_argument("Hidden state trajectory contains states outside of [0, " +
+                                        std::to_string(nStates) + ").");
+        }
+    }
+}
+
 namespace discrete {
 
+/**
+ * Draws one observation per time step of the hidden state trajectory. Each hidden state gets an alias table of its
+ * output probabilities, built once, so that every observation is drawn in constant time.
+ */
 template<typename dtype, typename State>
 np_array<std::int64_t> generateObservationTrajectory(const np_array_nfc<State> &hiddenStateTrajectory,
-                                                     const np_array_nfc<dtype> &outputProbabilities) {
+                                                     const np_array_nfc<dtype> &outputProbabilities,
+                                                     std::int64_t seed) {
     if (hiddenStateTrajectory.ndim() != 1) {
         throw std::invalid_argument("generate observation trajectory needs 1-dimensional hidden state trajectory");
     }
-    auto nTimesteps = hiddenStateTrajectory.shape(0);
-    auto nObs = outputProbabilities.shape(1);
+    if (outputProbabilities.ndim() != 2) {
+        throw std::invalid_argument("Output probabilities must be a matrix of shape (N, M).");
+    }
+    const auto nTimesteps = static_cast<std::size_t>(hiddenStateTrajectory.shape(0));
+    const auto nStates = static_cast<std::size_t>(outputProbabilities.shape(0));
+    const auto nObs = static_cast<std::size_t>(outputProbabilities.shape(1));
+    const auto* hiddenStates = hiddenStateTrajectory.data();
+    checkHiddenStates(hiddenStates, nTimesteps, nStates);
 
-    np_array<std::int64_t> output({nTimesteps});
-    auto outputPtr = output.mutable_data();
+    std::vector<deeptime::rnd::alias_distribution<std::int64_t>> distributions;
+    distributions.reserve(nStates);
+    const auto* outputProbabilitiesBuf = outputProbabilities.data();
+    for (std::size_t i = 0; i < nStates; ++i) {
+        distributions.emplace_back(outputProbabilitiesBuf + i * nObs, outputProbabilitiesBuf + (i + 1) * nObs);
+    }
 
-    {
-        auto nThreads = std::thread::hardware_concurrency();
-        std::vector<deeptime::thread::scoped_thread> threads;
-        threads.reserve(nThreads);
-        auto grainSize = std::max(static_cast<pybind11::ssize_t>(1), nTimesteps / nThreads);
-
-        const auto* hiddenStateTrajectoryBuf = hiddenStateTrajectory.data();
-        const auto* outputProbabilitiesBuf = outputProbabilities.data();
-
-        for(pybind11::ssize_t nextIndex = 0; nextIndex < nTimesteps; nextIndex += grainSize) {
-            auto beginIndex = nextIndex;
-            auto endIndex = std::min(nextIndex+grainSize, nTimesteps);
-            threads.emplace_back([hiddenStateTrajectoryBuf, outputProbabilitiesBuf,
-                                  beginIndex, endIndex, outputPtr, nObs]{
-                auto generator = deeptime::rnd::randomlySeededGenerator();
-                std::discrete_distribution<> ddist;
-                for(pybind11::ssize_t t = beginIndex; t < endIndex; ++t) {
-                    auto state = hiddenStateTrajectoryBuf[t];
-                    auto begin = outputProbabilitiesBuf + state * nObs;  // outputProbabilities.at(state, 0)
-                    auto end = outputProbabilitiesBuf + (state+1) * nObs;  // outputProbabilities.at(state+1, 0)
-                    ddist.param(decltype(ddist)::param_type(begin, end));
-                    auto obs = ddist(generator);
-                    *(outputPtr + t) = obs;
-                }
-            });
+    np_array<std::int64_t> output (std::vector<std::size_t>{nTimesteps});
+    auto* outputPtr = output.mutable_data();
+    generateInChunks(nTimesteps, seed, [hiddenStates, outputPtr, &distributions](auto &generator, std::size_t begin,
+                                                                                 std::size_t end) {
+        for (auto t = begin; t < end; ++t) {
+            outputPtr[t] = distributions[static_cast<std::size_t>(hiddenStates[t])](generator);
         }
-    }
+    });
     return output;
 }
 
@@ -103,6 +300,208 @@ np_array<dtype> toOutputProbabilityTrajectory(const np_array_nfc<State> &observa
     return output;
 }
 
+/**
+ * Transposes the (N, M) output probabilities P into an (M, N) table whose row o holds the emission probabilities
+ * P[:, o] of symbol o. Rows that vanish are replaced by ones if outliers are ignored, as handleOutliers does for a
+ * state probability trajectory. The emission probabilities of a time step are then one contiguous row of the table,
+ * see detail::GatheredPObs.
+ */
+template<typename dtype>
+std::vector<dtype> pObsTable(const dtype* const P, std::size_t N, std::size_t M, bool ignoreOutliers) {
+    std::vector<dtype> table(M * N);
+    for (std::size_t i = 0; i < N; ++i) {
+        for (std::size_t o = 0; o < M; ++o) {
+            table[o * N + i] = P[i * M + o];
+        }
+    }
+    if (ignoreOutliers) {
+        for (std::size_t o = 0; o < M; ++o) {
+            auto* row = table.data() + o * N;
+            if (std::all_of(row, row + N, [](dtype p) { return p == 0; })) {
+                std::fill(row, row + N, static_cast<dtype>(1));
+            }
+        }
+    }
+    return table;
+}
+
+/**
+ * Returns a function writing the emission probabilities of time step t, i.e., row obs[t] of a table as computed by
+ * pObsTable.
+ */
+template<typename dtype, typename State>
+auto pObsRowFunction(const dtype* const table, const State* const obs, std::size_t N) {
+    return [table, obs, N](std::size_t t, dtype* out) {
+        const auto* row = table + static_cast<std::size_t>(obs[t]) * N;
+        std::copy(row, row + N, out);
+    };
+}
+
+/**
+ * Log-likelihoods of K observation trajectories under M candidate models with discrete output models, see
+ * scoreModels. Returns an (M, K) array.
+ */
+template<typename dtype, typename State>
+np_array<dtype> logLikelihoods(const std::vector<np_array<dtype>> &transitionMatrices,
+                               const std::vector<np_array<dtype>> &initialDistributions,
+                               const std::vector<np_array<dtype>> &outputProbabilities,
+                               const std::vector<bool> &ignoreOutliers,
+                               const std::vector<np_array_nfc<State>> &observations) {
+    auto nModels = transitionMatrices.size();
+    if (outputProbabilities.size() != nModels || ignoreOutliers.size() != nModels) {
+        throw std::invalid_argument("There must be exactly one output probability matrix and ignore outliers flag "
+                                    "per transition matrix.");
+    }
+    std::vector<const State*> obsPtrs;
+    std::vector<std::size_t> lengths;
+    State maxObs = 0;
+    for (const auto &obs : observations) {
+        if (obs.ndim() != 1) {
+            throw std::invalid_argument("observations trajectory needs to be one-dimensional.");
+        }
+        obsPtrs.push_back(obs.data());
+        lengths.push_back(static_cast<std::size_t>(obs.shape(0)));
+        if (std::any_of(obs.data(), obs.data() + obs.shape(0), [](State o) { return o < 0; })) {
+            throw std::invalid_argument("Observations must be non-negative.");
+        }
+        if (obs.shape(0) > 0) {
+            maxObs = std::max(maxObs, *std::max_element(obs.data(), obs.data() + obs.shape(0)));
+        }
+    }
+    std::vector<std::vector<dtype>> tables;
+    for (std::size_t m = 0; m < nModels; ++m) {
+        const auto &B = outputProbabilities[m];
+        if (B.ndim() != 2 || transitionMatrices[m].ndim() != 2 || B.shape(0) != transitionMatrices[m].shape(0)) {
+            throw std::invalid_argument("Output probabilities of model " + std::to_string(m) + " must be of shape "
+                                        "(N, M) with N the number of hidden states.");
+        }
+        if (static_cast<std::size_t>(maxObs) >= static_cast<std::size_t>(B.shape(1)) && !observations.empty()) {
+            throw std::invalid_argument("Observations exceed the number of observable states of model " +
+                                        std::to_string(m) + ".");
+        }
+        tables.push_back(pObsTable(B.data(), static_cast<std::size_t>(B.shape(0)),
+                                   static_cast<std::size_t>(B.shape(1)), static_cast<bool>(ignoreOutliers[m])));
+    }
+
+    return scoreModels(transitionMatrices, initialDistributions, lengths, [&](std::size_t m, std::size_t k) {
+        return pObsRowFunction(static_cast<const dtype*>(tables[m].data()), obsPtrs[k],
+                               static_cast<std::size_t>(outputProbabilities[m].shape(0)));
+    });
+}
+
+/**
+ * Checks that there is one one-dimensional observation trajectory of length lengths[k] per trajectory k with
+ * observations in [0, nObservableStates) and returns pointers to their data.
+ */
+template<typename State>
+std::vector<const State*> observationPointers(const std::vector<np_array_nfc<State>> &observations,
+                                              const std::vector<std::size_t> &lengths, std::size_t nObservableStates) {
+    if (observations.size() != lengths.size()) {
+        throw std::invalid_argument("There must be exactly one observation trajectory per state probability "
+                                    "trajectory.");
+    }
+    std::vector<const State*> obsPtrs;
+    for (std::size_t k = 0; k < observations.size(); ++k) {
+        const auto &obs = observations[k];
+        if (obs.ndim() != 1 || static_cast<std::size_t>(obs.shape(0)) != lengths[k]) {
+            throw std::invalid_argument("Observation trajectory " + std::to_string(k) + " must be one-dimensional "
+                                        "and as long as its state probability trajectory.");
+        }
+        if (std::any_of(obs.data(), obs.data() + obs.shape(0), [nObservableStates](State o) {
+            return o < 0 || static_cast<std::size_t>(o) >= nObservableStates;
+        })) {
+            throw std::invalid_argument("Observations must be in the range [0, M) with M = " +
+                                        std::to_string(nObservableStates) + ".");
+        }
+        obsPtrs.push_back(obs.data());
+    }
+    return obsPtrs;
+}
+
+/**
+ * Emission (see forwardBackwardBatchImpl) accumulating the (N, M) expected observation counts, i.e., the sufficient
+ * statistics of the discrete output model.
+ */
+template<typename dtype, typename State>
+auto observationCounts(const std::vector<const State*> &obsPtrs, std::size_t N, std::size_t M) {
+    return [&obsPtrs, N, M](std::size_t k, std::size_t t, const dtype* gamma, dtype* stats) {
+        const auto o = obsPtrs[k][t];
+        for (std::size_t i = 0; i < N; ++i) {
+            stats[i * M + o] += gamma[i];
+        }
+    };
+}
+
+/**
+ * Batched forward-backward pass which accumulates the (N, M) expected observation counts, i.e., the sufficient
+ * statistics of the discrete output model, while computing the state probabilities. The emission probabilities are
+ * gathered from the output probabilities per time step (see pObsTable), no (T, N) state probability trajectories are
+ * materialized. gammasOut may be None. Returns the logprobs, transition counts, initial counts and observation counts.
+ */
+template<typename dtype, typename State>
+std::tuple<np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>>
+forwardBackwardBatch(const np_array<dtype> &transitionMatrix, const np_array<dtype> &outputProbabilities,
+                     const np_array<dtype> &pi, const std::vector<np_array_nfc<State>> &observations,
+                     bool ignoreOutliers, const py::object &gammasOut, bool parallelInTime) {
+    std::vector<std::size_t> lengths;
+    for (const auto &obs : observations) {
+        lengths.push_back(static_cast<std::size_t>(obs.ndim() == 1 ? obs.shape(0) : 0));
+    }
+    auto batch = batchArrays(transitionMatrix, lengths, pi, gammasOut);
+    auto N = batch.nStates;
+    if (outputProbabilities.ndim() != 2 || static_cast<std::size_t>(outputProbabilities.shape(0)) != N) {
+        throw std::invalid_argument("Output probabilities must be of shape (N, M) with N = " + std::to_string(N) +
+                                    ".");
+    }
+    auto M = static_cast<std::size_t>(outputProbabilities.shape(1));
+    auto obsPtrs = observationPointers(observations, lengths, M);
+    const auto table = pObsTable(outputProbabilities.data(), N, M, ignoreOutliers);
+    const auto* tablePtr = table.data();
+    return forwardBackwardBatchWithStatistics(transitionMatrix, pi, batch, [tablePtr, &obsPtrs, N](std::size_t k) {
+        return detail::GatheredPObs<dtype, State>{tablePtr, obsPtrs[k], N};
+    }, parallelInTime, {N, M}, observationCounts<dtype>(obsPtrs, N, M));
+}
+
+/**
+ * Checkpointed forward-backward pass which gathers the emission probabilities of each time step from the output
+ * probabilities instead of a precomputed (T, N) state probability trajectory. Returns the log-likelihood, transition
+ * counts, state probabilities of the first time step and the (N, M) expected observation counts.
+ */
+template<typename dtype, typename State>
+std::tuple<dtype, np_array<dtype>, np_array<dtype>, np_array<dtype>>
+forwardBackwardCheckpointed(const np_array<dtype> &transitionMatrix, const np_array<dtype> &outputProbabilities,
+                            const np_array<dtype> &pi, const np_array_nfc<State> &observations, bool ignoreOutliers,
+                            std::size_t checkpointInterval, const py::object &gammaOut) {
+    if (observations.ndim() != 1) {
+        throw std::invalid_argument("observations trajectory needs to be one-dimensional.");
+    }
+    if (outputProbabilities.ndim() != 2 || outputProbabilities.shape(0) != transitionMatrix.shape(0)) {
+        throw std::invalid_argument("Output probabilities must be of shape (N, M) with N the number of hidden states.");
+    }
+    auto N = static_cast<std::size_t>(outputProbabilities.shape(0));
+    auto M = static_cast<std::size_t>(outputProbabilities.shape(1));
+    auto T = static_cast<std::size_t>(observations.shape(0));
+    const auto* obs = observations.data();
+    if (std::any_of(obs, obs + T, [M](State o) { return o < 0 || static_cast<std::size_t>(o) >= M; })) {
+        throw std::invalid_argument("Observations must be in the range [0, M) with M = " + std::to_string(M) + ".");
+    }
+    const auto table = pObsTable(outputProbabilities.data(), N, M, ignoreOutliers);
+
+    np_array<dtype> stats (std::vector<std::size_t>{N, M});
+    auto* statsPtr = stats.mutable_data();
+    std::fill(statsPtr, statsPtr + N * M, static_cast<dtype>(0));
+
+    auto pObsRow = pObsRowFunction(table.data(), obs, N);
+    auto emission = [statsPtr, obs, N, M](std::size_t t, const dtype* gamma) {
+        for (std::size_t i = 0; i < N; ++i) {
+            statsPtr[i * M + obs[t]] += gamma[i];
+        }
+    };
+    auto [logprob, counts, gamma0] = checkpointedForwardBackward(transitionMatrix, pi, T, checkpointInterval,
+                                                                 gammaOut, pObsRow, emission);
+    return std::make_tuple(logprob, counts, gamma0, stats);
+}
+
 template<typename dtype, typename State>
 void sample(const std::vector<np_array_nfc<State>> &observationsPerState, np_array_nfc<dtype> &outputProbabilities,
             const np_array_nfc<dtype> &prior) {
@@ -163,10 +562,10 @@ void sample(const std::vector<np_array_nfc<State>> &observationsPerState, np_arr
         }
 
         dirichlet.params(reducedHist.begin(), reducedHist.end());
-        auto probs = dirichlet(generator);
+        dirichlet(generator, reducedHist.data());
 
-        for (std::size_t i = 0; i < probs.size(); ++i) {
-            outputProbabilities.mutable_at(currentState, positivesMapping[i]) = probs[i];
+        for (std::size_t i = 0; i < reducedHist.size(); ++i) {
+            outputProbabilities.mutable_at(currentState, positivesMapping[i]) = reducedHist[i];
         }
 
         ++currentState;
@@ -261,25 +660,197 @@ np_array<dtype> toOutputProbabilityTrajectory(const np_array_nfc<dtype> &obs, co
     return p;
 }
 
+/**
+ * Draws one observation per time step of the hidden state trajectory from the ziggurat normal distribution, see
+ * generateInChunks.
+ */
 template<typename dtype>
 np_array<dtype>
 generateObservationTrajectory(const np_array_nfc<dtype> &hiddenStateTrajectory, const np_array_nfc<dtype> &means,
-                              const np_array_nfc<dtype> &sigmas) {
+                              const np_array_nfc<dtype> &sigmas, std::int64_t seed) {
     if (hiddenStateTrajectory.ndim() != 1) {
         throw std::invalid_argument("Hidden state trajectory must be one-dimensional!");
     }
-    auto nTimesteps = hiddenStateTrajectory.shape(0);
-    np_array<dtype> output({nTimesteps});
-    auto ptr = output.mutable_data();
-
-    std::normal_distribution<dtype> dist{0, 1};
-    for (decltype(nTimesteps) t = 0; t < nTimesteps; ++t) {
-        auto state = hiddenStateTrajectory.at(t);
-        *(ptr + t) = sigmas.at(state) * dist(deeptime::rnd::staticThreadLocalGenerator()) + means.at(state);
+    if (means.ndim() != 1 || sigmas.ndim() != 1 || means.shape(0) != sigmas.shape(0)) {
+        throw std::invalid_argument("Means and sigmas must be one-dimensional and of the same length.");
     }
+    const auto nTimesteps = static_cast<std::size_t>(hiddenStateTrajectory.shape(0));
+    const auto* hiddenStates = hiddenStateTrajectory.data();
+    checkHiddenStates(hiddenStates, nTimesteps, static_cast<std::size_t>(means.shape(0)));
+
+    np_array<dtype> output (std::vector<std::size_t>{nTimesteps});
+    auto* outputPtr = output.mutable_data();
+    const auto* mus = means.data();
+    const auto* sigmasPtr = sigmas.data();
+    generateInChunks(nTimesteps, seed, [hiddenStates, mus, sigmasPtr, outputPtr](auto &generator, std::size_t begin,
+                                                                                 std::size_t end) {
+        deeptime::rnd::normal_distribution<dtype> dist{0, 1};
+        for (auto t = begin; t < end; ++t) {
+            auto state = static_cast<std::size_t>(hiddenStates[t]);
+            outputPtr[t] = sigmasPtr[state] * dist(generator) + mus[state];
+        }
+    });
     return output;
 }
 
+/**
+ * Returns a function writing the Gaussian densities of observation obs[t] for all states, replaced by ones if they
+ * all vanish and outliers are ignored.
+ */
+template<typename dtype>
+auto pObsRowFunction(const dtype* const obs, const dtype* const mus, const dtype* const sigmas, std::size_t N,
+                     bool ignoreOutliers) {
+    return [obs, mus, sigmas, N, ignoreOutliers](std::size_t t, dtype* out) {
+        dtype rowSum = 0;
+        for (std::size_t i = 0; i < N; ++i) {
+            out[i] = sample(obs[t], mus[i], sigmas[i]);
+            rowSum += out[i];
+        }
+        if (ignoreOutliers && rowSum == 0) {
+            std::fill(out, out + N, static_cast<dtype>(1));
+        }
+    };
+}
+
+/**
+ * Log-likelihoods of K observation trajectories under M candidate models with Gaussian output models, see
+ * scoreModels. Returns an (M, K) array.
+ */
+template<typename dtype>
+np_array<dtype> logLikelihoods(const std::vector<np_array<dtype>> &transitionMatrices,
+                               const std::vector<np_array<dtype>> &initialDistributions,
+                               const std::vector<np_array<dtype>> &means, const std::vector<np_array<dtype>> &sigmas,
+                               const std::vector<bool> &ignoreOutliers,
+                               const std::vector<np_array<dtype>> &observations) {
+    auto nModels = transitionMatrices.size();
+    if (means.size() != nModels || sigmas.size() != nModels || ignoreOutliers.size() != nModels) {
+        throw std::invalid_argument("There must be exactly one set of means, sigmas and ignore outliers flag per "
+                                    "transition matrix.");
+    }
+    for (std::size_t m = 0; m < nModels; ++m) {
+        if (transitionMatrices[m].ndim() != 2 || means[m].ndim() != 1 || sigmas[m].ndim() != 1 ||
+            means[m].shape(0) != transitionMatrices[m].shape(0) || sigmas[m].shape(0) != means[m].shape(0)) {
+            throw std::invalid_argument("Means and sigmas of model " + std::to_string(m) + " must have one entry "
+                                        "per hidden state.");
+        }
+    }
+    std::vector<std::size_t> lengths;
+    for (const auto &obs : observations) {
+        if (obs.ndim() != 1) {
+            throw std::invalid_argument("observations trajectory needs to be one-dimensional.");
+        }
+        lengths.push_back(static_cast<std::size_t>(obs.shape(0)));
+    }
+
+    return scoreModels(transitionMatrices, initialDistributions, lengths, [&](std::size_t m, std::size_t k) {
+        return pObsRowFunction(observations[k].data(), means[m].data(), sigmas[m].data(),
+                               static_cast<std::size_t>(means[m].shape(0)), static_cast<bool>(ignoreOutliers[m]));
+    });
+}
+
+/**
+ * Checks that there is one one-dimensional observation trajectory of length lengths[k] per trajectory k and returns
+ * pointers to their data.
+ */
+template<typename dtype>
+std::vector<const dtype*> observationPointers(const std::vector<np_array<dtype>> &observations,
+                                              const std::vector<std::size_t> &lengths) {
+    if (observations.size() != lengths.size()) {
+        throw std::invalid_argument("There must be exactly one observation trajectory per state probability "
+                                    "trajectory.");
+    }
+    std::vector<const dtype*> obsPtrs;
+    for (std::size_t k = 0; k < observations.size(); ++k) {
+        const auto &obs = observations[k];
+        if (obs.ndim() != 1 || static_cast<std::size_t>(obs.shape(0)) != lengths[k]) {
+            throw std::invalid_argument("Observation trajectory " + std::to_string(k) + " must be one-dimensional "
+                                        "and as long as its state probability trajectory.");
+        }
+        obsPtrs.push_back(obs.data());
+    }
+    return obsPtrs;
+}
+
+/**
+ * Emission (see forwardBackwardBatchImpl) accumulating the (3, N) weighted moments of the observations around shifts,
+ * i.e., (sum_t w_t, sum_t w_t (o_t - c), sum_t w_t (o_t - c)^2) for each state.
+ */
+template<typename dtype>
+auto shiftedMoments(const std::vector<const dtype*> &obsPtrs, const dtype* const shifts, std::size_t N) {
+    return [&obsPtrs, shifts, N](std::size_t k, std::size_t t, const dtype* gamma, dtype* stats) {
+        const auto o = obsPtrs[k][t];
+        for (std::size_t i = 0; i < N; ++i) {
+            const auto d = o - shifts[i];
+            stats[i] += gamma[i];
+            stats[N + i] += gamma[i] * d;
+            stats[2 * N + i] += gamma[i] * d * d;
+        }
+    };
+}
+
+/**
+ * Batched forward-backward pass which accumulates the weighted moments of the observations around given shifts
+ * (e.g. the current means), i.e., (sum_t w_t, sum_t w_t (o_t - c), sum_t w_t (o_t - c)^2) for each state, while
+ * computing the state probabilities. Shifting the moments avoids cancellation when computing variances from them.
+ * gammasOut may be None. Returns the logprobs, transition counts, initial counts and (3, N) moments.
+ */
+template<typename dtype>
+std::tuple<np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>>
+forwardBackwardBatch(const np_array<dtype> &transitionMatrix, const py::list &pObsList, const np_array<dtype> &pi,
+                     const std::vector<np_array<dtype>> &observations, const np_array<dtype> &shifts,
+                     const py::object &gammasOut, bool parallelInTime) {
+    auto batch = batchArrays(transitionMatrix, pObsList, pi, gammasOut);
+    auto N = batch.nStates;
+    if (shifts.ndim() != 1 || static_cast<std::size_t>(shifts.shape(0)) != N) {
+        throw std::invalid_argument("There must be exactly one shift per hidden state.");
+    }
+    auto obsPtrs = observationPointers(observations, batch.lengths);
+    return forwardBackwardBatchWithStatistics(transitionMatrix, pi, batch, parallelInTime, {3, N},
+                                              shiftedMoments(obsPtrs, shifts.data(), N));
+}
+
+/**
+ * Checkpointed forward-backward pass which evaluates the Gaussian densities of each time step on the fly instead of
+ * reading a precomputed (T, N) state probability trajectory. Returns the log-likelihood, transition counts, state
+ * probabilities of the first time step and the (3, N) weighted moments (sum_t w_t, sum_t w_t o_t, sum_t w_t o_t^2).
+ */
+template<typename dtype>
+std::tuple<dtype, np_array<dtype>, np_array<dtype>, np_array<dtype>>
+forwardBackwardCheckpointed(const np_array<dtype> &transitionMatrix, const np_array<dtype> &means,
+                            const np_array<dtype> &sigmas, const np_array<dtype> &pi,
+                            const np_array_nfc<dtype> &observations, bool ignoreOutliers,
+                            std::size_t checkpointInterval, const py::object &gammaOut) {
+    if (observations.ndim() != 1) {
+        throw std::invalid_argument("observations trajectory needs to be one-dimensional.");
+    }
+    auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
+    if (means.ndim() != 1 || sigmas.ndim() != 1 || static_cast<std::size_t>(means.shape(0)) != N ||
+        static_cast<std::size_t>(sigmas.shape(0)) != N) {
+        throw std::invalid_argument("Means and sigmas must be of length N = " + std::to_string(N) + ".");
+    }
+    auto T = static_cast<std::size_t>(observations.shape(0));
+    const auto* obs = observations.data();
+    const auto* mus = means.data();
+    const auto* sigmasPtr = sigmas.data();
+
+    np_array<dtype> stats (std::vector<std::size_t>{3, N});
+    auto* statsPtr = stats.mutable_data();
+    std::fill(statsPtr, statsPtr + 3 * N, static_cast<dtype>(0));
+
+    auto pObsRow = pObsRowFunction(obs, mus, sigmasPtr, N, ignoreOutliers);
+    auto emission = [statsPtr, obs, N](std::size_t t, const dtype* gamma) {
+        const auto o = obs[t];
+        for (std::size_t i = 0; i < N; ++i) {
+            statsPtr[i] += gamma[i];
+            statsPtr[N + i] += gamma[i] * o;
+            statsPtr[2 * N + i] += gamma[i] * o * o;
+        }
+    };
+    auto [logprob, counts, gamma0] = checkpointedForwardBackward(transitionMatrix, pi, T, checkpointInterval,
+                                                                 gammaOut, pObsRow, emission);
+    return std::make_tuple(logprob, counts, gamma0, stats);
+}
+
 template<typename dtype>
 std::tuple<np_array<dtype>, np_array<dtype>> fit(std::size_t nHiddenStates, const py::list &observations,
                                                  const py::list &weights) {
@@ -357,5 +928,611 @@ std::tuple<np_array<dtype>, np_array<dtype>> fit(std::size_t nHiddenStates, cons
 
 }
 
+namespace multivariate_gaussian {
+
+/**
+ * Cached factors of N Gaussians in D dimensions. For full covariances Sigma_i = L_i L_i^T, factors holds the inverse
+ * Cholesky factors W_i = L_i^{-1} as row-major (D, D) blocks with zero strictly upper triangle, for diagonal
+ * covariances the (N, D) inverse standard deviations. The log-density of state i is
+ * logNormalizers[i] - ||W_i (x - mu_i)||^2 / 2.
+ */
+template<typename dtype>
+struct Precisions {
+    std::size_t nStates {0};
+    std::size_t dim {0};
+    bool diagonal {false};
+    std::vector<dtype> means;
+    std::vector<dtype> factors;
+    std::vector<dtype> logNormalizers;
+};
+
+/**
+ * Number of consecutive observations whose log-densities are evaluated together, so that the factor of each state is
+ * read from cache for the whole block.
+ */
+static constexpr std::size_t timeBlockSize = 64;
+
+/**
+ * Lower triangular Cholesky factor of a symmetric (D, D) matrix in double precision, only its lower triangle is read.
+ */
+template<typename dtype>
+std::vector<double> cholesky(const dtype* const A, std::size_t D, std::size_t state) {
+    std::vector<double> L(D * D, 0);
+    for (std::size_t j = 0; j < D; ++j) {
+        double diag = A[j * D + j];
+        for (std::size_t k = 0; k < j; ++k) {
+            diag -= L[j * D + k] * L[j * D + k];
+        }
+        if (!(diag > 0)) {
+            throw std::invalid_argument("Covariance matrix of state " + std::to_string(state) + " is not positive "
+                                        "definite.");
+        }
+        L[j * D + j] = std::sqrt(diag);
+        for (std::size_t i = j + 1; i < D; ++i) {
+            double sum = A[i * D + j];
+            for (std::size_t k = 0; k < j; ++k) {
+                sum -= L[i * D + k] * L[j * D + k];
+            }
+            L[i * D + j] = sum / L[j * D + j];
+        }
+    }
+    return L;
+}
+
+/**
+ * Inverse of a lower triangular (D, D) matrix by forward substitution, column by column.
+ */
+inline std::vector<double> inverseLowerTriangular(const std::vector<double> &L, std::size_t D) {
+    std::vector<double> W(D * D, 0);
+    for (std::size_t j = 0; j < D; ++j) {
+        W[j * D + j] = 1 / L[j * D + j];
+        for (std::size_t i = j + 1; i < D; ++i) {
+            double sum = 0;
+            for (std::size_t k = j; k < i; ++k) {
+                sum += L[i * D + k] * W[k * D + j];
+            }
+            W[i * D + j] = -sum / L[i * D + i];
+        }
+    }
+    return W;
+}
+
+/**
+ * Validates (N, D) means and (N, D, D) covariances, or (N, D) variances for diagonal covariances, and caches their
+ * factors. Throws if a covariance is not positive definite.
+ */
+template<typename dtype>
+Precisions<dtype> precisions(const np_array<dtype> &means, const np_array<dtype> &covariances) {
+    if (means.ndim() != 2) {
+        throw std::invalid_argument("Means must be of shape (N, D).");
+    }
+    Precisions<dtype> result;
+    const auto N = static_cast<std::size_t>(means.shape(0));
+    const auto D = static_cast<std::size_t>(means.shape(1));
+    result.nStates = N;
+    result.dim = D;
+    result.diagonal = covariances.ndim() == 2;
+    if (result.diagonal) {
+        if (static_cast<std::size_t>(covariances.shape(0)) != N || static_cast<std::size_t>(covariances.shape(1)) != D) {
+            throw std::invalid_argument("Diagonal covariances must be of shape (N, D) = (" + std::to_string(N) + ", " +
+                                        std::to_string(D) + ").");
+        }
+    } else if (covariances.ndim() != 3 || static_cast<std::size_t>(covariances.shape(0)) != N ||
+               static_cast<std::size_t>(covariances.shape(1)) != D ||
+               static_cast<std::size_t>(covariances.shape(2)) != D) {
+        throw std::invalid_argument("Covariances must be of shape (N, D, D) = (" + std::to_string(N) + ", " +
+                                    std::to_string(D) + ", " + std::to_string(D) + ") or, if diagonal, (N, D).");
+    }
+    const auto* mus = means.data();
+    const auto* cov = covariances.data();
+    const auto logTwoPi = std::log(2 * gaussian::pi<double>());
+    result.means.assign(mus, mus + N * D);
+    result.factors.resize(result.diagonal ? N * D : N * D * D);
+    result.logNormalizers.resize(N);
+    for (std::size_t i = 0; i < N; ++i) {
+        double halfLogDet = 0;
+        if (result.diagonal) {
+            for (std::size_t d = 0; d < D; ++d) {
+                double variance = cov[i * D + d];
+                if (!(variance > 0)) {
+                    throw std::invalid_argument("Variances of state " + std::to_string(i) + " must be positive.");
+                }
+                halfLogDet += std::log(variance) / 2;
+                result.factors[i * D + d] = static_cast<dtype>(1 / std::sqrt(variance));
+            }
+        } else {
+            auto L = cholesky(cov + i * D * D, D, i);
+            auto W = inverseLowerTriangular(L, D);
+            for (std::size_t d = 0; d < D; ++d) {
+                halfLogDet += std::log(L[d * D + d]);
+            }
+            std::transform(W.begin(), W.end(), result.factors.begin() + i * D * D,
+                           [](double w) { return static_cast<dtype>(w); });
+        }
+        result.logNormalizers[i] = static_cast<dtype>(-0.5 * static_cast<double>(D) * logTwoPi - halfLogDet);
+    }
+    return result;
+}
+
+/**
+ * ||W z||^2 for a lower triangular (D, D) factor W with zero strictly upper triangle. As in detail::matVec, blocks of
+ * four rows share every load of z; each block reads the columns up to its last diagonal element only.
+ */
+template<typename dtype>
+dtype squaredNorm(const dtype* const W, const dtype* const z, std::size_t D) {
+    dtype result = 0;
+    std::size_t r = 0;
+    for (; r + 4 <= D; r += 4) {
+        const auto* w0 = W + r * D;
+        const auto* w1 = w0 + D;
+        const auto* w2 = w1 + D;
+        const auto* w3 = w2 + D;
+        dtype s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        #pragma omp simd reduction(+:s0, s1, s2, s3)
+        for (std::size_t j = 0; j < r + 4; ++j) {
+            s0 += w0[j] * z[j];
+            s1 += w1[j] * z[j];
+            s2 += w2[j] * z[j];
+            s3 += w3[j] * z[j];
+        }
+        result += s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+    }
+    for (; r < D; ++r) {
+        const auto* w = W + r * D;
+        dtype sum = 0;
+        #pragma omp simd reduction(+:sum)
+        for (std::size_t j = 0; j <= r; ++j) {
+            sum += w[j] * z[j];
+        }
+        result += sum * sum;
+    }
+    return result;
+}
+
+/**
+ * Writes the (t1 - t0, N) log-densities of the observations [t0, t1) of a row-major (T, D) trajectory to out. The
+ * states form the outer loop, so that each factor is reused for the whole block of observations. diff is a buffer of
+ * length D.
+ */
+template<typename dtype>
+void logDensityBlock(const Precisions<dtype> &precisions, const dtype* const obs, std::size_t t0, std::size_t t1,
+                     dtype* const out, dtype* const diff) {
+    const auto N = precisions.nStates;
+    const auto D = precisions.dim;
+    for (std::size_t i = 0; i < N; ++i) {
+        const auto* mu = precisions.means.data() + i * D;
+        const auto logNormalizer = precisions.logNormalizers[i];
+        if (precisions.diagonal) {
+            const auto* w = precisions.factors.data() + i * D;
+            for (auto t = t0; t < t1; ++t) {
+                const auto* x = obs + t * D;
+                dtype distance = 0;
+                #pragma omp simd reduction(+:distance)
+                for (std::size_t d = 0; d < D; ++d) {
+                    const auto z = w[d] * (x[d] - mu[d]);
+                    distance += z * z;
+                }
+                out[(t - t0) * N + i] = logNormalizer - distance / 2;
+            }
+        } else {
+            const auto* W = precisions.factors.data() + i * D * D;
+            for (auto t = t0; t < t1; ++t) {
+                const auto* x = obs + t * D;
+                for (std::size_t d = 0; d < D; ++d) {
+                    diff[d] = x[d] - mu[d];
+                }
+                out[(t - t0) * N + i] = logNormalizer - squaredNorm(W, diff, D) / 2;
+            }
+        }
+    }
+}
+
+/**
+ * Turns a row of log-densities into densities scaled by exp(-shift) with shift the largest log-density, which is
+ * returned. Densities scaled like this do not underflow however far an observation is from the means, so that only
+ * non-finite observations are outliers; their rows are set to ones if outliers are ignored and to zeros otherwise.
+ */
+template<typename dtype>
+dtype exponentiateRow(dtype* const row, std::size_t N, bool ignoreOutliers) {
+    const auto shift = *std::max_element(row, row + N);
+    if (!std::isfinite(shift)) {
+        std::fill(row, row + N, static_cast<dtype>(ignoreOutliers ? 1 : 0));
+        return 0;
+    }
+    for (std::size_t i = 0; i < N; ++i) {
+        row[i] = std::exp(row[i] - shift);
+    }
+    return shift;
+}
+
+/**
+ * Checks that the observation trajectories are of shape (T_k, D), writes their lengths and returns pointers to their
+ * data.
+ */
+template<typename dtype>
+std::vector<const dtype*> observationPointers(const std::vector<np_array<dtype>> &observations, std::size_t D,
+                                              std::vector<std::size_t> &lengths) {
+    std::vector<const dtype*> obsPtrs;
+    lengths.clear();
+    for (std::size_t k = 0; k < observations.size(); ++k) {
+        const auto &obs = observations[k];
+        if (obs.ndim() != 2 || static_cast<std::size_t>(obs.shape(1)) != D) {
+            throw std::invalid_argument("Observation trajectory " + std::to_string(k) + " must be of shape (T, D) "
+                                        "with D = " + std::to_string(D) + ".");
+        }
+        lengths.push_back(static_cast<std::size_t>(obs.shape(0)));
+        obsPtrs.push_back(obs.data());
+    }
+    return obsPtrs;
+}
+
+/**
+ * (T, N) log-densities of the observations of a (T, D) trajectory under each state, distributed over the threads in
+ * blocks of time steps.
+ */
+template<typename dtype>
+np_array<dtype> logOutputProbabilityTrajectory(const np_array<dtype> &observations, const np_array<dtype> &means,
+                                               const np_array<dtype> &covariances) {
+    const auto prec = precisions(means, covariances);
+    const auto N = prec.nStates;
+    const auto D = prec.dim;
+    std::vector<std::size_t> lengths;
+    const auto* obs = observationPointers(std::vector<np_array<dtype>>{observations}, D, lengths).front();
+    const auto T = lengths.front();
+
+    np_array<dtype> result (std::vector<std::size_t>{T, N});
+    auto* resultPtr = result.mutable_data();
+    {
+        py::gil_scoped_release gil;
+        const auto blockSize = timeBlockSize;
+        const auto nBlocks = static_cast<std::int64_t>((T + blockSize - 1) / blockSize);
+        #pragma omp parallel default(none) firstprivate(nBlocks, blockSize, T, N, D, obs, resultPtr) shared(prec)
+        {
+            std::vector<dtype> diff(D);
+            #pragma omp for
+            for (std::int64_t b = 0; b < nBlocks; ++b) {
+                const auto t0 = static_cast<std::size_t>(b) * blockSize;
+                logDensityBlock(prec, obs, t0, std::min(T, t0 + blockSize), resultPtr + t0 * N, diff.data());
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * Evaluates the (T_k, N) output probabilities of all trajectories in log-space, blocks of time steps distributed over
+ * the threads, and scales each time step as in exponentiateRow. Returns the sum of the shifts of each trajectory,
+ * which is to be added to its log-likelihood.
+ */
+template<typename dtype>
+std::vector<dtype> scaledOutputProbabilities(const Precisions<dtype> &precisions,
+                                             const std::vector<const dtype*> &obsPtrs,
+                                             const std::vector<std::size_t> &lengths, bool ignoreOutliers,
+                                             std::vector<std::vector<dtype>> &pObs) {
+    const auto N = precisions.nStates;
+    const auto D = precisions.dim;
+    const auto blockSize = timeBlockSize;
+    std::vector<std::size_t> blockTrajectories, blockStarts;
+    pObs.resize(lengths.size());
+    for (std::size_t k = 0; k < lengths.size(); ++k) {
+        pObs[k].resize(lengths[k] * N);
+        for (std::size_t t0 = 0; t0 < lengths[k]; t0 += blockSize) {
+            blockTrajectories.push_back(k);
+            blockStarts.push_back(t0);
+        }
+    }
+    const auto nBlocks = static_cast<std::int64_t>(blockStarts.size());
+    std::vector<dtype> blockShifts(nBlocks, 0);
+
+    #pragma omp parallel default(none) firstprivate(nBlocks, blockSize, N, D, ignoreOutliers) \
+            shared(precisions, obsPtrs, lengths, pObs, blockTrajectories, blockStarts, blockShifts)
+    {
+        std::vector<dtype> diff(D);
+        #pragma omp for
+        for (std::int64_t b = 0; b < nBlocks; ++b) {
+            const auto k = blockTrajectories[b];
+            const auto t0 = blockStarts[b];
+            const auto t1 = std::min(lengths[k], t0 + blockSize);
+            auto* out = pObs[k].data() + t0 * N;
+            logDensityBlock(precisions, obsPtrs[k], t0, t1, out, diff.data());
+            dtype shift = 0;
+            for (auto t = t0; t < t1; ++t) {
+                shift += exponentiateRow(out + (t - t0) * N, N, ignoreOutliers);
+            }
+            blockShifts[b] = shift;
+        }
+    }
+
+    std::vector<dtype> logShifts(lengths.size(), 0);
+    for (std::int64_t b = 0; b < nBlocks; ++b) {
+        logShifts[blockTrajectories[b]] += blockShifts[b];
+    }
+    return logShifts;
+}
+
+/**
+ * Number of weighted moments per state: the weight, D first moments and D * D second moments, or D for diagonal
+ * covariances.
+ */
+inline std::size_t statisticsSize(std::size_t D, bool diagonal) {
+    return 1 + D + (diagonal ? D : D * D);
+}
+
+/**
+ * Adds the moments of observation x with weights w_i around the means mu_i to the (N, S) statistics: w_i,
+ * w_i (x - mu_i) and the lower triangle of w_i (x - mu_i)(x - mu_i)^T, or its diagonal for diagonal covariances.
+ */
+template<typename dtype>
+void accumulateMoments(const dtype* const x, const dtype* const weights, const dtype* const mus, std::size_t N,
+                       std::size_t D, bool diagonal, dtype* const stats) {
+    const auto S = statisticsSize(D, diagonal);
+    for (std::size_t i = 0; i < N; ++i) {
+        const auto w = weights[i];
+        const auto* mu = mus + i * D;
+        auto* firstMoments = stats + i * S + 1;
+        auto* secondMoments = firstMoments + D;
+        stats[i * S] += w;
+        for (std::size_t r = 0; r < D; ++r) {
+            const auto weightedDiff = w * (x[r] - mu[r]);
+            firstMoments[r] += weightedDiff;
+            if (diagonal) {
+                secondMoments[r] += weightedDiff * (x[r] - mu[r]);
+            } else {
+                auto* row = secondMoments + r * D;
+                #pragma omp simd
+                for (std::size_t c = 0; c <= r; ++c) {
+                    row[c] += weightedDiff * (x[c] - mu[c]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Completes the upper triangles of the second moments accumulated by accumulateMoments.
+ */
+template<typename dtype>
+void symmetrize(dtype* const stats, std::size_t N, std::size_t D, bool diagonal) {
+    if (diagonal) {
+        return;
+    }
+    const auto S = statisticsSize(D, diagonal);
+    for (std::size_t i = 0; i < N; ++i) {
+        auto* secondMoments = stats + i * S + 1 + D;
+        for (std::size_t r = 0; r < D; ++r) {
+            for (std::size_t c = 0; c < r; ++c) {
+                secondMoments[c * D + r] = secondMoments[r * D + c];
+            }
+        }
+    }
+}
+
+/**
+ * Batched forward-backward pass on output probabilities from the log-space kernels (see scaledOutputProbabilities)
+ * which accumulates the weighted moments of the observations around the current means, see accumulateMoments.
+ * gammasOut may be None. Returns the logprobs, transition counts, initial counts and (N, S) moments.
+ */
+template<typename dtype>
+std::tuple<np_array<dtype>, np_array<dtype>, np_array<dtype>, np_array<dtype>>
+forwardBackwardBatch(const np_array<dtype> &transitionMatrix, const np_array<dtype> &means,
+                     const np_array<dtype> &covariances, const np_array<dtype> &pi,
+                     const std::vector<np_array<dtype>> &observations, bool ignoreOutliers,
+                     const py::object &gammasOut, bool parallelInTime) {
+    const auto prec = precisions(means, covariances);
+    const auto N = prec.nStates;
+    const auto D = prec.dim;
+    const auto diagonal = prec.diagonal;
+    std::vector<std::size_t> lengths;
+    auto obsPtrs = observationPointers(observations, D, lengths);
+    auto batch = batchArrays(transitionMatrix, lengths, pi, gammasOut);
+    if (batch.nStates != N) {
+        throw std::invalid_argument("There must be exactly one mean and covariance per hidden state.");
+    }
+
+    std::vector<std::vector<dtype>> pObs;
+    std::vector<dtype> logShifts;
+    {
+        py::gil_scoped_release gil;
+        logShifts = scaledOutputProbabilities(prec, obsPtrs, lengths, ignoreOutliers, pObs);
+    }
+    const auto* mus = prec.means.data();
+    auto result = forwardBackwardBatchWithStatistics(
+            transitionMatrix, pi, batch, [&pObs, N](std::size_t k) { return detail::DensePObs<dtype>{pObs[k].data(), N}; },
+            parallelInTime, {N, statisticsSize(D, diagonal)},
+            [&obsPtrs, mus, N, D, diagonal](std::size_t k, std::size_t t, const dtype* gamma, dtype* stats) {
+                accumulateMoments(obsPtrs[k] + t * D, gamma, mus, N, D, diagonal, stats);
+            });
+    auto* logprobs = std::get<0>(result).mutable_data();
+    for (std::size_t k = 0; k < lengths.size(); ++k) {
+        logprobs[k] += logShifts[k];
+    }
+    symmetrize(std::get<3>(result).mutable_data(), N, D, diagonal);
+    return result;
+}
+
+/**
+ * (N, S) weighted moments of the observations around the given means, see accumulateMoments. The time steps of all
+ * trajectories are split into a fixed number of contiguous chunks which are reduced in order, so that the moments do
+ * not depend on the number of threads.
+ */
+template<typename dtype>
+np_array<dtype> weightedMoments(const std::vector<np_array<dtype>> &observations,
+                                const std::vector<np_array<dtype>> &weights, const np_array<dtype> &means,
+                                bool diagonal) {
+    if (means.ndim() != 2) {
+        throw std::invalid_argument("Means must be of shape (N, D).");
+    }
+    const auto N = static_cast<std::size_t>(means.shape(0));
+    const auto D = static_cast<std::size_t>(means.shape(1));
+    std::vector<std::size_t> lengths;
+    auto obsPtrs = observationPointers(observations, D, lengths);
+    if (weights.size() != observations.size()) {
+        throw std::invalid_argument("number of observation trajectories must match number of weight matrices");
+    }
+    std::vector<const dtype*> weightPtrs;
+    std::vector<std::size_t> offsets {0};
+    for (std::size_t k = 0; k < weights.size(); ++k) {
+        if (weights[k].ndim() != 2 || static_cast<std::size_t>(weights[k].shape(0)) != lengths[k] ||
+            static_cast<std::size_t>(weights[k].shape(1)) != N) {
+            throw std::invalid_argument("Weights " + std::to_string(k) + " must be of shape (T, N) with T the length "
+                                        "of its trajectory and N = " + std::to_string(N) + ".");
+        }
+        weightPtrs.push_back(weights[k].data());
+        offsets.push_back(offsets.back() + lengths[k]);
+    }
+    const auto S = statisticsSize(D, diagonal);
+    np_array<dtype> result (std::vector<std::size_t>{N, S});
+    auto* resultPtr = result.mutable_data();
+    std::fill(resultPtr, resultPtr + N * S, static_cast<dtype>(0));
+    {
+        py::gil_scoped_release gil;
+        const auto* mus = means.data();
+        const auto totalLength = offsets.back();
+        const auto nChunks = static_cast<std::int64_t>(std::min(totalLength, detail::maxBatchBlocks));
+        std::vector<dtype> chunkStats(nChunks * N * S, 0);
+        auto* chunkStatsPtr = chunkStats.data();
+        #pragma omp parallel for default(none) firstprivate(nChunks, totalLength, N, D, S, diagonal, mus, \
+                chunkStatsPtr) shared(offsets, obsPtrs, weightPtrs)
+        for (std::int64_t c = 0; c < nChunks; ++c) {
+            const auto begin = static_cast<std::size_t>(c) * totalLength / nChunks;
+            const auto end = static_cast<std::size_t>(c + 1) * totalLength / nChunks;
+            // trajectory containing the first time step of this chunk
+            auto k = static_cast<std::size_t>(std::upper_bound(offsets.begin(), offsets.end(), begin) -
+                                              offsets.begin()) - 1;
+            for (auto g = begin; g < end; ++g) {
+                while (g >= offsets[k + 1]) {
+                    ++k;
+                }
+                const auto t = g - offsets[k];
+                accumulateMoments(obsPtrs[k] + t * D, weightPtrs[k] + t * N, mus, N, D, diagonal,
+                                  chunkStatsPtr + c * N * S);
+            }
+        }
+        for (std::size_t i = 0; i < chunkStats.size(); ++i) {
+            resultPtr[i % (N * S)] += chunkStats[i];
+        }
+    }
+    symmetrize(resultPtr, N, D, diagonal);
+    return result;
+}
+
+/**
+ * Log-likelihoods of K observation trajectories under M candidate models with multivariate Gaussian output models,
+ * see scoreModels. The output probabilities are scaled as in exponentiateRow one time step at a time and the shifts
+ * are added to the log-likelihoods. Returns an (M, K) array.
+ */
+template<typename dtype>
+np_array<dtype> logLikelihoods(const std::vector<np_array<dtype>> &transitionMatrices,
+                               const std::vector<np_array<dtype>> &initialDistributions,
+                               const std::vector<np_array<dtype>> &means,
+                               const std::vector<np_array<dtype>> &covariances,
+                               const std::vector<bool> &ignoreOutliers,
+                               const std::vector<np_array<dtype>> &observations) {
+    const auto nModels = transitionMatrices.size();
+    const auto nTrajectories = observations.size();
+    if (means.size() != nModels || covariances.size() != nModels || ignoreOutliers.size() != nModels) {
+        throw std::invalid_argument("There must be exactly one set of means, covariances and ignore outliers flag "
+                                    "per transition matrix.");
+    }
+    std::vector<Precisions<dtype>> precisionsList;
+    std::vector<char> ignoreOutliersList;
+    std::vector<std::size_t> lengths;
+    std::vector<const dtype*> obsPtrs;
+    for (std::size_t m = 0; m < nModels; ++m) {
+        precisionsList.push_back(precisions(means[m], covariances[m]));
+        if (transitionMatrices[m].ndim() != 2 ||
+            static_cast<std::size_t>(transitionMatrices[m].shape(0)) != precisionsList.back().nStates) {
+            throw std::invalid_argument("Means and covariances of model " + std::to_string(m) + " must have one "
+                                        "entry per hidden state.");
+        }
+        obsPtrs = observationPointers(observations, precisionsList.back().dim, lengths);
+        ignoreOutliersList.push_back(static_cast<char>(ignoreOutliers[m]));
+    }
+    if (nModels == 0) {
+        for (const auto &obs : observations) {
+            lengths.push_back(static_cast<std::size_t>(obs.shape(0)));
+        }
+    }
+
+    std::vector<dtype> logShifts(nModels * nTrajectories, 0);
+    auto result = scoreModels(transitionMatrices, initialDistributions, lengths, [&](std::size_t m, std::size_t k) {
+        const auto &prec = precisionsList[m];
+        return [&prec, x = obsPtrs[k], shift = logShifts.data() + m * nTrajectories + k,
+                ignore = static_cast<bool>(ignoreOutliersList[m]),
+                diff = std::vector<dtype>(prec.dim)](std::size_t t, dtype* out) mutable {
+            logDensityBlock(prec, x, t, t + 1, out, diff.data());
+            *shift += exponentiateRow(out, prec.nStates, ignore);
+        };
+    });
+    auto* resultPtr = result.mutable_data();
+    for (std::size_t i = 0; i < logShifts.size(); ++i) {
+        resultPtr[i] += logShifts[i];
+    }
+    return result;
+}
+
+/**
+ * Draws one observation per time step of the hidden state trajectory as x = mu_i + L_i z with the Cholesky factor
+ * L_i of the covariance of state i and z standard normal, see generateInChunks. Returns a (T, D) trajectory.
+ */
+template<typename dtype>
+np_array<dtype> generateObservationTrajectory(const np_array<std::int64_t> &hiddenStateTrajectory,
+                                              const np_array<dtype> &means, const np_array<dtype> &covariances,
+                                              std::int64_t seed) {
+    if (hiddenStateTrajectory.ndim() != 1) {
+        throw std::invalid_argument("Hidden state trajectory must be one-dimensional!");
+    }
+    const auto prec = precisions(means, covariances);
+    const auto N = prec.nStates;
+    const auto D = prec.dim;
+    std::vector<dtype> factors;
+    const auto* cov = covariances.data();
+    for (std::size_t i = 0; i < N; ++i) {
+        if (prec.diagonal) {
+            for (std::size_t d = 0; d < D; ++d) {
+                factors.push_back(static_cast<dtype>(std::sqrt(static_cast<double>(cov[i * D + d]))));
+            }
+        } else {
+            for (auto l : cholesky(cov + i * D * D, D, i)) {
+                factors.push_back(static_cast<dtype>(l));
+            }
+        }
+    }
+
+    const auto T = static_cast<std::size_t>(hiddenStateTrajectory.shape(0));
+    const auto* hidden = hiddenStateTrajectory.data();
+    checkHiddenStates(hidden, T, N);
+    np_array<dtype> output (std::vector<std::size_t>{T, D});
+    auto* ptr = output.mutable_data();
+
+    generateInChunks(T, seed, [&prec, &factors, hidden, ptr, D](auto &generator, std::size_t begin, std::size_t end) {
+        deeptime::rnd::normal_distribution<dtype> dist{0, 1};
+        std::vector<dtype> z(D);
+        for (auto t = begin; t < end; ++t) {
+            const auto state = static_cast<std::size_t>(hidden[t]);
+            const auto* mu = prec.means.data() + state * D;
+            for (auto &zd : z) {
+                zd = dist(generator);
+            }
+            auto* x = ptr + t * D;
+            for (std::size_t r = 0; r < D; ++r) {
+                if (prec.diagonal) {
+                    x[r] = mu[r] + factors[state * D + r] * z[r];
+                } else {
+                    const auto* L = factors.data() + state * D * D + r * D;
+                    dtype sum = 0;
+                    for (std::size_t c = 0; c <= r; ++c) {
+                        sum += L[c] * z[c];
+                    }
+                    x[r] = mu[r] + sum;
+                }
+            }
+        }
+    });
+    return output;
+}
+
+}
+
 }
 }
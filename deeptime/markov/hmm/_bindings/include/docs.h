@@ -82,6 +82,35 @@ forward : calculate forward coefficients `alpha`
 backward : calculate backward coefficients `beta`
 )mydelim";
 
+static constexpr const char* FORWARD_BACKWARD_BATCH = R"mydelim(Run the forward-backward algorithm on a batch of trajectories in
+parallel and reduce the Baum-Welch statistics.
+
+Parameters
+----------
+transition_matrix : ndarray((N,N), dtype = float)
+    transition matrix of the hidden states
+state_probability_trajectories : list of ndarray((T_k,N), dtype = float)
+    state probability trajectory per observation trajectory
+initial_distribution : ndarray((N), dtype = float)
+    initial distribution of hidden states
+gammas_out : list of ndarray((T_k,N), dtype = float)
+    containers for the state probabilities of each trajectory, C-contiguous and of the same dtype as the
+    transition matrix.
+parallel_in_time : bool, default = False
+    if True, the trajectories are processed one after the other and each of them is split in time over the threads,
+    which is useful for few long trajectories and small numbers of hidden states. Otherwise the trajectories are
+    distributed over the threads.
+
+Returns
+-------
+logprobs : ndarray((K,), dtype = float)
+    log-likelihood of each trajectory
+counts : ndarray((N,N), dtype = float)
+    transition counts summed over all trajectories
+initial_counts : ndarray((N,), dtype = float)
+    state probabilities at the first time step summed over all trajectories
+)mydelim";
+
 static constexpr const char* VITERBI = R"mydelim(Estimate the hidden pathway of maximum likelihood using the Viterbi algorithm.
 
 Parameters
@@ -92,6 +121,10 @@ state_probability_trajectory : ndarray((T,N), dtype = float)
     pobs[t,i] is the observation probability for observation at time t given hidden state i
 initial_distribution : ndarray((N), dtype = float)
     initial distribution of hidden states
+checkpoint_interval : int, optional, default=0
+    number of time steps whose backpointers are stored at once. If smaller than T, backpointers are recomputed
+    segment by segment from stored checkpoints, which needs O((T / checkpoint_interval + checkpoint_interval) N)
+    memory. Zero stores all backpointers unless they would exceed 256 MiB, in which case ceil(sqrt(T)) is used.
 
 Returns
 -------
@@ -99,6 +132,26 @@ q : numpy.array shape (T)
     maximum likelihood hidden path
 )mydelim";
 
+static constexpr const char* VITERBI_BATCH = R"mydelim(Estimate the hidden pathways of maximum likelihood of several
+trajectories using the Viterbi algorithm. The trajectories are decoded in parallel.
+
+Parameters
+----------
+transition_matrix : ndarray((N,N), dtype = float)
+    transition matrix of the hidden states
+state_probability_trajectories : list of ndarray((T_k,N), dtype = float)
+    state probability trajectories of each trajectory k
+initial_distribution : ndarray((N), dtype = float)
+    initial distribution of hidden states
+checkpoint_interval : int, optional, default=0
+    number of time steps whose backpointers are stored at once per trajectory, see viterbi.
+
+Returns
+-------
+paths : list of numpy.array shape (T_k)
+    maximum likelihood hidden paths
+)mydelim";
+
 static constexpr const char* SAMPLE_PATH = R"mydelim(Sample the hidden pathway S from the conditional distribution P ( S | Parameters, Observations )
 
 Parameters
@@ -4,165 +4,362 @@
 
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
 
 #include "common.h"
 #include "distribution_utils.h"
 
+namespace detail {
+
 /**
- * computes viterbi path
- * @tparam dtype dtype
- * @param transitionMatrix (N, N) transition matrix
- * @param stateProbabilityTraj (T, N) pobs
- * @param initialDistribution (N,) init dist
- * @return (T, )ndarray
+ * Number of hidden states for which the recursions are instantiated with a compile-time dimension, larger models use
+ * the runtime dimension and SIMD mat-vec kernels.
  */
-template<typename dtype>
-np_array<std::int32_t> viterbiPath(const np_array<dtype> &transitionMatrix, const np_array<dtype> &stateProbabilityTraj,
-                                   const np_array<dtype> &initialDistribution) {
-    if (transitionMatrix.ndim() < 1 || stateProbabilityTraj.ndim() < 1) {
-        throw std::invalid_argument("transition matrix and pobs need to be at least 1-dimensional.");
-    }
-    auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
-    auto T = static_cast<std::size_t>(stateProbabilityTraj.shape(0));
-    {
-        // check shapes
-        if (transitionMatrix.ndim() != 2) throw std::invalid_argument("transition matrix must be 2-dimensional");
-        if (transitionMatrix.shape(1) != transitionMatrix.shape(0)) {
-            throw std::invalid_argument("Transition matrix must be (N, N) but was (" + std::to_string(N) + ", " +
-                                        std::to_string(transitionMatrix.shape(1)) + ")");
+static constexpr std::size_t maxFixedStates = 8;
+
+/**
+ * Calls f with std::integral_constant<std::size_t, N> if N < maxFixedStates and with
+ * std::integral_constant<std::size_t, 0> (runtime dimension) otherwise.
+ */
+template<typename F, std::size_t DIM = 2>
+decltype(auto) dispatchStates(std::size_t N, F &&f) {
+    if constexpr (DIM < maxFixedStates) {
+        if (N == DIM) {
+            return f(std::integral_constant<std::size_t, DIM>{});
         }
-        if (stateProbabilityTraj.ndim() != 2) throw std::invalid_argument("pobs must be 2-dimensional");
-        if (static_cast<std::size_t>(stateProbabilityTraj.shape(1)) != N) {
-            std::stringstream ss;
-            ss << "State probablity trajectory must be (T, N) = (" << T << ", " << N << ") dimensional but was (";
-            ss << stateProbabilityTraj.shape(0) << ", " << stateProbabilityTraj.shape(1) << ")";
-            throw std::invalid_argument(ss.str());
+        return dispatchStates<F, DIM + 1>(N, std::forward<F>(f));
+    } else {
+        return f(std::integral_constant<std::size_t, 0>{});
+    }
+}
+
+/**
+ * y = M x for a row-major (N, N) matrix M. Blocks of four rows share every load of x and are reduced in SIMD lanes;
+ * with a compile-time dimension DIM > 0 the loops are unrolled completely.
+ */
+template<std::size_t DIM, typename dtype>
+void matVec(const dtype* const M, const dtype* const x, dtype* const y, std::size_t N) {
+    if constexpr (DIM > 0) {
+        for (std::size_t i = 0; i < DIM; ++i) {
+            dtype sum = 0;
+            for (std::size_t j = 0; j < DIM; ++j) {
+                sum += M[i * DIM + j] * x[j];
+            }
+            y[i] = sum;
         }
-        if (initialDistribution.ndim() != 1) throw std::invalid_argument("initial distribution must be 1-dimensional");
-        if (static_cast<std::size_t>(initialDistribution.shape(0)) != N) {
-            throw std::invalid_argument(
-                    "initial distribution must have length N = " + std::to_string(N) + " but had len=" +
-                    std::to_string(initialDistribution.shape(0)));
+    } else {
+        std::size_t i = 0;
+        for (; i + 4 <= N; i += 4) {
+            const auto* m0 = M + i * N;
+            const auto* m1 = m0 + N;
+            const auto* m2 = m1 + N;
+            const auto* m3 = m2 + N;
+            dtype s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            #pragma omp simd reduction(+:s0, s1, s2, s3)
+            for (std::size_t j = 0; j < N; ++j) {
+                s0 += m0[j] * x[j];
+                s1 += m1[j] * x[j];
+                s2 += m2[j] * x[j];
+                s3 += m3[j] * x[j];
+            }
+            y[i] = s0;
+            y[i + 1] = s1;
+            y[i + 2] = s2;
+            y[i + 3] = s3;
         }
-        if (T == 0 || N == 0) {
-            throw std::invalid_argument("Needs T and N to be at least 1, i.e., no empty arrays permitted.");
+        for (; i < N; ++i) {
+            const auto* m = M + i * N;
+            dtype sum = 0;
+            #pragma omp simd reduction(+:sum)
+            for (std::size_t j = 0; j < N; ++j) {
+                sum += m[j] * x[j];
+            }
+            y[i] = sum;
         }
     }
-    np_array<std::int32_t> path(std::vector<std::size_t>{T});
-    auto pathBuf = path.mutable_data();
-    auto ABuf = transitionMatrix.data();
-    auto pobsBuf = stateProbabilityTraj.data();
-    auto piBuf = initialDistribution.data();
-    {
-        std::fill(pathBuf, pathBuf + T, 0);
-
-        dtype sum;
-        auto vData = std::unique_ptr<dtype[]>(new dtype[N]);
-        auto v = vData.get();
-        auto vnextData = std::unique_ptr<dtype[]>(new dtype[N]);
-        auto vnext = vnextData.get();
-        auto hData = std::unique_ptr<dtype[]>(new dtype[N]);
-        auto h = hData.get();
-        auto pathTmpBuf = std::unique_ptr<std::int32_t[]>(new std::int32_t[T * N]);
-        auto ptr = pathTmpBuf.get();
-
-        // initialization of v
-        sum = 0.0;
-        for (std::size_t i = 0; i < N; i++) {
-            v[i] = pobsBuf[i] * piBuf[i];
-            sum += v[i];
-        }
-        // normalize
-        for (std::size_t i = 0; i < N; i++) {
-            v[i] /= sum;
-        }
-
-        // iteration of v
-        for (std::size_t t = 1; t < T; t++) {
-            sum = 0.0;
-            for (std::size_t j = 0; j < N; j++) {
-                for (std::size_t i = 0; i < N; i++) {
-                    h[i] = v[i] * ABuf[i * N + j];
-                }
-                auto maxi = std::distance(h, std::max_element(h, h + N));
-                ptr[t * N + j] = maxi;
-                vnext[j] = pobsBuf[t * N + j] * v[maxi] * ABuf[maxi * N + j];
-                sum += vnext[j];
-            }
-            // normalize
-            for (std::size_t i = 0; i < N; i++) {
-                vnext[i] /= sum;
-            }
-            // update v
-            std::swap(v, vnext);
+}
+
+/**
+ * Multiplies x element-wise by w in place and returns the sum of the products. Like the following helpers it only
+ * requests SIMD lanes for the runtime dimension, fixed tiny dimensions are unrolled instead.
+ */
+template<std::size_t DIM, typename dtype>
+dtype multiplySum(dtype* const x, const dtype* const w, std::size_t N) {
+    dtype sum = 0;
+    if constexpr (DIM > 0) {
+        for (std::size_t i = 0; i < DIM; ++i) {
+            x[i] *= w[i];
+            sum += x[i];
+        }
+    } else {
+        #pragma omp simd reduction(+:sum)
+        for (std::size_t i = 0; i < N; ++i) {
+            x[i] *= w[i];
+            sum += x[i];
         }
+    }
+    return sum;
+}
 
-        // path reconstruction
-        pathBuf[T - 1] = std::distance(v, std::max_element(v, v + N));
-        for (std::size_t t = T - 1; t >= 1; t--) {
-            pathBuf[t - 1] = ptr[t * N + pathBuf[t]];
+template<std::size_t DIM, typename dtype>
+void multiply(const dtype* const x, const dtype* const w, dtype* const out, std::size_t N) {
+    if constexpr (DIM > 0) {
+        for (std::size_t i = 0; i < DIM; ++i) {
+            out[i] = x[i] * w[i];
+        }
+    } else {
+        #pragma omp simd
+        for (std::size_t i = 0; i < N; ++i) {
+            out[i] = x[i] * w[i];
         }
+    }
+}
 
+template<std::size_t DIM, typename dtype>
+dtype sum(const dtype* const x, std::size_t N) {
+    dtype sum = 0;
+    if constexpr (DIM > 0) {
+        for (std::size_t i = 0; i < DIM; ++i) {
+            sum += x[i];
+        }
+    } else {
+        #pragma omp simd reduction(+:sum)
+        for (std::size_t i = 0; i < N; ++i) {
+            sum += x[i];
+        }
+    }
+    return sum;
+}
 
+template<std::size_t DIM, typename dtype>
+void scale(dtype* const x, dtype factor, std::size_t N) {
+    if constexpr (DIM > 0) {
+        for (std::size_t i = 0; i < DIM; ++i) {
+            x[i] *= factor;
+        }
+    } else {
+        #pragma omp simd
+        for (std::size_t i = 0; i < N; ++i) {
+            x[i] *= factor;
+        }
     }
-    return path;
 }
 
 template<typename dtype>
-dtype forwardImpl(const dtype*const  transitionMatrix, const dtype*const  pObs, const dtype*const pi,
-                  dtype* const alpha, std::size_t N, std::size_t T) {
+std::vector<dtype> transposed(const dtype* const M, std::size_t N) {
+    std::vector<dtype> out(N * N);
+    for (std::size_t i = 0; i < N; ++i) {
+        for (std::size_t j = 0; j < N; ++j) {
+            out[j * N + i] = M[i * N + j];
+        }
+    }
+    return out;
+}
 
-    dtype logprob, scaling;
-    {
-        // first alpha and scaling factors
-        scaling = 0.0;
-        //#pragma omp parallel for reduction(+:scaling) default(none) firstprivate(N, alpha, pi, pObs)
-        for (std::size_t i = 0; i < N; i++) {
-            alpha[i] = pi[i] * pObs[i];
-            scaling += alpha[i];
-        }
-
-        // initialize likelihood
-        logprob = std::log(scaling);
-
-        // scale first alpha
-        if (scaling != 0) {
-            //#pragma omp parallel for default(none) firstprivate(N, alpha, scaling)
-            for (std::size_t i = 0; i < N; i++) {
-                alpha[i] /= scaling;
-            }
+/**
+ * Adds xi_t(i, j) = alpha_t(i) A(i, j) w(j), normalized to sum one, to the transition counts. Here w = pobs_{t+1} * beta_{t+1}
+ * and tmp is (N, N) scratch memory.
+ */
+template<typename dtype>
+void accumulateTransitionCounts(const dtype* const alpha, const dtype* const transitionMatrix,
+                                const dtype* const weights, dtype* const tmp, dtype* const counts, std::size_t N) {
+    dtype sum = 0.0;
+    for (std::size_t i = 0; i < N; i++) {
+        const auto alphaI = alpha[i];
+        const auto* row = transitionMatrix + i * N;
+        auto* tmpRow = tmp + i * N;
+        #pragma omp simd reduction(+:sum)
+        for (std::size_t j = 0; j < N; j++) {
+            tmpRow[j] = alphaI * row[j] * weights[j];
+            sum += tmpRow[j];
         }
+    }
+    const auto normalization = 1 / sum;
+    #pragma omp simd
+    for (std::size_t ij = 0; ij < N * N; ij++) {
+        counts[ij] += tmp[ij] * normalization;
+    }
+}
 
-        // iterate trajectory
-        for (std::size_t t = 0; t < T - 1; t++) {
-            scaling = 0.0;
-            // compute new alpha and scaling
-            //#pragma omp parallel for reduction(+:scaling) default(none) firstprivate(N, alpha, transitionMatrix, pObs, t)
-            for (std::size_t j = 0; j < N; j++) {
-                dtype sum = 0.0;
-                for (std::size_t i = 0; i < N; i++) {
-                    sum += alpha[t * N + i] * transitionMatrix[i * N + j];
-                }
-                alpha[(t + 1) * N + j] = sum * pObs[(t + 1) * N + j];
-                scaling += alpha[(t + 1) * N + j];
-            }
-            // scale this row
-            if (scaling != 0) {
-                //#pragma omp parallel for default(none) firstprivate(N, alpha, scaling, t)
-                for (std::size_t j = 0; j < N; j++) {
-                    alpha[(t + 1) * N + j] /= scaling;
-                }
-            }
+/**
+ * Emission probabilities of a materialized (T, N) state probability trajectory, pObs(t) is its row t.
+ */
+template<typename dtype>
+struct DensePObs {
+    const dtype* pObs;
+    std::size_t N;
 
-            // update likelihood
-            logprob += std::log(scaling);
-        }
+    const dtype* operator()(std::size_t t) const {
+        return pObs + t * N;
+    }
+
+    DensePObs from(std::size_t t0) const {
+        return {pObs + t0 * N, N};
+    }
+};
+
+/**
+ * Emission probabilities of a discrete trajectory, gathered on the fly from its observations and the transposed (M, N)
+ * output probabilities: pObs(t) is row obs[t] of the table. No (T, N) state probability trajectory is materialized
+ * and every time step reads one contiguous row.
+ */
+template<typename dtype, typename State>
+struct GatheredPObs {
+    const dtype* table;
+    const State* obs;
+    std::size_t N;
+
+    const dtype* operator()(std::size_t t) const {
+        return table + static_cast<std::size_t>(obs[t]) * N;
+    }
+
+    GatheredPObs from(std::size_t t0) const {
+        return {table, obs + t0, N};
+    }
+};
+
+/**
+ * alpha_{t+1} = diag(pobs_{t+1}) A^T alpha_t, scaled to sum one. Returns the scaling factor.
+ */
+template<std::size_t DIM, typename dtype>
+dtype forwardStep(const dtype* const transitionMatrixT, const dtype* const alpha, const dtype* const pObsNext,
+                  dtype* const alphaNext, std::size_t n) {
+    matVec<DIM>(transitionMatrixT, alpha, alphaNext, n);
+    auto scaling = multiplySum<DIM>(alphaNext, pObsNext, n);
+    if (scaling != 0) {
+        scale<DIM>(alphaNext, 1 / scaling, n);
+    }
+    return scaling;
+}
+
+template<std::size_t DIM, typename dtype, typename PObs>
+dtype forward(const dtype* const transitionMatrixT, const PObs &pObs, const dtype* const pi,
+              dtype* const alpha, std::size_t N, std::size_t T) {
+    const auto n = DIM > 0 ? DIM : N;
+
+    // first alpha and scaling factors
+    std::copy(pi, pi + n, alpha);
+    auto scaling = multiplySum<DIM>(alpha, pObs(0), n);
+
+    // initialize likelihood
+    dtype logprob = std::log(scaling);
+
+    // scale first alpha
+    if (scaling != 0) {
+        scale<DIM>(alpha, 1 / scaling, n);
+    }
+
+    // iterate trajectory
+    for (std::size_t t = 0; t < T - 1; t++) {
+        // compute new alpha and update likelihood
+        scaling = forwardStep<DIM>(transitionMatrixT, alpha + t * n, pObs(t + 1), alpha + (t + 1) * n, n);
+        logprob += std::log(scaling);
     }
 
     return logprob;
 }
 
+/**
+ * beta_{t-1} = A diag(pobs_t) beta_t, scaled to sum one. The weights pobs_t * beta_t are left in weights.
+ */
+template<std::size_t DIM, typename dtype>
+void backwardStep(const dtype* const transitionMatrix, const dtype* const beta, const dtype* const pObs,
+                  dtype* const betaPrev, dtype* const weights, std::size_t n) {
+    multiply<DIM>(beta, pObs, weights, n);
+    matVec<DIM>(transitionMatrix, weights, betaPrev, n);
+    auto scaling = sum<DIM>(betaPrev, n);
+    if (scaling != 0) {
+        scale<DIM>(betaPrev, 1 / scaling, n);
+    }
+}
+
+template<std::size_t DIM, typename dtype, typename PObs>
+void backward(const dtype* const transitionMatrix, const PObs &pObs, dtype* const beta, std::size_t N,
+              std::size_t T) {
+    const auto n = DIM > 0 ? DIM : N;
+    std::vector<dtype> weightsBuffer(DIM > 0 ? 0 : n);
+    std::array<dtype, maxFixedStates> fixedWeights {};
+    auto* weights = DIM > 0 ? fixedWeights.data() : weightsBuffer.data();
+
+    // first beta, normalized
+    std::fill(beta + (T - 1) * n, beta + T * n, static_cast<dtype>(1) / static_cast<dtype>(n));
+
+    // iterate trajectory
+    for (std::size_t t = T - 1; t >= 1; --t) {
+        backwardStep<DIM>(transitionMatrix, beta + t * n, pObs(t), beta + (t - 1) * n, weights, n);
+    }
+}
+
+}
+
+namespace detail {
+
+template<std::size_t DIM, typename dtype, typename PObsRow>
+dtype forwardLogprob(const dtype* const transitionMatrixT, const dtype* const pi, std::size_t N, std::size_t T,
+                     PObsRow &&pObsRow) {
+    const auto n = DIM > 0 ? DIM : N;
+    std::vector<dtype> buffer(3 * n);
+    auto* alpha = buffer.data();
+    auto* alphaNext = alpha + n;
+    auto* pObs = alphaNext + n;
+
+    pObsRow(0, pObs);
+    std::copy(pi, pi + n, alpha);
+    auto scaling = multiplySum<DIM>(alpha, pObs, n);
+    dtype logprob = std::log(scaling);
+    if (scaling != 0) {
+        scale<DIM>(alpha, 1 / scaling, n);
+    }
+    for (std::size_t t = 1; t < T; ++t) {
+        pObsRow(t, pObs);
+        logprob += std::log(forwardStep<DIM>(transitionMatrixT, alpha, pObs, alphaNext, n));
+        std::swap(alpha, alphaNext);
+    }
+    return logprob;
+}
+
+}
+
+/**
+ * Log-likelihood of a trajectory of length T from the forward recursion, keeping only two alpha vectors and one
+ * row of emission probabilities, which is requested through pObsRow(t, out). Takes the transposed transition matrix
+ * so that it can be shared across calls.
+ */
+template<typename dtype, typename PObsRow>
+dtype forwardLogprobImpl(const dtype* const transitionMatrixT, const dtype* const pi, std::size_t N, std::size_t T,
+                         PObsRow &&pObsRow) {
+    if (T == 0) {
+        return 0;
+    }
+    return detail::dispatchStates(N, [&](auto dim) {
+        return detail::forwardLogprob<decltype(dim)::value>(transitionMatrixT, pi, N, T, pObsRow);
+    });
+}
+
+/**
+ * Forward pass, pObs(t) yields the emission probabilities of time step t, see detail::DensePObs and
+ * detail::GatheredPObs.
+ */
+template<typename dtype, typename PObs>
+dtype forwardImpl(const dtype*const  transitionMatrix, const PObs &pObs, const dtype*const pi,
+                  dtype* const alpha, std::size_t N, std::size_t T) {
+    // alpha_{t+1} = diag(pobs_{t+1}) A^T alpha_t, with A^T stored row-major the mat-vec reads contiguous rows
+    const auto transitionMatrixT = detail::transposed(transitionMatrix, N);
+    return detail::dispatchStates(N, [&](auto dim) {
+        return detail::forward<decltype(dim)::value>(transitionMatrixT.data(), pObs, pi, alpha, N, T);
+    });
+}
+
 template<typename dtype>
 dtype forward(const np_array<dtype> &transitionMatrix, const np_array<dtype> &pObs, const np_array<dtype> &pi,
               np_array<dtype> &alpha, const py::object &pyT) {
@@ -182,48 +379,17 @@ dtype forward(const np_array<dtype> &transitionMatrix, const np_array<dtype> &pO
         throw std::invalid_argument("Shape mismatch: Shape of state probability trajectory must match shape of alphas");
     }
     auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
-    return forwardImpl(transitionMatrix.data(), pObs.data(), pi.data(), alpha.mutable_data(), N, T);
+    return forwardImpl(transitionMatrix.data(), detail::DensePObs<dtype>{pObs.data(), N}, pi.data(),
+                       alpha.mutable_data(), N, T);
 }
 
-template<typename dtype>
-void backwardImpl(const dtype* const transitionMatrix, const dtype* const pobs, dtype* const beta, std::size_t N,
+template<typename dtype, typename PObs>
+void backwardImpl(const dtype* const transitionMatrix, const PObs &pObs, dtype* const beta, std::size_t N,
                   std::size_t T) {
-    {
-        std::size_t i, j, t;
-        dtype sum, scaling;
-
-        // first beta and scaling factors
-        scaling = 0.0;
-        for (i = 0; i < N; ++i) {
-            beta[(T - 1) * N + i] = 1.0;
-            scaling += beta[(T - 1) * N + i];
-        }
-
-        // scale first beta
-        for (i = 0; i < N; ++i) {
-            beta[(T - 1) * N + i] /= scaling;
-        }
-
-        // iterate trajectory
-        for (t = T - 1; t >= 1; --t) {
-            scaling = 0.0;
-            // compute new beta and scaling
-            for (i = 0; i < N; ++i) {
-                sum = 0.0;
-                for (j = 0; j < N; ++j) {
-                    sum += transitionMatrix[i * N + j] * pobs[t * N + j] * beta[t * N + j];
-                }
-                beta[(t - 1) * N + i] = sum;
-                scaling += sum;
-            }
-            // scale this row
-            if (scaling != 0) {
-                for (j = 0; j < N; ++j) {
-                    beta[(t - 1) * N + j] /= scaling;
-                }
-            }
-        }
-    }
+    // beta_{t-1} = A diag(pobs_t) beta_t
+    detail::dispatchStates(N, [&](auto dim) {
+        detail::backward<decltype(dim)::value>(transitionMatrix, pObs, beta, N, T);
+    });
 }
 
 template<typename dtype>
@@ -244,7 +410,7 @@ void backward(const np_array<dtype> &transitionMatrix, const np_array<dtype> &po
 
     auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
 
-    backwardImpl(transitionMatrix.data(), pobs.data(), beta.mutable_data(), N, T);
+    backwardImpl(transitionMatrix.data(), detail::DensePObs<dtype>{pobs.data(), N}, beta.mutable_data(), N, T);
 }
 
 template<typename dtype>
@@ -252,15 +418,10 @@ void stateProbabilitiesImpl(const dtype* const alpha, const dtype* const beta, d
                             std::size_t N, std::size_t T) {
     #pragma omp parallel for default(none) firstprivate(T, N, alpha, beta, gamma)
     for (std::size_t t = 0; t < T; ++t) {
-        dtype rowSum = 0;
-        for (std::size_t n = 0; n < N; ++n) {
-            *(gamma + t * N + n) = *(alpha + t * N + n) * *(beta + t * N + n);
-            rowSum += gamma[t * N + n];
-        }
-        for (std::size_t n = 0; n < N; ++n) {
-            if (rowSum != 0.) {
-                gamma[t * N + n] /= rowSum;
-            }
+        std::copy(alpha + t * N, alpha + (t + 1) * N, gamma + t * N);
+        auto rowSum = detail::multiplySum<0>(gamma + t * N, beta + t * N, N);
+        if (rowSum != 0.) {
+            detail::scale<0>(gamma + t * N, 1 / rowSum, N);
         }
     }
 }
@@ -282,30 +443,17 @@ void stateProbabilities(const np_array<dtype> &alpha, const np_array<dtype> &bet
     stateProbabilitiesImpl(alphaPtr, betaPtr, gammaPtr, N, T);
 }
 
-template<typename dtype>
+template<typename dtype, typename PObs>
 void transitionCountsImpl(const dtype* const alpha, const dtype* const beta, const dtype* const transitionMatrix,
-                          const dtype* const pObs, dtype* const counts, std::size_t N, std::size_t T) {
+                          const PObs &pObs, dtype* const counts, std::size_t N, std::size_t T) {
     std::fill(counts, counts + N*N, 0.0);
 
-    dtype sum;
-
-    std::unique_ptr<dtype[]> tmp = std::unique_ptr<dtype[]>(new dtype[N * N]);
+    std::vector<dtype> weights(N);
+    std::vector<dtype> tmp(N * N);
 
     for (std::size_t t = 0; t < T - 1; t++) {
-        sum = 0.0;
-        for (std::size_t i = 0; i < N; i++) {
-            for (std::size_t j = 0; j < N; j++) {
-                tmp[i * N + j] =
-                        alpha[t * N + i] * transitionMatrix[i * N + j] * pObs[(t + 1) * N + j] *
-                        beta[(t + 1) * N + j];
-                sum += tmp[i * N + j];
-            }
-        }
-        for (std::size_t i = 0; i < N; i++) {
-            for (std::size_t j = 0; j < N; j++) {
-                counts[i * N + j] += tmp[i * N + j] / sum;
-            }
-        }
+        detail::multiply<0>(pObs(t + 1), beta + (t + 1) * N, weights.data(), N);
+        detail::accumulateTransitionCounts(alpha + t * N, transitionMatrix, weights.data(), tmp.data(), counts, N);
     }
 }
 
@@ -334,7 +482,8 @@ void transitionCounts(const np_array<dtype> &alpha, const np_array<dtype> &beta,
 
     auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
 
-    transitionCountsImpl(alphaBuf, betaBuf, transitionMatrixPtr, pObsBuf, countsBuf, N, T);
+    transitionCountsImpl(alphaBuf, betaBuf, transitionMatrixPtr, detail::DensePObs<dtype>{pObsBuf, N}, countsBuf, N,
+                         T);
 }
 
 template<typename dtype, typename Generator>
@@ -352,7 +501,7 @@ void samplePathImpl(const dtype* const alpha, const dtype* const transitionMatri
     }
 
     auto sample = [&generator, N, psel]() {
-        static thread_local std::uniform_real_distribution<dtype> uiDist (0, 1);
+        static thread_local deeptime::rnd::uniform_real_distribution<dtype> uiDist (0, 1);
         auto p = uiDist(generator) * psel[N - 1];  // uniform between 0 and psel[N-1] which is cumulative
         auto it = std::lower_bound(psel, psel + N, p);
         return std::distance(psel, it);
@@ -416,10 +565,232 @@ np_array<dtype> countMatrix(const py::list& dtrajs, std::uint32_t lag, std::uint
     return result;
 }
 
+namespace detail {
+
+/**
+ * A trajectory is only split in time if each segment gets at least this many time steps.
+ */
+static constexpr std::size_t minTimeSegmentLength = 64;
+
+/**
+ * Replaces the (N, N) operator op by diag(post) M diag(pre) op scaled to sum one, pre and post may be null.
+ * tmp is (N, N) scratch memory.
+ */
+template<typename dtype>
+void transferStep(const dtype* const M, const dtype* const pre, const dtype* const post, dtype* const op,
+                  dtype* const tmp, std::size_t N) {
+    dtype total = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        auto* row = tmp + i * N;
+        std::fill(row, row + N, static_cast<dtype>(0));
+        for (std::size_t l = 0; l < N; ++l) {
+            const auto c = M[i * N + l] * (pre ? pre[l] : static_cast<dtype>(1));
+            const auto* opRow = op + l * N;
+            #pragma omp simd
+            for (std::size_t j = 0; j < N; ++j) {
+                row[j] += c * opRow[j];
+            }
+        }
+        const auto f = post ? post[i] : static_cast<dtype>(1);
+        #pragma omp simd reduction(+:total)
+        for (std::size_t j = 0; j < N; ++j) {
+            row[j] *= f;
+            total += row[j];
+        }
+    }
+    const auto normalization = total != 0 ? 1 / total : static_cast<dtype>(1);
+    #pragma omp simd
+    for (std::size_t ij = 0; ij < N * N; ++ij) {
+        op[ij] = tmp[ij] * normalization;
+    }
+}
+
+/**
+ * Parallel-in-time forward-backward pass. The trajectory is split into one segment per thread. In a first parallel
+ * sweep, the first segment runs the forward recursion and the last segment the backward recursion, all other segments
+ * compute their scaled forward and backward transfer operators, i.e., the products of diag(pobs_t) A^T and
+ * A diag(pobs_{t+1}) over the segment. Chaining the operators over the segments yields alpha and beta at all segment
+ * boundaries, from which each segment refines its alphas and betas with the serial recursions. The log-likelihood is
+ * the sum of the scaling factors of these serial recursions, so results agree with the serial pass up to rounding.
+ * Phase one costs O(N^3) per time step for the inner segments, this pays off if there are many more threads than
+ * hidden states.
+ */
+template<std::size_t DIM, typename dtype, typename PObs>
+dtype forwardBackwardParallelInTime(const dtype* const transitionMatrix, const dtype* const transitionMatrixT,
+                                    const PObs &pObs, const dtype* const pi, dtype* const alpha,
+                                    dtype* const beta, dtype* const gamma, dtype* const counts, std::size_t N,
+                                    std::size_t T, std::size_t nSegments) {
+    const auto n = DIM > 0 ? DIM : N;
+    const auto nSeg = static_cast<std::int64_t>(nSegments);
+    std::vector<std::size_t> starts(nSegments + 1);
+    for (std::size_t k = 0; k <= nSegments; ++k) {
+        starts[k] = k * T / nSegments;
+    }
+
+    std::vector<dtype> forwardOperators(nSegments * n * n), backwardOperators(nSegments * n * n);
+    std::vector<dtype> alphaBoundaries(nSegments * n), betaBoundaries(nSegments * n);
+    std::vector<dtype> segmentLogprobs(nSegments, 0), segmentCounts(nSegments * n * n, 0);
+
+    auto* F = forwardOperators.data();
+    auto* G = backwardOperators.data();
+    auto* logprobs = segmentLogprobs.data();
+
+    #pragma omp parallel for schedule(static, 1) default(none) \
+        firstprivate(nSeg, n, T, transitionMatrix, transitionMatrixT, pObs, pi, alpha, beta, F, G, logprobs) \
+        shared(starts)
+    for (std::int64_t k = 0; k < nSeg; ++k) {
+        const auto t0 = starts[k], t1 = starts[k + 1];
+        if (k == 0) {
+            logprobs[0] = forward<DIM>(transitionMatrixT, pObs, pi, alpha, n, t1);
+        }
+        if (k == nSeg - 1) {
+            backward<DIM>(transitionMatrix, pObs.from(t0), beta + t0 * n, n, T - t0);
+        }
+        if (k > 0 && k < nSeg - 1) {
+            std::vector<dtype> tmp(n * n);
+            auto* Fk = F + k * n * n;
+            auto* Gk = G + k * n * n;
+            std::fill(Fk, Fk + n * n, static_cast<dtype>(0));
+            std::fill(Gk, Gk + n * n, static_cast<dtype>(0));
+            for (std::size_t i = 0; i < n; ++i) {
+                Fk[i * n + i] = 1;
+                Gk[i * n + i] = 1;
+            }
+            // F_k maps alpha_{t0 - 1} to alpha_{t1 - 1}
+            for (auto t = t0; t < t1; ++t) {
+                transferStep(transitionMatrixT, static_cast<const dtype*>(nullptr), pObs(t), Fk, tmp.data(), n);
+            }
+            // G_k maps beta_{t1} to beta_{t0}
+            for (auto t = t1; t-- > t0;) {
+                transferStep(transitionMatrix, pObs(t + 1), static_cast<const dtype*>(nullptr), Gk, tmp.data(), n);
+            }
+        }
+    }
+
+    // chain the segment boundaries
+    {
+        auto* alphaEnd = alphaBoundaries.data();
+        std::copy(alpha + (starts[1] - 1) * n, alpha + starts[1] * n, alphaEnd);
+        for (std::size_t k = 1; k + 1 < nSegments; ++k) {
+            auto* alphaK = alphaEnd + k * n;
+            matVec<0>(F + k * n * n, alphaK - n, alphaK, n);
+            auto alphaSum = sum<0>(alphaK, n);
+            if (alphaSum != 0) {
+                scale<0>(alphaK, 1 / alphaSum, n);
+            }
+        }
+        auto* betaStart = betaBoundaries.data();
+        std::copy(beta + starts[nSegments - 1] * n, beta + (starts[nSegments - 1] + 1) * n,
+                  betaStart + (nSegments - 1) * n);
+        for (std::size_t k = nSegments - 2; k >= 1; --k) {
+            auto* betaK = betaStart + k * n;
+            matVec<0>(G + k * n * n, betaK + n, betaK, n);
+            auto betaSum = sum<0>(betaK, n);
+            if (betaSum != 0) {
+                scale<0>(betaK, 1 / betaSum, n);
+            }
+        }
+    }
+
+    auto* alphaEnds = alphaBoundaries.data();
+    auto* betaStarts = betaBoundaries.data();
+    auto* countsK = segmentCounts.data();
+
+    // refine the segments with the serial recursions
+    #pragma omp parallel for schedule(static, 1) default(none) \
+        firstprivate(nSeg, n, transitionMatrix, transitionMatrixT, pObs, alpha, beta, logprobs, alphaEnds, betaStarts) \
+        shared(starts)
+    for (std::int64_t k = 0; k < nSeg; ++k) {
+        const auto t0 = starts[k], t1 = starts[k + 1];
+        if (k > 0) {
+            for (auto t = t0; t < t1; ++t) {
+                const auto* alphaPrev = t == t0 ? alphaEnds + (k - 1) * n : alpha + (t - 1) * n;
+                logprobs[k] += std::log(forwardStep<DIM>(transitionMatrixT, alphaPrev, pObs(t), alpha + t * n, n));
+            }
+        }
+        if (k < nSeg - 1) {
+            std::vector<dtype> weights(n);
+            for (auto t = t1; t > t0; --t) {
+                const auto* betaNext = t == t1 ? betaStarts + (k + 1) * n : beta + t * n;
+                backwardStep<DIM>(transitionMatrix, betaNext, pObs(t), beta + (t - 1) * n, weights.data(), n);
+            }
+        }
+    }
+
+    // state probabilities and transition counts per segment
+    #pragma omp parallel for schedule(static, 1) default(none) \
+        firstprivate(nSeg, n, T, transitionMatrix, pObs, alpha, beta, gamma, countsK) shared(starts)
+    for (std::int64_t k = 0; k < nSeg; ++k) {
+        const auto t0 = starts[k], t1 = starts[k + 1];
+        std::vector<dtype> weights(n), tmp(n * n);
+        for (auto t = t0; t < t1; ++t) {
+            std::copy(alpha + t * n, alpha + (t + 1) * n, gamma + t * n);
+            auto rowSum = multiplySum<0>(gamma + t * n, beta + t * n, n);
+            if (rowSum != 0) {
+                scale<0>(gamma + t * n, 1 / rowSum, n);
+            }
+            if (t + 1 < T) {
+                multiply<0>(pObs(t + 1), beta + (t + 1) * n, weights.data(), n);
+                accumulateTransitionCounts(alpha + t * n, transitionMatrix, weights.data(), tmp.data(),
+                                           countsK + k * n * n, n);
+            }
+        }
+    }
+
+    std::fill(counts, counts + n * n, static_cast<dtype>(0));
+    dtype logprob = 0;
+    for (std::size_t k = 0; k < nSegments; ++k) {
+        logprob += segmentLogprobs[k];
+        for (std::size_t ij = 0; ij < n * n; ++ij) {
+            counts[ij] += segmentCounts[k * n * n + ij];
+        }
+    }
+    return logprob;
+}
+
+}
+
+/**
+ * Forward-backward pass over one trajectory writing alpha, beta, gamma and the transition counts, split in time over
+ * the available threads if the trajectory is long enough, see detail::forwardBackwardParallelInTime. A positive
+ * nSegments forces that many segments (at most T) regardless of the number of threads and of minTimeSegmentLength.
+ */
+template<typename dtype, typename PObs>
+dtype forwardBackwardParallelInTimeImpl(const dtype* const transitionMatrix, const PObs &pObs,
+                                        const dtype* const pi, dtype* const alpha, dtype* const beta,
+                                        dtype* const gamma, dtype* const counts, std::size_t N, std::size_t T,
+                                        std::size_t nSegments = 0) {
+    if (nSegments == 0) {
+        nSegments = 1;
+        #ifdef USE_OPENMP
+        nSegments = static_cast<std::size_t>(omp_get_max_threads());
+        #endif
+        nSegments = std::min(nSegments, T / detail::minTimeSegmentLength);
+    }
+    // every segment needs at least one time step
+    nSegments = std::min(nSegments, T);
+    if (nSegments < 2) {
+        auto logprob = forwardImpl(transitionMatrix, pObs, pi, alpha, N, T);
+        backwardImpl(transitionMatrix, pObs, beta, N, T);
+        stateProbabilitiesImpl(alpha, beta, gamma, N, T);
+        transitionCountsImpl(alpha, beta, transitionMatrix, pObs, counts, N, T);
+        return logprob;
+    }
+    const auto transitionMatrixT = detail::transposed(transitionMatrix, N);
+    return detail::dispatchStates(N, [&](auto dim) {
+        return detail::forwardBackwardParallelInTime<decltype(dim)::value>(
+                transitionMatrix, transitionMatrixT.data(), pObs, pi, alpha, beta, gamma, counts, N, T, nSegments);
+    });
+}
+
+/**
+ * Serial forward-backward pass over one trajectory. With nSegments > 1 the pass is split in time into that many
+ * segments instead, see forwardBackwardParallelInTimeImpl.
+ */
 template<typename dtype>
 dtype forwardBackward(const np_array<dtype> &transitionMatrix, const np_array<dtype> &pObs,
     const np_array<dtype> &pi, np_array<dtype> &alpha, np_array_nfc<dtype> &beta, np_array_nfc<dtype> &gamma,
-    np_array_nfc<dtype> &counts, const py::object &pyT) {
+    np_array_nfc<dtype> &counts, const py::object &pyT, std::size_t nSegments) {
     std::size_t T = [&pyT, &pObs]() {
         if (pyT.is_none()) {
             return static_cast<std::size_t>(pObs.shape(0));
@@ -446,9 +817,674 @@ dtype forwardBackward(const np_array<dtype> &transitionMatrix, const np_array<dt
     auto* gammaBuf = gamma.mutable_data();
     auto* countsBuf = counts.mutable_data();
 
-    auto logprob = forwardImpl(P, pObsBuf, piBuf, alphaBuf, N, T);
-    backwardImpl(P, pObsBuf, betaBuf, N, T);
+    const detail::DensePObs<dtype> pObsRows {pObsBuf, N};
+    if (nSegments > 1) {
+        return forwardBackwardParallelInTimeImpl(P, pObsRows, piBuf, alphaBuf, betaBuf, gammaBuf, countsBuf, N, T,
+                                                 nSegments);
+    }
+    auto logprob = forwardImpl(P, pObsRows, piBuf, alphaBuf, N, T);
+    backwardImpl(P, pObsRows, betaBuf, N, T);
     stateProbabilitiesImpl(alphaBuf, betaBuf, gammaBuf, N, T);
-    transitionCountsImpl(alphaBuf, betaBuf, P, pObsBuf, countsBuf, N, T);
+    transitionCountsImpl(alphaBuf, betaBuf, P, pObsRows, countsBuf, N, T);
+    return logprob;
+}
+
+namespace detail {
+
+/**
+ * Trajectories of a batch are processed in at most this many contiguous blocks of similar total length. Each block
+ * accumulates its statistics in trajectory order and the blocks are reduced in block order, so that the sums do not
+ * depend on the number of threads.
+ */
+static constexpr std::size_t maxBatchBlocks = 64;
+
+inline std::vector<std::size_t> batchBlocks(const std::vector<std::size_t> &lengths) {
+    const auto nTrajectories = lengths.size();
+    const auto totalLength = std::accumulate(lengths.begin(), lengths.end(), static_cast<std::size_t>(0));
+    const auto nBlocks = std::min(nTrajectories, maxBatchBlocks);
+
+    std::vector<std::size_t> blockStarts {0};
+    std::size_t cumulativeLength = 0;
+    for (std::size_t k = 0; k < nTrajectories; ++k) {
+        cumulativeLength += lengths[k];
+        auto remainingTrajectories = nTrajectories - k - 1;
+        auto remainingBlocks = nBlocks - blockStarts.size();
+        if (remainingBlocks > 0 && remainingTrajectories > 0 &&
+            (cumulativeLength * nBlocks >= totalLength * blockStarts.size() ||
+             remainingTrajectories == remainingBlocks)) {
+            blockStarts.push_back(k + 1);
+        }
+    }
+    blockStarts.push_back(nTrajectories);
+    return blockStarts;
+}
+
+}
+
+/**
+ * Inputs of a batched forward-backward pass, the arrays are kept alive while their pointers are used without the GIL.
+ */
+template<typename dtype>
+struct BatchArrays {
+    std::size_t nStates {0};
+    std::vector<np_array<dtype>> pObs;
+    std::vector<np_array_nfc<dtype>> gammas;
+    std::vector<std::size_t> lengths;
+    std::vector<const dtype*> pObsPtrs;
+    std::vector<dtype*> gammaPtrs;
+};
+
+/**
+ * Validates the inputs of a batched forward-backward pass over trajectories of the given lengths. gammasOut may be
+ * None, in which case the state probabilities are not stored and the gamma pointers are null. The emission
+ * probabilities are left empty.
+ */
+template<typename dtype>
+BatchArrays<dtype> batchArrays(const np_array<dtype> &transitionMatrix, const std::vector<std::size_t> &lengths,
+                               const np_array<dtype> &pi, const py::object &gammasOut) {
+    if (transitionMatrix.ndim() != 2 || transitionMatrix.shape(0) != transitionMatrix.shape(1)) {
+        throw std::invalid_argument("Transition matrix must be a square matrix.");
+    }
+    BatchArrays<dtype> batch;
+    auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
+    batch.nStates = N;
+    if (pi.ndim() != 1 || static_cast<std::size_t>(pi.shape(0)) != N) {
+        throw std::invalid_argument("Initial distribution must have length N = " + std::to_string(N) + ".");
+    }
+    auto storeGammas = !gammasOut.is_none();
+    py::list gammaList;
+    if (storeGammas) {
+        gammaList = py::cast<py::list>(gammasOut);
+        if (lengths.size() != gammaList.size()) {
+            throw std::invalid_argument("There must be exactly one gamma output array per trajectory.");
+        }
+    }
+    auto nTrajectories = lengths.size();
+
+    batch.gammas.reserve(nTrajectories);
+    batch.lengths = lengths;
+    if (storeGammas) {
+        for (std::size_t k = 0; k < nTrajectories; ++k) {
+            if (!py::isinstance<np_array_nfc<dtype>>(gammaList[k])) {
+                throw std::invalid_argument("Gamma output array " + std::to_string(k) + " must be C-contiguous and "
+                                            "of the same dtype as the transition matrix.");
+            }
+            batch.gammas.push_back(py::cast<np_array_nfc<dtype>>(gammaList[k]));
+            const auto &gamma = batch.gammas.back();
+            if (gamma.ndim() != 2 || static_cast<std::size_t>(gamma.shape(0)) != lengths[k] ||
+                static_cast<std::size_t>(gamma.shape(1)) != N) {
+                throw std::invalid_argument("Gamma output array " + std::to_string(k) + " must be of shape (T, N) "
+                                            "with T the length of its trajectory and N = " + std::to_string(N) + ".");
+            }
+        }
+    }
+    for (std::size_t k = 0; k < nTrajectories; ++k) {
+        batch.gammaPtrs.push_back(storeGammas ? batch.gammas[k].mutable_data() : nullptr);
+    }
+    return batch;
+}
+
+/**
+ * Validates the inputs of a batched forward-backward pass over materialized (T, N) state probability trajectories,
+ * see above.
+ */
+template<typename dtype>
+BatchArrays<dtype> batchArrays(const np_array<dtype> &transitionMatrix, const py::list &pObsList,
+                               const np_array<dtype> &pi, const py::object &gammasOut) {
+    if (transitionMatrix.ndim() != 2 || transitionMatrix.shape(0) != transitionMatrix.shape(1)) {
+        throw std::invalid_argument("Transition matrix must be a square matrix.");
+    }
+    auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
+    std::vector<np_array<dtype>> pObsArrays;
+    std::vector<std::size_t> lengths;
+    pObsArrays.reserve(pObsList.size());
+    for (std::size_t k = 0; k < pObsList.size(); ++k) {
+        pObsArrays.push_back(py::cast<np_array<dtype>>(pObsList[k]));
+        const auto &pObs = pObsArrays.back();
+        if (pObs.ndim() != 2 || static_cast<std::size_t>(pObs.shape(1)) != N) {
+            throw std::invalid_argument("State probability trajectory " + std::to_string(k) + " must be of shape "
+                                        "(T, N) with N = " + std::to_string(N) + ".");
+        }
+        lengths.push_back(static_cast<std::size_t>(pObs.shape(0)));
+    }
+    auto batch = batchArrays(transitionMatrix, lengths, pi, gammasOut);
+    batch.pObs = std::move(pObsArrays);
+    for (const auto &pObs : batch.pObs) {
+        batch.pObsPtrs.push_back(pObs.data());
+    }
+    return batch;
+}
+
+namespace detail {
+
+/**
+ * Writes gamma_t = alpha_t * beta_t / <alpha_t, beta_t> for the time steps [t0, t1) and hands each of them to
+ * emission(k, t, gamma_t, stats). gamma may be null, then the rows are only kept in rowBuffer.
+ */
+template<typename dtype, typename Emission>
+void emitStateProbabilities(const dtype* const alpha, const dtype* const beta, dtype* const gamma,
+                            dtype* const rowBuffer, std::size_t N, std::size_t k, std::size_t t0, std::size_t t1,
+                            dtype* const stats, Emission &emission) {
+    for (auto t = t0; t < t1; ++t) {
+        auto* row = gamma ? gamma + t * N : rowBuffer;
+        std::copy(alpha + t * N, alpha + (t + 1) * N, row);
+        auto rowSum = multiplySum<0>(row, beta + t * N, N);
+        if (rowSum != 0) {
+            scale<0>(row, 1 / rowSum, N);
+        }
+        emission(k, t, static_cast<const dtype*>(row), stats);
+    }
+}
+
+}
+
+/**
+ * Batched forward-backward pass. The emission probabilities of trajectory k are given by pObsRows(k), see
+ * detail::DensePObs and detail::GatheredPObs. For each trajectory k, the state probabilities are (optionally) written
+ * to gammaPtrs[k] and handed to emission(k, t, gamma_t, stats), which accumulates nStats emission statistics onto
+ * stats in the same pass. Logprobs, transition counts, initial counts and statistics are reduced in a fixed order, so
+ * that they do not depend on the number of threads. With parallelInTime the trajectories are processed one after the
+ * other, each of them split in time over the threads.
+ */
+template<typename dtype, typename PObsRows, typename Emission>
+void forwardBackwardBatchImpl(const dtype* const transitionMatrix, const dtype* const pi,
+                              const BatchArrays<dtype> &batch, PObsRows &&pObsRows, bool parallelInTime,
+                              dtype* const logprobs, dtype* const counts, dtype* const initialCounts,
+                              std::size_t nStats, dtype* const stats, Emission &&emission) {
+    const auto N = batch.nStates;
+    const auto &lengths = batch.lengths;
+    const auto &gammaPtrs = batch.gammaPtrs;
+    const auto nTrajectories = lengths.size();
+    std::fill(counts, counts + N * N, static_cast<dtype>(0));
+    std::fill(initialCounts, initialCounts + N, static_cast<dtype>(0));
+    std::fill(stats, stats + nStats, static_cast<dtype>(0));
+
+    if (parallelInTime) {
+        // one trajectory after the other, each of them split in time over the threads
+        const auto maxLength = std::accumulate(lengths.begin(), lengths.end(), static_cast<std::size_t>(0),
+                                               [](auto a, auto b) { return std::max(a, b); });
+        std::vector<dtype> alpha(maxLength * N), beta(maxLength * N), trajectoryCounts(N * N);
+        std::vector<dtype> gammaBuffer;
+        if (std::find(gammaPtrs.begin(), gammaPtrs.end(), nullptr) != gammaPtrs.end()) {
+            gammaBuffer.resize(maxLength * N);
+        }
+        const auto nChunks = static_cast<std::int64_t>(detail::maxBatchBlocks);
+        std::vector<dtype> chunkStats(nChunks * nStats);
+        for (std::size_t k = 0; k < nTrajectories; ++k) {
+            const auto T = lengths[k];
+            if (T == 0) {
+                logprobs[k] = 0;
+                continue;
+            }
+            auto* gamma = gammaPtrs[k] ? gammaPtrs[k] : gammaBuffer.data();
+            logprobs[k] = forwardBackwardParallelInTimeImpl(transitionMatrix, pObsRows(k), pi, alpha.data(),
+                                                            beta.data(), gamma, trajectoryCounts.data(), N, T);
+            for (std::size_t ij = 0; ij < N * N; ++ij) {
+                counts[ij] += trajectoryCounts[ij];
+            }
+            for (std::size_t i = 0; i < N; ++i) {
+                initialCounts[i] += gamma[i];
+            }
+            if (nStats > 0) {
+                // emission statistics over contiguous chunks of time steps, reduced in chunk order
+                std::fill(chunkStats.begin(), chunkStats.end(), static_cast<dtype>(0));
+                auto* chunkStatsPtr = chunkStats.data();
+                #pragma omp parallel for default(none) firstprivate(nChunks, nStats, chunkStatsPtr, gamma, N, T, k) \
+                        shared(emission)
+                for (std::int64_t c = 0; c < nChunks; ++c) {
+                    for (auto t = c * T / nChunks; t < (c + 1) * T / nChunks; ++t) {
+                        emission(k, t, static_cast<const dtype*>(gamma + t * N), chunkStatsPtr + c * nStats);
+                    }
+                }
+                for (std::size_t i = 0; i < nChunks * nStats; ++i) {
+                    stats[i % nStats] += chunkStats[i];
+                }
+            }
+        }
+        return;
+    }
+
+    const auto blockStarts = detail::batchBlocks(lengths);
+    const auto nBlocks = static_cast<std::int64_t>(blockStarts.size()) - 1;
+    std::vector<dtype> blockCounts(nBlocks * N * N, 0);
+    std::vector<dtype> blockInitialCounts(nBlocks * N, 0);
+    std::vector<dtype> blockStats(nBlocks * nStats, 0);
+
+    #pragma omp parallel for schedule(dynamic) default(none) \
+            firstprivate(nBlocks, N, nStats, transitionMatrix, pi, logprobs) \
+            shared(blockStarts, lengths, pObsRows, gammaPtrs, blockCounts, blockInitialCounts, blockStats, emission)
+    for (std::int64_t b = 0; b < nBlocks; ++b) {
+        std::vector<dtype> alpha, beta, trajectoryCounts(N * N), row(N);
+        auto* blockCountsPtr = blockCounts.data() + b * N * N;
+        auto* blockInitialCountsPtr = blockInitialCounts.data() + b * N;
+        auto* blockStatsPtr = blockStats.data() + b * nStats;
+        for (auto k = blockStarts[b]; k < blockStarts[b + 1]; ++k) {
+            const auto T = lengths[k];
+            if (T == 0) {
+                logprobs[k] = 0;
+                continue;
+            }
+            alpha.resize(T * N);
+            beta.resize(T * N);
+            const auto pObs = pObsRows(k);
+            logprobs[k] = forwardImpl(transitionMatrix, pObs, pi, alpha.data(), N, T);
+            backwardImpl(transitionMatrix, pObs, beta.data(), N, T);
+            transitionCountsImpl(alpha.data(), beta.data(), transitionMatrix, pObs, trajectoryCounts.data(), N, T);
+            // the first state probabilities separately, later rows are not kept if gamma is not stored
+            detail::emitStateProbabilities(alpha.data(), beta.data(), gammaPtrs[k], row.data(), N, k, 0, 1,
+                                           blockStatsPtr, emission);
+            const auto* gamma0 = gammaPtrs[k] ? gammaPtrs[k] : row.data();
+            for (std::size_t i = 0; i < N; ++i) {
+                blockInitialCountsPtr[i] += gamma0[i];
+            }
+            detail::emitStateProbabilities(alpha.data(), beta.data(), gammaPtrs[k], row.data(), N, k, 1, T,
+                                           blockStatsPtr, emission);
+            for (std::size_t ij = 0; ij < N * N; ++ij) {
+                blockCountsPtr[ij] += trajectoryCounts[ij];
+            }
+        }
+    }
+
+    for (std::int64_t b = 0; b < nBlocks; ++b) {
+        for (std::size_t ij = 0; ij < N * N; ++ij) {
+            counts[ij] += blockCounts[b * N * N + ij];
+        }
+        for (std::size_t i = 0; i < N; ++i) {
+            initialCounts[i] += blockInitialCounts[b * N + i];
+        }
+        for (std::size_t s = 0; s < nStats; ++s) {
+            stats[s] += blockStats[b * nStats + s];
+        }
+    }
+}
+
+/**
+ * Batched forward-backward pass over the materialized state probability trajectories of batch, see above.
+ */
+template<typename dtype, typename Emission>
+void forwardBackwardBatchImpl(const dtype* const transitionMatrix, const dtype* const pi,
+                              const BatchArrays<dtype> &batch, bool parallelInTime, dtype* const logprobs,
+                              dtype* const counts, dtype* const initialCounts, std::size_t nStats,
+                              dtype* const stats, Emission &&emission) {
+    const auto &pObsPtrs = batch.pObsPtrs;
+    const auto N = batch.nStates;
+    forwardBackwardBatchImpl(transitionMatrix, pi, batch, [&pObsPtrs, N](std::size_t k) {
+        return detail::DensePObs<dtype>{pObsPtrs[k], N};
+    }, parallelInTime, logprobs, counts, initialCounts, nStats, stats, std::forward<Emission>(emission));
+}
+
+template<typename dtype>
+std::tuple<np_array<dtype>, np_array<dtype>, np_array<dtype>>
+forwardBackwardBatch(const np_array<dtype> &transitionMatrix, const py::list &pObsList, const np_array<dtype> &pi,
+                     const py::list &gammaList, bool parallelInTime) {
+    auto batch = batchArrays(transitionMatrix, pObsList, pi, gammaList);
+    auto N = batch.nStates;
+
+    np_array<dtype> logprobs (std::vector<std::size_t>{batch.lengths.size()});
+    np_array<dtype> counts (std::vector<std::size_t>{N, N});
+    np_array<dtype> initialCounts (std::vector<std::size_t>{N});
+    auto* logprobsPtr = logprobs.mutable_data();
+    auto* countsPtr = counts.mutable_data();
+    auto* initialCountsPtr = initialCounts.mutable_data();
+    {
+        py::gil_scoped_release gil;
+        forwardBackwardBatchImpl(transitionMatrix.data(), pi.data(), batch, parallelInTime, logprobsPtr, countsPtr,
+                                 initialCountsPtr, 0, static_cast<dtype*>(nullptr),
+                                 [](std::size_t, std::size_t, const dtype*, dtype*) {});
+    }
+    return std::make_tuple(logprobs, counts, initialCounts);
+}
+
+namespace detail {
+
+inline std::size_t defaultCheckpointInterval(std::size_t T) {
+    return std::max(static_cast<std::size_t>(1), static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(T)))));
+}
+
+/**
+ * Forward-backward pass which stores only every interval-th alpha. The backward sweep recomputes the alphas of one
+ * segment at a time from its checkpoint, so that memory is O((T / interval + interval) * N) at the cost of a second
+ * forward pass. Emission probabilities are requested row by row through pObsRow(t, out), the state probabilities of
+ * each time step are handed to emission(t, gamma_t) in reverse time order and only written to gamma if it is not null.
+ * Transition counts are added onto counts, the state probabilities of the first time step are written to gamma0.
+ */
+template<std::size_t DIM, typename dtype, typename PObsRow, typename Emission>
+dtype forwardBackwardCheckpointed(const dtype* const transitionMatrix, const dtype* const transitionMatrixT,
+                                  const dtype* const pi, std::size_t N, std::size_t T, std::size_t interval,
+                                  PObsRow &&pObsRow, Emission &&emission, dtype* const counts, dtype* const gamma0,
+                                  dtype* const gamma) {
+    const auto n = DIM > 0 ? DIM : N;
+    const auto nSegments = (T + interval - 1) / interval;
+
+    std::vector<dtype> checkpoints(nSegments * n);
+    std::vector<dtype> alpha(interval * n), pObs(interval * n);
+    std::vector<dtype> alphaNext(n), pObsNext(n), beta(n), betaPrev(n), weights(n), gammaRow(n), tmp(n * n);
+
+    // forward sweep, keeping the first alpha of each segment
+    pObsRow(0, pObs.data());
+    std::copy(pi, pi + n, alpha.data());
+    auto scaling = multiplySum<DIM>(alpha.data(), pObs.data(), n);
+    dtype logprob = std::log(scaling);
+    if (scaling != 0) {
+        scale<DIM>(alpha.data(), 1 / scaling, n);
+    }
+    std::copy(alpha.begin(), alpha.begin() + n, checkpoints.begin());
+    for (std::size_t t = 1; t < T; ++t) {
+        pObsRow(t, pObsNext.data());
+        logprob += std::log(forwardStep<DIM>(transitionMatrixT, alpha.data(), pObsNext.data(), alphaNext.data(), n));
+        std::copy(alphaNext.begin(), alphaNext.end(), alpha.begin());
+        if (t % interval == 0) {
+            std::copy(alphaNext.begin(), alphaNext.end(), checkpoints.begin() + (t / interval) * n);
+        }
+    }
+
+    // backward sweep over the segments in reverse order
+    std::fill(beta.begin(), beta.end(), static_cast<dtype>(1) / static_cast<dtype>(n));
+    for (auto segment = nSegments; segment-- > 0;) {
+        const auto start = segment * interval;
+        const auto length = std::min(interval, T - start);
+
+        // recompute the alphas and emission probabilities of this segment
+        std::copy(checkpoints.begin() + segment * n, checkpoints.begin() + (segment + 1) * n, alpha.begin());
+        pObsRow(start, pObs.data());
+        for (std::size_t t = 1; t < length; ++t) {
+            pObsRow(start + t, pObs.data() + t * n);
+            forwardStep<DIM>(transitionMatrixT, alpha.data() + (t - 1) * n, pObs.data() + t * n,
+                             alpha.data() + t * n, n);
+        }
+
+        for (auto t = length; t-- > 0;) {
+            const auto* alphaT = alpha.data() + t * n;
+            if (start + t < T - 1) {
+                // beta currently holds beta_{t+1} and pObsNext holds pobs_{t+1}
+                backwardStep<DIM>(transitionMatrix, beta.data(), pObsNext.data(), betaPrev.data(), weights.data(), n);
+                accumulateTransitionCounts(alphaT, transitionMatrix, weights.data(), tmp.data(), counts, n);
+                std::swap(beta, betaPrev);
+            }
+
+            std::copy(alphaT, alphaT + n, gammaRow.begin());
+            auto rowSum = multiplySum<DIM>(gammaRow.data(), beta.data(), n);
+            if (rowSum != 0) {
+                scale<DIM>(gammaRow.data(), 1 / rowSum, n);
+            }
+            emission(start + t, gammaRow.data());
+            if (gamma) {
+                std::copy(gammaRow.begin(), gammaRow.end(), gamma + (start + t) * n);
+            }
+            std::copy(pObs.begin() + t * n, pObs.begin() + (t + 1) * n, pObsNext.begin());
+        }
+    }
+    std::copy(gammaRow.begin(), gammaRow.end(), gamma0);
     return logprob;
 }
+
+}
+
+/**
+ * Checkpointed forward-backward pass for a trajectory of length T > 0, see detail::forwardBackwardCheckpointed.
+ * An interval of zero selects ceil(sqrt(T)), giving O(sqrt(T) N) memory.
+ */
+template<typename dtype, typename PObsRow, typename Emission>
+dtype forwardBackwardCheckpointedImpl(const dtype* const transitionMatrix, const dtype* const pi, std::size_t N,
+                                      std::size_t T, std::size_t interval, PObsRow &&pObsRow, Emission &&emission,
+                                      dtype* const counts, dtype* const gamma0, dtype* const gamma) {
+    if (interval == 0) {
+        interval = detail::defaultCheckpointInterval(T);
+    }
+    interval = std::min(interval, T);
+    const auto transitionMatrixT = detail::transposed(transitionMatrix, N);
+    return detail::dispatchStates(N, [&](auto dim) {
+        return detail::forwardBackwardCheckpointed<decltype(dim)::value>(
+                transitionMatrix, transitionMatrixT.data(), pi, N, T, interval, pObsRow, emission, counts, gamma0,
+                gamma);
+    });
+}
+
+namespace detail {
+
+/**
+ * Viterbi backpointer tables of more than this many bytes are replaced by checkpointed decoding.
+ */
+static constexpr std::size_t maxViterbiTableBytes = static_cast<std::size_t>(1) << 28;
+
+/**
+ * Calls f with a value of the smallest unsigned integer type that can hold the state indices of an N-state model.
+ */
+template<typename F>
+void dispatchBackpointers(std::size_t N, F &&f) {
+    if (N <= std::numeric_limits<std::uint8_t>::max() + static_cast<std::size_t>(1)) {
+        f(std::uint8_t{});
+    } else if (N <= std::numeric_limits<std::uint16_t>::max() + static_cast<std::size_t>(1)) {
+        f(std::uint16_t{});
+    } else {
+        f(std::uint32_t{});
+    }
+}
+
+/**
+ * Signed integer of the same width as dtype, used for the running argmax so that it shares the SIMD lanes of the
+ * running maximum.
+ */
+template<typename dtype>
+using LaneIndex = std::conditional_t<sizeof(dtype) == sizeof(std::int32_t), std::int32_t, std::int64_t>;
+
+/**
+ * Max-plus step in log space, deltaNext[j] = max_i (delta[i] + logTransitionMatrix[i, j]) + log(pObsNext[j]), with
+ * the first maximizing i written to backpointers[j]. The rows of the transition matrix are swept in order and every
+ * sweep is a branch-free select over contiguous j, so that both the maximum and its index (in argmax, of length N)
+ * are computed in SIMD lanes. deltaNext is shifted so that its maximum is zero, which keeps single precision accurate
+ * over long trajectories without changing any decision.
+ */
+template<typename dtype, typename Index>
+void viterbiStep(const dtype* const logTransitionMatrix, const dtype* const delta, const dtype* const pObsNext,
+                 dtype* const deltaNext, LaneIndex<dtype>* const argmax, Index* const backpointers, std::size_t N) {
+    #pragma omp simd
+    for (std::size_t j = 0; j < N; ++j) {
+        deltaNext[j] = delta[0] + logTransitionMatrix[j];
+        argmax[j] = 0;
+    }
+    for (std::size_t i = 1; i < N; ++i) {
+        const auto* row = logTransitionMatrix + i * N;
+        const auto deltaI = delta[i];
+        const auto index = static_cast<LaneIndex<dtype>>(i);
+        // two single-select sweeps, which baseline x86-64 if-converts unlike one sweep with two selects
+        #pragma omp simd
+        for (std::size_t j = 0; j < N; ++j) {
+            const auto previous = argmax[j];
+            argmax[j] = deltaI + row[j] > deltaNext[j] ? index : previous;
+        }
+        #pragma omp simd
+        for (std::size_t j = 0; j < N; ++j) {
+            const auto candidate = deltaI + row[j];
+            const auto previous = deltaNext[j];
+            deltaNext[j] = candidate > previous ? candidate : previous;
+        }
+    }
+    auto maxDelta = -std::numeric_limits<dtype>::infinity();
+    for (std::size_t j = 0; j < N; ++j) {
+        backpointers[j] = static_cast<Index>(argmax[j]);
+        deltaNext[j] += std::log(pObsNext[j]);
+        maxDelta = std::max(maxDelta, deltaNext[j]);
+    }
+    if (std::isfinite(maxDelta)) {
+        for (std::size_t j = 0; j < N; ++j) {
+            deltaNext[j] -= maxDelta;
+        }
+    }
+}
+
+/**
+ * Log-space Viterbi decoding of a trajectory of length T > 0 into path. Backpointers are stored for at most interval
+ * time steps: if interval < T, only every interval-th delta is kept during the forward sweep and the backpointers of
+ * one segment at a time are recomputed from its checkpoint while backtracking, giving O((T / interval + interval) N)
+ * memory at the cost of a second forward sweep.
+ */
+template<typename Index, typename dtype>
+void viterbiDecode(const dtype* const logTransitionMatrix, const dtype* const pObs, const dtype* const pi,
+                   std::size_t N, std::size_t T, std::size_t interval, std::int32_t* const path) {
+    const auto nSegments = (T + interval - 1) / interval;
+    std::vector<dtype> delta(N), deltaNext(N), checkpoints(nSegments > 1 ? nSegments * N : 0);
+    std::vector<LaneIndex<dtype>> argmax(N);
+    std::vector<Index> backpointers(std::min(interval, T - 1) * N);
+
+    auto maxDelta = -std::numeric_limits<dtype>::infinity();
+    for (std::size_t i = 0; i < N; ++i) {
+        delta[i] = std::log(pi[i]) + std::log(pObs[i]);
+        maxDelta = std::max(maxDelta, delta[i]);
+    }
+    if (std::isfinite(maxDelta)) {
+        for (std::size_t i = 0; i < N; ++i) {
+            delta[i] -= maxDelta;
+        }
+    }
+
+    // forward sweep, with a single segment the backpointers are kept directly
+    for (std::size_t t = 1; t < T; ++t) {
+        if (nSegments > 1 && (t - 1) % interval == 0) {
+            std::copy(delta.begin(), delta.end(), checkpoints.begin() + ((t - 1) / interval) * N);
+        }
+        auto* rowBackpointers = backpointers.data() + (nSegments > 1 ? 0 : (t - 1) * N);
+        viterbiStep(logTransitionMatrix, delta.data(), pObs + t * N, deltaNext.data(), argmax.data(), rowBackpointers,
+                    N);
+        std::swap(delta, deltaNext);
+    }
+    path[T - 1] = static_cast<std::int32_t>(std::distance(delta.begin(), std::max_element(delta.begin(),
+                                                                                           delta.end())));
+
+    // backtracking, segment s owns the backpointers of the time steps (s * interval, min((s + 1) * interval, T - 1)]
+    for (auto segment = nSegments; segment-- > 0;) {
+        const auto start = segment * interval;
+        const auto end = std::min(start + interval, T - 1);
+        if (end == start) {
+            continue;
+        }
+        if (nSegments > 1) {
+            std::copy(checkpoints.begin() + segment * N, checkpoints.begin() + (segment + 1) * N, delta.begin());
+            for (auto t = start + 1; t <= end; ++t) {
+                viterbiStep(logTransitionMatrix, delta.data(), pObs + t * N, deltaNext.data(), argmax.data(),
+                            backpointers.data() + (t - start - 1) * N, N);
+                std::swap(delta, deltaNext);
+            }
+        }
+        for (auto t = end; t > start; --t) {
+            path[t - 1] = static_cast<std::int32_t>(backpointers[(t - start - 1) * N + path[t]]);
+        }
+    }
+}
+
+template<typename dtype>
+std::vector<dtype> elementwiseLog(const dtype* const x, std::size_t n) {
+    std::vector<dtype> result(n);
+    std::transform(x, x + n, result.begin(), [](dtype v) { return std::log(v); });
+    return result;
+}
+
+}
+
+/**
+ * Viterbi path of a trajectory of length T > 0. The backpointers use the smallest index type that fits N; an interval
+ * of zero keeps the full backpointer table unless it would exceed detail::maxViterbiTableBytes, in which case
+ * ceil(sqrt(T)) is used.
+ */
+template<typename dtype>
+void viterbiImpl(const dtype* const logTransitionMatrix, const dtype* const pObs, const dtype* const pi,
+                 std::size_t N, std::size_t T, std::size_t interval, std::int32_t* const path) {
+    detail::dispatchBackpointers(N, [&](auto index) {
+        if (interval == 0) {
+            interval = T * N * sizeof(index) > detail::maxViterbiTableBytes ? detail::defaultCheckpointInterval(T) : T;
+        }
+        detail::viterbiDecode<decltype(index)>(logTransitionMatrix, pObs, pi, N, T, std::min(interval, T), path);
+    });
+}
+
+/**
+ * computes viterbi path
+ * @tparam dtype dtype
+ * @param transitionMatrix (N, N) transition matrix
+ * @param stateProbabilityTraj (T, N) pobs
+ * @param initialDistribution (N,) init dist
+ * @param checkpointInterval number of time steps per stored backpointer segment, zero for automatic
+ * @return (T, )ndarray
+ */
+template<typename dtype>
+np_array<std::int32_t> viterbiPath(const np_array<dtype> &transitionMatrix, const np_array<dtype> &stateProbabilityTraj,
+                                   const np_array<dtype> &initialDistribution, std::size_t checkpointInterval) {
+    if (transitionMatrix.ndim() < 1 || stateProbabilityTraj.ndim() < 1) {
+        throw std::invalid_argument("transition matrix and pobs need to be at least 1-dimensional.");
+    }
+    auto N = static_cast<std::size_t>(transitionMatrix.shape(0));
+    auto T = static_cast<std::size_t>(stateProbabilityTraj.shape(0));
+    {
+        // check shapes
+        if (transitionMatrix.ndim() != 2) throw std::invalid_argument("transition matrix must be 2-dimensional");
+        if (transitionMatrix.shape(1) != transitionMatrix.shape(0)) {
+            throw std::invalid_argument("Transition matrix must be (N, N) but was (" + std::to_string(N) + ", " +
+                                        std::to_string(transitionMatrix.shape(1)) + ")");
+        }
+        if (stateProbabilityTraj.ndim() != 2) throw std::invalid_argument("pobs must be 2-dimensional");
+        if (static_cast<std::size_t>(stateProbabilityTraj.shape(1)) != N) {
+            std::stringstream ss;
+            ss << "State probablity trajectory must be (T, N) = (" << T << ", " << N << ") dimensional but was (";
+            ss << stateProbabilityTraj.shape(0) << ", " << stateProbabilityTraj.shape(1) << ")";
+            throw std::invalid_argument(ss.str());
+        }
+        if (initialDistribution.ndim() != 1) throw std::invalid_argument("initial distribution must be 1-dimensional");
+        if (static_cast<std::size_t>(initialDistribution.shape(0)) != N) {
+            throw std::invalid_argument(
+                    "initial distribution must have length N = " + std::to_string(N) + " but had len=" +
+                    std::to_string(initialDistribution.shape(0)));
+        }
+        if (T == 0 || N == 0) {
+            throw std::invalid_argument("Needs T and N to be at least 1, i.e., no empty arrays permitted.");
+        }
+    }
+    np_array<std::int32_t> path(std::vector<std::size_t>{T});
+    auto* pathBuf = path.mutable_data();
+    auto* pobsBuf = stateProbabilityTraj.data();
+    auto* piBuf = initialDistribution.data();
+    auto logTransitionMatrix = detail::elementwiseLog(transitionMatrix.data(), N * N);
+    {
+        py::gil_scoped_release gil;
+        viterbiImpl(logTransitionMatrix.data(), pobsBuf, piBuf, N, T, checkpointInterval, pathBuf);
+    }
+    return path;
+}
+
+/**
+ * Viterbi paths of a list of state probability trajectories, decoded in parallel over the trajectories.
+ */
+template<typename dtype>
+py::list viterbiBatch(const np_array<dtype> &transitionMatrix, const py::list &pObsList,
+                      const np_array<dtype> &initialDistribution, std::size_t checkpointInterval) {
+    auto batch = batchArrays(transitionMatrix, pObsList, initialDistribution, py::none());
+    const auto N = batch.nStates;
+    const auto nTrajectories = static_cast<std::int64_t>(batch.lengths.size());
+
+    std::vector<np_array<std::int32_t>> paths;
+    std::vector<std::int32_t*> pathPtrs;
+    paths.reserve(nTrajectories);
+    for (auto T : batch.lengths) {
+        paths.emplace_back(std::vector<std::size_t>{T});
+        pathPtrs.push_back(paths.back().mutable_data());
+    }
+    auto logTransitionMatrix = detail::elementwiseLog(transitionMatrix.data(), N * N);
+    {
+        py::gil_scoped_release gil;
+        const auto* logTransitionMatrixPtr = logTransitionMatrix.data();
+        const auto* pi = initialDistribution.data();
+        #pragma omp parallel for schedule(dynamic) default(none) \
+                firstprivate(nTrajectories, N, checkpointInterval, logTransitionMatrixPtr, pi) \
+                shared(batch, pathPtrs)
+        for (std::int64_t k = 0; k < nTrajectories; ++k) {
+            if (batch.lengths[k] > 0) {
+                viterbiImpl(logTransitionMatrixPtr, batch.pObsPtrs[k], pi, N, batch.lengths[k], checkpointInterval,
+                            pathPtrs[k]);
+            }
+        }
+    }
+    py::list result;
+    for (auto &path : paths) {
+        result.append(path);
+    }
+    return result;
+}
@@ -5,26 +5,35 @@
 #include "common.h"
 #include "utils.h"
 #include "OutputModelUtils.h"
+#include "BaumWelch.h"
+#include "GibbsSampler.h"
 #include "docs.h"
 
 using namespace pybind11::literals;
 
 PYBIND11_MODULE(_hmm_bindings, m) {
+    py::register_exception<hmm::gibbs::DisconnectedCountMatrix>(m, "DisconnectedCountMatrixError",
+                                                                PyExc_NotImplementedError);
     auto outputModels = m.def_submodule("output_models");
     outputModels.def("handle_outliers", &hmm::output_models::handleOutliers<float>);
     outputModels.def("handle_outliers", &hmm::output_models::handleOutliers<double>);
     {
         auto discreteModule = outputModels.def_submodule("discrete");
         discreteModule.def("generate_observation_trajectory",
-                          &hmm::output_models::discrete::generateObservationTrajectory<float, std::int16_t>);
+                          &hmm::output_models::discrete::generateObservationTrajectory<float, std::int16_t>,
+                           "hidden_state_trajectory"_a, "output_probabilities"_a, "seed"_a = -1);
         discreteModule.def("generate_observation_trajectory",
-                           &hmm::output_models::discrete::generateObservationTrajectory<float, std::int32_t>);
+                           &hmm::output_models::discrete::generateObservationTrajectory<float, std::int32_t>,
+                           "hidden_state_trajectory"_a, "output_probabilities"_a, "seed"_a = -1);
         discreteModule.def("generate_observation_trajectory",
-                           &hmm::output_models::discrete::generateObservationTrajectory<float, std::int64_t>);
+                           &hmm::output_models::discrete::generateObservationTrajectory<float, std::int64_t>,
+                           "hidden_state_trajectory"_a, "output_probabilities"_a, "seed"_a = -1);
         discreteModule.def("generate_observation_trajectory",
-                           &hmm::output_models::discrete::generateObservationTrajectory<double, std::int32_t>);
+                           &hmm::output_models::discrete::generateObservationTrajectory<double, std::int32_t>,
+                           "hidden_state_trajectory"_a, "output_probabilities"_a, "seed"_a = -1);
         discreteModule.def("generate_observation_trajectory",
-                           &hmm::output_models::discrete::generateObservationTrajectory<double, std::int64_t>);
+                           &hmm::output_models::discrete::generateObservationTrajectory<double, std::int64_t>,
+                           "hidden_state_trajectory"_a, "output_probabilities"_a, "seed"_a = -1);
         discreteModule.def("to_output_probability_trajectory",
                            &hmm::output_models::discrete::toOutputProbabilityTrajectory<float, std::int32_t>);
         discreteModule.def("to_output_probability_trajectory",
@@ -45,6 +54,98 @@ PYBIND11_MODULE(_hmm_bindings, m) {
         discreteModule.def("update_p_out", &hmm::output_models::discrete::updatePOut<double, std::int16_t>);
         discreteModule.def("update_p_out", &hmm::output_models::discrete::updatePOut<double, std::int32_t>);
         discreteModule.def("update_p_out", &hmm::output_models::discrete::updatePOut<double, std::int64_t>);
+        discreteModule.def("forward_backward_batch",
+                           &hmm::output_models::discrete::forwardBackwardBatch<float, std::int32_t>, "transition_matrix"_a,
+                           "output_probabilities"_a, "initial_distribution"_a, "observations"_a, "ignore_outliers"_a,
+                           "gammas_out"_a = py::none(), "parallel_in_time"_a = false);
+        discreteModule.def("forward_backward_batch",
+                           &hmm::output_models::discrete::forwardBackwardBatch<float, std::int64_t>, "transition_matrix"_a,
+                           "output_probabilities"_a, "initial_distribution"_a, "observations"_a, "ignore_outliers"_a,
+                           "gammas_out"_a = py::none(), "parallel_in_time"_a = false);
+        discreteModule.def("forward_backward_batch",
+                           &hmm::output_models::discrete::forwardBackwardBatch<double, std::int32_t>, "transition_matrix"_a,
+                           "output_probabilities"_a, "initial_distribution"_a, "observations"_a, "ignore_outliers"_a,
+                           "gammas_out"_a = py::none(), "parallel_in_time"_a = false);
+        discreteModule.def("forward_backward_batch",
+                           &hmm::output_models::discrete::forwardBackwardBatch<double, std::int64_t>, "transition_matrix"_a,
+                           "output_probabilities"_a, "initial_distribution"_a, "observations"_a, "ignore_outliers"_a,
+                           "gammas_out"_a = py::none(), "parallel_in_time"_a = false);
+        discreteModule.def("log_likelihoods", &hmm::output_models::discrete::logLikelihoods<float, std::int32_t>,
+                           "transition_matrices"_a, "initial_distributions"_a, "output_probabilities"_a,
+                           "ignore_outliers"_a, "observations"_a);
+        discreteModule.def("log_likelihoods", &hmm::output_models::discrete::logLikelihoods<float, std::int64_t>,
+                           "transition_matrices"_a, "initial_distributions"_a, "output_probabilities"_a,
+                           "ignore_outliers"_a, "observations"_a);
+        discreteModule.def("log_likelihoods", &hmm::output_models::discrete::logLikelihoods<double, std::int32_t>,
+                           "transition_matrices"_a, "initial_distributions"_a, "output_probabilities"_a,
+                           "ignore_outliers"_a, "observations"_a);
+        discreteModule.def("log_likelihoods", &hmm::output_models::discrete::logLikelihoods<double, std::int64_t>,
+                           "transition_matrices"_a, "initial_distributions"_a, "output_probabilities"_a,
+                           "ignore_outliers"_a, "observations"_a);
+        discreteModule.def("forward_backward_checkpointed",
+                           &hmm::output_models::discrete::forwardBackwardCheckpointed<float, std::int32_t>,
+                           "transition_matrix"_a, "output_probabilities"_a, "initial_distribution"_a, "observations"_a,
+                           "ignore_outliers"_a, "checkpoint_interval"_a = 0, "gamma_out"_a = py::none());
+        discreteModule.def("forward_backward_checkpointed",
+                           &hmm::output_models::discrete::forwardBackwardCheckpointed<float, std::int64_t>,
+                           "transition_matrix"_a, "output_probabilities"_a, "initial_distribution"_a, "observations"_a,
+                           "ignore_outliers"_a, "checkpoint_interval"_a = 0, "gamma_out"_a = py::none());
+        discreteModule.def("forward_backward_checkpointed",
+                           &hmm::output_models::discrete::forwardBackwardCheckpointed<double, std::int32_t>,
+                           "transition_matrix"_a, "output_probabilities"_a, "initial_distribution"_a, "observations"_a,
+                           "ignore_outliers"_a, "checkpoint_interval"_a = 0, "gamma_out"_a = py::none());
+        discreteModule.def("forward_backward_checkpointed",
+                           &hmm::output_models::discrete::forwardBackwardCheckpointed<double, std::int64_t>,
+                           "transition_matrix"_a, "output_probabilities"_a, "initial_distribution"_a, "observations"_a,
+                           "ignore_outliers"_a, "checkpoint_interval"_a = 0, "gamma_out"_a = py::none());
+        discreteModule.def("baum_welch", &hmm::baum_welch::discrete::baumWelch<float, std::int32_t>,
+                           "transition_matrix"_a, "initial_distribution"_a, "output_probabilities"_a,
+                           "ignore_outliers"_a, "observations"_a, "gammas_out"_a, "reversible"_a, "stationary"_a,
+                           "fixed_stationary_distribution"_a, "fixed_initial_distribution"_a, "accuracy"_a, "maxit"_a,
+                           "maxit_reversible"_a, "parallel_in_time"_a = false, "callback"_a = py::none());
+        discreteModule.def("baum_welch", &hmm::baum_welch::discrete::baumWelch<float, std::int64_t>,
+                           "transition_matrix"_a, "initial_distribution"_a, "output_probabilities"_a,
+                           "ignore_outliers"_a, "observations"_a, "gammas_out"_a, "reversible"_a, "stationary"_a,
+                           "fixed_stationary_distribution"_a, "fixed_initial_distribution"_a, "accuracy"_a, "maxit"_a,
+                           "maxit_reversible"_a, "parallel_in_time"_a = false, "callback"_a = py::none());
+        discreteModule.def("baum_welch", &hmm::baum_welch::discrete::baumWelch<double, std::int32_t>,
+                           "transition_matrix"_a, "initial_distribution"_a, "output_probabilities"_a,
+                           "ignore_outliers"_a, "observations"_a, "gammas_out"_a, "reversible"_a, "stationary"_a,
+                           "fixed_stationary_distribution"_a, "fixed_initial_distribution"_a, "accuracy"_a, "maxit"_a,
+                           "maxit_reversible"_a, "parallel_in_time"_a = false, "callback"_a = py::none());
+        discreteModule.def("baum_welch", &hmm::baum_welch::discrete::baumWelch<double, std::int64_t>,
+                           "transition_matrix"_a, "initial_distribution"_a, "output_probabilities"_a,
+                           "ignore_outliers"_a, "observations"_a, "gammas_out"_a, "reversible"_a, "stationary"_a,
+                           "fixed_stationary_distribution"_a, "fixed_initial_distribution"_a, "accuracy"_a, "maxit"_a,
+                           "maxit_reversible"_a, "parallel_in_time"_a = false, "callback"_a = py::none());
+        discreteModule.def("gibbs_sample", &hmm::gibbs::discrete::sample<float, std::int32_t>, "transition_matrix"_a,
+                           "initial_distribution"_a, "output_probabilities"_a, "output_prior"_a, "ignore_outliers"_a,
+                           "observations"_a, "transition_matrix_prior"_a, "initial_distribution_prior"_a,
+                           "reversible"_a, "stationary"_a, "n_transition_matrix_sampling_steps"_a, "n_burn_in"_a,
+                           "n_thin"_a, "seed"_a, "transition_matrices_out"_a, "stationary_distributions_out"_a,
+                           "output_probabilities_out"_a, "counts_out"_a,
+                           "hidden_state_trajectories_out"_a = py::none());
+        discreteModule.def("gibbs_sample", &hmm::gibbs::discrete::sample<float, std::int64_t>, "transition_matrix"_a,
+                           "initial_distribution"_a, "output_probabilities"_a, "output_prior"_a, "ignore_outliers"_a,
+                           "observations"_a, "transition_matrix_prior"_a, "initial_distribution_prior"_a,
+                           "reversible"_a, "stationary"_a, "n_transition_matrix_sampling_steps"_a, "n_burn_in"_a,
+                           "n_thin"_a, "seed"_a, "transition_matrices_out"_a, "stationary_distributions_out"_a,
+                           "output_probabilities_out"_a, "counts_out"_a,
+                           "hidden_state_trajectories_out"_a = py::none());
+        discreteModule.def("gibbs_sample", &hmm::gibbs::discrete::sample<double, std::int32_t>, "transition_matrix"_a,
+                           "initial_distribution"_a, "output_probabilities"_a, "output_prior"_a, "ignore_outliers"_a,
+                           "observations"_a, "transition_matrix_prior"_a, "initial_distribution_prior"_a,
+                           "reversible"_a, "stationary"_a, "n_transition_matrix_sampling_steps"_a, "n_burn_in"_a,
+                           "n_thin"_a, "seed"_a, "transition_matrices_out"_a, "stationary_distributions_out"_a,
+                           "output_probabilities_out"_a, "counts_out"_a,
+                           "hidden_state_trajectories_out"_a = py::none());
+        discreteModule.def("gibbs_sample", &hmm::gibbs::discrete::sample<double, std::int64_t>, "transition_matrix"_a,
+                           "initial_distribution"_a, "output_probabilities"_a, "output_prior"_a, "ignore_outliers"_a,
+                           "observations"_a, "transition_matrix_prior"_a, "initial_distribution_prior"_a,
+                           "reversible"_a, "stationary"_a, "n_transition_matrix_sampling_steps"_a, "n_burn_in"_a,
+                           "n_thin"_a, "seed"_a, "transition_matrices_out"_a, "stationary_distributions_out"_a,
+                           "output_probabilities_out"_a, "counts_out"_a,
+                           "hidden_state_trajectories_out"_a = py::none());
     }
     {
         auto gaussian = outputModels.def_submodule("gaussian");
@@ -56,16 +157,85 @@ PYBIND11_MODULE(_hmm_bindings, m) {
         gaussian.def("to_output_probability_trajectory",
                      &hmm::output_models::gaussian::toOutputProbabilityTrajectory<float>);
         gaussian.def("generate_observation_trajectory",
-                     &hmm::output_models::gaussian::generateObservationTrajectory<float>);
+                     &hmm::output_models::gaussian::generateObservationTrajectory<float>, "hidden_state_trajectory"_a,
+                     "means"_a, "sigmas"_a, "seed"_a = -1);
         gaussian.def("generate_observation_trajectory",
-                     &hmm::output_models::gaussian::generateObservationTrajectory<double>);
+                     &hmm::output_models::gaussian::generateObservationTrajectory<double>, "hidden_state_trajectory"_a,
+                     "means"_a, "sigmas"_a, "seed"_a = -1);
+        gaussian.def("forward_backward_batch", &hmm::output_models::gaussian::forwardBackwardBatch<float>,
+                     "transition_matrix"_a, "state_probability_trajectories"_a, "initial_distribution"_a,
+                     "observations"_a, "shifts"_a, "gammas_out"_a = py::none(), "parallel_in_time"_a = false);
+        gaussian.def("forward_backward_batch", &hmm::output_models::gaussian::forwardBackwardBatch<double>,
+                     "transition_matrix"_a, "state_probability_trajectories"_a, "initial_distribution"_a,
+                     "observations"_a, "shifts"_a, "gammas_out"_a = py::none(), "parallel_in_time"_a = false);
+        gaussian.def("log_likelihoods", &hmm::output_models::gaussian::logLikelihoods<float>,
+                     "transition_matrices"_a, "initial_distributions"_a, "means"_a, "sigmas"_a, "ignore_outliers"_a,
+                     "observations"_a);
+        gaussian.def("log_likelihoods", &hmm::output_models::gaussian::logLikelihoods<double>,
+                     "transition_matrices"_a, "initial_distributions"_a, "means"_a, "sigmas"_a, "ignore_outliers"_a,
+                     "observations"_a);
         gaussian.def("fit32", &hmm::output_models::gaussian::fit<float>);
         gaussian.def("fit64", &hmm::output_models::gaussian::fit<double>);
+        gaussian.def("forward_backward_checkpointed",
+                     &hmm::output_models::gaussian::forwardBackwardCheckpointed<float>, "transition_matrix"_a,
+                     "means"_a, "sigmas"_a, "initial_distribution"_a, "observations"_a, "ignore_outliers"_a,
+                     "checkpoint_interval"_a = 0, "gamma_out"_a = py::none());
+        gaussian.def("forward_backward_checkpointed",
+                     &hmm::output_models::gaussian::forwardBackwardCheckpointed<double>, "transition_matrix"_a,
+                     "means"_a, "sigmas"_a, "initial_distribution"_a, "observations"_a, "ignore_outliers"_a,
+                     "checkpoint_interval"_a = 0, "gamma_out"_a = py::none());
+        gaussian.def("baum_welch", &hmm::baum_welch::gaussian::baumWelch<float>, "transition_matrix"_a,
+                     "initial_distribution"_a, "means"_a, "sigmas"_a, "ignore_outliers"_a, "observations"_a,
+                     "gammas_out"_a, "reversible"_a, "stationary"_a, "fixed_stationary_distribution"_a,
+                     "fixed_initial_distribution"_a, "accuracy"_a, "maxit"_a, "maxit_reversible"_a,
+                     "parallel_in_time"_a = false, "callback"_a = py::none());
+        gaussian.def("baum_welch", &hmm::baum_welch::gaussian::baumWelch<double>, "transition_matrix"_a,
+                     "initial_distribution"_a, "means"_a, "sigmas"_a, "ignore_outliers"_a, "observations"_a,
+                     "gammas_out"_a, "reversible"_a, "stationary"_a, "fixed_stationary_distribution"_a,
+                     "fixed_initial_distribution"_a, "accuracy"_a, "maxit"_a, "maxit_reversible"_a,
+                     "parallel_in_time"_a = false, "callback"_a = py::none());
+    }
+    {
+        auto multivariateGaussian = outputModels.def_submodule("multivariate_gaussian");
+        multivariateGaussian.def("log_output_probability_trajectory",
+                                 &hmm::output_models::multivariate_gaussian::logOutputProbabilityTrajectory<float>,
+                                 "observations"_a, "means"_a, "covariances"_a);
+        multivariateGaussian.def("log_output_probability_trajectory",
+                                 &hmm::output_models::multivariate_gaussian::logOutputProbabilityTrajectory<double>,
+                                 "observations"_a, "means"_a, "covariances"_a);
+        multivariateGaussian.def("generate_observation_trajectory",
+                                 &hmm::output_models::multivariate_gaussian::generateObservationTrajectory<float>,
+                                 "hidden_state_trajectory"_a, "means"_a, "covariances"_a, "seed"_a = -1);
+        multivariateGaussian.def("generate_observation_trajectory",
+                                 &hmm::output_models::multivariate_gaussian::generateObservationTrajectory<double>,
+                                 "hidden_state_trajectory"_a, "means"_a, "covariances"_a, "seed"_a = -1);
+        multivariateGaussian.def("forward_backward_batch",
+                                 &hmm::output_models::multivariate_gaussian::forwardBackwardBatch<float>,
+                                 "transition_matrix"_a, "means"_a, "covariances"_a, "initial_distribution"_a,
+                                 "observations"_a, "ignore_outliers"_a, "gammas_out"_a = py::none(),
+                                 "parallel_in_time"_a = false);
+        multivariateGaussian.def("forward_backward_batch",
+                                 &hmm::output_models::multivariate_gaussian::forwardBackwardBatch<double>,
+                                 "transition_matrix"_a, "means"_a, "covariances"_a, "initial_distribution"_a,
+                                 "observations"_a, "ignore_outliers"_a, "gammas_out"_a = py::none(),
+                                 "parallel_in_time"_a = false);
+        multivariateGaussian.def("weighted_moments", &hmm::output_models::multivariate_gaussian::weightedMoments<float>,
+                                 "observations"_a, "weights"_a, "means"_a, "diagonal"_a);
+        multivariateGaussian.def("weighted_moments", &hmm::output_models::multivariate_gaussian::weightedMoments<double>,
+                                 "observations"_a, "weights"_a, "means"_a, "diagonal"_a);
+        multivariateGaussian.def("log_likelihoods", &hmm::output_models::multivariate_gaussian::logLikelihoods<float>,
+                                 "transition_matrices"_a, "initial_distributions"_a, "means"_a, "covariances"_a,
+                                 "ignore_outliers"_a, "observations"_a);
+        multivariateGaussian.def("log_likelihoods", &hmm::output_models::multivariate_gaussian::logLikelihoods<double>,
+                                 "transition_matrices"_a, "initial_distributions"_a, "means"_a, "covariances"_a,
+                                 "ignore_outliers"_a, "observations"_a);
     }
     {
         auto util = m.def_submodule("util");
-        util.def("viterbi", &viterbiPath<float>, "transition_matrix"_a, "state_probability_trajectory"_a, "initial_distribution"_a, docs::VITERBI);
-        util.def("viterbi", &viterbiPath<double>, "transition_matrix"_a, "state_probability_trajectory"_a, "initial_distribution"_a, docs::VITERBI);
+        util.def("viterbi", &viterbiPath<float>, "transition_matrix"_a, "state_probability_trajectory"_a, "initial_distribution"_a, "checkpoint_interval"_a = 0, docs::VITERBI);
+        util.def("viterbi", &viterbiPath<double>, "transition_matrix"_a, "state_probability_trajectory"_a, "initial_distribution"_a, "checkpoint_interval"_a = 0, docs::VITERBI);
+        util.def("viterbi_batch", &viterbiBatch<float>, "transition_matrix"_a, "state_probability_trajectories"_a, "initial_distribution"_a, "checkpoint_interval"_a = 0, docs::VITERBI_BATCH);
+        util.def("viterbi_batch", &viterbiBatch<double>, "transition_matrix"_a, "state_probability_trajectories"_a, "initial_distribution"_a, "checkpoint_interval"_a = 0, docs::VITERBI_BATCH);
         util.def("forward", &forward<float>, "transition_matrix"_a, "state_probability_trajectory"_a, "initial_distribution"_a, "alpha_out"_a, "T"_a = py::none(), docs::FORWARD);
         util.def("forward", &forward<double>, "transition_matrix"_a, "state_probability_trajectory"_a, "initial_distribution"_a, "alpha_out"_a, "T"_a = py::none(), docs::FORWARD);
         util.def("backward", &backward<float>, "transition_matrix"_a, "state_probability_trajectory"_a, "beta_out"_a, "T"_a = py::none(), docs::BACKWARD);
@@ -77,7 +247,13 @@ PYBIND11_MODULE(_hmm_bindings, m) {
         util.def("sample_path", &samplePath<float>, "alpha"_a, "transition_matrix"_a, "T"_a , "seed"_a = -1, docs::SAMPLE_PATH);
         util.def("sample_path", &samplePath<double>, "alpha"_a, "transition_matrix"_a, "T"_a, "seed"_a = -1, docs::SAMPLE_PATH);
         util.def("count_matrix", &countMatrix<std::int32_t>, "dtrajs"_a, "lag"_a, "n_states"_a);
-        util.def("forward_backward", &forwardBackward<float>, "transition_matrix"_a, "pObs"_a, "pi"_a, "alpha"_a, "beta"_a, "gamma"_a, "counts"_a, "T"_a);
-        util.def("forward_backward", &forwardBackward<double>, "transition_matrix"_a, "pObs"_a, "pi"_a, "alpha"_a, "beta"_a, "gamma"_a, "counts"_a, "T"_a);
+        util.def("forward_backward", &forwardBackward<float>, "transition_matrix"_a, "pObs"_a, "pi"_a, "alpha"_a, "beta"_a, "gamma"_a, "counts"_a, "T"_a, "n_segments"_a = 1);
+        util.def("forward_backward", &forwardBackward<double>, "transition_matrix"_a, "pObs"_a, "pi"_a, "alpha"_a, "beta"_a, "gamma"_a, "counts"_a, "T"_a, "n_segments"_a = 1);
+        util.def("forward_backward_batch", &forwardBackwardBatch<float>, "transition_matrix"_a, "state_probability_trajectories"_a, "initial_distribution"_a, "gammas_out"_a, "parallel_in_time"_a = false, docs::FORWARD_BACKWARD_BATCH);
+        util.def("forward_backward_batch", &forwardBackwardBatch<double>, "transition_matrix"_a, "state_probability_trajectories"_a, "initial_distribution"_a, "gammas_out"_a, "parallel_in_time"_a = false, docs::FORWARD_BACKWARD_BATCH);
+        util.def("estimate_transition_matrix", &hmm::baum_welch::bindings::estimateTransitionMatrix<float>, "counts"_a, "reversible"_a, "fixed_stationary_distribution"_a = py::none(), "maxit_reversible"_a = 1000000);
+        util.def("estimate_transition_matrix", &hmm::baum_welch::bindings::estimateTransitionMatrix<double>, "counts"_a, "reversible"_a, "fixed_stationary_distribution"_a = py::none(), "maxit_reversible"_a = 1000000);
+        util.def("stationary_distribution", &hmm::baum_welch::bindings::stationaryDistribution<float>, "transition_matrix"_a, "counts"_a);
+        util.def("stationary_distribution", &hmm::baum_welch::bindings::stationaryDistribution<double>, "transition_matrix"_a, "counts"_a);
     }
 }
@@ -6,7 +6,7 @@ import numpy as np
 from deeptime.base import Model
 from ._output_model import OutputModel, DiscreteOutputModel
 from deeptime.markov import sample
-from ._hmm_bindings.util import viterbi as viterbi_impl, forward as forward_impl
+from ._hmm_bindings.util import viterbi as viterbi_impl, viterbi_batch as viterbi_batch_impl
 from ...util.types import ensure_dtraj_list, ensure_array
 
 
@@ -101,7 +101,7 @@ class HiddenMarkovModel(Model):
     def compute_observation_likelihood(self, data: Union[np.ndarray, List[np.ndarray]]):
         r""" Computes the likelihood of observed data under this model.
 
-        Internally, the forward pass of the Baum-Welch algorithm is used.
+        Internally, the forward pass of the Baum-Welch algorithm is used, see :meth:`observation_log_likelihoods`.
 
         Parameters
         ----------
@@ -113,23 +113,7 @@ class HiddenMarkovModel(Model):
         likelihood : float
             The computed likelihood.
         """
-        if not isinstance(data, (list, tuple)):
-            data = [data]
-        max_n_frames = max(len(obs) for obs in data)
-
-        # get parameters
-        A = self.transition_model.transition_matrix
-        pi = self.initial_distribution
-        alpha = np.zeros((max_n_frames, self.n_hidden_states), dtype=A.dtype)
-
-        # compute output probability matrix
-        loglik = 0.
-        for obs in data:
-            T = len(obs)
-            pobs = self.output_model.to_state_probability_trajectory(obs)
-            pobs = pobs.astype(A.dtype)
-            loglik += forward_impl(A, pobs, pi, alpha_out=alpha, T=T)
-        return loglik
+        return np.sum(observation_log_likelihoods([self], data))
 
     @property
     def lagtime(self) -> int:
@@ -435,8 +419,7 @@ class HiddenMarkovModel(Model):
         state_probabilities = [
             self.output_model.to_state_probability_trajectory(obs) for obs in observations
         ]
-        paths = [viterbi(A, obs, pi) for obs in state_probabilities]
-        return paths
+        return viterbi_batch(A, state_probabilities, pi)
 
     def collect_observations_in_state(self, observations: List[np.ndarray], state_index: int):
         """Collect a vector of all observations belonging to a specified hidden state.
@@ -470,7 +453,7 @@ class HiddenMarkovModel(Model):
     # Generation of trajectories and samples
     ################################################################################
 
-    def simulate(self, n_steps, start=None, stop=None, dt=1):
+    def simulate(self, n_steps, start=None, stop=None, dt=1, seed=-1):
         """
         Generates a realization of the Hidden Markov Model
 
@@ -487,6 +470,9 @@ class HiddenMarkovModel(Model):
         dt : int
             trajectory will be saved every dt time steps.
             Internally, the dt'th power of P is taken to ensure a more efficient simulation.
+        seed : int, optional, default=-1
+            Random seed. A negative value draws a random seed, otherwise the hidden and the observable trajectory
+            are reproducible.
 
         Returns
         -------
@@ -497,8 +483,8 @@ class HiddenMarkovModel(Model):
 
         """
         # sample hidden trajectory
-        htraj = self.transition_model.simulate(n_steps, start=start, stop=stop, dt=dt)
-        otraj = self.output_model.generate_observation_trajectory(htraj)
+        htraj = self.transition_model.simulate(n_steps, start=start, stop=stop, dt=dt, seed=seed)
+        otraj = self.output_model.generate_observation_trajectory(htraj, seed=seed)
         return htraj, otraj
 
     def transform_discrete_trajectories_to_observed_symbols(self, dtrajs):
@@ -980,7 +966,46 @@ class HiddenMarkovModel(Model):
     # ================================================================================================================
 
 
-def viterbi(transition_matrix: np.ndarray, state_probability_trajectory: np.ndarray, initial_distribution: np.ndarray):
+def observation_log_likelihoods(models: List[HiddenMarkovModel], data: Union[np.ndarray, List[np.ndarray]]) \
+        -> np.ndarray:
+    r""" Computes the log-likelihood of each observation trajectory under each of the given hidden Markov models, e.g.,
+    for model selection or cross-validation.
+
+    Only the forward pass of the Baum-Welch algorithm is run, keeping two vectors of length n_hidden_states per
+    trajectory. For discrete and Gaussian output models the emission probabilities are evaluated one time step at a
+    time and all pairs of model and trajectory are scored in parallel.
+
+    Parameters
+    ----------
+    models : list of HiddenMarkovModel
+        The candidate models, they may differ in their number of hidden states and type of output model.
+    data : array_like or list of array_like
+        The observations.
+
+    Returns
+    -------
+    log_likelihoods : (n_models, n_trajectories) ndarray
+        The log-likelihood of each observation trajectory under each model.
+    """
+    if not isinstance(data, (list, tuple)):
+        data = [data]
+    data = [np.asarray(obs) for obs in data]
+    result = np.empty((len(models), len(data)))
+    groups = {}
+    for m, model in enumerate(models):
+        groups.setdefault(type(model.output_model), []).append(m)
+    for output_model_type, indices in groups.items():
+        result[indices] = output_model_type._log_likelihoods(
+            [np.asarray(models[m].transition_model.transition_matrix) for m in indices],
+            [models[m].initial_distribution for m in indices],
+            [models[m].output_model for m in indices],
+            data
+        )
+    return result
+
+
+def viterbi(transition_matrix: np.ndarray, state_probability_trajectory: np.ndarray, initial_distribution: np.ndarray,
+            checkpoint_interval: Optional[int] = None):
     """ Estimate the hidden pathway of maximum likelihood using the Viterbi algorithm.
 
     Parameters
@@ -991,6 +1016,10 @@ def viterbi(transition_matrix: np.ndarray, state_probability_trajectory: np.ndar
         pobs[t,i] is the observation probability for observation at time t given hidden state i
     initial_distribution : ndarray((N), dtype = float)
         initial distribution of hidden states
+    checkpoint_interval : int, optional, default=None
+        Number of time steps whose backpointers are held in memory at once. If smaller than T, backpointers are
+        recomputed segment by segment from stored checkpoints during backtracking. Defaults to keeping all
+        backpointers unless they exceed 256 MiB, in which case ceil(sqrt(T)) is used.
 
     Returns
     -------
@@ -1003,4 +1032,35 @@ def viterbi(transition_matrix: np.ndarray, state_probability_trajectory: np.ndar
         state_probability_trajectory = state_probability_trajectory[..., None]
     return viterbi_impl(transition_matrix=transition_matrix,
                         state_probability_trajectory=state_probability_trajectory,
-                        initial_distribution=initial_distribution)
+                        initial_distribution=initial_distribution,
+                        checkpoint_interval=0 if checkpoint_interval is None else checkpoint_interval)
+
+
+def viterbi_batch(transition_matrix: np.ndarray, state_probability_trajectories: List[np.ndarray],
+                  initial_distribution: np.ndarray, checkpoint_interval: Optional[int] = None) -> List[np.ndarray]:
+    """ Estimate the hidden pathways of maximum likelihood of several trajectories using the Viterbi algorithm.
+    The trajectories are decoded in parallel.
+
+    Parameters
+    ----------
+    transition_matrix : ndarray((N,N), dtype = float)
+        transition matrix of the hidden states
+    state_probability_trajectories : list of ndarray((T_k,N), dtype = float)
+        state probability trajectories, see :meth:`viterbi`
+    initial_distribution : ndarray((N), dtype = float)
+        initial distribution of hidden states
+    checkpoint_interval : int, optional, default=None
+        Number of time steps whose backpointers are held in memory at once per trajectory, see :meth:`viterbi`.
+
+    Returns
+    -------
+    paths : list of numpy.array shape (T_k)
+        maximum likelihood hidden paths
+    """
+    if transition_matrix.shape[0] == 1:
+        # if there is only one state, pad so that there is an additional dimension
+        state_probability_trajectories = [p[..., None] if p.ndim == 1 else p for p in state_probability_trajectories]
+    return viterbi_batch_impl(transition_matrix=transition_matrix,
+                              state_probability_trajectories=state_probability_trajectories,
+                              initial_distribution=initial_distribution,
+                              checkpoint_interval=0 if checkpoint_interval is None else checkpoint_interval)
@@ -7,10 +7,9 @@ from scipy.sparse import issparse
 
 from ...base import Estimator
 from .._transition_matrix import estimate_P, stationary_distribution
-from ._hidden_markov_model import HiddenMarkovModel, viterbi
+from ._hidden_markov_model import HiddenMarkovModel, viterbi_batch
 from ..msm import MarkovStateModel
 from .. import TransitionCountModel, compute_dtrajs_effective
-from ._hmm_bindings import util as _util
 from ...util.types import ensure_timeseries_data
 
 
@@ -65,6 +64,10 @@ class MaximumLikelihoodHMM(Estimator):
         accuracy, the iteration is stopped without convergence and a warning is given.
     maxit_reversible : int, optional, default=1000000
         Maximum number of iterations for reversible transition matrix estimation. Only used with reversible=True.
+    parallel_in_time : bool, optional, default=False
+        If True, the forward-backward pass processes the observation trajectories one after the other and splits each
+        of them in time over the available threads. This yields multicore speedups for few long trajectories and
+        small numbers of hidden states. Otherwise the trajectories are distributed over the threads.
 
     References
     ----------
@@ -77,7 +80,7 @@ class MaximumLikelihoodHMM(Estimator):
     def __init__(self, initial_model: HiddenMarkovModel, stride: Union[int, str] = 1,
                  lagtime: int = 1, reversible: bool = True, stationary: bool = False,
                  p: Optional[np.ndarray] = None, accuracy: float = 1e-3,
-                 maxit: int = 1000, maxit_reversible: int = 100000):
+                 maxit: int = 1000, maxit_reversible: int = 100000, parallel_in_time: bool = False):
         super().__init__()
         self.initial_transition_model = initial_model
         self.stride = stride
@@ -93,6 +96,7 @@ class MaximumLikelihoodHMM(Estimator):
         self.accuracy = accuracy
         self.maxit = maxit
         self.maxit_reversible = maxit_reversible
+        self.parallel_in_time = parallel_in_time
 
     def fetch_model(self) -> HiddenMarkovModel:
         r""" Yields the current HiddenMarkovModel or None if :meth:`fit` was not called yet.
@@ -113,6 +117,15 @@ class MaximumLikelihoodHMM(Estimator):
     def maxit_reversible(self, value: int):
         self._maxit_reversible = int(value)
 
+    @property
+    def parallel_in_time(self) -> bool:
+        r""" Whether the forward-backward pass splits each observation trajectory in time over the threads. """
+        return self._parallel_in_time
+
+    @parallel_in_time.setter
+    def parallel_in_time(self, value: bool):
+        self._parallel_in_time = bool(value)
+
     @property
     def fixed_stationary_distribution(self) -> Optional[np.ndarray]:
         r"""Fix the stationary distribution to the provided value. Only used when :attr:`stationary` is True, otherwise
@@ -220,8 +233,9 @@ class MaximumLikelihoodHMM(Estimator):
     def initial_transition_model(self, value: HiddenMarkovModel) -> None:
         self._initial_transition_model = value
 
-    def fit(self, dtrajs, initial_model=None, **kwargs):
-        r""" Fits a new :class:`HMM <HiddenMarkovModel>` to data.
+    def fit(self, dtrajs, initial_model=None, callback=None, **kwargs):
+        r""" Fits a new :class:`HMM <HiddenMarkovModel>` to data. For discrete and Gaussian output models, the
+        Baum-Welch iteration runs entirely in native code.
 
         Parameters
         ----------
@@ -229,6 +243,8 @@ class MaximumLikelihoodHMM(Estimator):
             Timeseries data.
         initial_model : HiddenMarkovModel, optional, default=None
             Override for :attr:`initial_transition_model`.
+        callback : callable, optional, default=None
+            Progress hook which is called as :code:`callback(iteration, log_likelihood)` after every iteration.
         **kwargs
             Ignored kwargs for scikit-learn compatibility.
 
@@ -260,26 +276,78 @@ class MaximumLikelihoodHMM(Estimator):
         dtrajs = compute_dtrajs_effective(dtrajs, lagtime=self.lagtime, n_states=initial_model.n_hidden_states,
                                           stride=self.stride)
 
-        max_n_frames = max(len(obs) for obs in dtrajs)
         # pre-construct hidden variables
         N = initial_model.n_hidden_states
-        alpha = np.zeros((max_n_frames, N))
-        beta = np.zeros((max_n_frames, N))
-        gammas = [np.zeros((len(obs), N)) for obs in dtrajs]
-        count_matrices = [np.zeros((N, N)) for _ in dtrajs]
+        gammas = [np.zeros((len(obs), N), dtype=transition_matrix.dtype) for obs in dtrajs]
+
+        result = hmm_data.output_model._baum_welch(
+            hmm_data.transition_matrix, hmm_data.initial_distribution, dtrajs, gammas, self.reversible,
+            self.stationary, self.fixed_stationary_distribution, self.fixed_initial_distribution, self.accuracy,
+            self.maxit, self.maxit_reversible, parallel_in_time=self.parallel_in_time, callback=callback
+        )
+        if result is not None:
+            transition_matrix, initial_distribution, likelihoods, transition_counts, initial_counts = result
+            hmm_data.transition_matrix[:] = transition_matrix
+            hmm_data.initial_distribution[:] = initial_distribution
+        else:
+            likelihoods, transition_counts, initial_counts = self._baum_welch(hmm_data, dtrajs, gammas, callback)
+
+        count_model = TransitionCountModel(count_matrix=transition_counts, lagtime=self.lagtime)
+        transition_model = MarkovStateModel(hmm_data.transition_matrix, reversible=self.reversible,
+                                            count_model=count_model)
+        hidden_state_trajs = viterbi_batch(
+            hmm_data.transition_matrix, [hmm_data.output_model.to_state_probability_trajectory(obs) for obs in dtrajs],
+            hmm_data.initial_distribution
+        )
+        model = HiddenMarkovModel(
+            transition_model=transition_model,
+            output_model=hmm_data.output_model,
+            initial_distribution=hmm_data.initial_distribution,
+            likelihoods=likelihoods,
+            state_probabilities=gammas,
+            initial_count=initial_counts,
+            hidden_state_trajectories=hidden_state_trajs,
+            stride=self.stride
+        )
+        self._model = model
+        return self
+
+    def _baum_welch(self, model: _HMMModelStorage, observations: List[np.ndarray], gammas: List[np.ndarray],
+                    callback=None):
+        """ Baum-Welch iteration for output models without native implementation, updates the model in place.
+
+        Parameters
+        ----------
+        model: _HMMModelStorage
+            named tuple with transition matrix, initial distribution, output model
+        observations: list of np.ndarray
+            observation trajectories
+        gammas: list of ndarray
+            output containers for the state probabilities of each trajectory
+        callback: callable, optional, default=None
+            called as callback(iteration, log_likelihood) after every iteration
 
+        Returns
+        -------
+        likelihoods : ndarray
+            The log-likelihood history
+        transition_counts : ndarray
+            Baum-Welch transition counts of the last iteration
+        initial_counts : ndarray
+            State probabilities at the first time step of the last iteration
+        """
         it = 0
         likelihoods = np.empty(self.maxit)
         # flag if connectivity has changed (e.g. state lost) - in that case the likelihood
         # is discontinuous and can't be used as a convergence criterion in that iteration.
-        tmatrix_nonzeros = hmm_data.transition_matrix.nonzero()
+        tmatrix_nonzeros = model.transition_matrix.nonzero()
         converged = False
 
         while not converged and it < self.maxit:
-            loglik = 0.0
-            for obs, gamma, counts in zip(dtrajs, gammas, count_matrices):
-                loglik_update, _ = self._forward_backward(hmm_data, obs, alpha, beta, gamma, counts)
-                loglik += loglik_update
+            logprobs, transition_counts, initial_counts, statistics = self._forward_backward(
+                model, observations, gammas, self.parallel_in_time
+            )
+            loglik = np.sum(logprobs)
             assert np.isfinite(loglik), it
 
             # convergence check
@@ -289,10 +357,11 @@ class MaximumLikelihoodHMM(Estimator):
                     converged = True
 
             # update model
-            self._update_model(hmm_data, dtrajs, gammas, count_matrices, maxiter=self.maxit_reversible)
+            self._update_model(model, observations, gammas, transition_counts, initial_counts, statistics,
+                               maxiter=self.maxit_reversible)
 
             # connectivity change check
-            tmatrix_nonzeros_new = hmm_data.transition_matrix.nonzero()
+            tmatrix_nonzeros_new = model.transition_matrix.nonzero()
             if not np.array_equal(tmatrix_nonzeros, tmatrix_nonzeros_new):
                 converged = False  # unset converged
                 tmatrix_nonzeros = tmatrix_nonzeros_new
@@ -300,82 +369,46 @@ class MaximumLikelihoodHMM(Estimator):
             # end of iteration
             likelihoods[it] = loglik
             it += 1
+            if callback is not None:
+                callback(it, loglik)
 
         likelihoods = np.resize(likelihoods, it)
 
-        transition_counts = self._reduce_transition_counts(count_matrices)
-
-        count_model = TransitionCountModel(count_matrix=transition_counts, lagtime=self.lagtime)
-        transition_model = MarkovStateModel(hmm_data.transition_matrix, reversible=self.reversible,
-                                            count_model=count_model)
-        hidden_state_trajs = [
-            viterbi(hmm_data.transition_matrix, hmm_data.output_model.to_state_probability_trajectory(obs),
-                    hmm_data.initial_distribution) for obs in dtrajs
-        ]
-        model = HiddenMarkovModel(
-            transition_model=transition_model,
-            output_model=hmm_data.output_model,
-            initial_distribution=hmm_data.initial_distribution,
-            likelihoods=likelihoods,
-            state_probabilities=gammas,
-            initial_count=self._init_counts(gammas),
-            hidden_state_trajectories=hidden_state_trajs,
-            stride=self.stride
-        )
-        self._model = model
-        return self
+        return likelihoods, transition_counts, initial_counts
 
     @staticmethod
-    def _forward_backward(model: _HMMModelStorage, obs, alpha, beta, gamma, counts):
-        """ Estimation step: Runs the forward-back algorithm on trajectory obs
+    def _forward_backward(model: _HMMModelStorage, observations, gammas, parallel_in_time=False):
+        """ Estimation step: Runs the forward-backward algorithm on all observation trajectories in parallel and
+        accumulates the sufficient statistics of the output model in the same pass
 
         Parameters
         ----------
         model: _HMMModelStorage
             named tuple with transition matrix, initial distribution, output model
-        obs: np.ndarray
-            single observation corresponding to index itraj
-        alpha: ndarray
-            forward coefficients
-        beta: ndarray
-            backward coefficients
-        gamma: ndarray
-            gammas
-        counts: ndarray
-            count matrix
+        observations: list of np.ndarray
+            observation trajectories
+        gammas: list of ndarray
+            output containers for the state probabilities of each trajectory
+        parallel_in_time: bool, optional, default=False
+            whether to split each trajectory in time over the threads instead of distributing the trajectories
 
         Returns
         -------
-        logprob : float
-            The probability to observe the observation sequence given the HMM
-            parameters
-        pobs : ndarray
-            state probability trajectory obtained from obs
+        logprobs : ndarray
+            The log-probability to observe each observation sequence given the HMM parameters
+        transition_counts : ndarray
+            Baum-Welch transition counts summed over all trajectories
+        initial_counts : ndarray
+            State probabilities at the first time step summed over all trajectories
+        statistics : ndarray or None
+            Sufficient statistics of the output model, None if it is fitted from the state probabilities
         """
-        # get parameters
-        A = model.transition_matrix
-        pi = model.initial_distribution
-        T = len(obs)
-        # compute output probability matrix
-        pobs = model.output_model.to_state_probability_trajectory(obs)
-        pobs = pobs.astype(A.dtype)
-        # run forward - backward pass
-        logprob = _util.forward_backward(A, pobs, pi, alpha, beta, gamma, counts, T)
-        return logprob, pobs
-
-    def _init_counts(self, gammas):
-        gamma0_sum = np.zeros(self.n_hidden_states)
-        # update state counts
-        for g in gammas:
-            gamma0_sum += g[0]
-        return gamma0_sum
-
-    @staticmethod
-    def _reduce_transition_counts(count_matrices):
-        return np.add.reduce(count_matrices)
+        return model.output_model._forward_backward_batch(model.transition_matrix, model.initial_distribution,
+                                                          observations, gammas, parallel_in_time=parallel_in_time)
 
     def _update_model(self, model: _HMMModelStorage, observations: List[np.ndarray], gammas: List[np.ndarray],
-                      count_matrices: List[np.ndarray], maxiter: int = int(1e7)):
+                      transition_counts: np.ndarray, initial_counts: np.ndarray, statistics=None,
+                      maxiter: int = int(1e7)):
         """
         Maximization step: Updates the HMM model given the hidden state assignment and count matrices
 
@@ -383,15 +416,18 @@ class MaximumLikelihoodHMM(Estimator):
         ----------
         gammas : [ ndarray(T,N, dtype=float) ]
             list of state probabilities for each trajectory
-        count_matrices : [ ndarray(N,N, dtype=float) ]
-            list of the Baum-Welch transition count matrices for each hidden
-            state trajectory
+        transition_counts : ndarray(N,N, dtype=float)
+            Baum-Welch transition count matrix summed over all trajectories
+        initial_counts : ndarray(N, dtype=float)
+            state probabilities at the first time step summed over all trajectories
+        statistics : ndarray or None
+            sufficient statistics of the output model accumulated in the estimation step
         maxiter : int
             maximum number of iterations of the transition matrix estimation if
             an iterative method is used.
 
         """
-        C = self._reduce_transition_counts(count_matrices)
+        C = transition_counts
 
         # compute new transition matrix
         T = estimate_P(C, reversible=self.reversible, fixed_statdist=self.fixed_stationary_distribution,
@@ -404,14 +440,13 @@ class MaximumLikelihoodHMM(Estimator):
                 pi = self.fixed_stationary_distribution
         else:
             if self.fixed_initial_distribution is None:
-                gamma0_sum = self._init_counts(gammas)
-                pi = gamma0_sum / np.sum(gamma0_sum)
+                pi = initial_counts / np.sum(initial_counts)
             else:
                 pi = self.fixed_initial_distribution
 
         model.initial_distribution[:] = pi
         model.transition_matrix[:] = T
-        model.output_model.fit(observations, gammas)
+        model.output_model._fit_statistics(observations, gammas, statistics)
 
     def chapman_kolmogorov_validator(self, mlags=None, test_model: HiddenMarkovModel = None):
         r""" Creates a validator instance which can be used to perform a Chapman-Kolmogorov test.
@@ -3,6 +3,7 @@ from typing import Optional, List
 
 import numpy as np
 from ._hmm_bindings import output_models as _bindings
+from ._hmm_bindings import util as _util_bindings
 
 from ...base import Model
 
@@ -29,6 +30,7 @@ class OutputModel(Model, metaclass=abc.ABCMeta):
     --------
     DiscreteOutputModel
     GaussianOutputModel
+    MultivariateGaussianOutputModel
     """
 
     def __init__(self, n_hidden_states: int, n_observable_states: int, ignore_outliers: bool = True):
@@ -81,13 +83,16 @@ class OutputModel(Model, metaclass=abc.ABCMeta):
         pass
 
     @abc.abstractmethod
-    def generate_observation_trajectory(self, hidden_state_trajectory: np.ndarray) -> np.ndarray:
+    def generate_observation_trajectory(self, hidden_state_trajectory: np.ndarray, seed: int = -1) -> np.ndarray:
         r""" Generates a synthetic trajectory in observation space given a trajectory in hidden state space.
 
         Parameters
         ----------
         hidden_state_trajectory : (T, 1) ndarray
             Hidden state trajectory.
+        seed : int, optional, default=-1
+            Random seed. A negative value draws a random seed, otherwise the observations are reproducible
+            independently of the number of threads.
 
         Returns
         -------
@@ -147,6 +152,178 @@ class OutputModel(Model, metaclass=abc.ABCMeta):
         """
         pass
 
+    def forward_backward_checkpointed(self, transition_matrix: np.ndarray, initial_distribution: np.ndarray,
+                                      observations: np.ndarray, checkpoint_interval: Optional[int] = None,
+                                      gamma_out: Optional[np.ndarray] = None):
+        r""" Forward-backward pass over one observation trajectory which only stores every
+        :code:`checkpoint_interval`-th forward variable and recomputes the others segment by segment during the
+        backward sweep. Emission probabilities are evaluated on the fly, transition counts and emission statistics
+        are accumulated during the backward sweep. With the default interval of :math:`\lceil\sqrt{T}\rceil` this
+        needs :math:`\mathcal{O}(\sqrt{T} n)` memory at roughly twice the cost of the forward pass.
+
+        Parameters
+        ----------
+        transition_matrix : (n, n) ndarray
+            Transition matrix of the hidden states.
+        initial_distribution : (n,) ndarray
+            Initial distribution of the hidden states.
+        observations : (T,) ndarray
+            Observation trajectory.
+        checkpoint_interval : int, optional, default=None
+            Distance between stored forward variables, defaults to :math:`\lceil\sqrt{T}\rceil`.
+        gamma_out : (T, n) ndarray, optional, default=None
+            If given, the state probabilities of all time steps are written into this array. It must be C-contiguous
+            and of the same dtype as the transition matrix.
+
+        Returns
+        -------
+        logprob : float
+            Log-likelihood of the observations.
+        transition_counts : (n, n) ndarray
+            Expected transition counts.
+        initial_counts : (n,) ndarray
+            State probabilities of the first time step.
+        emission_statistics : ndarray
+            Sufficient statistics of the output model, see the implementing output model.
+        """
+        raise NotImplementedError(f"Checkpointed forward-backward is not implemented for {type(self).__name__}.")
+
+    def _forward_backward_batch(self, transition_matrix: np.ndarray, initial_distribution: np.ndarray,
+                                observations: List[np.ndarray], gammas: Optional[List[np.ndarray]],
+                                parallel_in_time: bool = False):
+        r""" Batched forward-backward pass over all observation trajectories, the E-step of the Baum-Welch algorithm.
+        Output models which accumulate their sufficient statistics during the pass return them as fourth element,
+        see :meth:`_fit_statistics`.
+
+        Parameters
+        ----------
+        transition_matrix : (n, n) ndarray
+            Transition matrix of the hidden states.
+        initial_distribution : (n,) ndarray
+            Initial distribution of the hidden states.
+        observations : list of ndarray
+            Observation trajectories.
+        gammas : list of ndarray or None
+            Output containers for the state probabilities of each trajectory, C-contiguous and of the same dtype
+            as the transition matrix. Output models without sufficient statistics require them.
+        parallel_in_time : bool, optional, default=False
+            Whether to split each trajectory in time over the threads instead of distributing the trajectories.
+
+        Returns
+        -------
+        logprobs : ndarray
+            The log-likelihood of each observation trajectory.
+        transition_counts : (n, n) ndarray
+            Expected transition counts summed over all trajectories.
+        initial_counts : (n,) ndarray
+            State probabilities at the first time step summed over all trajectories.
+        statistics : ndarray or None
+            Sufficient statistics of the output model or None if it is fitted from the state probabilities.
+        """
+        dtype = transition_matrix.dtype
+        pobs = [self.to_state_probability_trajectory(obs).astype(dtype, copy=False) for obs in observations]
+        result = _util_bindings.forward_backward_batch(transition_matrix, pobs,
+                                                       initial_distribution.astype(dtype, copy=False), gammas,
+                                                       parallel_in_time=parallel_in_time)
+        return (*result, None)
+
+    def _baum_welch(self, transition_matrix: np.ndarray, initial_distribution: np.ndarray,
+                    observations: List[np.ndarray], gammas: List[np.ndarray], reversible: bool, stationary: bool,
+                    fixed_stationary_distribution: Optional[np.ndarray],
+                    fixed_initial_distribution: Optional[np.ndarray], accuracy: float, maxit: int,
+                    maxit_reversible: int, parallel_in_time: bool = False, callback=None):
+        r""" Runs the complete Baum-Welch iteration in native code without returning to Python between iterations.
+        On success, the parameters of this output model are updated in place. Output models without a native
+        implementation return None, the iteration is then performed by the estimator.
+
+        Parameters
+        ----------
+        transition_matrix : (n, n) ndarray
+            Initial transition matrix of the hidden states.
+        initial_distribution : (n,) ndarray
+            Initial distribution of the hidden states.
+        observations : list of ndarray
+            Observation trajectories.
+        gammas : list of ndarray
+            Output containers for the state probabilities of each trajectory, C-contiguous and of the same dtype
+            as the transition matrix.
+        reversible : bool
+            Whether the transition matrix is estimated reversibly.
+        stationary : bool
+            Whether the initial distribution is the stationary distribution of the transition matrix.
+        fixed_stationary_distribution : ndarray or None
+            Fixed stationary distribution, if any.
+        fixed_initial_distribution : ndarray or None
+            Fixed initial distribution, if any.
+        accuracy : float
+            Convergence threshold on the increase of the log-likelihood.
+        maxit : int
+            Maximum number of iterations.
+        maxit_reversible : int
+            Maximum number of iterations of the reversible transition matrix estimation.
+        parallel_in_time : bool, optional, default=False
+            Whether to split each trajectory in time over the threads instead of distributing the trajectories.
+        callback : callable, optional, default=None
+            Called as :code:`callback(iteration, log_likelihood)` after every iteration.
+
+        Returns
+        -------
+        result : tuple or None
+            Transition matrix, initial distribution, log-likelihood history and the transition and initial counts
+            of the last iteration, or None if not implemented.
+        """
+        return None
+
+    def _fit_statistics(self, observations: List[np.ndarray], weights: List[np.ndarray], statistics):
+        r""" The M-step of the Baum-Welch algorithm given the results of :meth:`_forward_backward_batch`. Falls back
+        to :meth:`fit` if no sufficient statistics were accumulated.
+
+        Parameters
+        ----------
+        observations : list of ndarray
+            Observation trajectories.
+        weights : list of ndarray
+            State probabilities of each trajectory.
+        statistics : ndarray or None
+            Sufficient statistics accumulated during the forward-backward pass.
+
+        Returns
+        -------
+        self : OutputModel
+            Reference to self.
+        """
+        return self.fit(observations, weights)
+
+    @classmethod
+    def _log_likelihoods(cls, transition_matrices: List[np.ndarray], initial_distributions: List[np.ndarray],
+                         output_models: List['OutputModel'], observations: List[np.ndarray]) -> np.ndarray:
+        r""" Log-likelihoods of the observation trajectories under models which all have an output model of this
+        type. Output models without a native implementation evaluate full state probability trajectories.
+
+        Parameters
+        ----------
+        transition_matrices : list of ndarray
+            Transition matrix of each model.
+        initial_distributions : list of ndarray
+            Initial distribution of each model.
+        output_models : list of OutputModel
+            Output model of each model.
+        observations : list of ndarray
+            Observation trajectories.
+
+        Returns
+        -------
+        log_likelihoods : (n_models, n_trajectories) ndarray
+            The log-likelihood of each trajectory under each model.
+        """
+        result = np.empty((len(output_models), len(observations)))
+        for m, (A, pi, output_model) in enumerate(zip(transition_matrices, initial_distributions, output_models)):
+            for k, obs in enumerate(observations):
+                pobs = output_model.to_state_probability_trajectory(obs).astype(A.dtype, copy=False)
+                alpha = np.empty_like(pobs)
+                result[m, k] = _util_bindings.forward(A, pobs, pi.astype(A.dtype, copy=False), alpha_out=alpha)
+        return result
+
     @staticmethod
     def _handle_outliers(state_probability_trajectory: np.ndarray) -> None:
         r"""Takes a state probability trajectory, shape (T, n_hidden_states), and sets all probabilities which sum up to
@@ -161,6 +338,25 @@ class OutputModel(Model, metaclass=abc.ABCMeta):
         _bindings.handle_outliers(state_probability_trajectory)
 
 
+def _native_baum_welch_dtype(transition_matrix: np.ndarray, gammas: List[np.ndarray]):
+    r""" The dtype of a native Baum-Welch run or None if transition matrix and state probabilities do not support
+    one. """
+    dtype = transition_matrix.dtype
+    if dtype not in (np.float32, np.float64) or any(g.dtype != dtype or not g.flags.c_contiguous for g in gammas):
+        return None
+    return dtype
+
+
+def _optional_distribution(distribution: Optional[np.ndarray], dtype):
+    return None if distribution is None else np.asarray(distribution, dtype=dtype)
+
+
+def _discrete_observations(observations: List[np.ndarray]) -> List[np.ndarray]:
+    r""" Casts discrete observation trajectories to a common integer dtype supported by the bindings. """
+    obs_dtype = np.int32 if all(obs.dtype == np.int32 for obs in observations) else np.int64
+    return [np.ascontiguousarray(obs, dtype=obs_dtype) for obs in observations]
+
+
 class DiscreteOutputModel(OutputModel):
     r"""HMM output probability model using discrete symbols. This corresponds to the "standard" HMM that is
     classically used in the literature.
@@ -231,8 +427,66 @@ class DiscreteOutputModel(OutputModel):
             self._handle_outliers(state_probabilities)
         return state_probabilities
 
-    def generate_observation_trajectory(self, hidden_state_trajectory: np.ndarray) -> np.ndarray:
-        return _bindings.discrete.generate_observation_trajectory(hidden_state_trajectory, self.output_probabilities)
+    def generate_observation_trajectory(self, hidden_state_trajectory: np.ndarray, seed: int = -1) -> np.ndarray:
+        return _bindings.discrete.generate_observation_trajectory(hidden_state_trajectory, self.output_probabilities,
+                                                                  seed=seed)
+
+    def forward_backward_checkpointed(self, transition_matrix: np.ndarray, initial_distribution: np.ndarray,
+                                      observations: np.ndarray, checkpoint_interval: Optional[int] = None,
+                                      gamma_out: Optional[np.ndarray] = None):
+        r""" See :meth:`OutputModel.forward_backward_checkpointed`. The emission statistics are the expected
+        observation counts of shape (:attr:`n_hidden_states`, :attr:`n_observable_states`). """
+        dtype = transition_matrix.dtype
+        return _bindings.discrete.forward_backward_checkpointed(
+            transition_matrix, self.output_probabilities.astype(dtype, copy=False),
+            initial_distribution.astype(dtype, copy=False), observations, self.ignore_outliers,
+            checkpoint_interval=0 if checkpoint_interval is None else checkpoint_interval, gamma_out=gamma_out
+        )
+
+    def _forward_backward_batch(self, transition_matrix, initial_distribution, observations, gammas,
+                                parallel_in_time=False):
+        r""" See :meth:`OutputModel._forward_backward_batch`, the statistics are the expected observation counts of
+        shape (:attr:`n_hidden_states`, :attr:`n_observable_states`). The emission probabilities are gathered from the
+        output probabilities per time step, no state probability trajectories are computed. """
+        dtype = transition_matrix.dtype
+        return _bindings.discrete.forward_backward_batch(
+            transition_matrix, self.output_probabilities.astype(dtype, copy=False),
+            initial_distribution.astype(dtype, copy=False), _discrete_observations(observations),
+            self.ignore_outliers, gammas_out=gammas, parallel_in_time=parallel_in_time
+        )
+
+    def _baum_welch(self, transition_matrix, initial_distribution, observations, gammas, reversible, stationary,
+                    fixed_stationary_distribution, fixed_initial_distribution, accuracy, maxit, maxit_reversible,
+                    parallel_in_time=False, callback=None):
+        dtype = _native_baum_welch_dtype(transition_matrix, gammas)
+        if dtype is None:
+            return None
+        P, pi, output_probabilities, likelihoods, counts, initial_counts = _bindings.discrete.baum_welch(
+            transition_matrix, initial_distribution.astype(dtype, copy=False),
+            self.output_probabilities.astype(dtype, copy=False), self.ignore_outliers,
+            _discrete_observations(observations), gammas, reversible, stationary,
+            _optional_distribution(fixed_stationary_distribution, dtype),
+            _optional_distribution(fixed_initial_distribution, dtype), accuracy, maxit, maxit_reversible,
+            parallel_in_time=parallel_in_time, callback=callback
+        )
+        self._output_probabilities[:] = output_probabilities
+        return P, pi, likelihoods, counts, initial_counts
+
+    def _fit_statistics(self, observations, weights, statistics):
+        self._output_probabilities[:] = statistics
+        self.normalize()
+        return self
+
+    @classmethod
+    def _log_likelihoods(cls, transition_matrices, initial_distributions, output_models, observations):
+        dtype = np.float32 if all(A.dtype == np.float32 for A in transition_matrices) else np.float64
+        return _bindings.discrete.log_likelihoods(
+            [A.astype(dtype, copy=False) for A in transition_matrices],
+            [pi.astype(dtype, copy=False) for pi in initial_distributions],
+            [om.output_probabilities.astype(dtype, copy=False) for om in output_models],
+            [om.ignore_outliers for om in output_models],
+            _discrete_observations(observations)
+        )
 
     def fit(self, observations: List[np.ndarray], weights: List[np.ndarray]):
         # initialize output probability matrix
@@ -340,13 +594,15 @@ class GaussianOutputModel(OutputModel):
             self._handle_outliers(state_probabilities)
         return state_probabilities
 
-    def generate_observation_trajectory(self, hidden_state_trajectory: np.ndarray) -> np.ndarray:
+    def generate_observation_trajectory(self, hidden_state_trajectory: np.ndarray, seed: int = -1) -> np.ndarray:
         """ Generate synthetic observation data from a given state sequence.
 
         Parameters
         ----------
         hidden_state_trajectory : numpy.array with shape (T,) of int type
             s_t[t] is the hidden state sampled at time t
+        seed : int, optional, default=-1
+            Random seed, a negative value draws a random seed.
 
         Returns
         -------
@@ -367,7 +623,22 @@ class GaussianOutputModel(OutputModel):
         >>> o_t = output_model.generate_observation_trajectory(s_t)
 
         """
-        return _bindings.gaussian.generate_observation_trajectory(hidden_state_trajectory, self.means, self.sigmas)
+        return _bindings.gaussian.generate_observation_trajectory(hidden_state_trajectory, self.means, self.sigmas,
+                                                                  seed=seed)
+
+    def forward_backward_checkpointed(self, transition_matrix: np.ndarray, initial_distribution: np.ndarray,
+                                      observations: np.ndarray, checkpoint_interval: Optional[int] = None,
+                                      gamma_out: Optional[np.ndarray] = None):
+        r""" See :meth:`OutputModel.forward_backward_checkpointed`. The emission statistics are the weighted moments
+        of shape (3, :attr:`n_hidden_states`), i.e., :math:`\sum_t \gamma_t`, :math:`\sum_t \gamma_t o_t` and
+        :math:`\sum_t \gamma_t o_t^2`. """
+        dtype = transition_matrix.dtype
+        return _bindings.gaussian.forward_backward_checkpointed(
+            transition_matrix, self.means.astype(dtype, copy=False), self.sigmas.astype(dtype, copy=False),
+            initial_distribution.astype(dtype, copy=False), observations.astype(dtype, copy=False),
+            self.ignore_outliers, checkpoint_interval=0 if checkpoint_interval is None else checkpoint_interval,
+            gamma_out=gamma_out
+        )
 
     def submodel(self, states: Optional[np.ndarray] = None, obs: Optional[np.ndarray] = None):
         if states is None:
@@ -375,6 +646,59 @@ class GaussianOutputModel(OutputModel):
         return GaussianOutputModel(len(states), means=self.means[states], sigmas=self.sigmas[states],
                                    ignore_outliers=self.ignore_outliers)
 
+    def _forward_backward_batch(self, transition_matrix, initial_distribution, observations, gammas,
+                                parallel_in_time=False):
+        r""" See :meth:`OutputModel._forward_backward_batch`, the statistics are the weighted moments of shape
+        (3, :attr:`n_hidden_states`) of the observations around the current means, i.e., :math:`\sum_t \gamma_t`,
+        :math:`\sum_t \gamma_t (o_t - \mu)` and :math:`\sum_t \gamma_t (o_t - \mu)^2`. """
+        dtype = transition_matrix.dtype
+        pobs = [self.to_state_probability_trajectory(obs).astype(dtype, copy=False) for obs in observations]
+        return _bindings.gaussian.forward_backward_batch(
+            transition_matrix, pobs, initial_distribution.astype(dtype, copy=False),
+            [obs.astype(dtype, copy=False) for obs in observations], self.means.astype(dtype, copy=False),
+            gammas_out=gammas, parallel_in_time=parallel_in_time
+        )
+
+    def _baum_welch(self, transition_matrix, initial_distribution, observations, gammas, reversible, stationary,
+                    fixed_stationary_distribution, fixed_initial_distribution, accuracy, maxit, maxit_reversible,
+                    parallel_in_time=False, callback=None):
+        dtype = _native_baum_welch_dtype(transition_matrix, gammas)
+        if dtype is None:
+            return None
+        P, pi, means, sigmas, likelihoods, counts, initial_counts = _bindings.gaussian.baum_welch(
+            transition_matrix, initial_distribution.astype(dtype, copy=False), self.means.astype(dtype, copy=False),
+            self.sigmas.astype(dtype, copy=False), self.ignore_outliers,
+            [obs.astype(dtype, copy=False) for obs in observations], gammas, reversible, stationary,
+            _optional_distribution(fixed_stationary_distribution, dtype),
+            _optional_distribution(fixed_initial_distribution, dtype), accuracy, maxit, maxit_reversible,
+            parallel_in_time=parallel_in_time, callback=callback
+        )
+        self._means = means.astype(self.means.dtype)
+        self._sigmas = sigmas.astype(self.sigmas.dtype)
+        return P, pi, likelihoods, counts, initial_counts
+
+    def _fit_statistics(self, observations, weights, statistics):
+        weight_sums, first_moments, second_moments = np.asarray(statistics, dtype=np.float64)
+        mean_shifts = first_moments / weight_sums
+        variances = np.maximum(second_moments / weight_sums - mean_shifts ** 2, 0)
+        self._means = (self.means + mean_shifts).astype(self.means.dtype)
+        self._sigmas = np.sqrt(variances).astype(self.sigmas.dtype)
+        if np.any(self._sigmas < np.finfo(self._sigmas.dtype).eps):
+            raise RuntimeError('at least one sigma is too small to continue.')
+        return self
+
+    @classmethod
+    def _log_likelihoods(cls, transition_matrices, initial_distributions, output_models, observations):
+        dtype = np.float32 if all(A.dtype == np.float32 for A in transition_matrices) else np.float64
+        return _bindings.gaussian.log_likelihoods(
+            [A.astype(dtype, copy=False) for A in transition_matrices],
+            [pi.astype(dtype, copy=False) for pi in initial_distributions],
+            [om.means.astype(dtype, copy=False) for om in output_models],
+            [om.sigmas.astype(dtype, copy=False) for om in output_models],
+            [om.ignore_outliers for om in output_models],
+            [obs.astype(dtype, copy=False) for obs in observations]
+        )
+
     def fit(self, observations: List[np.ndarray], weights: List[np.ndarray]):
         """
         Fits the output model given the observations and weights
@@ -461,3 +785,223 @@ class GaussianOutputModel(OutputModel):
                 chisquared = np.random.chisquare(nsamples_in_state - 1)
                 sigmahat2 = np.mean((observations_in_state - self.means[state_index]) ** 2)
                 self.sigmas[state_index] = np.sqrt(sigmahat2) / np.sqrt(chisquared / nsamples_in_state)
+
+
+class MultivariateGaussianOutputModel(OutputModel):
+    r""" HMM output probability model using multivariate Gaussians with full or diagonal covariance matrices.
+    Densities are evaluated in log-space, so that the forward-backward pass does not underflow for
+    high-dimensional observations (e.g., TICA coordinates) far from all means.
+
+    Parameters
+    ----------
+    n_states : int
+        number of hidden states
+    means : array_like
+        means of the output Gaussians, shape (n_states, dimension)
+    covariances : array_like, optional, default=None
+        covariance matrices of shape (n_states, dimension, dimension) or, if covariance_type is 'diag', variances of
+        shape (n_states, dimension). Defaults to identity covariances.
+    covariance_type : str, optional, default='full'
+        either 'full' or 'diag'
+    ignore_outliers : bool, optional, default=True
+        whether to ignore outliers which could cause numerical instabilities
+
+    See Also
+    --------
+    GaussianOutputModel
+    """
+
+    def __init__(self, n_states: int, means, covariances=None, covariance_type: str = 'full',
+                 ignore_outliers: bool = True):
+        if covariance_type not in ('full', 'diag'):
+            raise ValueError(f"Covariance type must be 'full' or 'diag' but was {covariance_type}.")
+        means = np.asarray(means)
+        if not np.issubdtype(means.dtype, np.floating):
+            means = means.astype(np.float64)
+        if means.ndim == 1:
+            means = means[:, None]
+        if means.ndim != 2 or means.shape[0] != n_states:
+            raise ValueError(f"Means must be of shape (n_states, dimension) = ({n_states}, d) but were of shape "
+                             f"{means.shape}.")
+        dim = means.shape[1]
+        if covariances is None:
+            covariances = np.ones((n_states, dim)) if covariance_type == 'diag' \
+                else np.tile(np.eye(dim), (n_states, 1, 1))
+        covariances = np.asarray(covariances, dtype=means.dtype)
+        expected_shape = (n_states, dim) if covariance_type == 'diag' else (n_states, dim, dim)
+        if covariances.shape != expected_shape:
+            raise ValueError(f"Covariances of type '{covariance_type}' must be of shape {expected_shape} but were of "
+                             f"shape {covariances.shape}.")
+        self._means = means
+        self._covariances = covariances
+        self._covariance_type = covariance_type
+
+        super(MultivariateGaussianOutputModel, self).__init__(n_hidden_states=n_states, n_observable_states=-1,
+                                                              ignore_outliers=ignore_outliers)
+
+    @property
+    def means(self) -> np.ndarray:
+        r""" Mean values of the Gaussian output densities, shape (:attr:`n_hidden_states`, :attr:`dimension`). """
+        return self._means
+
+    @property
+    def covariances(self) -> np.ndarray:
+        r""" Covariance matrices of the Gaussian output densities or their diagonals, depending on
+        :attr:`covariance_type`. """
+        return self._covariances
+
+    @property
+    def covariance_type(self) -> str:
+        r""" Either 'full' or 'diag'. """
+        return self._covariance_type
+
+    @property
+    def dimension(self) -> int:
+        r""" Dimension of the observation space. """
+        return self._means.shape[1]
+
+    def _observations(self, observations: np.ndarray, dtype=None) -> np.ndarray:
+        r""" Observations as C-contiguous (T, dimension) array, one-dimensional trajectories are treated as (T, 1). """
+        observations = np.asarray(observations)
+        if observations.ndim == 1:
+            observations = observations[:, None]
+        if observations.ndim != 2 or observations.shape[1] != self.dimension:
+            raise ValueError(f"Observations must be of shape (T, {self.dimension}) but were of shape "
+                             f"{observations.shape}.")
+        return np.ascontiguousarray(observations, dtype=self.means.dtype if dtype is None else dtype)
+
+    def _parameters(self, dtype):
+        return self.means.astype(dtype, copy=False), self.covariances.astype(dtype, copy=False)
+
+    def to_log_state_probability_trajectory(self, observations: np.ndarray) -> np.ndarray:
+        r""" Log-densities of the observations under each hidden state.
+
+        Parameters
+        ----------
+        observations : (T, dimension) ndarray
+            Array of observations.
+
+        Returns
+        -------
+        log_state_probabilities : (T, n_hidden) ndarray
+            Log-densities of each observation and hidden state.
+        """
+        obs = self._observations(observations)
+        return _bindings.multivariate_gaussian.log_output_probability_trajectory(obs, *self._parameters(obs.dtype))
+
+    def to_state_probability_trajectory(self, observations: np.ndarray) -> np.ndarray:
+        state_probabilities = np.exp(self.to_log_state_probability_trajectory(observations))
+        if self.ignore_outliers:
+            self._handle_outliers(state_probabilities)
+        return state_probabilities
+
+    def generate_observation_trajectory(self, hidden_state_trajectory: np.ndarray, seed: int = -1) -> np.ndarray:
+        """ Generate synthetic observation data from a given state sequence.
+
+        Parameters
+        ----------
+        hidden_state_trajectory : numpy.array with shape (T,) of int type
+            s_t[t] is the hidden state sampled at time t
+        seed : int, optional, default=-1
+            Random seed, a negative value draws a random seed.
+
+        Returns
+        -------
+        o_t : numpy.array with shape (T, dimension) of type dtype
+            o_t[t] is the observation associated with state s_t[t]
+
+        Examples
+        --------
+
+        >>> output_model = MultivariateGaussianOutputModel(2, means=[[-1, 0], [1, 1]], covariances=[[.5, .1], [1, 2]],
+        ...                                                covariance_type='diag')
+        >>> s_t = np.random.randint(0, output_model.n_hidden_states, size=[1000])
+        >>> o_t = output_model.generate_observation_trajectory(s_t)
+        >>> print(o_t.shape)
+        (1000, 2)
+        """
+        return _bindings.multivariate_gaussian.generate_observation_trajectory(
+            np.asarray(hidden_state_trajectory, dtype=np.int64), self.means, self.covariances, seed=seed
+        )
+
+    def submodel(self, states: Optional[np.ndarray] = None, obs: Optional[np.ndarray] = None):
+        if states is None:
+            states = np.arange(self.n_hidden_states)
+        return MultivariateGaussianOutputModel(len(states), means=self.means[states],
+                                               covariances=self.covariances[states],
+                                               covariance_type=self.covariance_type,
+                                               ignore_outliers=self.ignore_outliers)
+
+    def _forward_backward_batch(self, transition_matrix, initial_distribution, observations, gammas,
+                                parallel_in_time=False):
+        r""" See :meth:`OutputModel._forward_backward_batch`. The output probabilities are evaluated in log-space
+        and scaled per time step, the statistics are the weighted moments of the observations around the current
+        means of shape (:attr:`n_hidden_states`, s), see :meth:`_fit_statistics`. """
+        dtype = transition_matrix.dtype
+        return _bindings.multivariate_gaussian.forward_backward_batch(
+            transition_matrix, *self._parameters(dtype), initial_distribution.astype(dtype, copy=False),
+            [self._observations(obs, dtype) for obs in observations], self.ignore_outliers,
+            gammas_out=gammas, parallel_in_time=parallel_in_time
+        )
+
+    def _fit_statistics(self, observations, weights, statistics):
+        r""" Updates means and covariances from weighted moments around the current means: per state, the weight
+        sum, the :attr:`dimension` first moments and the flattened (dimension, dimension) second moments, or only
+        their diagonal for diagonal covariances. """
+        statistics = np.asarray(statistics, dtype=np.float64)
+        dim = self.dimension
+        weight_sums = statistics[:, :1]
+        mean_shifts = statistics[:, 1:dim + 1] / weight_sums
+        second_moments = statistics[:, dim + 1:] / weight_sums
+        if self.covariance_type == 'full':
+            covariances = second_moments.reshape(-1, dim, dim) - mean_shifts[:, :, None] * mean_shifts[:, None, :]
+            smallest_eigenvalues = np.linalg.eigvalsh(covariances)[:, 0]
+        else:
+            covariances = np.maximum(second_moments - mean_shifts ** 2, 0)
+            smallest_eigenvalues = np.min(covariances, axis=1)
+        self._means = (self.means + mean_shifts).astype(self.means.dtype)
+        self._covariances = covariances.astype(self.covariances.dtype)
+        if not np.all(smallest_eigenvalues > np.finfo(self._covariances.dtype).eps):
+            raise RuntimeError('at least one covariance matrix is too close to singular to continue.')
+        return self
+
+    @classmethod
+    def _log_likelihoods(cls, transition_matrices, initial_distributions, output_models, observations):
+        dtype = np.float32 if all(A.dtype == np.float32 for A in transition_matrices) else np.float64
+        return _bindings.multivariate_gaussian.log_likelihoods(
+            [A.astype(dtype, copy=False) for A in transition_matrices],
+            [pi.astype(dtype, copy=False) for pi in initial_distributions],
+            [om.means.astype(dtype, copy=False) for om in output_models],
+            [om.covariances.astype(dtype, copy=False) for om in output_models],
+            [om.ignore_outliers for om in output_models],
+            [output_models[0]._observations(obs, dtype) for obs in observations]
+        )
+
+    def fit(self, observations: List[np.ndarray], weights: List[np.ndarray]):
+        """
+        Fits the output model given the observations and weights. The weighted moments are accumulated in parallel
+        over blocks of time steps.
+
+        Parameters
+        ----------
+        observations : [ ndarray(T_k, dimension) ] with K elements
+            A list of K observation trajectories, each having length T_k
+        weights : [ ndarray(T_k, n_states) ] with K elements
+            A list of K weight matrices, each having length T_k
+            weights[k][t,n] is the weight assignment from observations[k][t] to state index n
+
+        Returns
+        -------
+        self : MultivariateGaussianOutputModel
+            Reference to self.
+        """
+        dtype = self.means.dtype
+        statistics = _bindings.multivariate_gaussian.weighted_moments(
+            [self._observations(obs, dtype) for obs in observations],
+            [np.asarray(w, dtype=dtype) for w in weights], self.means, self.covariance_type == 'diag'
+        )
+        return self._fit_statistics(observations, weights, statistics)
+
+    def sample(self, observations_per_state: List[np.ndarray]) -> None:
+        r""" Not supported, Bayesian HMMs are only available with discrete output models. """
+        raise NotImplementedError(f"Sampling of output model parameters is not implemented for {type(self).__name__}.")
@@ -6,7 +6,7 @@ def configuration(parent_package='', top_path=None):
 
     config.add_extension('_hmm_bindings',
                          sources=['_bindings/src/hmm_module.cpp'],
-                         include_dirs=['_bindings/include'],
+                         include_dirs=['_bindings/include', '../tools/estimation/dense/_bindings/include'],
                          language='c++',
                          extra_compile_args=['-fvisibility=hidden']
                          )
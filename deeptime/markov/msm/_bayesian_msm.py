@@ -48,6 +48,14 @@ class BayesianMSM(_MSMBaseEstimator):
         (:math:`x_i = \sum_k x_{ik}`). The relative stationary probability changes
         :math:`e_i = (x_i^{(1)} - x_i^{(2)})/(x_i^{(1)} + x_i^{(2)})` are used in order to track changes in small
         probabilities. The Euclidean norm of the change vector, :math:`|e_i|_2`, is compared to maxerr.
+    n_chains : int, optional, default=1
+        Number of independent Markov chains that generate the samples in parallel. Only used for reversible sampling
+        with dense count matrices. Every call to :meth:`sample` (and hence to :meth:`fit`) sets up a new sampler, so
+        that all of its chains start at the maximum likelihood estimate of the prior, or at the maximum likelihood
+        estimate given the stationary distribution if there is a `stationary_distribution_constraint`.
+    n_burn_in : int, optional, default=0
+        Number of Gibbs sampling steps each chain discards before recording samples, in every call to
+        :meth:`sample`.
 
     References
     ----------
@@ -130,7 +138,8 @@ class BayesianMSM(_MSMBaseEstimator):
 
     def __init__(self, n_samples: int = 100, n_steps: int = None, reversible: bool = True,
                  stationary_distribution_constraint: Optional[np.ndarray] = None,
-                 sparse: bool = False, confidence: float = 0.954, maxiter: int = int(1e6), maxerr: float = 1e-8):
+                 sparse: bool = False, confidence: float = 0.954, maxiter: int = int(1e6), maxerr: float = 1e-8,
+                 n_chains: int = 1, n_burn_in: int = 0):
         super(BayesianMSM, self).__init__(reversible=reversible, sparse=sparse)
         self.stationary_distribution_constraint = stationary_distribution_constraint
         self.maxiter = maxiter
@@ -138,6 +147,8 @@ class BayesianMSM(_MSMBaseEstimator):
         self.n_samples = n_samples
         self.n_steps = n_steps
         self.confidence = confidence
+        self.n_chains = n_chains
+        self.n_burn_in = n_burn_in
 
     @property
     def stationary_distribution_constraint(self) -> Optional[np.ndarray]:
@@ -216,7 +227,8 @@ class BayesianMSM(_MSMBaseEstimator):
 
         return self.fit_from_msm(msm, callback=callback)
 
-    def sample(self, prior: MarkovStateModel, n_samples: int, n_steps: Optional[int] = None, callback=None):
+    def sample(self, prior: MarkovStateModel, n_samples: int, n_steps: Optional[int] = None, callback=None,
+               n_chains: Optional[int] = None, n_burn_in: Optional[int] = None):
         r""" Performs sampling based on a prior.
 
         Parameters
@@ -230,6 +242,11 @@ class BayesianMSM(_MSMBaseEstimator):
             by :math:`\sqrt{\mathrm{n\_states}}`.
         callback : callable, optional, default=None
             Callback function that indicates progress of sampling.
+        n_chains : int, optional, default=None
+            Number of independent chains sampled in parallel. If None, the estimator's `n_chains` is used.
+        n_burn_in : int, optional, default=None
+            Number of steps each chain discards before recording samples. If None, the estimator's `n_burn_in` is
+            used.
 
         Returns
         -------
@@ -265,7 +282,10 @@ class BayesianMSM(_MSMBaseEstimator):
             # We can not use the MLE as T0. Use the initialization in the reversible pi sampler
             tsampler = tmatrix_sampler(prior.count_model.count_matrix, reversible=self.reversible,
                                        mu=statdist_active, nsteps=n_steps)
-        sample_Ps, sample_mus = tsampler.sample(nsamples=n_samples, return_statdist=True, callback=callback)
+        n_chains = self.n_chains if n_chains is None else n_chains
+        n_burn_in = self.n_burn_in if n_burn_in is None else n_burn_in
+        sample_Ps, sample_mus = tsampler.sample(nsamples=n_samples, return_statdist=True, callback=callback,
+                                                n_chains=n_chains, n_burn_in=n_burn_in)
         # construct sampled MSMs
         samples = [
             MarkovStateModel(P, stationary_distribution=pi, reversible=self.reversible,
@@ -951,7 +951,8 @@ class MarkovStateModel(Model):
             seed = -1
         from .._markov_bindings import simulation as sim
         if start is None:
-            start = np.random.choice(self.n_states, p=self.stationary_distribution)
+            state = np.random.RandomState(seed) if seed >= 0 else np.random
+            start = state.choice(self.n_states, p=self.stationary_distribution)
         if self.sparse:
             transition_matrix = self.transition_matrix.toarray()
         else:
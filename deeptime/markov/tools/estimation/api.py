@@ -698,7 +698,7 @@ def prior_rev(C, alpha=-1.0):
 def transition_matrix(C, reversible=False, mu=None, method='auto',
                       maxiter: int = 1000000, maxerr: float = 1e-8,
                       rev_pisym : bool = False, return_statdist: bool = False, warn_not_converged: bool = True,
-                      sparse_newton: bool = False):
+                      sparse_newton: bool = False, acceleration: str = 'none'):
     r"""Estimate the transition matrix from the given countmatrix. :footcite:`prinz2011markov`
     :footcite:`bowman2009progress` :footcite:`trendelkamp2015estimation`
 
@@ -751,6 +751,13 @@ def transition_matrix(C, reversible=False, mu=None, method='auto',
         Prints a warning if not converged.
     sparse_newton : bool, optional, default=False
         If True, use the experimental primal-dual interior-point solver for sparse input/computation method.
+    acceleration : str, optional, default='none'
+        Optional parameter with reversible = True.
+        Extrapolation scheme on top of the fixed-point iteration, one of 'none', 'squarem', and 'anderson'.
+        Extrapolated iterates are kept positive (and normalized) and fall back to the plain fixed-point step
+        whenever they are not admissible or increase the error. For slowly mixing systems this can reduce the
+        number of iterations considerably. Not supported together with `sparse_newton=True`, which raises a
+        ValueError.
 
     Returns
     -------
@@ -808,6 +815,10 @@ def transition_matrix(C, reversible=False, mu=None, method='auto',
     else:
         raise NotImplementedError('C has an unknown type.')
 
+    if sparse_newton and acceleration != 'none':
+        raise ValueError(f"acceleration='{acceleration}' is not supported by the sparse Newton solver, "
+                         f"use acceleration='none' or sparse_newton=False.")
+
     if method == 'dense':
         sparse_computation = False
     elif method == 'sparse':
@@ -846,7 +857,7 @@ def transition_matrix(C, reversible=False, mu=None, method='auto',
                 else:
                     result = sparse.mle.mle_trev(C, maxerr=maxerr, maxiter=maxiter,
                                                  warn_not_converged=warn_not_converged,
-                                                 return_statdist=return_statdist)
+                                                 return_statdist=return_statdist, acceleration=acceleration)
             else:
                 if rev_pisym:
                     result = dense.transition_matrix.transition_matrix_reversible_pisym(
@@ -854,14 +865,17 @@ def transition_matrix(C, reversible=False, mu=None, method='auto',
                     )
                 else:
                     result = dense.mle.mle_trev(C, maxerr=maxerr, maxiter=maxiter,
-                                                warn_not_converged=warn_not_converged, return_statdist=return_statdist)
+                                                warn_not_converged=warn_not_converged, return_statdist=return_statdist,
+                                                acceleration=acceleration)
         else:
             if sparse_computation:
                 # Sparse, reversible, fixed pi (currently using dense with sparse conversion)
                 result = sparse.mle.mle_trev_given_pi(C, mu, maxerr=maxerr, maxiter=maxiter,
-                                                      warn_not_converged=warn_not_converged)
+                                                      warn_not_converged=warn_not_converged,
+                                                      acceleration=acceleration)
             else:
-                result = dense.mle.mle_trev_given_pi(C, mu, maxerr=maxerr, maxiter=maxiter)
+                result = dense.mle.mle_trev_given_pi(C, mu, maxerr=maxerr, maxiter=maxiter,
+                                                     acceleration=acceleration)
     else:  # nonreversible estimation
         if mu is None:
             if sparse_computation:
@@ -1095,7 +1109,8 @@ def sample_tmatrix(C, nsample=1, nsteps=None, reversible=False, mu=None, T0=None
     Returns
     -------
     P : ndarray(n,n) or array of ndarray(n,n)
-        sampled transition matrix (or multiple matrices if nsample > 1)
+        sampled transition matrix (or multiple matrices if nsample > 1). For reversible sampling with a sparse count
+        matrix, the samples are sparse matrices in a list.
 
     Notes
     -----
@@ -1110,7 +1125,7 @@ def sample_tmatrix(C, nsample=1, nsteps=None, reversible=False, mu=None, T0=None
     tmatrix_sampler
 
     """
-    if issparse(C):
+    if issparse(C) and not reversible:
         _showSparseConversionWarning()
         C = C.toarray()
 
@@ -1146,6 +1161,9 @@ def tmatrix_sampler(C, reversible=False, mu=None, T0=None, nsteps=None, prior='s
     Returns
     -------
     sampler : A :py:class:dense.tmatrix_sampler.TransitionMatrixSampler object that can be used to generate samples.
+        For reversible sampling, a sparse count matrix is kept sparse: counts and samples are only stored on the
+        sparsity pattern of :math:`C + C^T` (plus the diagonal if the stationary distribution is fixed) and samples are
+        sparse matrices.
 
     Notes
     -----
@@ -1179,7 +1197,8 @@ def tmatrix_sampler(C, reversible=False, mu=None, T0=None, nsteps=None, prior='s
         uncertainty of reversible Markov models. J. Chem. Phys. (submitted)
 
     """
-    if issparse(C):
+    if issparse(C) and not reversible:
+        # only reversible sampling operates on sparse count matrices
         _showSparseConversionWarning()
         C = C.toarray()
 
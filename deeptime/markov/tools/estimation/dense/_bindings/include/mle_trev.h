@@ -6,109 +6,259 @@
 
 #include <cmath>
 #include <memory>
+#include <numeric>
+#include <tuple>
+#include <vector>
 
 #include "common.h"
+#include "fixed_point_utils.h"
 
+namespace detail {
+
+/**
+ * One step of the fixed-point iteration for the reversible maximum likelihood transition matrix on a dense,
+ * symmetrized count matrix CCt = C + C^T, i.e.,
+ *
+ *     x_i <- sum_j CCt_ij / (c_i / x_i + c_j / x_j),  c_i = sum_j C_ij.
+ *
+ * The ratios c_i / x_i are computed once per step, rows are distributed over threads and the inner loops are
+ * vectorized. Count matrices with many zeros are stored in compressed rows so that only nonzeros are visited.
+ */
 template<typename dtype>
-int mle_trev_dense(np_array<dtype> &T_arr, const np_array<dtype> &CCt_arr,
-                   const np_array<dtype> &sum_C_arr, const std::size_t dim,
-                   const dtype maxerr, const std::size_t maxiter,
-                   np_array<dtype> &mu, dtype eps_mu) {
-    py::gil_scoped_release gil;
+class TrevDenseUpdate {
+public:
+    TrevDenseUpdate(const dtype *CCt, const dtype *sumC, std::size_t dim) : CCt(CCt), sumC(sumC), dim(dim),
+                                                                             ratio(new dtype[dim]) {
+        std::vector<std::size_t> rowNnz(dim, 0);
+        for (std::size_t i = 0; i < dim; ++i) {
+            for (std::size_t j = 0; j < dim; ++j) {
+                rowNnz[i] += CCt[i * dim + j] != 0;
+            }
+        }
+        auto nnz = std::accumulate(rowNnz.begin(), rowNnz.end(), static_cast<std::size_t>(0));
+        sparse = nnz * sparseThreshold < dim * dim;
+        if (sparse) {
+            rowPtr.resize(dim + 1, 0);
+            std::partial_sum(rowNnz.begin(), rowNnz.end(), rowPtr.begin() + 1);
+            cols.resize(nnz);
+            vals.resize(nnz);
+            for (std::size_t i = 0; i < dim; ++i) {
+                auto k = rowPtr[i];
+                for (std::size_t j = 0; j < dim; ++j) {
+                    if (CCt[i * dim + j] != 0) {
+                        cols[k] = j;
+                        vals[k] = CCt[i * dim + j];
+                        ++k;
+                    }
+                }
+            }
+        }
+    }
 
-    dtype rel_err, x_norm;
-    auto sum_C = sum_C_arr.template unchecked<1>();
-    auto T = T_arr.template mutable_unchecked<2>();
-    auto CCt = CCt_arr.template unchecked<2>();
+    /**
+     * Initial guess for the iteration: the row sums of CCt.
+     */
+    void initialGuess(dtype *x) const {
+        auto CCtPtr = CCt;
+        auto n = dim;
+        #pragma omp parallel for default(none) firstprivate(CCtPtr, n, x)
+        for (std::size_t i = 0; i < n; ++i) {
+            dtype sum = 0;
+            #pragma omp simd reduction(+:sum)
+            for (std::size_t j = 0; j < n; ++j) {
+                sum += CCtPtr[i * n + j];
+            }
+            x[i] = sum;
+        }
+    }
 
-    std::unique_ptr<dtype[]> sum_x{new dtype[dim]};
-    std::unique_ptr<dtype[]> sum_x_new{new dtype[dim]};
+    /**
+     * Unnormalized update xNew = F(x), returns the sum over xNew.
+     */
+    dtype operator()(const dtype *x, dtype *xNew) const {
+        auto n = dim;
+        auto c = sumC;
+        auto r = ratio.get();
 
-    /* ckeck sum_C */
-    for (std::size_t i = 0; i < dim; i++) {
-        if (sum_C[i] == 0) {
-            throw std::invalid_argument("Some row and corresponding column of C have zero counts.");
+        #pragma omp parallel for simd default(none) firstprivate(n, c, r, x)
+        for (std::size_t i = 0; i < n; ++i) {
+            r[i] = c[i] / x[i];
+        }
+
+        dtype norm = 0;
+        if (sparse) {
+            auto ptr = rowPtr.data();
+            auto colsPtr = cols.data();
+            auto valsPtr = vals.data();
+            #pragma omp parallel for reduction(+:norm) default(none) firstprivate(n, r, xNew, ptr, colsPtr, valsPtr) schedule(guided)
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto ri = r[i];
+                dtype sum = 0;
+                #pragma omp simd reduction(+:sum)
+                for (auto k = ptr[i]; k < ptr[i + 1]; ++k) {
+                    sum += valsPtr[k] / (ri + r[colsPtr[k]]);
+                }
+                xNew[i] = sum;
+                norm += sum;
+            }
+        } else {
+            auto CCtPtr = CCt;
+            #pragma omp parallel for reduction(+:norm) default(none) firstprivate(n, r, xNew, CCtPtr)
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto ri = r[i];
+                const auto *const row = CCtPtr + i * n;
+                dtype sum = 0;
+                #pragma omp simd reduction(+:sum)
+                for (std::size_t j = 0; j < n; ++j) {
+                    sum += row[j] / (ri + r[j]);
+                }
+                xNew[i] = sum;
+                norm += sum;
+            }
         }
+        return norm;
     }
 
-    /* initialize sum_x_new */
-    x_norm = 0;
-    for (std::size_t i = 0; i < dim; i++) {
-        sum_x_new[i] = 0;
-        for (std::size_t j = 0; j < dim; j++) {
-            sum_x_new[i] += CCt(i, j);
+    /**
+     * Evaluates the transition matrix T_ij = X_ij / sum_k X_ik with X_ij = CCt_ij / (c_i / x_i + c_j / x_j).
+     */
+    void transitionMatrix(const dtype *x, dtype *T) const {
+        auto n = dim;
+        auto c = sumC;
+        auto r = ratio.get();
+        auto CCtPtr = CCt;
+
+        #pragma omp parallel for simd default(none) firstprivate(n, c, r, x)
+        for (std::size_t i = 0; i < n; ++i) {
+            r[i] = c[i] / x[i];
         }
-        x_norm += sum_x_new[i];
+
+        #pragma omp parallel for default(none) firstprivate(n, r, T, CCtPtr)
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto ri = r[i];
+            const auto *const row = CCtPtr + i * n;
+            auto *const Trow = T + i * n;
+            dtype sum = 0;
+            #pragma omp simd reduction(+:sum)
+            for (std::size_t j = 0; j < n; ++j) {
+                Trow[j] = row[j] / (ri + r[j]);
+                sum += Trow[j];
+            }
+            #pragma omp simd
+            for (std::size_t j = 0; j < n; ++j) {
+                Trow[j] /= sum;
+            }
+        }
+    }
+
+    std::size_t dimension() const {
+        return dim;
+    }
+
+private:
+    // use compressed rows if less than one in sparseThreshold elements is nonzero
+    static constexpr std::size_t sparseThreshold = 4;
+
+    const dtype *CCt;
+    const dtype *sumC;
+    std::size_t dim;
+    bool sparse {false};
+    std::vector<std::size_t> rowPtr;
+    std::vector<std::size_t> cols;
+    std::vector<dtype> vals;
+    std::unique_ptr<dtype[]> ratio;
+};
+
+template<typename dtype>
+void normalize(dtype *x, std::size_t n, dtype norm) {
+    #pragma omp parallel for simd default(none) firstprivate(x, n, norm)
+    for (std::size_t i = 0; i < n; ++i) {
+        x[i] /= norm;
     }
+}
+
+}
+
+/**
+ * Reversible maximum likelihood transition matrix of a strongly connected (dim, dim) count matrix C, given
+ * CCt = C + C^T and the row sums of C. The transition matrix is written to T and its stationary distribution to mu.
+ * Does not touch Python objects, so that it can be called without the GIL.
+ */
+template<typename dtype>
+deeptime::fixed_point::Result<dtype> mle_trev_dense_impl(dtype *T, const dtype *CCt, const dtype *sum_C,
+                                                         const std::size_t dim, const dtype maxerr,
+                                                         const std::size_t maxiter, dtype *mu, dtype eps_mu,
+                                                         deeptime::fixed_point::Acceleration method) {
+    /* ckeck sum_C */
     for (std::size_t i = 0; i < dim; i++) {
-        sum_x_new[i] /= x_norm;
+        if (sum_C[i] == 0) {
+            throw std::invalid_argument("Some row and corresponding column of C have zero counts.");
+        }
     }
 
-    /* iterate */
-    std::size_t iteration{0};
-    do {
-        /* swap buffers */
-        std::swap(sum_x, sum_x_new);
+    detail::TrevDenseUpdate<dtype> update(CCt, sum_C, dim);
 
-        x_norm = 0;
+    /* initialize sum_x */
+    std::vector<dtype> sum_x(dim);
+    update.initialGuess(sum_x.data());
+    detail::normalize(sum_x.data(), dim, std::accumulate(sum_x.begin(), sum_x.end(), dtype(0)));
+
+    auto map = [&update, dim, eps_mu](const dtype *x, dtype *x_new) {
+        auto x_norm = update(x, x_new);
         for (std::size_t i = 0; i < dim; i++) {
-            sum_x_new[i] = 0;
-            for (std::size_t j = 0; j < dim; j++) {
-                sum_x_new[i] += CCt(i, j) / (sum_C[i] / sum_x[i] + sum_C[j] / sum_x[j]);
-            }
-            if (sum_x_new[i] == 0 || std::isnan(sum_x_new[i])) {
+            if (x_new[i] == 0 || std::isnan(x_new[i])) {
                 throw std::logic_error("The update of the stationary distribution produced zero or NaN.");
             }
-            x_norm += sum_x_new[i];
         }
 
         /* normalize sum_x */
+        detail::normalize(x_new, dim, x_norm);
         for (std::size_t i = 0; i < dim; i++) {
-            sum_x_new[i] /= x_norm;
-            if (sum_x_new[i] <= eps_mu) {
+            if (x_new[i] <= eps_mu) {
                 throw std::logic_error("Stationary distribution contains entries smaller "
                                        "than " + std::to_string(eps_mu) + "  during iteration.");
             }
         }
-
-        iteration += 1;
-        rel_err = util::relativeError(dim, sum_x.get(), sum_x_new.get());
-    } while (rel_err > maxerr && iteration < maxiter);
+    };
+    auto error = [dim](const dtype *x, const dtype *x_new) {
+        return util::relativeError(dim, x, x_new);
+    };
+    auto result = deeptime::fixed_point::solvePositive(sum_x, map, error, true, eps_mu, maxerr, maxiter, method);
 
     /* calculate T*/
-    for (std::size_t i = 0; i < dim; i++) {
-        sum_x[i] = 0;  // updated sum
-        for (std::size_t j = 0; j < dim; j++) {
-            T(i, j) = CCt(i, j) / (sum_C[i] / sum_x_new[i] + sum_C[j] / sum_x_new[j]);  // X_ij
-            sum_x[i] += T(i, j);  // update sum with X_ij
-        }
-        /* normalize X to T*/
-        for (std::size_t j = 0; j < dim; j++) {
-            T(i, j) /= sum_x[i];
-        }
-    }
+    update.transitionMatrix(sum_x.data(), T);
 
-    std::copy(sum_x_new.get(), sum_x_new.get() + dim, mu.mutable_data());
+    std::copy(sum_x.begin(), sum_x.end(), mu);
 
-    if (iteration == maxiter) {
-        return -5;
-    } else {
-        return 0;
-    }
+    return result;
 }
 
 template<typename dtype>
-int mle_trev_given_pi_dense(np_array<dtype>& T_arr, const np_array<dtype> &C_arr, const np_array<dtype> &mu_arr,
-                            const std::size_t n, const dtype maxerr, const std::size_t maxiter) {
-    py::gil_scoped_release gil;
+std::tuple<int, std::vector<dtype>> mle_trev_dense(np_array<dtype> &T_arr, const np_array<dtype> &CCt_arr,
+                                                   const np_array<dtype> &sum_C_arr, const std::size_t dim,
+                                                   const dtype maxerr, const std::size_t maxiter,
+                                                   np_array<dtype> &mu, dtype eps_mu,
+                                                   const std::string &acceleration) {
+    auto method = deeptime::fixed_point::parseAcceleration(acceleration);
+    auto *T = T_arr.mutable_data();
+    auto *muPtr = mu.mutable_data();
 
-    auto T = T_arr.template mutable_unchecked<2>();
-    auto C = C_arr.template unchecked<2>();
-    auto mu = mu_arr.template unchecked<1>();
+    py::gil_scoped_release gil;
 
-    std::unique_ptr<dtype[]> lam{new dtype[n]};
-    std::unique_ptr<dtype[]> lam_new{new dtype[n]};
+    auto result = mle_trev_dense_impl(T, CCt_arr.data(), sum_C_arr.data(), dim, maxerr, maxiter, muPtr, eps_mu,
+                                      method);
+    return std::make_tuple(result.converged ? 0 : -5, std::move(result.errors));
+}
 
+/**
+ * Reversible maximum likelihood transition matrix of a (weakly connected) row-major (n, n) count matrix C with fixed
+ * stationary distribution mu, written to T. Does not touch Python objects, so that it can be called without the GIL.
+ */
+template<typename dtype>
+deeptime::fixed_point::Result<dtype> mle_trev_given_pi_dense_impl(dtype *T, const dtype *C, const dtype *mu,
+                                                                  const std::size_t n, const dtype maxerr,
+                                                                  const std::size_t maxiter,
+                                                                  deeptime::fixed_point::Acceleration method) {
     /* check mu */
     for (std::size_t i = 0; i < n; i++) {
         if (mu[i] == 0) {
@@ -117,66 +267,75 @@ int mle_trev_given_pi_dense(np_array<dtype>& T_arr, const np_array<dtype> &C_arr
     }
 
     /* initialise lambdas */
+    std::vector<dtype> lam(n);
     for (std::size_t i = 0; i < n; i++) {
-        lam_new[i] = 0.0;
+        lam[i] = 0.0;
         for (std::size_t j = 0; j < n; j++) {
-            lam_new[i] += static_cast<dtype>(.5) * (C(i, j) + C(j, i));
+            lam[i] += static_cast<dtype>(.5) * (C[i * n + j] + C[j * n + i]);
         }
-        if (lam_new[i] == 0) {
+        if (lam[i] == 0) {
             throw std::logic_error("Some row and corresponding column of C have zero counts.");
         }
     }
 
     /* iterate lambdas */
-    std::size_t iteration = 0;
-    dtype d_sq {0};
-    do {
-        /* swap buffers */
-        std::swap(lam, lam_new);
-
-        auto lam_ptr = lam.get();
-        auto lam_new_ptr = lam_new.get();
-
+    auto map = [C, mu, n](const dtype *lam_ptr, dtype *lam_new_ptr) {
         #pragma omp parallel for default(none) firstprivate(C, lam_ptr, lam_new_ptr, n, mu)
         for (std::size_t j = 0; j < n; j++) {
             lam_new_ptr[j] = 0.0;
             for (std::size_t i = 0; i < n; i++) {
-                auto C_ij = C(i, j) + C(j, i);
+                auto C_ij = C[i * n + j] + C[j * n + i];
                 if (C_ij != 0) {
                     lam_new_ptr[j] += C_ij / ((mu[j] * lam_ptr[i]) / (mu[i] * lam_ptr[j]) + 1);
                 }
             }
+        }
+        for (std::size_t j = 0; j < n; j++) {
             if (std::isnan(lam_new_ptr[j])) {
                 throw std::logic_error("The update of the Lagrange multipliers produced NaN.");
             }
         }
-        iteration += 1;
-        d_sq = util::distsq(n, lam_ptr, lam_new_ptr);
-    } while (d_sq > maxerr * maxerr && iteration < maxiter);
+    };
+    auto error = [n](const dtype *x, const dtype *x_new) {
+        return std::sqrt(util::distsq(n, x, x_new));
+    };
+    auto result = deeptime::fixed_point::solvePositive(lam, map, error, false, static_cast<dtype>(0), maxerr, maxiter,
+                                                       method);
 
     /* calculate T */
     for (std::size_t i = 0; i < n; i++) {
         dtype norm = 0;
         for (std::size_t j = 0; j < n; j++) {
-            auto C_ij = C(i, j) + C(j, i);
+            auto C_ij = C[i * n + j] + C[j * n + i];
             if (i != j) {
                 if (C_ij > 0.0) {
-                    T(i, j) = C_ij / (lam_new[i] + lam_new[j] * mu[i] / mu[j]);
-                    norm += T(i, j);
+                    T[i * n + j] = C_ij / (lam[i] + lam[j] * mu[i] / mu[j]);
+                    norm += T[i * n + j];
                 } else {
-                    T(i, j) = 0.0;
+                    T[i * n + j] = 0.0;
                 }
             }
         }
         if (norm > 1.0) {
-            T(i, i) = 0.0;
+            T[i * n + i] = 0.0;
         } else {
-            T(i, i) = 1.0 - norm;
+            T[i * n + i] = 1.0 - norm;
         }
     }
 
-    if (iteration == maxiter) {
-        return -5;
-    }
-    return 0;
+    return result;
+}
+
+template<typename dtype>
+std::tuple<int, std::vector<dtype>> mle_trev_given_pi_dense(np_array<dtype> &T_arr, const np_array<dtype> &C_arr,
+                                                            const np_array<dtype> &mu_arr, const std::size_t n,
+                                                            const dtype maxerr, const std::size_t maxiter,
+                                                            const std::string &acceleration) {
+    auto method = deeptime::fixed_point::parseAcceleration(acceleration);
+    auto *T = T_arr.mutable_data();
+
+    py::gil_scoped_release gil;
+
+    auto result = mle_trev_given_pi_dense_impl(T, C_arr.data(), mu_arr.data(), n, maxerr, maxiter, method);
+    return std::make_tuple(result.converged ? 0 : -5, std::move(result.errors));
 }
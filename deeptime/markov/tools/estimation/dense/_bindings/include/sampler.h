@@ -4,7 +4,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
 #include <distribution_utils.h>
 #include "common.h"
 #include "mle_trev.h"
@@ -16,10 +23,84 @@ auto isPositive(dtype x) -> bool {
 }
 }
 
-template<typename dtype, typename Generator = std::mt19937>
-class RevPiSampler {
+namespace detail {
+
+/**
+ * Generator of chain `chain` > 0 in the `run`-th call to sampleChains of a sampler: stream `chain` and substream `run`
+ * of the seed or, if the seed is negative, a randomly seeded generator. Chain 0 continues the sampler's own generator.
+ */
+template<typename Generator>
+Generator chainGenerator(int seed, std::uint32_t chain, std::uint32_t run) {
+    if (seed < 0) {
+        return deeptime::rnd::randomlySeededGenerator<Generator>();
+    }
+    if constexpr (std::is_same_v<Generator, deeptime::rnd::Philox4x32>) {
+        return deeptime::rnd::seededGenerator(static_cast<std::uint64_t>(seed), chain, run);
+    } else {
+        std::seed_seq seq{static_cast<std::uint32_t>(seed), chain, run};
+        return Generator(seq);
+    }
+}
+
+/**
+ * Runs nChains independent Markov chains in parallel which together produce nSamples samples, chain c yields the
+ * samples [c * nSamples / nChains, (c + 1) * nSamples / nChains). Chain 0 runs on `sampler` itself so that its
+ * generator carries over to the next call, chain c > 0 on a sampler drawing from makeGenerator(c).
+ */
+template<typename Sampler, typename MakeGenerator, typename Chain>
+void runChains(Sampler &sampler, std::int64_t nSamples, std::int64_t nChains, MakeGenerator &&makeGenerator,
+               Chain &&chain) {
+    std::vector<std::string> errors(nChains);
+    #pragma omp parallel for schedule(static, 1) default(none) firstprivate(nSamples, nChains) \
+            shared(sampler, makeGenerator, chain, errors)
+    for (std::int64_t c = 0; c < nChains; ++c) {
+        try {
+            auto begin = c * nSamples / nChains;
+            auto end = (c + 1) * nSamples / nChains;
+            if (c == 0) {
+                chain(sampler, c, begin, end);
+            } else {
+                Sampler chainSampler(makeGenerator(static_cast<std::uint32_t>(c)));
+                chain(chainSampler, c, begin, end);
+            }
+        } catch (const std::exception &e) {
+            errors[c] = e.what();
+        }
+    }
+    for (const auto &error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+}
+
+template<typename dtype>
+std::int64_t checkPosteriorArgs(const np_array_nfc<dtype> &PSamples, const np_array<dtype> &C,
+                                const np_array<dtype> &X0, int nChains, int nBurnIn, int nSteps) {
+    auto n = C.ndim() == 2 ? C.shape(0) : -1;
+    if (n < 0 || C.shape(1) != n || X0.ndim() != 2 || X0.shape(0) != n || X0.shape(1) != n) {
+        throw std::invalid_argument("Count matrix and initial sample must be square matrices of the same shape.");
+    }
+    if (PSamples.ndim() != 3 || PSamples.shape(1) != n || PSamples.shape(2) != n) {
+        throw std::invalid_argument("The output transition matrices must be of shape (n_samples, n, n).");
+    }
+    if (nChains < 1 || nBurnIn < 0 || nSteps < 1) {
+        throw std::invalid_argument("Need at least one chain, at least one step between samples, "
+                                    "and non-negative burn-in.");
+    }
+    return std::min(static_cast<std::int64_t>(nChains), static_cast<std::int64_t>(PSamples.shape(0)));
+}
+
+}
+
+/**
+ * Gibbs sampling kernels of the reversible transition matrix sampler with fixed stationary distribution, shared by
+ * the dense and the sparse variant.
+ */
+template<typename dtype, typename Generator = deeptime::rnd::Philox4x32>
+class RevPiSamplerBase {
 public:
-    explicit RevPiSampler(int seed) : uniform(0, 1) {
+    explicit RevPiSamplerBase(int seed) : seed(seed), uniform(0, 1) {
         if (seed < 0) {
             generator = deeptime::rnd::randomlySeededGenerator<Generator>();
         } else {
@@ -27,43 +108,42 @@ public:
         }
     }
 
-    void update(const np_array<dtype> &arrC, np_array<dtype> &arrX, const np_array<dtype> &arrB) {
-        auto M = arrC.shape(0);
-
-        auto C = arrC.template unchecked<2>();
-        auto b = arrB.template unchecked<1>();
-        auto X = arrX.template mutable_unchecked<2>();
-
-        for (ssize_t k = 0; k < M; ++k) {
-            for (ssize_t l = 0; l < k; ++l) {
-                if (C(k, l) + C(k, l) > 0) {
-                    auto xkl = X(k, l);
-                    auto xkl_new = sample_quad(X(k, l), X(k, k), X(l, l),
-                                               C(k, l), C(l, k), C(k, k), C(l, l),
-                                               b(k), b(l));
-                    X(k, l) = xkl_new;
-                    X(k, k) += (xkl - xkl_new);
-                    X(l, k) = xkl_new;
-                    X(l, l) += (xkl - xkl_new);
-
-                    xkl = X(k, l);
-                    xkl_new = sample_quad_rw(X(k, l), X(k, k), X(l, l),
-                                             C(k, l), C(l, k), C(k, k), C(l, l),
-                                             b(k), b(l));
-                    X(k, l) = xkl_new;
-                    X(k, k) += (xkl - xkl_new);
-                    X(l, k) = xkl_new;
-                    X(l, l) += (xkl - xkl_new);
-                }
-            }
-        }
+    explicit RevPiSamplerBase(Generator generator) : generator(std::move(generator)), uniform(0, 1) {}
+
+protected:
+    /**
+     * seed of the sampler and number of calls to sampleChains so far, which determine the generators of chains c > 0
+     */
+    int seed {-1};
+    std::uint32_t nChainRuns {0};
+
+    /**
+     * Updates the symmetric pair X_kl = X_lk at positions kl and lk of X and compensates on the diagonal elements at
+     * positions kk and ll, so that the row sums of X are preserved.
+     */
+    template<typename IndexType>
+    void updatePair(dtype *X, IndexType kl, IndexType lk, IndexType kk, IndexType ll,
+                    dtype ckl, dtype clk, dtype ckk, dtype cll, dtype bk, dtype bl) {
+        auto xkl = X[kl];
+        auto xkl_new = sample_quad(X[kl], X[kk], X[ll], ckl, clk, ckk, cll, bk, bl);
+        X[kl] = xkl_new;
+        X[kk] += (xkl - xkl_new);
+        X[lk] = xkl_new;
+        X[ll] += (xkl - xkl_new);
+
+        xkl = X[kl];
+        xkl_new = sample_quad_rw(X[kl], X[kk], X[ll], ckl, clk, ckk, cll, bk, bl);
+        X[kl] = xkl_new;
+        X[kk] += (xkl - xkl_new);
+        X[lk] = xkl_new;
+        X[ll] += (xkl - xkl_new);
     }
 
 private:
     Generator generator;
-    std::gamma_distribution<dtype> gamma;
-    std::uniform_real_distribution<dtype> uniform;
-    std::normal_distribution<dtype> normal;
+    deeptime::rnd::gamma_distribution<dtype> gamma;
+    deeptime::rnd::uniform_real_distribution<dtype> uniform;
+    deeptime::rnd::normal_distribution<dtype> normal;
 
     dtype maximum_point(dtype s, dtype a1, dtype a2, dtype a3) const {
         dtype a = a2 + static_cast<dtype>(1);
@@ -225,11 +305,142 @@ private:
     }
 };
 
-template<typename dtype, typename Generator = std::mt19937>
-class RevSampler {
+template<typename dtype, typename Generator = deeptime::rnd::Philox4x32>
+class RevPiSampler : public RevPiSamplerBase<dtype, Generator> {
+public:
+    explicit RevPiSampler(int seed) : RevPiSamplerBase<dtype, Generator>(seed) {}
+
+    explicit RevPiSampler(Generator generator) : RevPiSamplerBase<dtype, Generator>(std::move(generator)) {}
+
+    void update(const np_array<dtype> &arrC, np_array<dtype> &arrX, const np_array<dtype> &arrB) {
+        sweep(arrC.data(), arrX.mutable_data(), arrB.data(), static_cast<int>(arrC.shape(0)));
+    }
+
+    /**
+     * Samples the posterior with independent chains in parallel, see RevSampler::sampleChains.
+     *
+     * @param PSamples output transition matrices, shape (n_samples, n, n)
+     */
+    void sampleChains(np_array_nfc<dtype> &PSamples, const np_array<dtype> &arrC, np_array<dtype> &arrX,
+                      const np_array<dtype> &arrB, const np_array<dtype> &arrPi,
+                      int nChains, int nBurnIn, int nSteps) {
+        auto chains = detail::checkPosteriorArgs(PSamples, arrC, arrX, nChains, nBurnIn, nSteps);
+        auto nSamples = static_cast<std::int64_t>(PSamples.shape(0));
+        auto n = static_cast<int>(arrC.shape(0));
+        if (arrB.size() != n || arrPi.size() != n) {
+            throw std::invalid_argument("Need one diagonal prior and one stationary probability per state.");
+        }
+        const auto *C = arrC.data();
+        const std::vector<dtype> X0(arrX.data(), arrX.data() + n * n);
+        auto *X = arrX.mutable_data();
+        const auto *b = arrB.data();
+        const auto *pi = arrPi.data();
+        auto *P = PSamples.mutable_data();
+        const auto run = this->nChainRuns++;
+        auto makeGenerator = [seed = this->seed, run](std::uint32_t chain) {
+            return detail::chainGenerator<Generator>(seed, chain, run);
+        };
+
+        py::gil_scoped_release gil;
+        detail::runChains(*this, nSamples, chains, makeGenerator, [&](RevPiSampler &sampler, std::int64_t chain,
+                                                                      std::int64_t begin, std::int64_t end) {
+            // chain 0 continues in X and is only burnt in by the first call, the others start from a copy of it
+            std::vector<dtype> chainX;
+            auto *Xc = X;
+            if (chain > 0) {
+                chainX.assign(X0.begin(), X0.end());
+                Xc = chainX.data();
+            }
+            const auto burnIn = chain > 0 || run == 0 ? nBurnIn : 0;
+            for (int step = 0; step < burnIn; ++step) {
+                sampler.sweep(C, Xc, b, n);
+            }
+            for (auto s = begin; s < end; ++s) {
+                for (int step = 0; step < nSteps; ++step) {
+                    sampler.sweep(C, Xc, b, n);
+                }
+                auto *Ps = P + s * n * n;
+                for (int i = 0; i < n; ++i) {
+                    std::transform(Xc + i * n, Xc + (i + 1) * n, Ps + i * n,
+                                   [pii = pi[i]](dtype x) { return x / pii; });
+                }
+            }
+        });
+    }
+
+    /**
+     * Performs one Gibbs sweep over the off-diagonal elements of the (M, M) row-major matrix X, updated in place.
+     */
+    void sweep(const dtype *C, dtype *X, const dtype *b, int M) {
+        for (int k = 0; k < M; ++k) {
+            for (int l = 0; l < k; ++l) {
+                auto kl = k * M + l;
+                auto lk = l * M + k;
+                auto kk = k * M + k;
+                auto ll = l * M + l;
+                if (C[kl] + C[lk] > 0) {
+                    this->updatePair(X, kl, lk, kk, ll, C[kl], C[lk], C[kk], C[ll], b[k], b[l]);
+                }
+            }
+        }
+    }
+};
+
+namespace detail {
+
+/**
+ * Sparsity pattern of a structurally symmetric matrix in CSR format with sorted column indices. Each element (i, j)
+ * is linked to the position of its transposed element (j, i) and each row to the position of its diagonal element,
+ * or -1 if the diagonal is not part of the pattern.
+ */
+class SymmetricPattern {
+public:
+    SymmetricPattern(const int *indptrPtr, const int *indicesPtr, int nStates)
+            : indptr(indptrPtr, indptrPtr + nStates + 1), indices(indicesPtr, indicesPtr + indptrPtr[nStates]),
+              transposed(indices.size()), diagonal(nStates, -1) {
+        for (int i = 0; i < nStates; ++i) {
+            if (indptr[i] > indptr[i + 1]) {
+                throw std::invalid_argument("Row pointers must be non-decreasing.");
+            }
+            for (auto k = indptr[i]; k < indptr[i + 1]; ++k) {
+                auto j = indices[k];
+                if (j < 0 || j >= nStates || (k > indptr[i] && indices[k - 1] >= j)) {
+                    throw std::invalid_argument("Column indices must be sorted, unique, and in range.");
+                }
+                if (i == j) {
+                    diagonal[i] = k;
+                }
+                auto rowBegin = indices.begin() + indptr[j];
+                auto rowEnd = indices.begin() + indptr[j + 1];
+                auto it = std::lower_bound(rowBegin, rowEnd, i);
+                if (it == rowEnd || *it != i) {
+                    throw std::invalid_argument("Sparsity pattern must be symmetric.");
+                }
+                transposed[k] = static_cast<int>(it - indices.begin());
+            }
+        }
+    }
+
+    int nStates() const {
+        return static_cast<int>(diagonal.size());
+    }
+
+    std::vector<int> indptr;
+    std::vector<int> indices;
+    std::vector<int> transposed;
+    std::vector<int> diagonal;
+};
+
+}
+
+/**
+ * Gibbs sampling kernels of the reversible transition matrix sampler, shared by the dense and the sparse variant.
+ */
+template<typename dtype, typename Generator = deeptime::rnd::Philox4x32>
+class RevSamplerBase {
 
 public:
-    explicit RevSampler(int seed) : uniform(0, 1) {
+    explicit RevSamplerBase(int seed) : seed(seed), uniform(0, 1) {
         if (seed < 0) {
             generator = deeptime::rnd::randomlySeededGenerator<Generator>();
         } else {
@@ -237,6 +448,8 @@ public:
         }
     }
 
+    explicit RevSamplerBase(Generator generator) : generator(std::move(generator)), uniform(0, 1) {}
+
     dtype updateStep(dtype v0, dtype v1, dtype v2, dtype c0, dtype c1, dtype c2, dtype random_walk_stepsize) {
         /*
         update the sample v0 according to
@@ -299,29 +512,150 @@ public:
         return v0;
     }
 
+protected:
+    /**
+     * seed of the sampler and number of calls to sampleChains so far, which determine the generators of chains c > 0
+     */
+    int seed {-1};
+    std::uint32_t nChainRuns {0};
+
+    /**
+     * Samples the diagonal element x_ii given the sum of the off-diagonal elements of row i. Keeps the old value if
+     * the sample is not positive.
+     */
+    dtype sampleDiagonal(dtype xii, dtype offDiagonalSum, dtype cii, dtype sumCi) {
+        if (util::isPositive(cii) && util::isPositive(sumCi - cii)) {
+            beta.param(typename decltype(beta)::param_type {cii, sumCi - cii});
+            auto tmp1 = beta(generator);
+            auto tmp2 = tmp1 / (static_cast<dtype>(1) - tmp1) * offDiagonalSum;
+            if (util::isPositive(tmp2)) {
+                return tmp2;
+            }
+        }
+        return xii;
+    }
+
+    Generator generator;
+    deeptime::rnd::normal_distribution<dtype> normal;  // standard normal by default ctor
+    deeptime::rnd::gamma_distribution<dtype> gamma;
+    deeptime::rnd::beta_distribution<dtype> beta;
+    deeptime::rnd::uniform_real_distribution<dtype> uniform;
+
+    bool acceptStep(dtype log_prob_old, dtype log_prob_new) {
+        auto diff = log_prob_new - log_prob_old;
+        return diff > 0 /* this is faster */ ||
+               uniform(generator) < std::exp(std::min(diff, static_cast<dtype>(0)));
+    }
+};
+
+template<typename dtype, typename Generator = deeptime::rnd::Philox4x32>
+class RevSampler : public RevSamplerBase<dtype, Generator> {
+
+public:
+    explicit RevSampler(int seed) : RevSamplerBase<dtype, Generator>(seed) {}
+
+    explicit RevSampler(Generator generator) : RevSamplerBase<dtype, Generator>(std::move(generator)) {}
+
     void update(const np_array<dtype> &arrC, const np_array<dtype> &arrSumC, np_array<dtype> &arrX,
                 const np_array<int> &arrI, const np_array<int> &arrJ,
                 int n_step) {
-        dtype *X = arrX.mutable_data();
-        auto nStates = arrC.shape(0);
-        auto nIndices = arrI.shape(0);
-        // std::vector<dtype> arrSumX = sumX(arrX, nStates);
-        std::unique_ptr<dtype[]> sumX(new dtype[nStates]);
-        std::fill(sumX.get(), sumX.get() + nStates, 0);
+        auto nStates = static_cast<int>(arrC.shape(0));
+        auto nIndices = static_cast<int>(arrI.shape(0));
+        std::vector<dtype> sumX(nStates, 0);
 
-        // auto *sumX = arrSumX.data();
-        auto C = arrC.template unchecked<2>();
-        auto sumC = arrSumC.template unchecked<1>();
+        // row indexes
+        std::vector<int> rowIndices(nStates + 1, 0);
+        generateRowIndices(arrI.data(), nStates, nIndices, rowIndices.data());
 
-        const int *const I = arrI.data();
-        const int *const J = arrJ.data();
+        sweep(arrC.data(), arrSumC.data(), arrX.mutable_data(), arrI.data(), arrJ.data(), rowIndices.data(),
+              nStates, nIndices, n_step, sumX.data());
+    }
 
-        // row indexes
-        std::unique_ptr<int[]> rowIndices(new int[nStates + 1]);
-        std::fill(rowIndices.get(), rowIndices.get() + nStates + 1, 0);
-        generateRowIndices(I, nStates, nIndices, rowIndices.get());
+    /**
+     * Samples the posterior with independent chains in parallel. Each chain starts in X, discards nBurnIn sweeps,
+     * and then records a sample every nSteps sweeps. Chain 0 continues the chain of this sampler: it draws from the
+     * sampler's generator, leaves its final state in X and only discards the burn-in in the first call. Hence
+     * consecutive calls with a single chain continue one Markov chain, just as repeated calls to update. Chain c > 0
+     * is a new chain in every call, it draws from stream c and a fresh substream per call, see
+     * detail::chainGenerator.
+     *
+     * @param PSamples output transition matrices, shape (n_samples, n, n)
+     * @param piSamples output stationary distributions, shape (n_samples, n)
+     */
+    void sampleChains(np_array_nfc<dtype> &PSamples, np_array_nfc<dtype> &piSamples,
+                      const np_array<dtype> &arrC, const np_array<dtype> &arrSumC, np_array<dtype> &arrX,
+                      const np_array<int> &arrI, const np_array<int> &arrJ, int nChains, int nBurnIn, int nSteps) {
+        auto chains = detail::checkPosteriorArgs(PSamples, arrC, arrX, nChains, nBurnIn, nSteps);
+        auto nSamples = static_cast<std::int64_t>(PSamples.shape(0));
+        auto n = static_cast<int>(arrC.shape(0));
+        if (piSamples.ndim() != 2 || piSamples.shape(0) != nSamples || piSamples.shape(1) != n) {
+            throw std::invalid_argument("The output stationary distributions must be of shape (n_samples, n).");
+        }
+        if (arrSumC.size() != n || arrI.size() != arrJ.size()) {
+            throw std::invalid_argument("Need one count row sum per state and as many row as column indices.");
+        }
+        auto nIndices = static_cast<int>(arrI.size());
+        const auto *I = arrI.data();
+        for (int k = 0; k < nIndices; ++k) {
+            if (I[k] < 0 || I[k] >= n || arrJ.data()[k] < 0 || arrJ.data()[k] >= n || (k > 0 && I[k] < I[k - 1])) {
+                throw std::invalid_argument("Indices must be in range and sorted by row.");
+            }
+        }
+
+        std::vector<int> rowIndices(n + 1, 0);
+        generateRowIndices(I, n, nIndices, rowIndices.data());
+
+        const auto *C = arrC.data();
+        const auto *sumC = arrSumC.data();
+        const std::vector<dtype> X0(arrX.data(), arrX.data() + n * n);
+        auto *X = arrX.mutable_data();
+        const auto *J = arrJ.data();
+        auto *P = PSamples.mutable_data();
+        auto *pi = piSamples.mutable_data();
+        const auto run = this->nChainRuns++;
+        auto makeGenerator = [seed = this->seed, run](std::uint32_t chain) {
+            return detail::chainGenerator<Generator>(seed, chain, run);
+        };
+
+        py::gil_scoped_release gil;
+        detail::runChains(*this, nSamples, chains, makeGenerator, [&](RevSampler &sampler, std::int64_t chain,
+                                                                      std::int64_t begin, std::int64_t end) {
+            // chain 0 continues in X and is only burnt in by the first call, the others start from a copy of it
+            std::vector<dtype> chainX;
+            auto *Xc = X;
+            if (chain > 0) {
+                chainX.assign(X0.begin(), X0.end());
+                Xc = chainX.data();
+            }
+            const auto burnIn = chain > 0 || run == 0 ? nBurnIn : 0;
+            std::vector<dtype> sumX(n);
+            sampler.sweep(C, sumC, Xc, I, J, rowIndices.data(), n, nIndices, burnIn, sumX.data());
+            for (auto s = begin; s < end; ++s) {
+                sampler.sweep(C, sumC, Xc, I, J, rowIndices.data(), n, nIndices, nSteps, sumX.data());
+                auto *Ps = P + s * n * n;
+                auto *pis = pi + s * n;
+                for (int i = 0; i < n; ++i) {
+                    pis[i] = std::accumulate(Xc + i * n, Xc + (i + 1) * n, static_cast<dtype>(0));
+                    std::transform(Xc + i * n, Xc + (i + 1) * n, Ps + i * n,
+                                   [nu = pis[i]](dtype x) { return x / nu; });
+                }
+                auto total = std::accumulate(pis, pis + n, static_cast<dtype>(0));
+                std::transform(pis, pis + n, pis, [total](dtype nu) { return nu / total; });
+            }
+        });
+    }
 
-        for (int iter = 0; iter < n_step; iter++) {
+    /**
+     * Performs nSteps Gibbs sweeps on the (nStates, nStates) row-major matrix X, updated in place.
+     *
+     * @param I row indices of the nonzero elements of C + C^T in row-major order
+     * @param J column indices of the nonzero elements of C + C^T
+     * @param rowIndices offsets of the rows in I and J, see generateRowIndices
+     * @param sumX workspace for the row sums of X, size nStates
+     */
+    void sweep(const dtype *C, const dtype *sumC, dtype *X, const int *I, const int *J, const int *rowIndices,
+               int nStates, int nIndices, int nSteps, dtype *sumX) {
+        for (int iter = 0; iter < nSteps; iter++) {
             // update all X row sums once every iteration and then only do cheap updates.
             for (int i = 0; i < nStates; i++) {
                 sumX[i] = _sumRowSparse(X, nStates, i, J, rowIndices[i], rowIndices[i + 1]);
@@ -331,20 +665,16 @@ public:
                 auto i = I[k];
                 auto j = J[k];
                 if (i == j) {
-                    if (util::isPositive(C(i, i)) && util::isPositive(sumC(i) - C(i, i))) {
-                        beta.param(typename decltype(beta)::param_type {C(i, i), sumC(i) - C(i, i)});
-                        auto tmp1 = beta(generator);
-                        auto tmp2 = tmp1 / (static_cast<dtype>(1) - tmp1) * (sumX[i] - X[i * nStates + i]);
-                        if (util::isPositive(tmp2)) {
-                            sumX[i] += tmp2 - X[i * nStates + i];  // update sumX
-                            X[i * nStates + i] = tmp2;
-                        }
-                    }
+                    auto xii = this->sampleDiagonal(X[i * nStates + i], sumX[i] - X[i * nStates + i],
+                                                    C[i * nStates + i], sumC[i]);
+                    sumX[i] += xii - X[i * nStates + i];  // update sumX
+                    X[i * nStates + i] = xii;
                 } else if (i < j) {  // only work on the upper triangle, because we have symmetry.
                     auto tmp1 = sumX[i] - X[i * nStates + j];
                     auto tmp2 = sumX[j] - X[j * nStates + i];
-                    X[i * nStates + j] = updateStep(X[i * nStates + j], tmp1, tmp2, C(i, j) + C(j, i),
-                                                    sumC(i), sumC(j), 1);
+                    X[i * nStates + j] = this->updateStep(X[i * nStates + j], tmp1, tmp2,
+                                                          C[i * nStates + j] + C[j * nStates + i],
+                                                          sumC[i], sumC[j], 1);
                     X[j * nStates + i] = X[i * nStates + j];
                     // update X
                     sumX[i] = tmp1 + X[i * nStates + j];
@@ -356,20 +686,7 @@ public:
         }
     }
 
-private:
-    Generator generator;
-    std::normal_distribution<dtype> normal;  // standard normal by default ctor
-    std::gamma_distribution<dtype> gamma;
-    deeptime::rnd::beta_distribution<dtype> beta;
-    std::uniform_real_distribution<dtype> uniform;
-
-    bool acceptStep(dtype log_prob_old, dtype log_prob_new) {
-        auto diff = log_prob_new - log_prob_old;
-        return diff > 0 /* this is faster */ ||
-               uniform(generator) < std::exp(std::min(diff, static_cast<dtype>(0)));
-    }
-
-    void generateRowIndices(const int *const I, int n, int n_idx, int *rowIndices) {
+    static void generateRowIndices(const int *const I, int n, int n_idx, int *rowIndices) {
         rowIndices[0] = 0;  // starts with row 0
         int current_row = 0;
         for (int k = 0; k < n_idx; k++) {
@@ -386,6 +703,7 @@ private:
         rowIndices[n] = n_idx;
     }
 
+private:
     dtype _sumRowSparse(const dtype *const X, int n, int i, const int *const J, int from, int to) const {
         auto sum = static_cast<dtype>(0);
         for (int j = from; j < to; j++) {
@@ -408,3 +726,233 @@ private:
 
 
 };
+
+/**
+ * Reversible transition matrix sampler which stores the counts C and the sampled X only on the symmetric sparsity
+ * pattern of C + C^T in CSR format, so that memory scales with the number of nonzeros. It visits the elements in the
+ * same order as RevSampler, with the same seed both produce the same chain.
+ */
+template<typename dtype, typename Generator = deeptime::rnd::Philox4x32>
+class SparseRevSampler : public RevSamplerBase<dtype, Generator> {
+
+public:
+    SparseRevSampler(int seed, const np_array<int> &indptr, const np_array<int> &indices)
+            : RevSamplerBase<dtype, Generator>(seed),
+              pattern(indptr.data(), indices.data(), static_cast<int>(indptr.size()) - 1),
+              sumX(pattern.nStates()) {
+        if (static_cast<std::size_t>(indices.size()) != pattern.indices.size()) {
+            throw std::invalid_argument("The column indices must have as many entries as the pattern nonzeros.");
+        }
+    }
+
+    /**
+     * Performs nSteps Gibbs sweeps.
+     *
+     * @param arrC counts C_ij on the sparsity pattern
+     * @param arrSumC row sums of C
+     * @param arrX current sample X_ij on the sparsity pattern, updated in place
+     */
+    void update(const np_array<dtype> &arrC, const np_array<dtype> &arrSumC, np_array<dtype> &arrX, int nSteps) {
+        const auto nStates = pattern.nStates();
+        const auto nnz = pattern.indices.size();
+        if (static_cast<std::size_t>(arrC.size()) != nnz || static_cast<std::size_t>(arrX.size()) != nnz
+            || arrSumC.size() != nStates) {
+            throw std::invalid_argument("Counts and sample must be given on the sparsity pattern, "
+                                        "the count row sums for each state.");
+        }
+        const auto *C = arrC.data();
+        const auto *sumC = arrSumC.data();
+        auto *X = arrX.mutable_data();
+        const auto *indptr = pattern.indptr.data();
+        const auto *indices = pattern.indices.data();
+        const auto *transposed = pattern.transposed.data();
+
+        for (int iter = 0; iter < nSteps; ++iter) {
+            // update all X row sums once every iteration and then only do cheap updates.
+            for (int i = 0; i < nStates; ++i) {
+                sumX[i] = std::accumulate(X + indptr[i], X + indptr[i + 1], static_cast<dtype>(0));
+            }
+
+            for (int i = 0; i < nStates; ++i) {
+                for (auto k = indptr[i]; k < indptr[i + 1]; ++k) {
+                    auto j = indices[k];
+                    if (i == j) {
+                        auto xii = this->sampleDiagonal(X[k], sumX[i] - X[k], C[k], sumC[i]);
+                        sumX[i] += xii - X[k];
+                        X[k] = xii;
+                    } else if (i < j) {  // only work on the upper triangle, because we have symmetry.
+                        auto kt = transposed[k];
+                        auto tmp1 = sumX[i] - X[k];
+                        auto tmp2 = sumX[j] - X[kt];
+                        X[k] = this->updateStep(X[k], tmp1, tmp2, C[k] + C[kt], sumC[i], sumC[j], 1);
+                        X[kt] = X[k];
+                        sumX[i] = tmp1 + X[k];
+                        sumX[j] = tmp2 + X[kt];
+                    }
+                }
+            }
+
+            auto sum = std::accumulate(X, X + nnz, static_cast<dtype>(0));
+            std::transform(X, X + nnz, X, [sum](auto x) { return x / sum; });
+        }
+    }
+
+private:
+    detail::SymmetricPattern pattern;
+    std::vector<dtype> sumX;
+};
+
+/**
+ * Reversible transition matrix sampler with fixed stationary distribution which stores C and X on the symmetric
+ * sparsity pattern of C + C^T + I in CSR format. The pairs (k, l), l < k, of the pattern are precomputed once, a sweep
+ * visits them in the same order as RevPiSampler so that with the same seed both produce the same chain.
+ */
+template<typename dtype, typename Generator = deeptime::rnd::Philox4x32>
+class SparseRevPiSampler : public RevPiSamplerBase<dtype, Generator> {
+public:
+    SparseRevPiSampler(int seed, const np_array<int> &indptr, const np_array<int> &indices)
+            : RevPiSamplerBase<dtype, Generator>(seed),
+              pattern(indptr.data(), indices.data(), static_cast<int>(indptr.size()) - 1) {
+        if (static_cast<std::size_t>(indices.size()) != pattern.indices.size()) {
+            throw std::invalid_argument("The column indices must have as many entries as the pattern nonzeros.");
+        }
+        if (std::find(pattern.diagonal.begin(), pattern.diagonal.end(), -1) != pattern.diagonal.end()) {
+            throw std::invalid_argument("The sparsity pattern must contain all diagonal elements.");
+        }
+        for (int k = 0; k < pattern.nStates(); ++k) {
+            for (auto kl = pattern.indptr[k]; kl < pattern.indptr[k + 1] && pattern.indices[kl] < k; ++kl) {
+                auto l = pattern.indices[kl];
+                pairs.push_back({k, l, kl, pattern.transposed[kl], pattern.diagonal[k], pattern.diagonal[l]});
+            }
+        }
+    }
+
+    /**
+     * Performs one Gibbs sweep.
+     *
+     * @param arrC counts C_kl on the sparsity pattern
+     * @param arrX current sample X_kl on the sparsity pattern, updated in place
+     * @param arrB diagonal prior for each state
+     */
+    void update(const np_array<dtype> &arrC, np_array<dtype> &arrX, const np_array<dtype> &arrB) {
+        const auto nnz = pattern.indices.size();
+        if (static_cast<std::size_t>(arrC.size()) != nnz || static_cast<std::size_t>(arrX.size()) != nnz
+            || arrB.size() != pattern.nStates()) {
+            throw std::invalid_argument("Counts and sample must be given on the sparsity pattern, "
+                                        "the diagonal prior for each state.");
+        }
+        const auto *C = arrC.data();
+        const auto *b = arrB.data();
+        auto *X = arrX.mutable_data();
+        for (const auto &p : pairs) {
+            if (C[p.kl] + C[p.lk] > 0) {
+                this->updatePair(X, p.kl, p.lk, p.kk, p.ll, C[p.kl], C[p.lk], C[p.kk], C[p.ll], b[p.k], b[p.l]);
+            }
+        }
+    }
+
+private:
+    struct Pair {
+        int k, l;
+        int kl, lk, kk, ll;
+    };
+
+    detail::SymmetricPattern pattern;
+    std::vector<Pair> pairs;
+};
+
+/**
+ * Non-reversible transition matrix sampler. The rows of the posterior are independent Dirichlet distributions with
+ * the positive entries of alpha as parameters, elements with non-positive alpha are zero in all samples and are never
+ * drawn. Rows are grouped into blocks of roughly equal numbers of nonzeros which are sampled in parallel. Each block
+ * draws from its own stream of the seed, so that the samples do not depend on the number of threads.
+ */
+template<typename dtype, typename Generator = deeptime::rnd::Philox4x32>
+class NonRevSampler {
+public:
+    NonRevSampler(int seed, const np_array<dtype> &arrAlpha) {
+        if (arrAlpha.ndim() != 2 || arrAlpha.shape(0) != arrAlpha.shape(1)) {
+            throw std::invalid_argument("The Dirichlet parameters must be given as square matrix.");
+        }
+        n = static_cast<std::size_t>(arrAlpha.shape(0));
+        const auto *alphaDense = arrAlpha.data();
+        indptr.reserve(n + 1);
+        indptr.push_back(0);
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t j = 0; j < n; ++j) {
+                if (alphaDense[i * n + j] > 0) {
+                    indices.push_back(j);
+                    alpha.push_back(alphaDense[i * n + j]);
+                }
+            }
+            indptr.push_back(indices.size());
+        }
+
+        auto nBlocks = std::max(std::min(n, maxBlocks), static_cast<std::size_t>(1));
+        blocks.resize(nBlocks + 1, n);
+        blocks[0] = 0;
+        for (std::size_t b = 1; b < nBlocks; ++b) {
+            auto target = b * alpha.size() / nBlocks;
+            auto it = std::lower_bound(indptr.begin() + blocks[b - 1], indptr.begin() + n, target);
+            blocks[b] = static_cast<std::size_t>(it - indptr.begin());
+        }
+        generators.reserve(nBlocks);
+        for (std::size_t b = 0; b < nBlocks; ++b) {
+            generators.push_back(seed < 0 ? deeptime::rnd::randomlySeededGenerator<Generator>()
+                                          : deeptime::rnd::seededGenerator<Generator>(
+                                                  static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(b)));
+        }
+    }
+
+    /**
+     * Draws independent samples into the preallocated output of shape (n_samples, n, n).
+     */
+    void sample(np_array_nfc<dtype> &PSamples) {
+        if (PSamples.ndim() != 3 || static_cast<std::size_t>(PSamples.shape(1)) != n
+            || static_cast<std::size_t>(PSamples.shape(2)) != n) {
+            throw std::invalid_argument("The output transition matrices must be of shape (n_samples, n, n).");
+        }
+        auto nSamples = static_cast<std::size_t>(PSamples.shape(0));
+        auto nBlocks = static_cast<std::int64_t>(generators.size());
+        auto *P = PSamples.mutable_data();
+        auto nStates = n;
+        const auto *rowPtr = indptr.data();
+        const auto *cols = indices.data();
+        const auto *weights = alpha.data();
+        const auto *blockPtr = blocks.data();
+        auto *gens = generators.data();
+
+        py::gil_scoped_release gil;
+        #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nSamples, nBlocks, P, nStates, rowPtr, cols, weights, blockPtr, gens)
+        for (std::int64_t b = 0; b < nBlocks; ++b) {
+            auto &generator = gens[b];
+            deeptime::rnd::gamma_distribution<dtype> gamma;
+            for (std::size_t s = 0; s < nSamples; ++s) {
+                for (auto i = blockPtr[b]; i < blockPtr[b + 1]; ++i) {
+                    auto *row = P + (s * nStates + i) * nStates;
+                    std::fill(row, row + nStates, static_cast<dtype>(0));
+                    auto sum = static_cast<dtype>(0);
+                    for (auto k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+                        gamma.param(typename decltype(gamma)::param_type {weights[k], 1});
+                        auto x = gamma(generator);
+                        row[cols[k]] = x;
+                        sum += x;
+                    }
+                    for (auto k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+                        row[cols[k]] /= sum;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t maxBlocks = 64;
+
+    std::size_t n;
+    std::vector<std::size_t> indptr;
+    std::vector<std::size_t> indices;
+    std::vector<dtype> alpha;
+    std::vector<std::size_t> blocks;
+    std::vector<Generator> generators;
+};
@@ -9,9 +9,23 @@ template<typename Sampler, typename Mod>
 void exportSampler(Mod &m, const std::string &name) {
     py::class_<Sampler>(m, name.c_str())
             .def(py::init<int>())
+            .def("update", &Sampler::update)
+            .def("sample_chains", &Sampler::sampleChains);
+}
+
+template<typename Sampler, typename Mod>
+void exportSparseSampler(Mod &m, const std::string &name) {
+    py::class_<Sampler>(m, name.c_str())
+            .def(py::init<int, const np_array<int> &, const np_array<int> &>())
             .def("update", &Sampler::update);
 }
 
+template<typename dtype, typename Mod>
+void exportNonRevSampler(Mod &m, const std::string &name) {
+    py::class_<NonRevSampler<dtype>>(m, name.c_str())
+            .def(py::init<int, const np_array<dtype> &>())
+            .def("sample", &NonRevSampler<dtype>::sample);
+}
 
 PYBIND11_MODULE(_mle_bindings, m) {
     m.def("mle_trev_dense", &mle_trev_dense<float>);
@@ -25,7 +39,19 @@ PYBIND11_MODULE(_mle_bindings, m) {
     exportSampler<RevSampler<double>>(m, "RevSampler64");
     exportSampler<RevSampler<long double>>(m, "RevSampler128");
 
+    exportSparseSampler<SparseRevSampler<float>>(m, "SparseRevSampler32");
+    exportSparseSampler<SparseRevSampler<double>>(m, "SparseRevSampler64");
+    exportSparseSampler<SparseRevSampler<long double>>(m, "SparseRevSampler128");
+
+    exportNonRevSampler<float>(m, "NonRevSampler32");
+    exportNonRevSampler<double>(m, "NonRevSampler64");
+    exportNonRevSampler<long double>(m, "NonRevSampler128");
+
     exportSampler<RevPiSampler<float>>(m, "RevPiSampler32");
     exportSampler<RevPiSampler<double>>(m, "RevPiSampler64");
     exportSampler<RevPiSampler<long double>>(m, "RevPiSampler128");
+
+    exportSparseSampler<SparseRevPiSampler<float>>(m, "SparseRevPiSampler32");
+    exportSparseSampler<SparseRevPiSampler<double>>(m, "SparseRevPiSampler64");
+    exportSparseSampler<SparseRevPiSampler<long double>>(m, "SparseRevPiSampler128");
 }
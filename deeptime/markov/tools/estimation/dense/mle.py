@@ -6,7 +6,7 @@ from deeptime.util.exceptions import NotConvergedWarning
 
 
 def mle_trev(C, maxerr=1.0e-12, maxiter=int(1.0E6), warn_not_converged=True, return_statdist=False,
-             eps_mu=1.0e-15):
+             eps_mu=1.0e-15, acceleration='none', return_error_history=False):
     from ._mle_bindings import mle_trev_dense
     from ...analysis import is_connected
 
@@ -24,18 +24,18 @@ def mle_trev(C, maxerr=1.0e-12, maxiter=int(1.0E6), warn_not_converged=True, ret
     T = np.zeros(C.shape, dtype=dtype, order='C')
     mu = np.zeros(C.shape[0], dtype=dtype, order='C')
 
-    code = mle_trev_dense(T, CCt, C_sum, CCt.shape[0], maxerr, maxiter, mu, eps_mu)
+    code, errors = mle_trev_dense(T, CCt, C_sum, CCt.shape[0], maxerr, maxiter, mu, eps_mu, acceleration)
     if code == -5 and warn_not_converged:
         warnings.warn('Reversible transition matrix estimation didn\'t converge.',
                       NotConvergedWarning)
 
-    if return_statdist:
-        return T, mu
-    else:
-        return T
+    result = (T, mu) if return_statdist else (T,)
+    if return_error_history:
+        result += (np.array(errors, dtype=dtype),)
+    return result if len(result) > 1 else result[0]
 
 
-def mle_trev_given_pi(C, mu, maxerr=1.0E-12, maxiter=1000000):
+def mle_trev_given_pi(C, mu, maxerr=1.0E-12, maxiter=1000000, acceleration='none', return_error_history=False):
     from ._mle_bindings import mle_trev_given_pi_dense
     from ...analysis import is_connected
 
@@ -54,9 +54,11 @@ def mle_trev_given_pi(C, mu, maxerr=1.0E-12, maxiter=1000000):
 
     T = np.zeros_like(c_C, dtype=dtype, order='C')
 
-    code = mle_trev_given_pi_dense(T, c_C, c_mu, C.shape[0], maxerr, maxiter)
+    code, errors = mle_trev_given_pi_dense(T, c_C, c_mu, C.shape[0], maxerr, maxiter, acceleration)
 
     if code == -5:
         warnings.warn('Reversible transition matrix estimation with fixed stationary distribution didn\'t converge.',
                       NotConvergedWarning)
+    if return_error_history:
+        return T, np.array(errors, dtype=dtype)
     return T
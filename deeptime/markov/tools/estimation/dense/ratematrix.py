@@ -67,11 +67,7 @@ def vdot(a, b):
 
 def sum1(M):
     # 1-D Kahan summation along axis 1
-    n, m = M.shape
-    x = np.zeros(n)
-    for i in range(n):
-        x[i] = ksum(np.reshape(M[i, :], (1, m)))
-    return x
+    return ksum(M, axis=1)
 
 
 def raise_or_warn(msg, on_error, warning=UserWarning, exception=RuntimeError):
@@ -9,21 +9,25 @@ import numpy as np
 
 class SamplerNonRev:
     def __init__(self, Z, seed: int = -1):
+        from .._mle_bindings import NonRevSampler32, NonRevSampler64, NonRevSampler128
+
+        dtype = Z.dtype if Z.dtype in (np.float32, np.float64, np.longdouble) else np.float64
         """Posterior counts"""
-        self.Z = Z
-        """Alpha parameters for dirichlet sampling"""
-        self.alpha = Z + 1.0
+        self.Z = Z.astype(dtype)
+        """Alpha parameters for dirichlet sampling, only positive alphas are sampled"""
+        self.alpha = self.Z + 1.0
+        if dtype == np.float32:
+            self._sampler = NonRevSampler32(seed, self.alpha)
+        elif dtype == np.float64:
+            self._sampler = NonRevSampler64(seed, self.alpha)
+        else:
+            self._sampler = NonRevSampler128(seed, self.alpha)
         """Initial state from single sample"""
-        self.P = np.zeros_like(Z)
-        self.rnd = np.random.RandomState(seed if isinstance(seed, int) and seed >= 0 else None)
+        self.P = np.zeros_like(self.alpha)
         self.update()
 
     def update(self, N=1):
-        N = self.alpha.shape[0]
-        for i in range(N):
-            # only pass positive alphas to dirichlet sampling.
-            positive = self.alpha[i, :] > 0
-            self.P[i, positive] = np.random.dirichlet(self.alpha[i, positive])
+        self._sampler.sample(self.P[np.newaxis])
 
     def sample(self, N=1, return_statdist=False):
         from ....analysis import stationary_distribution
@@ -34,3 +38,14 @@ class SamplerNonRev:
             return self.P, pi
         else:
             return self.P
+
+    def sample_batch(self, n_samples, return_statdist=False):
+        r""" Draws `n_samples` independent samples, the rows of all samples are drawn in parallel. """
+        from ....analysis import stationary_distribution
+
+        n = self.alpha.shape[0]
+        P_samples = np.empty((n_samples, n, n), dtype=self.alpha.dtype)
+        self._sampler.sample(P_samples)
+        if return_statdist:
+            return P_samples, np.array([stationary_distribution(P) for P in P_samples])
+        return P_samples
@@ -1,7 +1,11 @@
 import numpy as np
+import scipy.sparse
 
 
 class SamplerRev:
+    r""" Reversible transition matrix sampler. If the count matrix is a scipy sparse matrix, counts and samples are
+    stored on the sparsity pattern of :math:`C + C^T` only and samples are returned as sparse matrices. """
+
     def __init__(self, C, P0=None, seed: int = -1):
         from deeptime.markov.tools.estimation import transition_matrix as tmatrix
         from deeptime.markov.tools.analysis import stationary_distribution
@@ -12,6 +16,11 @@ class SamplerRev:
         else:
             dtype = C.dtype
 
+        self.sparse = scipy.sparse.issparse(C)
+        if self.sparse:
+            self._init_sparse(C.astype(dtype), P0, seed)
+            return
+
         self.C = C.astype(dtype)
 
         """Set up initial state of the chain"""
@@ -43,6 +52,51 @@ class SamplerRev:
         else:
             raise ValueError(f"Unknown dtype {self.C.dtype}")
 
+    def _init_sparse(self, C, P0, seed):
+        from deeptime.markov.tools.estimation import transition_matrix as tmatrix
+        from deeptime.markov.tools.analysis import stationary_distribution, is_connected
+        from .._mle_bindings import SparseRevSampler32, SparseRevSampler64, SparseRevSampler128
+
+        self.C = scipy.sparse.csr_matrix(C)
+        if P0 is None:
+            P0 = tmatrix(self.C, reversible=True, maxiter=100, warn_not_converged=False)
+        P0 = scipy.sparse.csr_matrix(P0, dtype=self.C.dtype)
+        pi0 = stationary_distribution(P0).astype(self.C.dtype)
+        V0 = scipy.sparse.diags(pi0).dot(P0).tocsr()
+
+        if np.any(self.C.data < 0):
+            raise ValueError("Count matrix contains negative elements")
+        if not is_connected(self.C):
+            raise ValueError("Count matrix is not connected")
+        if np.any(V0.data < 0):
+            raise ValueError("P0 contains negative entries")
+        if abs(V0 - V0.T).max() > 1e-6:
+            raise ValueError("P0 is not reversible")
+        eye = scipy.sparse.eye(self.C.shape[0], dtype=self.C.dtype)
+        if ((self.C + self.C.T + eye > 0) != (V0 + V0.T + eye > 0)).nnz > 0:
+            raise ValueError('Sparsity patterns of C and X are different.')
+
+        """Counts, row sums of counts, and sample on the symmetric pattern of C + C^T"""
+        pattern = scipy.sparse.csr_matrix(self.C + self.C.T)
+        pattern.eliminate_zeros()
+        pattern.sum_duplicates()
+        pattern.sort_indices()
+        self.indptr = pattern.indptr.astype(np.intc)
+        self.indices = pattern.indices.astype(np.intc)
+        rows = np.repeat(np.arange(self.C.shape[0]), np.diff(self.indptr))
+        self.C_data = np.asarray(self.C[rows, self.indices], dtype=self.C.dtype).ravel()
+        self.V_data = np.asarray(V0[rows, self.indices], dtype=self.C.dtype).ravel()
+        self.c = np.asarray(self.C.sum(axis=1), dtype=self.C.dtype).ravel()
+
+        if self.C.dtype == np.float32:
+            self._sampler = SparseRevSampler32(seed, self.indptr, self.indices)
+        elif self.C.dtype == np.float64:
+            self._sampler = SparseRevSampler64(seed, self.indptr, self.indices)
+        elif self.C.dtype == np.longdouble:
+            self._sampler = SparseRevSampler128(seed, self.indptr, self.indices)
+        else:
+            raise ValueError(f"Unknown dtype {self.C.dtype}")
+
     def check_input(self):
         from deeptime.markov.tools.analysis import is_connected
         if self.C.dtype not in (np.float32, np.float64, np.longdouble):
@@ -64,10 +118,20 @@ class SamplerRev:
             raise ValueError('Sparsity patterns of C and X are different.')
 
     def update(self, N=1):
-        self._sampler.update(self.C, self.c, self.V, self.I, self.J, int(N))
+        if self.sparse:
+            self._sampler.update(self.C_data, self.c, self.V_data, int(N))
+        else:
+            self._sampler.update(self.C, self.c, self.V, self.I, self.J, int(N))
 
     def sample(self, N=1, return_statdist=False):
         self.update(N=N)
+        if self.sparse:
+            V = scipy.sparse.csr_matrix((self.V_data, self.indices, self.indptr), shape=self.C.shape)
+            nu = np.asarray(V.sum(axis=1)).ravel()
+            P = scipy.sparse.diags(1. / nu).dot(V).tocsr()
+            if return_statdist:
+                return P, nu / nu.sum()
+            return P
         Vsum = self.V.sum(axis=1)
         P = self.V / Vsum[..., np.newaxis]
         if return_statdist:
@@ -76,3 +140,27 @@ class SamplerRev:
             return P, pi
         else:
             return P
+
+    def sample_chains(self, n_samples, N=1, n_chains=1, n_burn_in=0):
+        r""" Draws samples from independent chains that run in parallel, all starting from the current state.
+        Each chain discards `n_burn_in` sweeps and then records a sample every `N` sweeps. The first chain continues
+        the chain of this sampler and its final state becomes the current state. It only discards the burn-in in the
+        first call, so that a single chain yields the same samples across calls as one call for all of them. The other
+        chains are new chains in every call which draw fresh random numbers. Only available for dense count
+        matrices.
+
+        Returns
+        -------
+        P_samples : (n_samples, n, n) ndarray
+            The sampled transition matrices.
+        pi_samples : (n_samples, n) ndarray
+            Their stationary distributions.
+        """
+        if self.sparse:
+            raise ValueError("Sampling of parallel chains is only supported for dense count matrices.")
+        n = self.C.shape[0]
+        P_samples = np.empty((n_samples, n, n), dtype=self.C.dtype)
+        pi_samples = np.empty((n_samples, n), dtype=self.C.dtype)
+        self._sampler.sample_chains(P_samples, pi_samples, self.C, self.c, self.V, self.I.astype(np.intc),
+                                    self.J.astype(np.intc), int(n_chains), int(n_burn_in), int(N))
+        return P_samples, pi_samples
@@ -1,7 +1,11 @@
 import numpy as np
+import scipy.sparse
 
 
 class SamplerRevPi:
+    r""" Reversible transition matrix sampler with fixed stationary distribution. If the count matrix is a scipy
+    sparse matrix, counts and samples are stored on the sparsity pattern of :math:`C + C^T + I` only and samples are
+    returned as sparse matrices. """
 
     def __init__(self, C, pi, P0=None, P_mle=None, eps=0.1, seed=-1):
         from deeptime.markov.tools.estimation.dense.mle import mle_trev_given_pi
@@ -10,6 +14,11 @@ class SamplerRevPi:
         dtype = C.dtype
         if dtype not in (np.float32, np.float64, np.longdouble):
             dtype = np.float64
+
+        self.sparse = scipy.sparse.issparse(C)
+        if self.sparse:
+            self._init_sparse(C.astype(dtype), pi.astype(dtype), P0, P_mle, eps, seed)
+            return
         self.C = C.astype(dtype)
         self.pi = pi.astype(dtype)
 
@@ -74,6 +83,68 @@ class SamplerRevPi:
         else:
             raise ValueError(f"Unknown dtype {self.C.dtype}")
 
+    def _init_sparse(self, C, pi, P0, P_mle, eps, seed):
+        from deeptime.markov.tools.estimation.sparse.mle import mle_trev_given_pi
+        from deeptime.markov.tools.analysis import is_connected
+        from .._mle_bindings import SparseRevPiSampler32, SparseRevPiSampler64, SparseRevPiSampler128
+
+        self.C = scipy.sparse.csr_matrix(C)
+        self.pi = pi
+        n = self.C.shape[0]
+        cii = self.C.diagonal()
+
+        if P_mle is None:
+            P_mle = mle_trev_given_pi(self.C, pi)
+        if P0 is None:
+            """Add counts, s.t. cii+bii>0 for all i"""
+            P0 = mle_trev_given_pi(self.C + scipy.sparse.diags((cii == 0).astype(self.C.dtype)), pi)
+
+        """Diagonal prior parameters"""
+        ind1 = np.isclose(cii, 0.0)
+        b = np.zeros(n, dtype=self.C.dtype)
+        b[ind1] = eps
+        b[np.logical_and(ind1, scipy.sparse.csr_matrix(P_mle).diagonal() > 0.0)] = 1.0
+        self.b = b
+
+        """Initial state of the chain"""
+        X0 = scipy.sparse.diags(pi).dot(scipy.sparse.csr_matrix(P0, dtype=self.C.dtype)).tocsr()
+        X0 /= X0.sum()
+
+        if np.any(self.C.data < 0):
+            raise ValueError("Count matrix contains negative elements")
+        if not is_connected(self.C, directed=False):
+            raise ValueError("Count matrix is not connected")
+        if np.any(X0.data < 0):
+            raise ValueError("P0 contains negative entries")
+        if not np.allclose((X0 - X0.T).data, 0.0):
+            raise ValueError("P0 is not reversible")
+
+        def off_diagonal_support(A):
+            return (scipy.sparse.triu(A, k=1) + scipy.sparse.tril(A, k=-1)) > 0
+
+        if (off_diagonal_support(self.C + self.C.T) != off_diagonal_support(X0 + X0.T)).nnz > 0:
+            raise ValueError('Sparsity patterns of C and X are different.')
+
+        """Counts and sample on the symmetric pattern of C + C^T + I"""
+        pattern = scipy.sparse.csr_matrix(self.C + self.C.T + scipy.sparse.eye(n, dtype=self.C.dtype))
+        pattern.eliminate_zeros()
+        pattern.sum_duplicates()
+        pattern.sort_indices()
+        self.indptr = pattern.indptr.astype(np.intc)
+        self.indices = pattern.indices.astype(np.intc)
+        rows = np.repeat(np.arange(n), np.diff(self.indptr))
+        self.C_data = np.asarray(self.C[rows, self.indices], dtype=self.C.dtype).ravel()
+        self.X_data = np.asarray(X0[rows, self.indices], dtype=self.C.dtype).ravel()
+
+        if self.C.dtype == np.float32:
+            self.xsampler = SparseRevPiSampler32(seed, self.indptr, self.indices)
+        elif self.C.dtype == np.float64:
+            self.xsampler = SparseRevPiSampler64(seed, self.indptr, self.indices)
+        elif self.C.dtype == np.longdouble:
+            self.xsampler = SparseRevPiSampler128(seed, self.indptr, self.indices)
+        else:
+            raise ValueError(f"Unknown dtype {self.C.dtype}")
+
     def check_input(self):
         from deeptime.markov.tools.analysis import is_connected
 
@@ -100,12 +171,37 @@ class SamplerRevPi:
 
     def update(self, N=1):
         for i in range(N):
-            self.xsampler.update(self.C, self.X, self.b)
+            if self.sparse:
+                self.xsampler.update(self.C_data, self.X_data, self.b)
+            else:
+                self.xsampler.update(self.C, self.X, self.b)
 
     def sample(self, N=1, return_statdist=False):
         self.update(N=N)
-        P = self.X / self.pi[:, np.newaxis]
+        if self.sparse:
+            X = scipy.sparse.csr_matrix((self.X_data, self.indices, self.indptr), shape=self.C.shape)
+            P = scipy.sparse.diags(1. / self.pi).dot(X).tocsr()
+        else:
+            P = self.X / self.pi[:, np.newaxis]
         if return_statdist:
             return P, self.pi
         else:
             return P
+
+    def sample_chains(self, n_samples, N=1, n_chains=1, n_burn_in=0):
+        r""" Draws samples from independent chains that run in parallel, see :meth:`SamplerRev.sample_chains`.
+
+        Returns
+        -------
+        P_samples : (n_samples, n, n) ndarray
+            The sampled transition matrices.
+        pi_samples : (n_samples, n) ndarray
+            The fixed stationary distribution for each sample.
+        """
+        if self.sparse:
+            raise ValueError("Sampling of parallel chains is only supported for dense count matrices.")
+        n = self.C.shape[0]
+        P_samples = np.empty((n_samples, n, n), dtype=self.C.dtype)
+        self.xsampler.sample_chains(P_samples, self.C, self.X, self.b, self.pi, int(n_chains), int(n_burn_in),
+                                    int(N))
+        return P_samples, np.tile(self.pi, (n_samples, 1))
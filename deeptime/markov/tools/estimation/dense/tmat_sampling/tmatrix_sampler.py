@@ -49,22 +49,36 @@ class TransitionMatrixSampler:
         # remember number of steps to decorrelate between samples
         self.n_steps = n_steps
 
-    def sample(self, nsamples=1, return_statdist=False, callback=None):
-        if nsamples == 1:
+    def sample(self, nsamples=1, return_statdist=False, callback=None, n_chains=1, n_burn_in=0):
+        r""" Draws transition matrix samples. For reversible sampling with dense count matrices, several samples are
+        generated natively by `n_chains` independent chains in parallel, each of which starts at the current state and
+        discards `n_burn_in` sweeps first. The first chain continues the chain of this sampler across calls and only
+        discards the burn-in in the first call, see :meth:`SamplerRev.sample_chains`. Non-reversible samples are
+        independent and drawn in one batch. In both cases the callback is invoked once per sample after sampling. """
+        if isinstance(self.sampler, SamplerNonRev):
+            if nsamples == 1:
+                return self.sampler.sample(return_statdist=return_statdist)
+            samples = self.sampler.sample_batch(nsamples, return_statdist=return_statdist)
+        elif nsamples == 1 and n_chains == 1 and n_burn_in == 0:
             return self.sampler.sample(N=self.n_steps, return_statdist=return_statdist)
-        else:
-            n = self.count_matrix.shape[0]
-            P_samples = np.zeros((nsamples, n, n))
+        elif getattr(self.sampler, 'sparse', False):
+            # sparse samples are collected in lists instead of dense (nsamples, n, n) arrays
+            samples = []
+            for i in range(nsamples):
+                samples.append(self.sampler.sample(N=self.n_steps, return_statdist=return_statdist))
+                if callback is not None:
+                    callback()
             if return_statdist:
-                pi_samples = np.zeros((nsamples, n))
-                for i in range(nsamples):
-                    P_samples[i, :, :], pi_samples[i, :] = self.sampler.sample(N=self.n_steps, return_statdist=True)
-                    if callback is not None:
-                        callback()
-                return P_samples, pi_samples
-            else:
-                for i in range(nsamples):
-                    P_samples[i, :, :] = self.sampler.sample(N=self.n_steps, return_statdist=False)
-                    if callback is not None:
-                        callback()
-                return P_samples
+                P_samples, pi_samples = zip(*samples)
+                return list(P_samples), np.array(pi_samples)
+            return samples
+        else:
+            P_samples, pi_samples = self.sampler.sample_chains(nsamples, N=self.n_steps, n_chains=n_chains,
+                                                               n_burn_in=n_burn_in)
+            if nsamples == 1:
+                P_samples, pi_samples = P_samples[0], pi_samples[0]
+            samples = (P_samples, pi_samples) if return_statdist else P_samples
+        if callback is not None:
+            for _ in range(nsamples):
+                callback()
+        return samples
@@ -10,4 +10,4 @@ from . import likelihood
 from . import transition_matrix
 from . import prior
 
-from .mle import mle_trev, mle_trev_given_pi
+from .mle import mle_trev, mle_trev_given_pi, mle_trev_batch
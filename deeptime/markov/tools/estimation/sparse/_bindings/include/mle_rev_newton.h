@@ -0,0 +1,641 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "mle_trev_sparse.h"
+
+namespace detail {
+namespace newton {
+
+template<typename dtype>
+dtype dot(const dtype *a, const dtype *b, std::size_t n) {
+    dtype result = 0;
+    #pragma omp parallel for simd reduction(+:result) default(none) firstprivate(a, b, n)
+    for (std::size_t i = 0; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+template<typename dtype>
+dtype norm(const dtype *a, std::size_t n) {
+    return std::sqrt(dot(a, a, n));
+}
+
+/**
+ * Preconditioned MINRES of Paige and Saunders for a symmetric, possibly indefinite system A x = b, starting from
+ * x = 0. The preconditioner is diagonal and must be positive. Stopping criteria are the ones of
+ * scipy.sparse.linalg.minres.
+ *
+ * @param matvec callable (v, out) computing out = A v
+ * @param preconditioner diagonal of the preconditioner
+ * @return the number of iterations
+ */
+template<typename dtype, typename MatVec>
+std::size_t minres(MatVec &&matvec, const dtype *preconditioner, const dtype *b, dtype *x, std::size_t n,
+                   dtype tol, std::size_t maxIter) {
+    constexpr auto eps = std::numeric_limits<dtype>::epsilon();
+    std::fill(x, x + n, static_cast<dtype>(0));
+
+    std::vector<dtype> r1(b, b + n), r2(b, b + n), y(n), v(n), w(n, 0), w1(n, 0), w2(n, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] = preconditioner[i] * r1[i];
+    }
+    auto beta1 = dot(r1.data(), y.data(), n);
+    if (beta1 < 0) {
+        throw std::logic_error("The preconditioner of the Newton system is indefinite.");
+    }
+    if (beta1 == 0) {
+        return 0;
+    }
+    beta1 = std::sqrt(beta1);
+
+    dtype oldb = 0, beta = beta1, dbar = 0, epsln = 0, phibar = beta1, rhs1 = beta1, rhs2 = 0, tnorm2 = 0;
+    dtype gmax = 0, gmin = std::numeric_limits<dtype>::max(), cs = -1, sn = 0;
+    int istop = 0;
+    std::size_t itn = 0;
+    while (itn < maxIter) {
+        ++itn;
+
+        // Lanczos step
+        auto s = 1 / beta;
+        for (std::size_t i = 0; i < n; ++i) {
+            v[i] = s * y[i];
+        }
+        matvec(v.data(), y.data());
+        if (itn >= 2) {
+            auto f = beta / oldb;
+            for (std::size_t i = 0; i < n; ++i) {
+                y[i] -= f * r1[i];
+            }
+        }
+        auto alfa = dot(v.data(), y.data(), n);
+        {
+            auto f = alfa / beta;
+            for (std::size_t i = 0; i < n; ++i) {
+                y[i] -= f * r2[i];
+            }
+        }
+        std::swap(r1, r2);
+        std::swap(r2, y);
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = preconditioner[i] * r2[i];
+        }
+        oldb = beta;
+        beta = dot(r2.data(), y.data(), n);
+        if (beta < 0) {
+            throw std::logic_error("The Newton system is not symmetric.");
+        }
+        beta = std::sqrt(beta);
+        tnorm2 += alfa * alfa + oldb * oldb + beta * beta;
+        if (itn == 1 && beta / beta1 <= 10 * eps) {
+            istop = -1;
+        }
+
+        // apply the previous rotation and compute the next one
+        auto oldeps = epsln;
+        auto delta = cs * dbar + sn * alfa;
+        auto gbar = sn * dbar - cs * alfa;
+        epsln = sn * beta;
+        dbar = -cs * beta;
+        auto root = std::hypot(gbar, dbar);
+        auto gamma = std::max(std::hypot(gbar, beta), eps);
+        cs = gbar / gamma;
+        sn = beta / gamma;
+        auto phi = cs * phibar;
+        phibar = sn * phibar;
+
+        // update x
+        auto denom = 1 / gamma;
+        std::swap(w1, w2);
+        std::swap(w2, w);
+        for (std::size_t i = 0; i < n; ++i) {
+            w[i] = (v[i] - oldeps * w1[i] - delta * w2[i]) * denom;
+            x[i] += phi * w[i];
+        }
+
+        gmax = std::max(gmax, gamma);
+        gmin = std::min(gmin, gamma);
+        auto z = rhs1 / gamma;
+        rhs1 = rhs2 - delta * z;
+        rhs2 = -epsln * z;
+
+        // estimate norms and test for convergence
+        auto aNorm = std::sqrt(tnorm2);
+        auto yNorm = norm(x, n);
+        auto epsx = aNorm * yNorm * eps;
+        auto test1 = yNorm == 0 || aNorm == 0 ? std::numeric_limits<dtype>::infinity() : phibar / (aNorm * yNorm);
+        auto test2 = aNorm == 0 ? std::numeric_limits<dtype>::infinity() : root / aNorm;
+        auto aCond = gmax / gmin;
+        if (istop == 0) {
+            if (1 + test2 <= 1) istop = 2;
+            if (1 + test1 <= 1) istop = 1;
+            if (itn >= maxIter) istop = 6;
+            if (aCond >= static_cast<dtype>(.1) / eps) istop = 4;
+            if (epsx >= beta1) istop = 3;
+            if (test2 <= tol) istop = 2;
+            if (test1 <= tol) istop = 1;
+        }
+        if (istop != 0) {
+            break;
+        }
+    }
+    return itn;
+}
+
+/**
+ * Symmetrized Jacobian of the monotone mapping at a point (x, y), see ReversibleMapping::evaluate.
+ */
+template<typename dtype>
+struct Jacobian {
+    Jacobian(std::size_t nnz, std::size_t dim) : H(nnz), diagXX(dim), diagYY(dim), diagYX(dim), x(dim) {}
+
+    std::vector<dtype> H;
+    std::vector<dtype> diagXX;
+    std::vector<dtype> diagYY;
+    std::vector<dtype> diagYX;
+    std::vector<dtype> x;
+};
+
+/**
+ * Monotone mapping F(x, y) of the reversible maximum likelihood problem on the scaled and symmetrized count matrix
+ * Cs = C + C^T in CSR format with column sums c of C,
+ *
+ *     F_x(k) = 1 - sum_j Cs_kj / (x_k + x_j e_kj),
+ *     F_y(k) = -c_k + sum_j Cs_kj x_j e_kj / (x_k + x_j e_kj),    e_kj = exp(y_k - y_j).
+ *
+ * Since Cs is symmetric, rows of Cs are also its columns and all products with the Jacobian are segmented reductions
+ * over rows.
+ */
+template<typename dtype, typename IndexType>
+class ReversibleMapping {
+public:
+    ReversibleMapping(const IndexType *indptr, const IndexType *indices, const dtype *Cs, const dtype *c,
+                      std::size_t dim)
+            : indptr(indptr), indices(indices), Cs(Cs), c(c), dim(dim), ranges(balancedRowRanges(indptr, dim)) {}
+
+    std::size_t nnz() const {
+        return static_cast<std::size_t>(indptr[dim]);
+    }
+
+    /**
+     * Evaluates F at (x, y) into F of length 2 dim. If a Jacobian is given, it is assembled in the same pass reusing
+     * the exponentials. Its blocks
+     *
+     *           ( DF_xx  DF_yx^T )
+     *     DF = (                  )
+     *           ( DF_yx  DF_yy   )
+     *
+     * have off-diagonal entries H_kj, -H_kj x_k and H_kj x_k x_j with H_kj = Cs_kj e_kj / (x_k + x_j e_kj)^2, which
+     * is symmetric in k and j. Only H and the diagonal parts are stored.
+     */
+    void evaluate(const dtype *x, const dtype *y, dtype *F, Jacobian<dtype> *jacobian) const {
+        const auto *cPtr = c;
+        const auto n = dim;
+        if (jacobian) {
+            std::copy(x, x + dim, jacobian->x.begin());
+            auto *H = jacobian->H.data();
+            auto *dXX = jacobian->diagXX.data();
+            auto *dYY = jacobian->diagYY.data();
+            auto *dYX = jacobian->diagYX.data();
+            forEachRow([x, y, F, cPtr, n, H, dXX, dYY, dYX](std::size_t k, IndexType begin, IndexType end,
+                                                         const IndexType *indices, const dtype *Cs) {
+                const auto xk = x[k];
+                const auto yk = y[k];
+                dtype fx = 1, fy = -cPtr[k], xx = 0, yx = 0;
+                #pragma omp simd reduction(+:fx, fy, xx, yx)
+                for (auto l = begin; l < end; ++l) {
+                    const auto j = indices[l];
+                    const auto e = std::exp(yk - y[j]);
+                    const auto d = 1 / (xk + x[j] * e);
+                    const auto cd = Cs[l] * d;
+                    const auto h = cd * d * e;
+                    fx -= cd;
+                    fy += cd * x[j] * e;
+                    H[l] = h;
+                    xx += cd * d;
+                    yx += h * x[j];
+                }
+                F[k] = fx;
+                F[k + n] = fy;
+                dXX[k] = xx;
+                dYY[k] = -xk * yx;
+                dYX[k] = yx;
+            });
+        } else {
+            forEachRow([x, y, F, cPtr, n](std::size_t k, IndexType begin, IndexType end,
+                                          const IndexType *indices, const dtype *Cs) {
+                const auto xk = x[k];
+                const auto yk = y[k];
+                dtype fx = 1, fy = -cPtr[k];
+                #pragma omp simd reduction(+:fx, fy)
+                for (auto l = begin; l < end; ++l) {
+                    const auto j = indices[l];
+                    const auto e = std::exp(yk - y[j]);
+                    const auto cd = Cs[l] / (xk + x[j] * e);
+                    fx -= cd;
+                    fy += cd * x[j] * e;
+                }
+                F[k] = fx;
+                F[k + n] = fy;
+            });
+        }
+    }
+
+    /**
+     * out = (DF + diag(sigma, 0)) v for vectors of length 2 dim.
+     */
+    void multiply(const Jacobian<dtype> &jacobian, const dtype *sigma, const dtype *v, dtype *out,
+                  std::vector<dtype> &workspace) const {
+        const auto n = dim;
+        const auto *vx = v;
+        const auto *vy = v + dim;
+        const auto *x = jacobian.x.data();
+        // w = x * v_y, then the off-diagonal sums of both blocks of row k are S_k and -x_k S_k with
+        // S_k = sum_j H_kj (v_x(j) - w_j)
+        workspace.resize(dim);
+        auto *w = workspace.data();
+        #pragma omp parallel for simd default(none) firstprivate(n, w, x, vy)
+        for (std::size_t i = 0; i < n; ++i) {
+            w[i] = x[i] * vy[i];
+        }
+        const auto *H = jacobian.H.data();
+        const auto *dXX = jacobian.diagXX.data();
+        const auto *dYY = jacobian.diagYY.data();
+        const auto *dYX = jacobian.diagYX.data();
+        forEachRow([=](std::size_t k, IndexType begin, IndexType end, const IndexType *indices, const dtype *) {
+            dtype sum = 0;
+            #pragma omp simd reduction(+:sum)
+            for (auto l = begin; l < end; ++l) {
+                const auto j = indices[l];
+                sum += H[l] * (vx[j] - w[j]);
+            }
+            out[k] = sum + (dXX[k] + sigma[k]) * vx[k] + dYX[k] * vy[k];
+            out[k + n] = -x[k] * sum + dYX[k] * vx[k] + dYY[k] * vy[k];
+        });
+    }
+
+    /**
+     * Diagonal of DF, length 2 dim.
+     */
+    void diagonal(const Jacobian<dtype> &jacobian, dtype *d) const {
+        const auto n = dim;
+        const auto *H = jacobian.H.data();
+        const auto *x = jacobian.x.data();
+        const auto *dXX = jacobian.diagXX.data();
+        const auto *dYY = jacobian.diagYY.data();
+        forEachRow([=](std::size_t k, IndexType begin, IndexType end, const IndexType *indices, const dtype *) {
+            dtype hkk = 0;
+            for (auto l = begin; l < end; ++l) {
+                if (static_cast<std::size_t>(indices[l]) == k) {
+                    hkk = H[l];
+                }
+            }
+            d[k] = dXX[k] + hkk;
+            d[k + n] = dYY[k] + hkk * x[k] * x[k];
+        });
+    }
+
+    /**
+     * Transition matrix in the sparsity pattern of Cs with the diagonal stored separately and the unnormalized
+     * stationary distribution exp(y).
+     */
+    void transitionMatrix(const dtype *x, const dtype *y, dtype *P, dtype *diagP, dtype *nu) const {
+        forEachRow([x, y, P, diagP, nu](std::size_t k, IndexType begin, IndexType end, const IndexType *indices,
+                                        const dtype *Cs) {
+            nu[k] = std::exp(y[k]);
+            dtype diag = 1;
+            for (auto l = begin; l < end; ++l) {
+                const auto j = static_cast<std::size_t>(indices[l]);
+                if (j != k) {
+                    P[l] = Cs[l] / (x[k] + x[j] * std::exp(y[k] - y[j]));
+                    diag -= P[l];
+                } else {
+                    P[l] = 0;
+                }
+            }
+            diagP[k] = diag;
+        });
+    }
+
+private:
+    template<typename F>
+    void forEachRow(F &&f) const {
+        const auto nRanges = static_cast<std::int64_t>(ranges.size() - 1);
+        const auto *rangesPtr = ranges.data();
+        const auto *ptr = indptr;
+        const auto *ind = indices;
+        const auto *values = Cs;
+        #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nRanges, rangesPtr, ptr, ind, values) shared(f)
+        for (std::int64_t range = 0; range < nRanges; ++range) {
+            for (auto i = rangesPtr[range]; i < rangesPtr[range + 1]; ++i) {
+                f(i, ptr[i], ptr[i + 1], ind, values);
+            }
+        }
+    }
+
+    const IndexType *indptr;
+    const IndexType *indices;
+    const dtype *Cs;
+    const dtype *c;
+    std::size_t dim;
+    std::vector<std::size_t> ranges;
+};
+
+/**
+ * Primal-dual interior point method for the reversible maximum likelihood problem in the variables z = (x, y, nu, l, s)
+ * with the inequality constraints x >= 0 (multipliers l, slacks s) and the equality constraint y_0 = 0 (multiplier nu).
+ * Each Newton system is symmetrized by negating the rows belonging to y and nu and solved with Jacobi preconditioned
+ * MINRES. The step length is reduced until the iterate is strictly feasible and lies in the central path neighborhood.
+ */
+template<typename dtype, typename IndexType>
+class PrimalDualSolver {
+public:
+    static constexpr dtype GAMMA_MIN = 0.0001;
+    static constexpr dtype GAMMA_MAX = 0.01;
+    static constexpr dtype GAMMA_BAR = 0.49;
+    static constexpr dtype KAPPA = 0.01;
+    static constexpr dtype SIGMA = 0.1;
+    static constexpr dtype BETA = 100000;
+    static constexpr std::size_t MAX_STEP_REDUCTIONS = 10;
+
+    PrimalDualSolver(const ReversibleMapping<dtype, IndexType> &mapping, std::size_t dim)
+            : mapping(mapping), dim(dim), nZ(4 * dim + 1), current(mapping.nnz(), dim), trial(mapping.nnz(), dim),
+              kkt(nZ), kktTrial(nZ), kktPerturbed(nZ), sigma(dim), rhs(2 * dim + 1), preconditioner(2 * dim + 1),
+              diagonal(2 * dim), dz(nZ), zTrial(nZ), workspace(dim) {}
+
+    /**
+     * Solves the problem starting from x = 1, y = 0.
+     *
+     * @param iterates if not null, all iterates z are appended
+     * @return the final iterate
+     */
+    std::vector<dtype> solve(dtype tol, std::size_t maxIter, std::vector<std::vector<dtype>> *iterates) {
+        // (0.5 GAMMA_BAR)^(1 / TAU) with TAU = 0.5
+        const auto rho = std::min(static_cast<dtype>(.2),
+                                  std::min((GAMMA_BAR / 2) * (GAMMA_BAR / 2), 1 - KAPPA));
+
+        std::vector<dtype> z(nZ, 0);
+        std::fill(z.begin(), z.begin() + dim, static_cast<dtype>(1));
+        std::fill(z.begin() + lOffset(), z.begin() + sOffset(), static_cast<dtype>(1));
+        std::copy(z.begin(), z.begin() + dim, z.begin() + sOffset());
+
+        evaluate(z.data(), kkt.data(), current);
+        auto mu = gap(z.data());
+        auto dual = dualNorm(kkt.data());
+        auto prim = primalNorm(kkt.data());
+
+        // initial neighborhood
+        auto beta = BETA * std::sqrt(dual * dual + prim * prim) / mu;
+        auto gamma = GAMMA_MAX;
+        // GAMMA_BAR^t with t the number of fast steps
+        dtype gammaBarT = 1;
+
+        if (iterates) {
+            iterates->push_back(z);
+        }
+
+        bool converged = false;
+        for (std::size_t n = 0; n < maxIter; ++n) {
+            auto betaNew = (1 + gammaBarT * GAMMA_BAR) * beta;
+            auto gammaNew = GAMMA_MIN + gammaBarT * GAMMA_BAR * (GAMMA_MAX - GAMMA_MIN);
+            auto alpha0 = 1 - std::sqrt(mu) / gammaBarT;
+
+            bool fast = false;
+            if (alpha0 > 0) {
+                auto muNew = step(z.data(), kkt.data(), alpha0, betaNew, gammaNew, mu, false);
+                if (muNew < rho * mu) {
+                    mu = muNew;
+                    beta = betaNew;
+                    gamma = gammaNew;
+                    gammaBarT *= GAMMA_BAR;
+                    fast = true;
+                }
+            }
+            if (!fast) {
+                // centering step with perturbed right-hand side
+                std::copy(kkt.begin(), kkt.end(), kktPerturbed.begin());
+                for (std::size_t i = sOffset(); i < nZ; ++i) {
+                    kktPerturbed[i] -= SIGMA * mu;
+                }
+                mu = step(z.data(), kktPerturbed.data(), 1, beta, gamma, mu, true);
+            }
+
+            // accept the trial point, its residual and Jacobian were evaluated during the step length reduction
+            std::swap(z, zTrial);
+            std::swap(kkt, kktTrial);
+            std::swap(current, trial);
+            dual = dualNorm(kkt.data());
+            prim = primalNorm(kkt.data());
+
+            if (iterates) {
+                iterates->push_back(z);
+            }
+            if (mu < tol && dual < tol && prim < tol) {
+                converged = true;
+                break;
+            }
+        }
+        if (!converged) {
+            throw std::runtime_error("Maximum number of iterations reached");
+        }
+        return z;
+    }
+
+private:
+    std::size_t yOffset() const { return dim; }
+    std::size_t nuOffset() const { return 2 * dim; }
+    std::size_t lOffset() const { return 2 * dim + 1; }
+    std::size_t sOffset() const { return 3 * dim + 1; }
+
+    dtype gap(const dtype *z) const {
+        return dot(z + lOffset(), z + sOffset(), dim) / static_cast<dtype>(dim);
+    }
+
+    dtype centrality(const dtype *z) const {
+        const auto *l = z + lOffset();
+        const auto *s = z + sOffset();
+        auto result = std::numeric_limits<dtype>::infinity();
+        for (std::size_t i = 0; i < dim; ++i) {
+            result = std::min(result, l[i] * s[i]);
+        }
+        return result;
+    }
+
+    dtype dualNorm(const dtype *kktValue) const {
+        return norm(kktValue, 2 * dim);
+    }
+
+    dtype primalNorm(const dtype *kktValue) const {
+        return norm(kktValue + nuOffset(), dim + 1);
+    }
+
+    /**
+     * Unperturbed KKT residual (r_dual, r_prim1, r_prim2, r_slack) at z. The Jacobian at z is assembled into jacobian
+     * in the same pass.
+     */
+    void evaluate(const dtype *z, dtype *kktValue, Jacobian<dtype> &jacobian) const {
+        const auto *x = z;
+        const auto *y = z + yOffset();
+        const auto *l = z + lOffset();
+        const auto *s = z + sOffset();
+        mapping.evaluate(x, y, kktValue, &jacobian);
+        // dual residual F + A^T nu + G^T l with G = (-I, 0) and A = e_dim
+        for (std::size_t i = 0; i < dim; ++i) {
+            kktValue[i] -= l[i];
+        }
+        kktValue[yOffset()] += z[nuOffset()];
+        // primal residuals A z - b and G z - h + s
+        kktValue[nuOffset()] = y[0];
+        for (std::size_t i = 0; i < dim; ++i) {
+            kktValue[lOffset() + i] = s[i] - x[i];
+            kktValue[sOffset() + i] = l[i] * s[i];
+        }
+    }
+
+    /**
+     * Newton direction dz for the (possibly perturbed) KKT residual at z, using the Jacobian in current.
+     */
+    void direction(const dtype *z, const dtype *kktValue) {
+        const auto *l = z + lOffset();
+        const auto *s = z + sOffset();
+        const auto *rd = kktValue;
+        const auto rp1 = kktValue[nuOffset()];
+        const auto *rp2 = kktValue + lOffset();
+        const auto *rc = kktValue + sOffset();
+
+        for (std::size_t i = 0; i < dim; ++i) {
+            sigma[i] = l[i] / s[i];
+        }
+        // symmetrized right-hand side, the rows of y and nu are negated
+        for (std::size_t i = 0; i < dim; ++i) {
+            rhs[i] = -rd[i] + sigma[i] * rp2[i] - rc[i] / s[i];
+            rhs[dim + i] = rd[dim + i];
+        }
+        rhs[2 * dim] = rp1;
+
+        mapping.diagonal(current, diagonal.data());
+        for (std::size_t i = 0; i < 2 * dim; ++i) {
+            auto d = std::abs(i < dim ? diagonal[i] + sigma[i] : diagonal[i]);
+            preconditioner[i] = d > 0 ? 1 / d : 1;
+        }
+        preconditioner[2 * dim] = 1;
+
+        auto matvec = [this](const dtype *v, dtype *out) {
+            mapping.multiply(current, sigma.data(), v, out, workspace);
+            out[dim] -= v[2 * dim];
+            out[2 * dim] = -v[dim];
+        };
+        const auto n = 2 * dim + 1;
+        minres(matvec, preconditioner.data(), rhs.data(), dz.data(), n, static_cast<dtype>(1e-10), 5 * n);
+
+        // directions of slacks and multipliers
+        auto *dl = dz.data() + lOffset();
+        auto *ds = dz.data() + sOffset();
+        for (std::size_t i = 0; i < dim; ++i) {
+            ds[i] = -rp2[i] + dz[i];
+            dl[i] = -sigma[i] * ds[i] - rc[i] / s[i];
+        }
+    }
+
+    /**
+     * Computes the Newton direction and reduces the step length until the trial point zTrial has positive multipliers
+     * and slacks and lies in the neighborhood given by beta and gamma. For centering steps, mu must additionally
+     * decrease sufficiently. On return, kktTrial and trial hold the unperturbed KKT residual and the Jacobian at zTrial.
+     *
+     * @return the gap at zTrial
+     */
+    dtype step(const dtype *z, const dtype *kktValue, dtype alpha, dtype beta, dtype gamma, dtype mu, bool centering) {
+        direction(z, kktValue);
+
+        bool positive = false;
+        for (std::size_t k = 0; k < MAX_STEP_REDUCTIONS && !positive; ++k) {
+            positive = true;
+            for (std::size_t i = lOffset(); i < nZ; ++i) {
+                positive = positive && z[i] + alpha * dz[i] > 0;
+            }
+            if (!positive) {
+                alpha /= 2;
+            }
+        }
+        if (!positive) {
+            throw std::runtime_error("Maximum steplength reduction (pos.) reached");
+        }
+
+        for (std::size_t k = 0; k < MAX_STEP_REDUCTIONS; ++k) {
+            for (std::size_t i = 0; i < nZ; ++i) {
+                zTrial[i] = z[i] + alpha * dz[i];
+            }
+            evaluate(zTrial.data(), kktTrial.data(), trial);
+            auto dual = dualNorm(kktTrial.data());
+            auto prim = primalNorm(kktTrial.data());
+            auto muNew = gap(zTrial.data());
+            auto centralityNew = centrality(zTrial.data());
+            if (dual <= beta * muNew && prim <= beta * muNew && centralityNew >= gamma * muNew
+                && (!centering || muNew <= (1 - KAPPA * alpha * (1 - SIGMA)) * mu)) {
+                return muNew;
+            }
+            alpha /= 2;
+        }
+        throw std::runtime_error("Maximum steplength reduction reached");
+    }
+
+    const ReversibleMapping<dtype, IndexType> &mapping;
+    std::size_t dim;
+    std::size_t nZ;
+    Jacobian<dtype> current;
+    Jacobian<dtype> trial;
+    std::vector<dtype> kkt, kktTrial, kktPerturbed, sigma, rhs, preconditioner, diagonal, dz, zTrial, workspace;
+};
+
+}
+}
+
+/**
+ * Reversible maximum likelihood estimation with the primal-dual interior point Newton method on the scaled and
+ * symmetrized count matrix Cs = C + C^T in CSR format with column sums c of the scaled count matrix.
+ *
+ * @param PArr output, off-diagonal elements of the transition matrix in the sparsity pattern of Cs
+ * @param diagPArr output, diagonal of the transition matrix
+ * @param piArr output, stationary distribution
+ * @param recordIterates whether to return all iterates z = (x, y, nu, l, s)
+ * @return the iterates if recorded, otherwise an empty list
+ */
+template<typename dtype, typename IndexType>
+std::vector<std::vector<dtype>> mle_rev_newton(np_array_nfc<dtype> &PArr, np_array_nfc<dtype> &diagPArr,
+                                               np_array_nfc<dtype> &piArr, const np_array_nfc<dtype> &CsArr,
+                                               const np_array_nfc<IndexType> &indptrArr,
+                                               const np_array_nfc<IndexType> &indicesArr,
+                                               const np_array_nfc<dtype> &cArr, const std::size_t dim,
+                                               const dtype tol, const std::size_t maxiter, bool recordIterates) {
+    if (static_cast<std::size_t>(indptrArr.size()) != dim + 1) {
+        throw std::invalid_argument("The row pointer array must have dim + 1 entries.");
+    }
+    if (dim == 0) {
+        throw std::invalid_argument("The count matrix must not be empty.");
+    }
+    if (static_cast<std::size_t>(cArr.size()) != dim || static_cast<std::size_t>(diagPArr.size()) != dim
+        || static_cast<std::size_t>(piArr.size()) != dim || PArr.size() != CsArr.size()
+        || CsArr.size() != indicesArr.size()) {
+        throw std::invalid_argument("Inconsistent array sizes.");
+    }
+
+    py::gil_scoped_release gil;
+
+    detail::newton::ReversibleMapping<dtype, IndexType> mapping(indptrArr.data(), indicesArr.data(), CsArr.data(),
+                                                                cArr.data(), dim);
+    detail::newton::PrimalDualSolver<dtype, IndexType> solver(mapping, dim);
+
+    std::vector<std::vector<dtype>> iterates;
+    auto z = solver.solve(tol, maxiter, recordIterates ? &iterates : nullptr);
+
+    auto *pi = piArr.mutable_data();
+    mapping.transitionMatrix(z.data(), z.data() + dim, PArr.mutable_data(), diagPArr.mutable_data(), pi);
+    auto piSum = detail::sum(pi, dim);
+    std::transform(pi, pi + dim, pi, [piSum](auto elem) { return elem / piSum; });
+    return iterates;
+}
@@ -4,183 +4,451 @@
 
 #pragma once
 
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include "common.h"
+#include "fixed_point_utils.h"
+
+namespace detail {
+
+/**
+ * Splits the rows of a CSR matrix into contiguous ranges of roughly the same number of nonzeros. Each range is
+ * processed by one thread, which then owns the corresponding output entries.
+ */
+template<typename IndexType>
+std::vector<std::size_t> balancedRowRanges(const IndexType *indptr, std::size_t nRows) {
+    std::size_t nRanges = 1;
+    #ifdef USE_OPENMP
+    nRanges = 8 * static_cast<std::size_t>(omp_get_max_threads());
+    #endif
+    nRanges = std::max(static_cast<std::size_t>(1), std::min(nRanges, nRows));
+    const auto nnz = static_cast<std::size_t>(indptr[nRows]);
+
+    std::vector<std::size_t> ranges {0};
+    for (std::size_t r = 1; r < nRanges; ++r) {
+        auto target = static_cast<IndexType>(nnz * r / nRanges);
+        auto row = static_cast<std::size_t>(std::lower_bound(indptr, indptr + nRows + 1, target) - indptr);
+        if (row > ranges.back() && row < nRows) {
+            ranges.push_back(row);
+        }
+    }
+    ranges.push_back(nRows);
+    return ranges;
+}
 
-template<typename dtype>
-int mle_trev_sparse(np_array_nfc<dtype> &TArr, const np_array_nfc<dtype> &CCtArr,
-                    const np_array<int> &iIndicesArr, const np_array<int> &jIndicesArr,
-                    std::size_t nData, const np_array_nfc<dtype> &sumCArr, const std::size_t dim,
-                    const dtype maxerr, const std::size_t maxiter,
-                    np_array_nfc<dtype> &mu, dtype muEps) {
-    py::gil_scoped_release gil;
+/**
+ * Fixed-point update for the reversible maximum likelihood transition matrix on the symmetrized count matrix
+ * CCt = C + C^T in CSR format. Since CCt is symmetric, its rows are also its columns, so that
+ *
+ *     x_i <- sum_j CCt_ij / (c_i / x_i + c_j / x_j)
+ *
+ * is a segmented reduction over row i. Threads own ranges of rows and write only to their own output entries.
+ */
+template<typename dtype, typename IndexType>
+class TrevSparseUpdate {
+public:
+    TrevSparseUpdate(const IndexType *indptr, const IndexType *indices, const dtype *data, const dtype *sumC,
+                     std::size_t dim)
+            : indptr(indptr), indices(indices), data(data), sumC(sumC), dim(dim), ratio(dim),
+              ranges(balancedRowRanges(indptr, dim)) {}
+
+    /**
+     * Row sums of CCt, the initial guess for the iteration.
+     */
+    void initialGuess(dtype *x) const {
+        forEachRow([x](std::size_t i, IndexType begin, IndexType end, const IndexType *, const dtype *data) {
+            dtype sum = 0;
+            #pragma omp simd reduction(+:sum)
+            for (auto k = begin; k < end; ++k) {
+                sum += data[k];
+            }
+            x[i] = sum;
+        });
+    }
+
+    /**
+     * Unnormalized update xNew = F(x).
+     */
+    void operator()(const dtype *x, dtype *xNew) const {
+        updateRatios(x);
+        const auto *r = ratio.data();
+        forEachRow([r, xNew](std::size_t i, IndexType begin, IndexType end,
+                             const IndexType *indices, const dtype *data) {
+            const auto ri = r[i];
+            dtype sum = 0;
+            #pragma omp simd reduction(+:sum)
+            for (auto k = begin; k < end; ++k) {
+                sum += data[k] / (ri + r[indices[k]]);
+            }
+            xNew[i] = sum;
+        });
+    }
+
+    /**
+     * Evaluates the nonzero elements of the transition matrix in the sparsity pattern of CCt.
+     */
+    void transitionMatrix(const dtype *x, dtype *T) const {
+        updateRatios(x);
+        const auto *r = ratio.data();
+        forEachRow([r, T](std::size_t i, IndexType begin, IndexType end,
+                          const IndexType *indices, const dtype *data) {
+            const auto ri = r[i];
+            dtype sum = 0;
+            #pragma omp simd reduction(+:sum)
+            for (auto k = begin; k < end; ++k) {
+                T[k] = data[k] / (ri + r[indices[k]]);
+                sum += T[k];
+            }
+            #pragma omp simd
+            for (auto k = begin; k < end; ++k) {
+                T[k] /= sum;
+            }
+        });
+    }
+
+private:
+    void updateRatios(const dtype *x) const {
+        auto *r = ratio.data();
+        auto c = sumC;
+        auto n = dim;
+        #pragma omp parallel for simd default(none) firstprivate(n, c, r, x)
+        for (std::size_t i = 0; i < n; ++i) {
+            r[i] = c[i] / x[i];
+        }
+    }
+
+    template<typename F>
+    void forEachRow(F &&f) const {
+        const auto nRanges = static_cast<std::int64_t>(ranges.size() - 1);
+        const auto *rangesPtr = ranges.data();
+        const auto *ptr = indptr;
+        const auto *ind = indices;
+        const auto *values = data;
+        #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nRanges, rangesPtr, ptr, ind, values) shared(f)
+        for (std::int64_t range = 0; range < nRanges; ++range) {
+            for (auto i = rangesPtr[range]; i < rangesPtr[range + 1]; ++i) {
+                f(i, ptr[i], ptr[i + 1], ind, values);
+            }
+        }
+    }
 
-    std::unique_ptr<dtype[]> sum_x{new dtype[dim]};
-    std::unique_ptr<dtype[]> sum_x_new{new dtype[dim]};
+    const IndexType *indptr;
+    const IndexType *indices;
+    const dtype *data;
+    const dtype *sumC;
+    std::size_t dim;
+    mutable std::vector<dtype> ratio;
+    std::vector<std::size_t> ranges;
+};
 
-    auto sumC = sumCArr.template unchecked<1>();
-    auto CCt = CCtArr.template unchecked<1>();
-    auto iIndices = iIndicesArr.template unchecked<1>();
-    auto jIndices = jIndicesArr.template unchecked<1>();
+template<typename dtype>
+bool allPositive(const dtype *x, std::size_t n) {
+    bool positive = true;
+    #pragma omp parallel for simd reduction(&&:positive) default(none) firstprivate(x, n)
+    for (std::size_t i = 0; i < n; ++i) {
+        positive = positive && x[i] > 0 && !std::isnan(x[i]);
+    }
+    return positive;
+}
 
-    auto T = TArr.template mutable_unchecked<1>();
+template<typename dtype>
+dtype sum(const dtype *x, std::size_t n) {
+    dtype result = 0;
+    #pragma omp parallel for simd reduction(+:result) default(none) firstprivate(x, n)
+    for (std::size_t i = 0; i < n; ++i) {
+        result += x[i];
+    }
+    return result;
+}
+
+}
 
+namespace detail {
+
+/**
+ * Reversible maximum likelihood estimation on raw CSR arrays of the symmetrized count matrix.
+ * @param x0 initial guess for the stationary distribution, nullptr for the normalized row sums of CCt
+ * @param T output, the nonzero elements of the transition matrix in the sparsity pattern of CCt
+ * @param mu output, the stationary distribution
+ */
+template<typename dtype, typename IndexType>
+deeptime::fixed_point::Result<dtype> mleTrevSparse(const IndexType *indptr, const IndexType *indices,
+                                                   const dtype *CCt, const dtype *sumC, std::size_t dim,
+                                                   dtype maxerr, std::size_t maxiter, dtype muEps,
+                                                   deeptime::fixed_point::Acceleration method, const dtype *x0,
+                                                   dtype *T, dtype *mu) {
     /* ckeck sum_C */
     for (std::size_t i = 0; i < dim; ++i) {
-        if (sumC(i) == 0) {
+        if (sumC[i] == 0) {
             throw std::invalid_argument("Some row and corresponding column of the count matrix C have zero counts.");
         }
     }
 
-    {
-        // initialize sum_x_new
-        std::fill(sum_x_new.get(), sum_x_new.get() + dim, 0);
-        dtype x_norm{0};
-        for (std::size_t t = 0; t < nData; t++) {
-            auto j = jIndices(t);
-            auto CCt_ij = CCt(t);
-            sum_x_new[j] += CCt_ij;
-            x_norm += CCt_ij;
+    TrevSparseUpdate<dtype, IndexType> update(indptr, indices, CCt, sumC, dim);
+
+    // initialize sum_x
+    std::vector<dtype> sum_x(dim);
+    if (x0 != nullptr) {
+        std::copy(x0, x0 + dim, sum_x.begin());
+        if (!deeptime::fixed_point::projectNormalized(sum_x.data(), dim, muEps)) {
+            throw std::invalid_argument("The initial guess for the stationary distribution must be positive.");
         }
-        std::transform(sum_x_new.get(), sum_x_new.get() + dim, sum_x_new.get(),
-                       [x_norm](auto elem) { return elem / x_norm; });
+    } else {
+        update.initialGuess(sum_x.data());
+        auto x_norm = sum(sum_x.data(), dim);
+        std::transform(sum_x.begin(), sum_x.end(), sum_x.begin(), [x_norm](auto elem) { return elem / x_norm; });
     }
 
-
     /* iterate */
-    std::size_t iteration = 0;
-    dtype rel_err;
-    do {
-        /* swap buffers */
-        std::swap(sum_x, sum_x_new);
-
-        {
-            /* update sum_x */
-            std::fill(sum_x_new.get(), sum_x_new.get() + dim, 0);
-            for (std::size_t t = 0; t < nData; t++) {
-                auto i = iIndices(t);
-                auto j = jIndices(t);
-                auto CCt_ij = CCt(t);
-                auto value = CCt_ij / (sumC(i) / sum_x[i] + sumC(j) / sum_x[j]);
-                sum_x_new[j] += value;
-            }
-            for (std::size_t i = 0; i < dim; ++i) {
-                if (sum_x_new[i] == 0 || std::isnan(sum_x_new[i])) {
-                    throw std::logic_error("The update of the stationary distribution produced zero or NaN.");
-                }
-            }
+    auto map = [&update, dim, muEps](const dtype *x, dtype *x_new) {
+        update(x, x_new);
+        if (!allPositive(x_new, dim)) {
+            throw std::logic_error("The update of the stationary distribution produced zero or NaN.");
         }
 
-        {
-            /* normalize sum_x */
-            auto xNorm = std::accumulate(sum_x_new.get(), sum_x_new.get() + dim, static_cast<dtype>(0));
-            for (std::size_t i = 0; i < dim; i++) {
-                sum_x_new[i] /= xNorm;
-                if (sum_x_new[i] <= muEps) {
-                    throw std::runtime_error("Stationary distribution contains entries smaller than "
-                                             + std::to_string(muEps) + " during iteration");
-                }
+        /* normalize sum_x */
+        auto xNorm = sum(x_new, dim);
+        for (std::size_t i = 0; i < dim; i++) {
+            x_new[i] /= xNorm;
+            if (x_new[i] <= muEps) {
+                throw std::runtime_error("Stationary distribution contains entries smaller than "
+                                         + std::to_string(muEps) + " during iteration");
             }
         }
+    };
+    auto error = [dim](const dtype *x, const dtype *x_new) {
+        return util::relativeError(dim, x, x_new);
+    };
+    auto result = deeptime::fixed_point::solvePositive(sum_x, map, error, true, muEps, maxerr, maxiter, method);
 
+    update.transitionMatrix(sum_x.data(), T);
 
-        iteration += 1;
-        rel_err = util::relativeError(dim, sum_x.get(), sum_x_new.get());
-    } while (rel_err > maxerr && iteration < maxiter);
+    std::copy(sum_x.begin(), sum_x.end(), mu);
+    return result;
+}
 
-    {
-        // calculate X
-        std::fill(sum_x.get(), sum_x.get() + dim, 0);
-        for (std::size_t t = 0; t < nData; t++) {
-            auto i = iIndices(t);
-            auto j = jIndices(t);
-            auto CCt_ij = CCt(t);
-            T(t) = CCt_ij / (sumC(i) / sum_x_new[i] + sumC(j) / sum_x_new[j]);
-            sum_x[i] += T(t);  // update sum with X_ij
-        }
+}
+
+template<typename dtype, typename IndexType>
+std::tuple<int, std::vector<dtype>> mle_trev_sparse(np_array_nfc<dtype> &TArr, const np_array_nfc<dtype> &CCtArr,
+                                                    const np_array_nfc<IndexType> &indptrArr,
+                                                    const np_array_nfc<IndexType> &indicesArr,
+                                                    const np_array_nfc<dtype> &sumCArr, const std::size_t dim,
+                                                    const dtype maxerr, const std::size_t maxiter,
+                                                    np_array_nfc<dtype> &mu, dtype muEps,
+                                                    const std::string &acceleration) {
+    auto method = deeptime::fixed_point::parseAcceleration(acceleration);
+    if (static_cast<std::size_t>(indptrArr.size()) != dim + 1) {
+        throw std::invalid_argument("The row pointer array must have dim + 1 entries.");
     }
 
-    // normalize to T
-    for (std::size_t t = 0; t < nData; t++) {
-        auto i = iIndices(t);
-        T(t) /= sum_x[i];
+    py::gil_scoped_release gil;
+
+    auto result = detail::mleTrevSparse(indptrArr.data(), indicesArr.data(), CCtArr.data(), sumCArr.data(), dim,
+                                        maxerr, maxiter, muEps, method, static_cast<const dtype *>(nullptr),
+                                        TArr.mutable_data(), mu.mutable_data());
+
+    return std::make_tuple(result.converged ? 0 : -5, std::move(result.errors));
+}
+
+/**
+ * Estimates reversible transition matrices for a batch of count matrices over the same state space. Problems are
+ * distributed over threads. A problem k with warmStart[k] >= 0 is initialized with the stationary distribution of
+ * problem warmStart[k] < k and is solved once that problem has finished; problems without warm start are solved
+ * first. If fewer problems than threads are ready, they are solved one after the other with row-parallel kernels.
+ *
+ * @return the stationary distributions, shape (nProblems, dim), the convergence codes, shape (nProblems,), and the
+ * number of fixed-point map evaluations per problem, shape (nProblems,)
+ */
+template<typename dtype, typename IndexType>
+std::tuple<np_array<dtype>, np_array<int>, np_array<std::int64_t>> mle_trev_sparse_batch(
+        std::vector<np_array_nfc<dtype>> TArrs, const std::vector<np_array_nfc<dtype>> &CCtArrs,
+        const std::vector<np_array_nfc<IndexType>> &indptrArrs, const std::vector<np_array_nfc<IndexType>> &indicesArrs,
+        const np_array_nfc<dtype> &sumCArr, const np_array<std::int64_t> &warmStartArr, const std::size_t dim,
+        const dtype maxerr, const std::size_t maxiter, dtype muEps, const std::string &acceleration) {
+    auto method = deeptime::fixed_point::parseAcceleration(acceleration);
+    const auto nProblems = TArrs.size();
+    if (CCtArrs.size() != nProblems || indptrArrs.size() != nProblems || indicesArrs.size() != nProblems) {
+        throw std::invalid_argument("The number of transition matrix, count matrix, and index arrays must agree.");
+    }
+    if (sumCArr.ndim() != 2 || static_cast<std::size_t>(sumCArr.shape(0)) != nProblems
+        || static_cast<std::size_t>(sumCArr.shape(1)) != dim) {
+        throw std::invalid_argument("The row sums of the count matrices must be of shape (n_problems, dim).");
+    }
+    if (static_cast<std::size_t>(warmStartArr.size()) != nProblems) {
+        throw std::invalid_argument("There must be exactly one warm start index per problem.");
+    }
+    // problems are solved in waves, each wave only depends on solutions of previous waves
+    std::vector<std::size_t> wave(nProblems, 0);
+    std::size_t nWaves = nProblems > 0 ? 1 : 0;
+    for (std::size_t k = 0; k < nProblems; ++k) {
+        if (static_cast<std::size_t>(indptrArrs[k].size()) != dim + 1
+            || CCtArrs[k].size() != indicesArrs[k].size() || TArrs[k].size() != CCtArrs[k].size()) {
+            throw std::invalid_argument("Inconsistent CSR arrays for problem " + std::to_string(k) + ".");
+        }
+        auto parent = warmStartArr.at(k);
+        if (parent >= static_cast<std::int64_t>(k)) {
+            throw std::invalid_argument("Problems can only be warm-started from preceding problems.");
+        }
+        if (parent >= 0) {
+            wave[k] = wave[parent] + 1;
+            nWaves = std::max(nWaves, wave[k] + 1);
+        }
     }
 
-    std::copy(sum_x_new.get(), sum_x_new.get() + dim, mu.mutable_data());
+    np_array<dtype> muArr({nProblems, dim});
+    np_array<int> codesArr({nProblems});
+    np_array<std::int64_t> iterationsArr({nProblems});
 
-    if (iteration == maxiter) {
-        return -5;
-    } else {
-        return 0;
+    {
+        py::gil_scoped_release gil;
+
+        std::vector<dtype *> T(nProblems);
+        std::vector<const dtype *> CCt(nProblems);
+        std::vector<const IndexType *> indptr(nProblems), indices(nProblems);
+        for (std::size_t k = 0; k < nProblems; ++k) {
+            T[k] = TArrs[k].mutable_data();
+            CCt[k] = CCtArrs[k].data();
+            indptr[k] = indptrArrs[k].data();
+            indices[k] = indicesArrs[k].data();
+        }
+        const auto *sumC = sumCArr.data();
+        const auto *warmStart = warmStartArr.data();
+        auto *mu = muArr.mutable_data();
+        auto *codes = codesArr.mutable_data();
+        auto *iterations = iterationsArr.mutable_data();
+        std::vector<std::string> errors(nProblems);
+
+        auto solve = [&](std::size_t k) {
+            const dtype *x0 = warmStart[k] >= 0 ? mu + warmStart[k] * dim : nullptr;
+            try {
+                auto result = detail::mleTrevSparse(indptr[k], indices[k], CCt[k], sumC + k * dim, dim, maxerr,
+                                                    maxiter, muEps, method, x0, T[k], mu + k * dim);
+                codes[k] = result.converged ? 0 : -5;
+                iterations[k] = static_cast<std::int64_t>(result.iterations);
+            } catch (const std::exception &e) {
+                errors[k] = e.what();
+                codes[k] = -1;
+                iterations[k] = 0;
+            }
+        };
+
+        std::size_t nThreads = 1;
+        #ifdef USE_OPENMP
+        nThreads = static_cast<std::size_t>(omp_get_max_threads());
+        #endif
+
+        for (std::size_t currentWave = 0; currentWave < nWaves; ++currentWave) {
+            std::vector<std::size_t> problems;
+            for (std::size_t k = 0; k < nProblems; ++k) {
+                if (wave[k] == currentWave) {
+                    problems.push_back(k);
+                }
+            }
+            if (problems.size() < nThreads) {
+                // too few problems to occupy all threads (e.g., a chain of warm starts): solve them one after the
+                // other outside of a parallel region, so that the row-parallel kernels get all threads
+                for (auto k : problems) {
+                    solve(k);
+                }
+            } else {
+                const auto nWaveProblems = static_cast<std::int64_t>(problems.size());
+                #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nWaveProblems) \
+                        shared(problems, solve)
+                for (std::int64_t p = 0; p < nWaveProblems; ++p) {
+                    solve(problems[p]);
+                }
+            }
+            for (auto k : problems) {
+                if (!errors[k].empty()) {
+                    throw std::runtime_error("Estimation failed for problem " + std::to_string(k) + ": " + errors[k]);
+                }
+            }
+        }
     }
 
+    return std::make_tuple(std::move(muArr), std::move(codesArr), std::move(iterationsArr));
 }
 
-template<typename dtype>
-int mle_trev_given_pi_sparse(np_array_nfc<dtype> &TunnormalizedArr, const np_array_nfc<dtype> &CCtArr,
-                             const np_array<int> &iIndicesArr, const np_array<int> &jIndicesArr,
-                             const std::size_t nData, const np_array_nfc<dtype> &muArr, const std::size_t len_mu,
-                             const dtype maxerr, const std::size_t maxiter) {
-    py::gil_scoped_release gil;
+template<typename dtype, typename IndexType>
+std::tuple<int, std::vector<dtype>> mle_trev_given_pi_sparse(np_array_nfc<dtype> &TunnormalizedArr,
+                                                             const np_array_nfc<dtype> &CCtArr,
+                                                             const np_array_nfc<IndexType> &indptrArr,
+                                                             const np_array_nfc<IndexType> &indicesArr,
+                                                             const np_array_nfc<dtype> &muArr,
+                                                             const std::size_t len_mu, const dtype maxerr,
+                                                             const std::size_t maxiter,
+                                                             const std::string &acceleration) {
+    auto method = deeptime::fixed_point::parseAcceleration(acceleration);
+    if (static_cast<std::size_t>(indptrArr.size()) != len_mu + 1) {
+        throw std::invalid_argument("The row pointer array must have len(mu) + 1 entries.");
+    }
 
-    std::unique_ptr<dtype[]> lam{new dtype[len_mu]};
-    std::unique_ptr<dtype[]> lam_new{new dtype[len_mu]};
+    py::gil_scoped_release gil;
 
-    auto CCt = CCtArr.template unchecked<1>();
-    auto iIndices = iIndicesArr.template unchecked<1>();
-    auto jIndices = jIndicesArr.template unchecked<1>();
-    auto T = TunnormalizedArr.template mutable_unchecked<1>();
-    auto mu = muArr.template unchecked<1>();
+    const auto *indptr = indptrArr.data();
+    const auto *indices = indicesArr.data();
+    const auto *CCt = CCtArr.data();
+    auto *T = TunnormalizedArr.mutable_data();
+    const auto *mu = muArr.data();
 
     // check mu
     for (std::size_t i = 0; i < len_mu; ++i) {
-        if (mu(i) == 0) {
+        if (mu[i] == 0) {
             throw std::invalid_argument("Some element of pi is zero.");
         }
     }
 
+    auto ranges = detail::balancedRowRanges(indptr, len_mu);
+    const auto nRanges = static_cast<std::int64_t>(ranges.size() - 1);
+    const auto *rangesPtr = ranges.data();
+
+    // initialize lambdas with half the row sums of CCt
+    std::vector<dtype> lam(len_mu);
     {
-        // initialize lambdas
-        std::fill(lam_new.get(), lam_new.get() + len_mu, 0);
-
-        for (std::size_t t = 0; t < nData; ++t) {
-            auto i = iIndices(t);
-            auto j = jIndices(t);
-            if (i < j) continue;
-            lam_new[i] += static_cast<dtype>(0.5) * CCt(t);
-            if (i != j) {
-                lam_new[j] += static_cast<dtype>(0.5) * CCt(t);
+        auto *lamPtr = lam.data();
+        #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nRanges, rangesPtr, indptr, CCt, lamPtr)
+        for (std::int64_t range = 0; range < nRanges; ++range) {
+            for (auto i = rangesPtr[range]; i < rangesPtr[range + 1]; ++i) {
+                dtype sum = 0;
+                for (auto k = indptr[i]; k < indptr[i + 1]; ++k) {
+                    sum += CCt[k];
+                }
+                lamPtr[i] = static_cast<dtype>(0.5) * sum;
             }
         }
-        for (std::size_t i = 0; i < len_mu; ++i) {
-            if (lam_new[i] == 0) {
-                throw std::invalid_argument("Some row and corresponding column of C have zero counts.");
-            }
+        if (!detail::allPositive(lamPtr, len_mu)) {
+            throw std::invalid_argument("Some row and corresponding column of C have zero counts.");
         }
     }
 
     /* iterate lambdas */
-    std::size_t iteration = 0;
-    dtype dsq{0};
-    do {
-        /* swap buffers */
-        std::swap(lam, lam_new);
-        std::fill(lam_new.get(), lam_new.get() + len_mu, 0);
-
-        for (std::size_t t = 0; t < nData; t++) {
-            auto i = iIndices(t);
-            auto j = jIndices(t);
-            if (i < j) {
-                continue;
-            }
-
-            auto CCt_ij = CCt(t);
-            if (CCt_ij == 0) {
-                throw std::logic_error("Encountered zero in CCt. Should not happen!");
-            }
-
-            lam_new[i] += CCt_ij / ((mu(i) * lam[j]) / (mu(j) * lam[i]) + static_cast<dtype>(1));
-            if (i != j) {
-                lam_new[j] += CCt_ij / ((mu(j) * lam[i]) / (mu(i) * lam[j]) + static_cast<dtype>(1));
+    std::vector<dtype> q(len_mu);
+    auto map = [&, nRanges, rangesPtr](const dtype *lam_old, dtype *lam_new) {
+        // with q_i = mu_i / lam_i: lam_i <- sum_j CCt_ij q_j / (q_i + q_j)
+        auto *qPtr = q.data();
+        auto n = len_mu;
+        #pragma omp parallel for simd default(none) firstprivate(n, qPtr, mu, lam_old)
+        for (std::size_t i = 0; i < n; ++i) {
+            qPtr[i] = mu[i] / lam_old[i];
+        }
+        #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nRanges, rangesPtr, indptr, indices, CCt, qPtr, lam_new)
+        for (std::int64_t range = 0; range < nRanges; ++range) {
+            for (auto i = rangesPtr[range]; i < rangesPtr[range + 1]; ++i) {
+                const auto qi = qPtr[i];
+                dtype sum = 0;
+                #pragma omp simd reduction(+:sum)
+                for (auto k = indptr[i]; k < indptr[i + 1]; ++k) {
+                    const auto qj = qPtr[indices[k]];
+                    sum += CCt[k] * qj / (qi + qj);
+                }
+                lam_new[i] = sum;
             }
         }
         for (std::size_t i = 0; i < len_mu; i++) {
@@ -188,27 +456,27 @@ int mle_trev_given_pi_sparse(np_array_nfc<dtype> &TunnormalizedArr, const np_arr
                 throw std::runtime_error("The update of the Lagrange multipliers produced NaN.");
             }
         }
-
-        iteration += 1;
-        dsq = util::distsq(len_mu, lam.get(), lam_new.get());
-    } while (dsq > maxerr * maxerr && iteration < maxiter);
+    };
+    auto error = [len_mu](const dtype *x, const dtype *x_new) {
+        return std::sqrt(util::distsq(len_mu, x, x_new));
+    };
+    auto result = deeptime::fixed_point::solvePositive(lam, map, error, false, static_cast<dtype>(0), maxerr, maxiter,
+                                                       method);
 
     /* calculate T */
-    for (std::size_t t = 0; t < nData; t++) {
-        auto i = iIndices(t);
-        auto j = jIndices(t);
-        if (i == j) {
-            T(t) = 0; // handle normalization later
-        } else {
-            auto CCt_ij = CCt(t);
-            T(t) = CCt_ij / (lam_new[i] + lam_new[j] * mu(i) / mu(j));
+    {
+        const auto *lamPtr = lam.data();
+        #pragma omp parallel for schedule(dynamic) default(none) firstprivate(nRanges, rangesPtr, indptr, indices, CCt, lamPtr, mu, T)
+        for (std::int64_t range = 0; range < nRanges; ++range) {
+            for (auto i = rangesPtr[range]; i < rangesPtr[range + 1]; ++i) {
+                for (auto k = indptr[i]; k < indptr[i + 1]; ++k) {
+                    auto j = static_cast<std::size_t>(indices[k]);
+                    // diagonal is handled by the normalization later
+                    T[k] = i == j ? 0 : CCt[k] / (lamPtr[i] + lamPtr[j] * mu[i] / mu[j]);
+                }
+            }
         }
     }
 
-    if (iteration == maxiter) {
-        return -5;
-    } else {
-        return 0;
-    }
-
+    return std::make_tuple(result.converged ? 0 : -5, std::move(result.errors));
 }
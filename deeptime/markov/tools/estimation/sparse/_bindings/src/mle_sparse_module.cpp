@@ -3,13 +3,21 @@
 //
 
 #include "mle_trev_sparse.h"
+#include "mle_rev_newton.h"
 
+template<typename dtype, typename IndexType, typename Module>
+void exportMleTrevSparse(Module &m) {
+    m.def("mle_trev_sparse", &mle_trev_sparse<dtype, IndexType>);
+    m.def("mle_trev_given_pi_sparse", &mle_trev_given_pi_sparse<dtype, IndexType>);
+    m.def("mle_trev_sparse_batch", &mle_trev_sparse_batch<dtype, IndexType>);
+    m.def("mle_rev_newton", &mle_rev_newton<dtype, IndexType>);
+}
 
 PYBIND11_MODULE(_mle_sparse_bindings, m) {
-    m.def("mle_trev_sparse", &mle_trev_sparse<float>);
-    m.def("mle_trev_sparse", &mle_trev_sparse<double>);
-    m.def("mle_trev_sparse", &mle_trev_sparse<long double>);
-    m.def("mle_trev_given_pi_sparse", &mle_trev_given_pi_sparse<float>);
-    m.def("mle_trev_given_pi_sparse", &mle_trev_given_pi_sparse<double>);
-    m.def("mle_trev_given_pi_sparse", &mle_trev_given_pi_sparse<long double>);
+    exportMleTrevSparse<float, std::int32_t>(m);
+    exportMleTrevSparse<float, std::int64_t>(m);
+    exportMleTrevSparse<double, std::int32_t>(m);
+    exportMleTrevSparse<double, std::int64_t>(m);
+    exportMleTrevSparse<long double, std::int32_t>(m);
+    exportMleTrevSparse<long double, std::int64_t>(m);
 }
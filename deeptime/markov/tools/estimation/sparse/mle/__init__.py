@@ -6,9 +6,21 @@ from deeptime.util.exceptions import NotConvergedWarning
 from .. import _mle_sparse_bindings as _bindings
 
 
+def _symmetrized_csr(C):
+    r""" Computes C + C^T in CSR format without explicit zeros and with index arrays that can be passed
+    to the native implementations. """
+    CCt = scipy.sparse.csr_matrix(C + C.T)
+    CCt.eliminate_zeros()
+    CCt.sum_duplicates()
+    if CCt.indices.dtype not in (np.int32, np.int64) or CCt.indices.dtype != CCt.indptr.dtype:
+        CCt.indices = CCt.indices.astype(np.int64)
+        CCt.indptr = CCt.indptr.astype(np.int64)
+    return CCt
+
+
 def mle_trev(C, maxerr=1.0E-12, maxiter=int(1.0E6),
              warn_not_converged=True, return_statdist=False,
-             eps_mu=1.0E-15):
+             eps_mu=1.0E-15, acceleration='none', return_error_history=False):
     assert maxerr > 0, 'maxerr must be positive'
     assert maxiter > 0, 'maxiter must be positive'
     assert C.shape[0] == C.shape[1], 'C must be a square matrix.'
@@ -22,34 +34,31 @@ def mle_trev(C, maxerr=1.0E-12, maxiter=int(1.0E6),
     C_sum_py = C.sum(axis=1).A1
     C_sum = C_sum_py.astype(dtype, order='C', copy=False)
 
-    CCt = C + C.T
-    # convert CCt to coo format
-    CCt_coo = CCt.tocoo()
-    n_data = CCt_coo.nnz
-    CCt_data = CCt_coo.data.astype(dtype, order='C', copy=False)
-    i_indices = CCt_coo.row.astype(int, order='C', copy=True)
-    j_indices = CCt_coo.col.astype(int, order='C', copy=True)
+    # CCt is symmetric, its CSR representation is also its CSC representation
+    CCt = _symmetrized_csr(C)
+    CCt_data = CCt.data.astype(dtype, order='C', copy=False)
 
-    # prepare data array of T in coo format
-    T_data = np.zeros(n_data, dtype=dtype, order='C')
+    # prepare data array of T in csr format
+    T_data = np.zeros(CCt.nnz, dtype=dtype, order='C')
     mu = np.zeros(C.shape[0], dtype=dtype, order='C')
-    code = _bindings.mle_trev_sparse(T_data, CCt_data, i_indices, j_indices, n_data, C_sum, CCt.shape[0],
-                                     maxerr, maxiter, mu, eps_mu)
+    code, errors = _bindings.mle_trev_sparse(T_data, CCt_data, CCt.indptr, CCt.indices, C_sum, CCt.shape[0],
+                                             maxerr, maxiter, mu, eps_mu, acceleration)
     if code == -5 and warn_not_converged:
         warnings.warn("Reversible transition matrix estimation with fixed stationary distribution didn't converge.",
                       NotConvergedWarning)
 
     # T matrix has the same shape and positions of nonzero elements as CCt
-    T = scipy.sparse.csr_matrix((T_data, (i_indices, j_indices)), shape=CCt.shape)
+    T = scipy.sparse.csr_matrix((T_data, CCt.indices, CCt.indptr), shape=CCt.shape)
     from deeptime.markov.tools.estimation.sparse.transition_matrix import correct_transition_matrix
     T = correct_transition_matrix(T)
-    if return_statdist:
-        return T, mu
-    else:
-        return T
+    result = (T, mu) if return_statdist else (T,)
+    if return_error_history:
+        result += (np.array(errors, dtype=dtype),)
+    return result if len(result) > 1 else result[0]
 
 
-def mle_trev_given_pi(C, mu, maxerr=1.0E-12, maxiter=1000000, warn_not_converged=True):
+def mle_trev_given_pi(C, mu, maxerr=1.0E-12, maxiter=1000000, warn_not_converged=True, acceleration='none',
+                      return_error_history=False):
     assert maxerr > 0, 'maxerr must be positive'
     assert maxiter > 0, 'maxiter must be positive'
     from deeptime.markov.tools.estimation import is_connected
@@ -58,27 +67,122 @@ def mle_trev_given_pi(C, mu, maxerr=1.0E-12, maxiter=1000000, warn_not_converged
     if dtype not in (np.float32, np.float64, np.longdouble):
         dtype = np.float64
     c_mu = mu.astype(dtype, order='C', copy=False)
-    CCt_coo = (C + C.T).tocoo()
-    assert CCt_coo.shape[0] == CCt_coo.shape[1] == c_mu.shape[0], 'Dimensions of C and mu don\'t agree.'
-    n_data = CCt_coo.nnz
-    CCt_data = CCt_coo.data.astype(dtype, order='C', copy=False)
-    i_indices = CCt_coo.row.astype(np.uint64, order='C', copy=False)
-    j_indices = CCt_coo.col.astype(np.uint64, order='C', copy=False)
-    # prepare data array of T in coo format
-    T_unnormalized_data = np.zeros(n_data, dtype=dtype, order='C')
-
-    code = _bindings.mle_trev_given_pi_sparse(T_unnormalized_data, CCt_data, i_indices, j_indices, n_data, c_mu,
-                                              CCt_coo.shape[0], maxerr, maxiter)
+    CCt = _symmetrized_csr(C)
+    assert CCt.shape[0] == CCt.shape[1] == c_mu.shape[0], 'Dimensions of C and mu don\'t agree.'
+    CCt_data = CCt.data.astype(dtype, order='C', copy=False)
+    # prepare data array of T in csr format
+    T_unnormalized_data = np.zeros(CCt.nnz, dtype=dtype, order='C')
+
+    code, errors = _bindings.mle_trev_given_pi_sparse(T_unnormalized_data, CCt_data, CCt.indptr, CCt.indices,
+                                                      c_mu, CCt.shape[0], maxerr, maxiter, acceleration)
 
     if code == -5 and warn_not_converged:
         warnings.warn("Reversible transition matrix estimation with fixed stationary distribution didn't converge.",
                       NotConvergedWarning)
 
     # unnormalized T matrix has the same shape and positions of nonzero elements as the C matrix
-    T_unnormalized = scipy.sparse.csr_matrix((T_unnormalized_data, (i_indices.copy(), j_indices.copy())),
-                                             shape=CCt_coo.shape)
+    T_unnormalized = scipy.sparse.csr_matrix((T_unnormalized_data, CCt.indices, CCt.indptr), shape=CCt.shape)
     # finish T by setting the diagonal elements according to the normalization constraint
     rowsum = T_unnormalized.sum(axis=1).A1
     T_diagonal = scipy.sparse.diags(np.maximum(1.0 - rowsum, 0.0), 0)
 
-    return T_unnormalized + T_diagonal
+    T = T_unnormalized + T_diagonal
+    if return_error_history:
+        return T, np.array(errors, dtype=dtype)
+    return T
+
+
+def mle_trev_batch(Cs, maxerr=1.0E-12, maxiter=int(1.0E6), warn_not_converged=True, eps_mu=1.0E-15,
+                   warm_start=None, acceleration='none', return_iterations=False):
+    r""" Reversible maximum likelihood estimation for a list of count matrices over the same state space in a single
+    native call. The problems are solved concurrently. Dense count matrices are converted to CSR format.
+
+    Parameters
+    ----------
+    Cs : list of (n, n) ndarray or scipy.sparse matrix
+        The count matrices.
+    maxerr : float, optional, default=1e-12
+        Convergence tolerance.
+    maxiter : int, optional, default=1e6
+        Maximum number of iterations per problem.
+    warn_not_converged : bool, optional, default=True
+        Whether to warn if some of the problems did not converge.
+    eps_mu : float, optional, default=1e-15
+        Lower bound on the stationary probabilities during the iteration.
+    warm_start : None or str or array_like, optional, default=None
+        Either None (no warm start), 'neighbor', 'pairs', or an integer array with one entry per problem containing
+        the index of a preceding problem whose stationary distribution is used as initial guess or -1.
+
+        * 'neighbor': every problem but the first is initialized with the solution of the preceding problem,
+          e.g., the previous lag time. This saves the most iterations, but the problems are solved one after the
+          other, each of them parallelized over the rows of its count matrix instead.
+        * 'pairs': only every odd problem is initialized with the solution of the preceding problem, so that half
+          of the problems can be solved concurrently in each of two waves.
+    acceleration : str, optional, default='none'
+        Extrapolation scheme, one of 'none', 'squarem', and 'anderson'.
+    return_iterations : bool, optional, default=False
+        Whether to additionally return the number of iterations per problem.
+
+    Returns
+    -------
+    Ts : list of (n, n) ndarray or scipy.sparse.csr_matrix
+        The transition matrices, same type as the respective count matrices.
+    mus : (len(Cs), n) ndarray
+        The stationary distributions.
+    codes : (len(Cs),) ndarray
+        Convergence codes, 0 for converged and -5 if maxiter was reached.
+    iterations : (len(Cs),) ndarray
+        Number of evaluations of the fixed-point map per problem, only returned if `return_iterations` is True.
+    """
+    assert maxerr > 0, 'maxerr must be positive'
+    assert maxiter > 0, 'maxiter must be positive'
+    from deeptime.markov.tools.estimation import is_connected
+    n_problems = len(Cs)
+    if n_problems == 0:
+        raise ValueError('Need at least one count matrix.')
+    dim = Cs[0].shape[0]
+    if any(C.shape != (dim, dim) for C in Cs):
+        raise ValueError('All count matrices must be square and of the same shape.')
+    for C in Cs:
+        assert is_connected(C, directed=True), 'All count matrices must be strongly connected'
+
+    dtype = np.result_type(*[C.dtype for C in Cs])
+    if dtype not in (np.float32, np.float64, np.longdouble):
+        dtype = np.float64
+
+    if warm_start is None:
+        warm_start = np.full(n_problems, -1, dtype=np.int64)
+    elif isinstance(warm_start, str):
+        if warm_start == 'neighbor':
+            warm_start = np.arange(-1, n_problems - 1, dtype=np.int64)
+        elif warm_start == 'pairs':
+            warm_start = np.array([k - 1 if k % 2 == 1 else -1 for k in range(n_problems)], dtype=np.int64)
+        else:
+            raise ValueError(f"Unknown warm start '{warm_start}', must be None, 'neighbor', 'pairs', "
+                             f"or an index array.")
+    else:
+        warm_start = np.asarray(warm_start, dtype=np.int64)
+
+    CCts = [_symmetrized_csr(scipy.sparse.csr_matrix(C)) for C in Cs]
+    # all index arrays must share one type
+    index_type = np.int64 if any(CCt.indices.dtype == np.int64 for CCt in CCts) else np.int32
+    indptrs = [CCt.indptr.astype(index_type, copy=False) for CCt in CCts]
+    indices = [CCt.indices.astype(index_type, copy=False) for CCt in CCts]
+    data = [CCt.data.astype(dtype, order='C', copy=False) for CCt in CCts]
+    sum_C = np.stack([np.asarray(C.sum(axis=1)).reshape(-1) for C in Cs]).astype(dtype, order='C', copy=False)
+    T_data = [np.zeros_like(d) for d in data]
+
+    mus, codes, iterations = _bindings.mle_trev_sparse_batch(T_data, data, indptrs, indices, sum_C, warm_start, dim,
+                                                             maxerr, maxiter, eps_mu, acceleration)
+    if np.any(codes == -5) and warn_not_converged:
+        warnings.warn(f"Reversible transition matrix estimation didn't converge for problems "
+                      f"{np.where(codes == -5)[0].tolist()}.", NotConvergedWarning)
+
+    from deeptime.markov.tools.estimation.sparse.transition_matrix import correct_transition_matrix
+    Ts = []
+    for C, T, ind, ptr in zip(Cs, T_data, indices, indptrs):
+        T = correct_transition_matrix(scipy.sparse.csr_matrix((T, ind, ptr), shape=(dim, dim)))
+        Ts.append(T if scipy.sparse.issparse(C) else T.toarray())
+    if return_iterations:
+        return Ts, mus, codes, iterations
+    return Ts, mus, codes
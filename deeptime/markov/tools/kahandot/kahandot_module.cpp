@@ -2,33 +2,452 @@
 // Created by mho on 8/6/20.
 //
 
+#include <cmath>
+#include <limits>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include "common.h"
 
+namespace kahan {
+
+/**
+ * Whether the platform offers a fused multiply-add for dtype that is at least as fast as a separate multiply and add.
+ */
+template<typename dtype>
+struct hasFastFma : std::false_type {};
+#ifdef FP_FAST_FMAF
+template<>
+struct hasFastFma<float> : std::true_type {};
+#endif
+#ifdef FP_FAST_FMA
+template<>
+struct hasFastFma<double> : std::true_type {};
+#endif
+#ifdef FP_FAST_FMAL
+template<>
+struct hasFastFma<long double> : std::true_type {};
+#endif
+
+/**
+ * Veltkamp's splitting constant 2^ceil(p/2) + 1 for a floating point type with p mantissa digits.
+ */
+template<typename dtype>
+constexpr dtype splitFactor() {
+    dtype factor{1};
+    for (int i = 0; i < (std::numeric_limits<dtype>::digits + 1) / 2; ++i) {
+        factor *= 2;
+    }
+    return factor + 1;
+}
+
+/**
+ * Error-free transformation of a sum (Knuth's TwoSum): a + b = s + e exactly.
+ */
+template<typename dtype>
+inline void twoSum(dtype a, dtype b, dtype &s, dtype &e) {
+    s = a + b;
+    auto z = s - a;
+    e = (a - (s - z)) + (b - z);
+}
+
+/**
+ * Error-free transformation of a product: a * b = p + e exactly. Uses a fused multiply-add when the hardware has
+ * one and Dekker's TwoProduct otherwise, so that the loop it is called from stays vectorizable. The latter is only
+ * error-free if the compiler does not contract its products into fused multiply-adds, hence this translation unit is
+ * built with -ffp-contract=off.
+ */
+template<typename dtype>
+inline void twoProduct(dtype a, dtype b, dtype &p, dtype &e) {
+    p = a * b;
+    if constexpr (hasFastFma<dtype>::value) {
+        e = std::fma(a, b, -p);
+    } else {
+        constexpr auto factor = splitFactor<dtype>();
+        auto ca = factor * a;
+        auto ah = ca - (ca - a);
+        auto al = a - ah;
+        auto cb = factor * b;
+        auto bh = cb - (cb - b);
+        auto bl = b - bh;
+        e = al * bl - (((p - ah * bh) - al * bh) - ah * bl);
+    }
+}
+
+// tile sizes of the compensated matrix product: a (kBlock x jBlock) panel of B stays cache resident while
+// all iBlock rows of the output tile are accumulated against it.
+static constexpr std::size_t iBlock = 32;
+static constexpr std::size_t jBlock = 128;
+static constexpr std::size_t kBlock = 256;
+
+/**
+ * Computes C = A B for row-major A (n x m), B (m x l), and C (n x l) with algorithm Dot2 of Ogita, Rump, and Oishi,
+ * i.e., as if evaluated in twice the working precision and rounded back. Output tiles are distributed over threads,
+ * the innermost loop runs along rows of B and C and carries an independent (sum, compensation) pair per column.
+ */
+template<typename dtype>
+void kdotImpl(const dtype *const A, const dtype *const B, dtype *const C,
+              std::size_t n, std::size_t m, std::size_t l) {
+    auto nTilesI = (n + iBlock - 1) / iBlock;
+    auto nTilesJ = (l + jBlock - 1) / jBlock;
+
+    #pragma omp parallel default(none) firstprivate(A, B, C, n, m, l, nTilesI, nTilesJ)
+    {
+        std::vector<dtype> compensation(iBlock * jBlock);
+
+        #pragma omp for collapse(2) schedule(dynamic)
+        for (std::size_t tileI = 0; tileI < nTilesI; ++tileI) {
+            for (std::size_t tileJ = 0; tileJ < nTilesJ; ++tileJ) {
+                auto i0 = tileI * iBlock;
+                auto i1 = std::min(i0 + iBlock, n);
+                auto j0 = tileJ * jBlock;
+                auto width = std::min(j0 + jBlock, l) - j0;
+
+                for (auto i = i0; i < i1; ++i) {
+                    std::fill(C + i * l + j0, C + i * l + j0 + width, static_cast<dtype>(0));
+                }
+                std::fill(compensation.begin(), compensation.end(), static_cast<dtype>(0));
+
+                for (std::size_t k0 = 0; k0 < m; k0 += kBlock) {
+                    auto k1 = std::min(k0 + kBlock, m);
+                    for (auto i = i0; i < i1; ++i) {
+                        auto *const sum = C + i * l + j0;
+                        auto *const err = compensation.data() + (i - i0) * jBlock;
+                        for (auto k = k0; k < k1; ++k) {
+                            const auto a = A[i * m + k];
+                            const auto *const b = B + k * l + j0;
+
+                            #pragma omp simd
+                            for (std::size_t j = 0; j < width; ++j) {
+                                dtype p, pErr, s, sErr;
+                                twoProduct(a, b[j], p, pErr);
+                                twoSum(sum[j], p, s, sErr);
+                                sum[j] = s;
+                                err[j] += pErr + sErr;
+                            }
+                        }
+                    }
+                }
+
+                for (auto i = i0; i < i1; ++i) {
+                    auto *const sum = C + i * l + j0;
+                    const auto *const err = compensation.data() + (i - i0) * jBlock;
+                    #pragma omp simd
+                    for (std::size_t j = 0; j < width; ++j) {
+                        sum[j] += err[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Running compensated sum, i.e., algorithm Sum2 of Ogita, Rump, and Oishi. The rounding error of every addition is
+ * captured exactly by TwoSum and accumulated separately, two partial sums are merged in the same way.
+ */
+template<typename dtype>
+struct CompensatedSum {
+    dtype sum{0};
+    dtype err{0};
+
+    void add(dtype x) {
+        dtype s, e;
+        twoSum(sum, x, s, e);
+        sum = s;
+        err += e;
+    }
+
+    void merge(const CompensatedSum &other) {
+        dtype s, e;
+        twoSum(sum, other.sum, s, e);
+        sum = s;
+        err += e + other.err;
+    }
+
+    dtype value() const {
+        return sum + err;
+    }
+};
+
+/**
+ * Merges partial sums pairwise in a binary tree, the result is stored in the first element.
+ */
+template<typename dtype>
+void treeReduce(CompensatedSum<dtype> *partials, std::size_t n) {
+    for (std::size_t width = 1; width < n; width *= 2) {
+        for (std::size_t i = 0; i + width < n; i += 2 * width) {
+            partials[i].merge(partials[i + width]);
+        }
+    }
+}
+
+// number of independent (sum, compensation) lanes in the line kernel, enough to fill the vector registers
+static constexpr std::size_t nLanes = 8;
+// minimal number of elements a thread works on when a reduction is split up
+static constexpr std::size_t minChunk = 1 << 14;
+
+/**
+ * Compensated sum of n elements starting at x that are stride elements apart. Consecutive elements go to different
+ * lanes, so that the loop vectorizes; the lanes are merged with a TwoSum tree reduction.
+ */
+template<typename dtype>
+CompensatedSum<dtype> sumLine(const dtype *const x, std::size_t n, std::ptrdiff_t stride) {
+    dtype sum[nLanes] = {};
+    dtype err[nLanes] = {};
+    auto nBlocks = n / nLanes;
+    for (std::size_t block = 0; block < nBlocks; ++block) {
+        const auto *const xb = x + static_cast<std::ptrdiff_t>(block * nLanes) * stride;
+        #pragma omp simd
+        for (std::size_t lane = 0; lane < nLanes; ++lane) {
+            dtype s, e;
+            twoSum(sum[lane], xb[static_cast<std::ptrdiff_t>(lane) * stride], s, e);
+            sum[lane] = s;
+            err[lane] += e;
+        }
+    }
+    CompensatedSum<dtype> partials[nLanes];
+    for (std::size_t lane = 0; lane < nLanes; ++lane) {
+        partials[lane].sum = sum[lane];
+        partials[lane].err = err[lane];
+    }
+    for (auto i = nBlocks * nLanes; i < n; ++i) {
+        partials[i - nBlocks * nLanes].add(x[static_cast<std::ptrdiff_t>(i) * stride]);
+    }
+    treeReduce(partials, nLanes);
+    return partials[0];
+}
+
+/**
+ * Accumulates rows [begin, end) of a (n x width) strided block into one (sum, compensation) pair per column. The inner
+ * loop runs along the columns, which makes column sums of row-major arrays vectorize.
+ */
 template<typename dtype>
-auto ksum(const dtype* const begin, const dtype* const end) -> dtype {
-    auto n = std::distance(begin, end);
-    dtype sum {0};
-    ssize_t o {0};
-    dtype correction {0};
+void sumColumns(const dtype *const x, std::size_t begin, std::size_t end, std::ptrdiff_t rowStride,
+                std::size_t width, std::ptrdiff_t colStride, dtype *const sum, dtype *const err) {
+    std::fill(sum, sum + width, static_cast<dtype>(0));
+    std::fill(err, err + width, static_cast<dtype>(0));
+    for (auto row = begin; row < end; ++row) {
+        const auto *const xr = x + static_cast<std::ptrdiff_t>(row) * rowStride;
+        #pragma omp simd
+        for (std::size_t j = 0; j < width; ++j) {
+            dtype s, e;
+            twoSum(sum[j], xr[static_cast<std::ptrdiff_t>(j) * colStride], s, e);
+            sum[j] = s;
+            err[j] += e;
+        }
+    }
+}
 
-    while (n--) {
-        auto y = begin[o] - correction;
-        auto t = sum + y;
-        correction = (t - sum) - y;
-        sum = t;
-        ++o;
+inline std::size_t maxThreads() {
+    #ifdef USE_OPENMP
+    return static_cast<std::size_t>(omp_get_max_threads());
+    #else
+    return 1;
+    #endif
+}
+
+/**
+ * Offset (in elements) of the flat index'th element of the sub-grid spanned by the given dimensions.
+ */
+inline std::ptrdiff_t offset(std::size_t index, const std::vector<std::size_t> &shape,
+                             const std::vector<std::ptrdiff_t> &strides) {
+    std::ptrdiff_t result = 0;
+    for (auto d = shape.size(); d-- > 0;) {
+        result += static_cast<std::ptrdiff_t>(index % shape[d]) * strides[d];
+        index /= shape[d];
     }
+    return result;
+}
 
-    return sum;
+/**
+ * Number of pieces a reduction of the given length is split into when there are only nGroups independent
+ * reductions: just enough to give every thread work, but never pieces shorter than minLength.
+ */
+inline std::size_t nPieces(std::size_t length, std::size_t nGroups, std::size_t minLength) {
+    auto nThreads = maxThreads();
+    if (nGroups >= nThreads || length == 0) {
+        return 1;
+    }
+    auto wanted = (nThreads + nGroups - 1) / nGroups;
+    auto possible = std::max(static_cast<std::size_t>(1), length / std::max(minLength, static_cast<std::size_t>(1)));
+    return std::min(wanted, possible);
 }
 
+/**
+ * Reduces along the given axis of a strided n-dimensional array. Depending on the memory layout either every output is
+ * a vectorized line reduction (the reduced axis is the innermost one) or a whole row of outputs is accumulated at once
+ * (an outer axis is reduced). If there are fewer independent reductions than threads, the reduced axis itself is split
+ * and the pieces are merged afterwards with TwoSum.
+ */
 template<typename dtype>
-auto ksumArr(const np_array_nfc<dtype> &Xarr) -> dtype {
-    return ksum(Xarr.data(), Xarr.data() + Xarr.size());
+void ksumAxis(const dtype *const data, const std::vector<std::size_t> &shape,
+              const std::vector<std::ptrdiff_t> &strides, std::size_t axis, dtype *const out) {
+    auto axisLength = shape[axis];
+    auto axisStride = strides[axis];
+
+    std::vector<std::size_t> outShape;
+    std::vector<std::ptrdiff_t> outStrides;
+    for (std::size_t d = 0; d < shape.size(); ++d) {
+        if (d != axis) {
+            outShape.push_back(shape[d]);
+            outStrides.push_back(strides[d]);
+        }
+    }
+    auto nOut = std::accumulate(outShape.begin(), outShape.end(), static_cast<std::size_t>(1),
+                                std::multiplies<>());
+    if (nOut == 0) {
+        return;
+    }
+
+    auto innerStride = outStrides.empty() ? std::numeric_limits<std::ptrdiff_t>::max() : outStrides.back();
+    if (std::abs(axisStride) <= std::abs(innerStride)) {
+        // every output element is a line reduction along the axis
+        auto pieces = nPieces(axisLength, nOut, minChunk);
+        auto pieceLength = (axisLength + pieces - 1) / pieces;
+        std::vector<CompensatedSum<dtype>> partials(nOut * pieces);
+        auto *partialsPtr = partials.data();
+        auto nItems = static_cast<std::int64_t>(nOut * pieces);
+
+        #pragma omp parallel for default(none) firstprivate(data, axisLength, axisStride, pieces, pieceLength, nItems, partialsPtr) shared(outShape, outStrides)
+        for (std::int64_t item = 0; item < nItems; ++item) {
+            auto o = static_cast<std::size_t>(item) / pieces;
+            auto begin = std::min((static_cast<std::size_t>(item) % pieces) * pieceLength, axisLength);
+            auto end = std::min(begin + pieceLength, axisLength);
+            const auto *const line = data + offset(o, outShape, outStrides) + static_cast<std::ptrdiff_t>(begin) * axisStride;
+            partialsPtr[item] = sumLine(line, end - begin, axisStride);
+        }
+
+        for (std::size_t o = 0; o < nOut; ++o) {
+            treeReduce(partialsPtr + o * pieces, pieces);
+            out[o] = partialsPtr[o * pieces].value();
+        }
+    } else {
+        // the reduced axis is an outer one: accumulate contiguous rows of outputs at once
+        auto width = outShape.back();
+        outShape.pop_back();
+        outStrides.pop_back();
+        auto nRows = nOut / width;
+        auto pieces = nPieces(axisLength, nRows, std::max(static_cast<std::size_t>(1), minChunk / width));
+        auto pieceLength = (axisLength + pieces - 1) / pieces;
+        std::vector<dtype> sums(nRows * pieces * width);
+        std::vector<dtype> errs(nRows * pieces * width);
+        auto *sumsPtr = sums.data();
+        auto *errsPtr = errs.data();
+        auto nItems = static_cast<std::int64_t>(nRows * pieces);
+
+        #pragma omp parallel for default(none) firstprivate(data, axisLength, axisStride, innerStride, width, pieces, pieceLength, nItems, sumsPtr, errsPtr) shared(outShape, outStrides)
+        for (std::int64_t item = 0; item < nItems; ++item) {
+            auto row = static_cast<std::size_t>(item) / pieces;
+            auto begin = std::min((static_cast<std::size_t>(item) % pieces) * pieceLength, axisLength);
+            auto end = std::min(begin + pieceLength, axisLength);
+            sumColumns(data + offset(row, outShape, outStrides), begin, end, axisStride, width, innerStride,
+                       sumsPtr + item * width, errsPtr + item * width);
+        }
+
+        std::vector<CompensatedSum<dtype>> partials(pieces);
+        for (std::size_t row = 0; row < nRows; ++row) {
+            for (std::size_t j = 0; j < width; ++j) {
+                for (std::size_t piece = 0; piece < pieces; ++piece) {
+                    partials[piece].sum = sums[(row * pieces + piece) * width + j];
+                    partials[piece].err = errs[(row * pieces + piece) * width + j];
+                }
+                treeReduce(partials.data(), pieces);
+                out[row * width + j] = partials[0].value();
+            }
+        }
+    }
+}
+
+/**
+ * Compensated sum over all elements of a strided n-dimensional array. C-contiguous input is treated as one long line
+ * that is split up between threads, otherwise the lines along the last axis are distributed.
+ */
+template<typename dtype>
+dtype ksumAll(const dtype *const data, const std::vector<std::size_t> &shape,
+              const std::vector<std::ptrdiff_t> &strides) {
+    if (shape.empty()) {
+        return *data;
+    }
+    auto size = std::accumulate(shape.begin(), shape.end(), static_cast<std::size_t>(1), std::multiplies<>());
+    if (size == 0) {
+        return 0;
+    }
+    bool contiguous = true;
+    {
+        std::ptrdiff_t expected = 1;
+        for (auto d = shape.size(); d-- > 0;) {
+            contiguous &= shape[d] == 1 || strides[d] == expected;
+            expected *= static_cast<std::ptrdiff_t>(shape[d]);
+        }
+    }
+    dtype result;
+    if (contiguous) {
+        std::vector<std::size_t> flatShape{size};
+        std::vector<std::ptrdiff_t> flatStrides{1};
+        ksumAxis(data, flatShape, flatStrides, 0, &result);
+    } else {
+        // sum up every line along the last axis, then the line sums
+        std::vector<std::size_t> outerShape(shape.begin(), shape.end() - 1);
+        auto nLines = size / shape.back();
+        std::vector<dtype> lineSums(nLines);
+        ksumAxis(data, shape, strides, shape.size() - 1, lineSums.data());
+        std::vector<std::size_t> flatShape{nLines};
+        std::vector<std::ptrdiff_t> flatStrides{1};
+        ksumAxis(lineSums.data(), flatShape, flatStrides, 0, &result);
+    }
+    return result;
+}
+
+}
+
+template<typename dtype>
+auto ksum(const np_array_strided<dtype> &arr, const py::object &axis) -> py::object {
+    std::vector<std::size_t> shape;
+    std::vector<std::ptrdiff_t> strides;
+    for (decltype(arr.ndim()) d = 0; d < arr.ndim(); ++d) {
+        shape.push_back(static_cast<std::size_t>(arr.shape(d)));
+        strides.push_back(static_cast<std::ptrdiff_t>(arr.strides(d) / static_cast<py::ssize_t>(sizeof(dtype))));
+    }
+    const auto *data = arr.data();
+
+    if (axis.is_none()) {
+        dtype result;
+        {
+            py::gil_scoped_release gil;
+            result = kahan::ksumAll(data, shape, strides);
+        }
+        return py::cast(result);
+    }
+
+    auto ax = py::cast<py::ssize_t>(axis);
+    if (ax < 0) {
+        ax += arr.ndim();
+    }
+    if (ax < 0 || ax >= arr.ndim()) {
+        throw std::invalid_argument("axis " + std::to_string(py::cast<py::ssize_t>(axis))
+                                    + " is out of bounds for array of dimension " + std::to_string(arr.ndim()));
+    }
+    std::vector<py::ssize_t> outShape;
+    for (decltype(arr.ndim()) d = 0; d < arr.ndim(); ++d) {
+        if (d != ax) outShape.push_back(arr.shape(d));
+    }
+    np_array<dtype> out(outShape);
+    auto *outPtr = out.mutable_data();
+    {
+        py::gil_scoped_release gil;
+        kahan::ksumAxis(data, shape, strides, static_cast<std::size_t>(ax), outPtr);
+    }
+    return std::move(out);
 }
 
 template<typename dtype>
 auto kdot(const np_array_nfc<dtype> &arrA, const np_array_nfc<dtype> &arrB) -> np_array<dtype> {
+    if (arrA.ndim() != 2 || arrB.ndim() != 2) {
+        throw std::invalid_argument("Both A and B must be two-dimensional.");
+    }
     auto n = arrA.shape(0);
     auto m = arrA.shape(1);
     auto l = arrB.shape(1);
@@ -37,36 +456,27 @@ auto kdot(const np_array_nfc<dtype> &arrA, const np_array_nfc<dtype> &arrB) -> n
         throw std::invalid_argument("Shape mismatch, A.shape[1] must match B.shape[0].");
     }
 
-    auto A = arrA.template unchecked<2>();
-    auto B = arrB.template unchecked<2>();
-
     auto Carr = np_array<dtype>({n, l});
 
-    auto C = Carr.template mutable_unchecked<2>();
-
-    for (ssize_t i = 0; i < n; ++i) {
-        for (ssize_t j = 0; j < l; ++j) {
-            dtype err{0};
-            dtype sum{0};
-            for (ssize_t k = 0; k < m; ++k) {
-                auto y = A(i, k) * B(k, j) - err;
-                auto t = sum + y;
-                err = (t - sum) - y;
-                sum = t;
-            }
-            C(i, j) = sum;
-        }
+    const auto *A = arrA.data();
+    const auto *B = arrB.data();
+    auto *C = Carr.mutable_data();
+    {
+        py::gil_scoped_release gil;
+        kahan::kdotImpl(A, B, C, static_cast<std::size_t>(n), static_cast<std::size_t>(m),
+                        static_cast<std::size_t>(l));
     }
 
     return Carr;
 }
 
+using namespace pybind11::literals;
 
 PYBIND11_MODULE(kahandot, m) {
     m.def("kdot", &kdot<float>);
     m.def("kdot", &kdot<double>);
     m.def("kdot", &kdot<long double>);
-    m.def("ksum", &ksumArr<float>);
-    m.def("ksum", &ksumArr<double>);
-    m.def("ksum", &ksumArr<long double>);
+    m.def("ksum", &ksum<float>, "x"_a, "axis"_a = py::none());
+    m.def("ksum", &ksum<double>, "x"_a, "axis"_a = py::none());
+    m.def("ksum", &ksum<long double>, "x"_a, "axis"_a = py::none());
 }
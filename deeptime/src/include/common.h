@@ -11,6 +11,8 @@ template<typename dtype>
 using np_array = py::array_t<dtype, py::array::c_style | py::array::forcecast>;
 template<typename dtype>
 using np_array_nfc = py::array_t<dtype, py::array::c_style>;
+template<typename dtype>
+using np_array_strided = py::array_t<dtype, 0>;
 
 namespace detail {
 template<typename T1, typename... T>
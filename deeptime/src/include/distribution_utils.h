@@ -1,20 +1,167 @@
 #pragma once
 
-#include <thread>
-#include <random>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <ctime>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "common.h"
 
 namespace deeptime {
 namespace rnd {
 
-template<typename Generator = std::mt19937>
+/**
+ * Counter-based Philox4x32-10 generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", 2011). The
+ * n-th output block is a bijective scrambling of the counter (n, substream, stream) under a 64 bit key derived from
+ * the seed, so that every (seed, stream, substream) triple addresses its own sequence of 2^66 random numbers without
+ * any state shared between threads, chains or chunks of work.
+ */
+class Philox4x32 {
+public:
+    using result_type = std::uint32_t;
+
+    static constexpr std::uint64_t default_seed = 20111115u;
+
+    static constexpr result_type min() { return 0; }
+
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    explicit Philox4x32(std::uint64_t seed = default_seed, std::uint32_t stream = 0, std::uint32_t substream = 0) {
+        this->seed(seed, stream, substream);
+    }
+
+    template<typename SeedSeq, typename = std::enable_if_t<!std::is_convertible_v<SeedSeq, std::uint64_t>>>
+    explicit Philox4x32(SeedSeq &seq) {
+        seed(seq);
+    }
+
+    void seed(std::uint64_t seed = default_seed, std::uint32_t stream = 0, std::uint32_t substream = 0) {
+        key = {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)};
+        counter = {0, 0, substream, stream};
+        position = output.size();
+    }
+
+    template<typename SeedSeq, typename = std::enable_if_t<!std::is_convertible_v<SeedSeq, std::uint64_t>>>
+    void seed(SeedSeq &seq) {
+        std::array<std::uint32_t, 4> words {};
+        seq.generate(words.begin(), words.end());
+        seed(static_cast<std::uint64_t>(words[1]) << 32 | words[0], words[2], words[3]);
+    }
+
+    result_type operator()() {
+        if (position == output.size()) {
+            generateBlock();
+            position = 0;
+        }
+        return output[position++];
+    }
+
+    void discard(unsigned long long n) {
+        const auto available = static_cast<unsigned long long>(output.size() - position);
+        if (n <= available) {
+            position += static_cast<std::size_t>(n);
+            return;
+        }
+        n -= available;
+        skipBlocks((n - 1) / output.size());
+        generateBlock();
+        position = 1 + static_cast<std::size_t>((n - 1) % output.size());
+    }
+
+    /**
+     * The raw Philox4x32-10 bijection of one counter block under a key.
+     */
+    static std::array<std::uint32_t, 4> block(std::array<std::uint32_t, 4> ctr, std::array<std::uint32_t, 2> k) {
+        for (int round = 0; round < 10; ++round) {
+            if (round > 0) {
+                k[0] += 0x9E3779B9u;
+                k[1] += 0xBB67AE85u;
+            }
+            const auto p0 = static_cast<std::uint64_t>(0xD2511F53u) * ctr[0];
+            const auto p1 = static_cast<std::uint64_t>(0xCD9E8D57u) * ctr[2];
+            ctr = {static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ k[0], static_cast<std::uint32_t>(p1),
+                   static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ k[1], static_cast<std::uint32_t>(p0)};
+        }
+        return ctr;
+    }
+
+    friend bool operator==(const Philox4x32 &lhs, const Philox4x32 &rhs) {
+        return lhs.key == rhs.key && lhs.counter == rhs.counter && lhs.position == rhs.position
+               && (lhs.position == lhs.output.size() || lhs.output == rhs.output);
+    }
+
+    friend bool operator!=(const Philox4x32 &lhs, const Philox4x32 &rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    void generateBlock() {
+        output = block(counter, key);
+        skipBlocks(1);
+    }
+
+    void skipBlocks(std::uint64_t n) {
+        auto blockIndex = (static_cast<std::uint64_t>(counter[1]) << 32 | counter[0]) + n;
+        counter[0] = static_cast<std::uint32_t>(blockIndex);
+        counter[1] = static_cast<std::uint32_t>(blockIndex >> 32);
+    }
+
+    std::array<std::uint32_t, 2> key {};
+    std::array<std::uint32_t, 4> counter {};
+    std::array<std::uint32_t, 4> output {};
+    std::size_t position {4};
+};
+
+template<typename Generator = Philox4x32>
 Generator seededGenerator(std::uint32_t seed) {
     return Generator{seed};
 }
 
-template<typename Generator = std::mt19937>
+/**
+ * Generator for stream `stream` of a seed, e.g., for one of several chains or threads that should draw independent
+ * random numbers. Stream 0 coincides with seededGenerator(seed). For Philox4x32 the streams are disjoint by
+ * construction, other generators are seeded through a seed sequence.
+ */
+template<typename Generator = Philox4x32>
+Generator seededGenerator(std::uint32_t seed, std::uint32_t stream) {
+    if constexpr (std::is_same_v<Generator, Philox4x32>) {
+        return Philox4x32{seed, stream};
+    } else {
+        if (stream == 0) {
+            return seededGenerator<Generator>(seed);
+        }
+        std::seed_seq seq{seed, stream};
+        return Generator(seq);
+    }
+}
+
+/**
+ * Generator for substream `substream` of stream `stream`, e.g., for fixed-size chunks of work inside one stream. The
+ * chunk-to-substream assignment does not depend on the thread count, hence neither do the results.
+ */
+inline Philox4x32 seededGenerator(std::uint64_t seed, std::uint32_t stream, std::uint32_t substream) {
+    return Philox4x32{seed, stream, substream};
+}
+
+/**
+ * A seed drawn from the random device, e.g., to derive several streams from one random seed.
+ */
+inline std::uint64_t randomSeed() {
+    std::random_device r;
+    auto clck = static_cast<std::uint64_t>(clock());
+    auto threadId = static_cast<std::uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    return ((static_cast<std::uint64_t>(r()) << 32) | r()) ^ (threadId * 0x9E3779B97F4A7C15u) ^ clck;
+}
+
+template<typename Generator = Philox4x32>
 Generator randomlySeededGenerator() {
     std::random_device r;
     std::random_device::result_type threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
@@ -23,56 +170,554 @@ Generator randomlySeededGenerator() {
     return Generator(seed);
 }
 
-template<typename Generator = std::mt19937>
+template<typename Generator = Philox4x32>
 Generator &staticThreadLocalGenerator() {
     static thread_local Generator generator(randomlySeededGenerator<Generator>());
     return generator;
 }
 
+/**
+ * The next 64 (or 32) random bits of a generator which produces 32 or 64 random bits per call. Independent of the
+ * standard library implementation, unlike std::generate_canonical.
+ */
+template<typename Generator>
+std::uint64_t bits64(Generator &generator) {
+    static_assert(Generator::min() == 0, "Generator must produce random bits.");
+    if constexpr (Generator::max() == std::numeric_limits<std::uint64_t>::max()) {
+        return static_cast<std::uint64_t>(generator());
+    } else {
+        static_assert(Generator::max() == std::numeric_limits<std::uint32_t>::max(),
+                      "Generator must produce 32 or 64 random bits.");
+        auto high = static_cast<std::uint64_t>(generator());
+        return (high << 32) | static_cast<std::uint64_t>(generator());
+    }
+}
+
+template<typename Generator>
+std::uint32_t bits32(Generator &generator) {
+    static_assert(Generator::min() == 0, "Generator must produce random bits.");
+    if constexpr (Generator::max() == std::numeric_limits<std::uint64_t>::max()) {
+        return static_cast<std::uint32_t>(static_cast<std::uint64_t>(generator()) >> 32);
+    } else {
+        static_assert(Generator::max() == std::numeric_limits<std::uint32_t>::max(),
+                      "Generator must produce 32 or 64 random bits.");
+        return static_cast<std::uint32_t>(generator());
+    }
+}
+
+/**
+ * Uniform random number in [0, 1) with as many random mantissa bits as RealType holds (at most 64).
+ */
+template<typename RealType, typename Generator>
+RealType uniform01(Generator &generator) {
+    constexpr int digits = std::min(std::numeric_limits<RealType>::digits, 64);
+    constexpr auto scale = static_cast<RealType>(1) / (static_cast<RealType>(std::uint64_t {1} << (digits - 1)) * 2);
+    if constexpr (digits <= 32) {
+        return static_cast<RealType>(bits32(generator) >> (32 - digits)) * scale;
+    } else {
+        return static_cast<RealType>(bits64(generator) >> (64 - digits)) * scale;
+    }
+}
+
+/**
+ * Uniform distribution on [a, b) based on uniform01.
+ */
+template<typename RealType = double>
+class uniform_real_distribution {
+public:
+    using result_type = RealType;
+
+    explicit uniform_real_distribution(RealType a = 0, RealType b = 1) : lower(a), width(b - a) {}
+
+    template<typename Generator>
+    result_type operator()(Generator &generator) const {
+        return lower + width * uniform01<RealType>(generator);
+    }
+
+    RealType a() const { return lower; }
+
+    RealType b() const { return lower + width; }
+
+private:
+    RealType lower, width;
+};
+
+namespace detail {
+
+/**
+ * Tables of the 256-layer ziggurat for the standard normal distribution (Marsaglia and Tsang, 2000). Layer 0 is the
+ * base strip including the tail, layer i > 0 spans [0, x_i] with x_i increasing in i. k holds the rectangle
+ * thresholds in units of 2^-52, w the layer widths in units of 2^-52, and f the density exp(-x_i^2 / 2). The tables
+ * are literals, generated once with the recurrence x_i = sqrt(-2 log(area / x_(i+1) + f(x_(i+1)))) from x_255 = r in
+ * double precision, so they do not depend on the C library they are compiled against.
+ */
+struct ZigguratNormal {
+    static constexpr int nLayers = 256;
+    static constexpr double r = 3.6541528853610087963519472518;
+    static constexpr double invR = 0.27366123732975827203338247596;
+    static constexpr double area = 4.92867323399e-3;
+
+    static constexpr std::uint64_t k[nLayers] = {
+            4208095142460473u, 0u, 3387314423377066u, 3838760076329526u,
+            4030768804284853u, 4136731738831425u, 4203757248061980u, 4249917568175232u,
+            4283617341567279u, 4309289223118741u, 4329489775160291u, 4345795907381542u,
+            4359232558735043u, 4370494503729112u, 4380069246208637u, 4388308869036326u,
+            4395473957544017u, 4401761481779246u, 4407323076017087u, 4412277362214489u,
+            4416718463609856u, 4420722014513400u, 4424349484774333u, 4427651345406786u,
+            4430669422002933u, 4433438668973077u, 4435988524276394u, 4438343955928258u,
+            4440526279075747u, 4442553800233099u, 4444442329864404u, 4446205593656774u,
+            4447855565092038u, 4449402736338919u, 4450856340407494u, 4452224534495418u,
+            4453514552209504u, 4454732830655845u, 4455885117108466u, 4456976558984185u,
+            4458011780093629u, 4458994945549610u, 4459929817253382u, 4460819801516491u,
+            4461667990088497u, 4462477195631624u, 4463249982499768u, 4463988693531267u,
+            4464695473444936u, 4465372289331327u, 4466020948651398u, 4466643115089263u,
+            4467240322551661u, 4467813987562078u, 4468365420260224u, 4468895834186563u,
+            4469406355005624u, 4469898028299962u, 4470371826548245u, 4470828655385394u,
+            4471269359229479u, 4471694726348839u, 4472105493433334u, 4472502349725409u,
+            4472885940759615u, 4473256871753215u, 4473615710685231u, 4473962991096833u,
+            4474299214642012u, 4474624853414143u, 4474940352071037u, 4475246129778548u,
+            4475542581990524u, 4475830082080948u, 4476108982842370u, 4476379617863191u,
+            4476642302795094u, 4476897336520643u, 4477145002230123u, 4477385568415673u,
+            4477619289790061u, 4477846408136603u, 4478067153096183u, 4478281742896694u,
+            4478490385029730u, 4478693276878899u, 4478890606303726u, 4479082552182711u,
+            4479269284918826u, 4479450966910420u, 4479627752990208u, 4479799790834828u,
+            4479967221347196u, 4480130179013718u, 4480288792238217u, 4480443183654313u,
+            4480593470417794u, 4480739764480445u, 4480882172846633u, 4481020797813872u,
+            4481155737198477u, 4481287084547321u, 4481414929336655u, 4481539357158847u,
+            4481660449897836u, 4481778285894042u, 4481892940099419u, 4482004484223265u,
+            4482112986869377u, 4482218513665090u, 4482321127382689u, 4482420888053648u,
+            4482517853076137u, 4482612077316170u, 4482703613202767u, 4482792510817473u,
+            4482878817978526u, 4482962580319976u, 4483043841366027u, 4483122642600828u,
+            4483199023533961u, 4483273021761828u, 4483344673025133u, 4483414011262633u,
+            4483481068661338u, 4483545875703290u, 4483608461209084u, 4483668852378237u,
+            4483727074826540u, 4483783152620481u, 4483837108308851u, 4483888962951605u,
+            4483938736146064u, 4483986446050518u, 4484032109405295u, 4484075741551344u,
+            4484117356446376u, 4484156966678588u, 4484194583478007u, 4484230216725477u,
+            4484263874959273u, 4484295565379379u, 4484325293849403u, 4484353064896116u,
+            4484378881706606u, 4484402746123007u, 4484424658634767u, 4484444618368408u,
+            4484462623074730u, 4484478669113370u, 4484492751434676u, 4484504863558768u,
+            4484514997551725u, 4484523143998772u, 4484529291974333u, 4484533429008846u,
+            4484535541052160u, 4484535612433364u, 4484533625816867u, 4484529562154522u,
+            4484523400633580u, 4484515118620234u, 4484504691598498u, 4484492093104109u,
+            4484477294653176u, 4484460265665197u, 4484440973380099u, 4484419382768864u,
+            4484395456437316u, 4484369154522569u, 4484340434581588u, 4484309251471307u,
+            4484275557219628u, 4484239300886605u, 4484200428415063u, 4484158882469765u,
+            4484114602264222u, 4484067523374110u, 4484017577536167u, 4483964692431316u,
+            4483908791450666u, 4483849793442839u, 4483787612440988u, 4483722157367614u,
+            4483653331715151u, 4483581033200037u, 4483505153387718u, 4483425577285788u,
+            4483342182902111u, 4483254840764426u, 4483163413397502u, 4483067754753491u,
+            4482967709590519u, 4482863112794028u, 4482753788634647u, 4482639549955592u,
+            4482520197281676u, 4482395517841033u, 4482265284489366u, 4482129254525262u,
+            4481987168383444u, 4481838748191032u, 4481683696169739u, 4481521692864423u,
+            4481352395175528u, 4481175434169523u, 4480990412637465u, 4480796902367093u,
+            4480594441088291u, 4480382529045184u, 4480160625140269u, 4479928142586622u,
+            4479684443993020u, 4479428835793358u, 4479160561915410u, 4478878796564346u,
+            4478582635972352u, 4478271088936365u, 4477943065929917u, 4477597366530497u,
+            4477232664848663u, 4476847492576150u, 4476440219183740u, 4476009028690393u,
+            4475551892286383u, 4475066535915605u, 4474550401693464u, 4474000601739862u,
+            4473413862618157u, 4472786458058253u, 4472114126958961u, 4471391972746450u,
+            4470614338917675u, 4469774653883112u, 4468865235838851u, 4467877045039485u,
+            4466799366045308u, 4465619395558350u, 4464321701199587u, 4462887501169234u,
+            4461293691124291u, 4459511507635920u, 4457504658253014u, 4455226650324954u,
+            4452616884242290u, 4449594783440737u, 4446050695647601u, 4441831266659550u,
+            4436714892173985u, 4430368316897255u, 4422264825074646u, 4411517007702021u,
+            4396496531309840u, 4373832704204105u, 4335125104963354u, 4251099761678858u,
+    };
+    static constexpr double w[nLayers] = {
+            8.6836270608283473e-16, 4.7793301741377593e-17, 6.3543524164102585e-17, 7.4548704804935243e-17,
+            8.3293668151732831e-17, 9.0680604045268064e-17, 9.7148600760968464e-17, 1.0294750313816509e-16,
+            1.0823430288059529e-16, 1.1311470195750259e-16, 1.1766359456688471e-16, 1.2193617278400444e-16,
+            1.259743991434077e-16, 1.2981099885983e-16, 1.3347203736556521e-16, 1.3697864842315511e-16,
+            1.4034823000997335e-16, 1.4359529451821483e-16, 1.4673208742137644e-16, 1.4976904668172175e-16,
+            1.5271515003384589e-16, 1.555781816925582e-16, 1.58364940090921e-16, 1.6108140175081854e-16,
+            1.6373285203782087e-16, 1.6632399058238027e-16, 1.6885901708498422e-16, 1.713417017638584e-16,
+            1.7377544365695136e-16, 1.7616331922835133e-16, 1.785081231681451e-16, 1.8081240285640384e-16,
+            1.8307848764671256e-16, 1.8530851388465636e-16, 1.8750444639224454e-16, 1.8966809700628152e-16,
+            1.9180114064694707e-16, 1.9390512930483762e-16, 1.9598150426489938e-16, 1.9803160682991647e-16,
+            2.0005668776139063e-16, 2.0205791561939557e-16, 2.04036384153502e-16, 2.0599311887275701e-16,
+            2.0792908290287945e-16, 2.0984518222246143e-16, 2.117422703563793e-16, 2.136211525932919e-16,
+            2.1548258978462456e-16, 2.1732730177446985e-16, 2.1915597050311459e-16, 2.2096924282121024e-16,
+            2.2276773304676732e-16, 2.2455202529302963e-16, 2.2632267559175672e-16, 2.280802138334151e-16,
+            2.298251455431733e-16, 2.3155795350934717e-16, 2.3327909927899507e-16, 2.3498902453367309e-16,
+            2.3668815235689126e-16, 2.3837688840352904e-16, 2.4005562198034833e-16, 2.417247270457588e-16,
+            2.4338456313612944e-16, 2.4503547622517899e-16, 2.4667779952231006e-16, 2.4831185421515809e-16,
+            2.4993795016110418e-16, 2.5155638653203404e-16, 2.5316745241621325e-16, 2.5477142738078082e-16,
+            2.5636858199803476e-16, 2.5795917833839038e-16, 2.5954347043262911e-16, 2.6112170470582226e-16,
+            2.6269412038510092e-16, 2.6426094988325525e-16, 2.6582241915997472e-16, 2.6737874806238796e-16,
+            2.6893015064642062e-16, 2.7047683548036584e-16, 2.7201900593194673e-16, 2.7355686044004848e-16,
+            2.7509059277220414e-16, 2.7662039226883326e-16, 2.7814644407515529e-16, 2.796689293616304e-16,
+            2.8118802553371588e-16, 2.8270390643166804e-16, 2.8421674252106693e-16, 2.8572670107469254e-16,
+            2.872339463463364e-16, 2.8873863973709251e-16, 2.9024093995463437e-16, 2.9174100316595041e-16,
+            2.9323898314397969e-16, 2.9473503140856054e-16, 2.9622929736207917e-16, 2.9772192842018089e-16,
+            2.9921307013788463e-16, 3.0070286633142165e-16, 3.0219145919609987e-16, 3.0367898942047899e-16,
+            3.051655962971257e-16, 3.0665141783020421e-16, 3.0813659084014336e-16, 3.0962125106561073e-16,
+            3.111055332630125e-16, 3.1258957130372778e-16, 3.1407349826927714e-16, 3.1555744654461717e-16,
+            3.1704154790974445e-16, 3.1852593362978663e-16, 3.2001073454375151e-16, 3.2149608115209942e-16,
+            3.2298210370330056e-16, 3.2446893227953307e-16, 3.2595669688167537e-16, 3.2744552751374234e-16,
+            3.2893555426691273e-16, 3.304269074032927e-16, 3.3191971743955903e-16, 3.3341411523062504e-16,
+            3.3491023205346958e-16, 3.3640819969127209e-16, 3.3790815051799441e-16, 3.3941021758355219e-16,
+            3.4091453469971958e-16, 3.4242123652691249e-16, 3.4393045866199745e-16, 3.4544233772727637e-16,
+            3.4695701146079997e-16, 3.4847461880816654e-16, 3.4999530001596677e-16, 3.5151919672703956e-16,
+            3.5304645207770958e-16, 3.5457721079718259e-16, 3.5611161930928127e-16, 3.5764982583671083e-16,
+            3.5919198050805217e-16, 3.6073823546768767e-16, 3.6228874498887499e-16, 3.6384366559019358e-16,
+            3.6540315615559934e-16, 3.6696737805833569e-16, 3.6853649528896015e-16, 3.7011067458776174e-16,
+            3.7169008558185731e-16, 3.7327490092727252e-16, 3.7486529645633009e-16, 3.764614513306871e-16,
+            3.7806354820038333e-16, 3.7967177336928472e-16, 3.8128631696733099e-16, 3.8290737313002048e-16,
+            3.8453514018559503e-16, 3.8616982085041696e-16, 3.8781162243306366e-16, 3.8946075704770047e-16,
+            3.9111744183733125e-16, 3.9278189920756777e-16, 3.9445435707160414e-16, 3.9613504910713278e-16,
+            3.9782421502599031e-16, 3.9952210085738131e-16, 4.0122895924559053e-16, 4.0294504976316317e-16,
+            4.0467063924060814e-16, 4.0640600211376089e-16, 4.0815142079003244e-16, 4.0990718603486792e-16,
+            4.1167359737984646e-16, 4.134509635539701e-16, 4.1523960293981795e-16, 4.1703984405638332e-16,
+            4.1885202607056557e-16, 4.2067649933945852e-16, 4.2251362598576456e-16, 4.2436378050887008e-16,
+            4.2622735043434475e-16, 4.2810473700487922e-16, 4.299963559159534e-16, 4.3190263809983563e-16,
+            4.3382403056185438e-16, 4.3576099727326276e-16, 4.3771402012543917e-16, 4.3968359995063508e-16,
+            4.4167025761500585e-16, 4.4367453519024474e-16, 4.4569699721079489e-16, 4.4773823202434653e-16,
+            4.4979885324415058e-16, 4.5187950131260395e-16, 4.5398084518660404e-16, 4.5610358415634541e-16,
+            4.5824844981056243e-16, 4.6041620816272361e-16, 4.6260766195439546e-16, 4.648236531539341e-16,
+            4.6706506567087898e-16, 4.6933282830895128e-16, 4.7162791798345608e-16, 4.7395136323221013e-16,
+            4.7630424805293972e-16, 4.7868771610450073e-16, 4.8110297531437273e-16, 4.8355130294078599e-16,
+            4.8603405114471714e-16, 4.8855265313499885e-16, 4.9110862995916812e-16, 4.9370359802367719e-16,
+            4.9633927744004502e-16, 4.990175013088311e-16, 5.0174022607146047e-16, 5.0450954308152693e-16,
+            5.0732769157301095e-16, 5.1019707323381559e-16, 5.1312026863034044e-16, 5.1610005577398766e-16,
+            5.1913943117543745e-16, 5.2224163379969378e-16, 5.2541017241743285e-16, 5.2864885695017039e-16,
+            5.3196183453351877e-16, 5.3535363118133128e-16, 5.3882920013308987e-16, 5.4239397821985875e-16,
+            5.4605395190716861e-16, 5.4981573508897504e-16, 5.5368666124648428e-16, 5.5767489329235749e-16,
+            5.6178955535524476e-16, 5.6604089200794866e-16, 5.7044046212884871e-16, 5.7500137689170287e-16,
+            5.7973859457217636e-16, 5.8466928934526864e-16, 5.8981331764751453e-16, 5.9519381496387295e-16,
+            6.0083796962692351e-16, 6.0677804093308186e-16, 6.1305272087226971e-16, 6.1970898945790904e-16,
+            6.2680469632988015e-16, 6.3441224071250802e-16, 6.4262396595456918e-16, 6.515603317342698e-16,
+            6.6138278850954465e-16, 6.7231504625034587e-16, 6.8468034175622373e-16, 6.9897183363857306e-16,
+            7.1599949348289484e-16, 7.3724243017973336e-16, 7.6589363708045354e-16, 8.1138493376564842e-16,
+    };
+    static constexpr double f[nLayers] = {
+            1, 0.97710170128273133, 0.95987909181241593, 0.94519895345307803,
+            0.93206007596899021, 0.91999150504836025, 0.90872644006056291, 0.89809592190630405,
+            0.88798466076339988, 0.87830965581614684, 0.86900868804379316, 0.86003362120300864,
+            0.85134625846512368, 0.84291565311844108, 0.83471629299293038, 0.82672683395209423,
+            0.8189291916094148, 0.81130787431821993, 0.80384948317638949, 0.79654233042825462,
+            0.78937614357119856, 0.7823418326598619, 0.77543130498613833, 0.76863731580333483,
+            0.76195334684154647, 0.7553735065117545, 0.74889244722372672, 0.74250529634463625,
+            0.73620759813126668, 0.72999526456580244, 0.7238645334728816, 0.7178119326349014,
+            0.71183424888235847, 0.70592850133679741, 0.7000919181404901, 0.69432191613003258,
+            0.68861608300852706, 0.68297216164879138, 0.67738803622251309, 0.67186171990076637,
+            0.66639134391238064, 0.66097514778024136, 0.65561147058322466, 0.65029874311429459,
+            0.64503548082425188, 0.63982027745643899, 0.63465179929096005, 0.62952877992812828,
+            0.62445001555027424, 0.61941436060903921, 0.6144207238920768, 0.60946806492889538,
+            0.60455539070054953, 0.59968175262216772, 0.59484624377099127, 0.59004799633579197,
+            0.58528617926630033, 0.58055999610368347, 0.57586868297521054, 0.57121150673807497,
+            0.56658776325895177, 0.56199677581727792, 0.55743789362148632, 0.55291049042851992,
+            0.54841396325792113, 0.54394773119264994, 0.53951123425954461, 0.53510393238301956,
+            0.53072530440619392, 0.5263748471741867, 0.52205207467479486, 0.51775651723220062,
+            0.51348772074974303, 0.50924524599813614, 0.50502866794582879, 0.50083757512848215,
+            0.49667156905479631, 0.49253026364614866, 0.48841328470771206, 0.4843202694289116,
+            0.48025086591124971, 0.47620473272168379, 0.47218153846988326, 0.46818096140782217,
+            0.46420268905027884, 0.46024641781492348, 0.45631185268077357, 0.4523987068638825,
+            0.44850670150921407, 0.44463556539772775, 0.44078503466776991, 0.43695485254992927,
+            0.43314476911457406, 0.42935454103134152, 0.42558393133990058, 0.4218327092313533,
+            0.41810064983968459, 0.41438753404270678, 0.41069314827198322, 0.40701728433124795,
+            0.40335973922286888, 0.39972031498193167, 0.39609881851754708, 0.39249506146101076,
+            0.3889088600204646, 0.38534003484173396, 0.38178841087503135, 0.37825381724723811,
+            0.37473608713949141, 0.37123505766982134, 0.36775056978059623, 0.3642824681305496,
+            0.36083060099117575, 0.35739482014729052, 0.35397498080156925, 0.3505709414828812,
+            0.34718256395825148, 0.34380971314829134, 0.34045225704594545, 0.33711006663841281,
+            0.33378301583210851, 0.3304709813805371, 0.32717384281495859, 0.32389148237773202,
+            0.32062378495823013, 0.3173706380312224, 0.31413193159763014, 0.31090755812756371,
+            0.30769741250555377, 0.30450139197789627, 0.30131939610203412, 0.29815132669790134,
+            0.29499708780116257, 0.29185658561828098, 0.28872972848335393, 0.28561642681665811,
+            0.28251659308484939, 0.27943014176276532, 0.27635698929678126, 0.2732970540696758,
+            0.27025025636695998, 0.26721651834463184, 0.26419576399831757, 0.26118791913376371,
+            0.25819291133864802, 0.25521066995567715, 0.25224112605694377, 0.2492842124195167,
+            0.24633986350223877, 0.24340801542371199, 0.24048860594144911, 0.23758157443217368,
+            0.23468686187325269, 0.23180441082524852, 0.22893416541557748, 0.22607607132326488,
+            0.22323007576478959, 0.22039612748101159, 0.21757417672517837, 0.2147641752520085,
+            0.21196607630785294, 0.20917983462193565, 0.20640540639867933, 0.2036427493111215,
+            0.20089182249543133, 0.19815258654653811, 0.19542500351488559, 0.19270903690432881,
+            0.19000465167119307, 0.18731181422451693, 0.18463049242750454, 0.18196065560021649,
+            0.1793022745235304, 0.17665532144440665, 0.17401977008249936, 0.17139559563815562,
+            0.16878277480185033, 0.16618128576511007, 0.16359110823298295, 0.16101222343811766,
+            0.15844461415652022, 0.15588826472506456, 0.15334316106083767, 0.15080929068241017,
+            0.14828664273312872, 0.14577520800653793, 0.14327497897404712, 0.14078594981496831,
+            0.13830811644906432, 0.13584147657175735, 0.13338602969216284, 0.13094177717412817,
+            0.12850872228047364, 0.12608687022065035, 0.1236762282020514, 0.12127680548523544,
+            0.1188886134433457, 0.11651166562603701, 0.11414597782825521, 0.11179156816424558,
+            0.10944845714721002, 0.10711666777507288, 0.10479622562286706, 0.10248715894230627,
+            0.10018949876917202, 0.097903279039215627, 0.095628536713353335, 0.093365311913026619,
+            0.091113648066700734, 0.088873592068594229, 0.086645194450867782, 0.084428509570654661,
+            0.082223595813495684, 0.080030515814947509, 0.077849336702372207, 0.075680130359194964,
+            0.073522973714240991, 0.071377949059141965, 0.069245144397250269, 0.067124653828023989,
+            0.065016577971470438, 0.062921024437977854, 0.060838108349751806, 0.058767952921137984,
+            0.056710690106399467, 0.054666461325077916, 0.052635418276973649, 0.050617723861121788,
+            0.048613553216035145, 0.046623094902089664, 0.044646552251446536, 0.042684144916619378,
+            0.040736110656078753, 0.038802707404656918, 0.036884215688691151, 0.034980941461833073,
+            0.033093219458688698, 0.03122141719202369, 0.029365939758230111, 0.027527235669693315,
+            0.025705804008632656, 0.023902203305873237, 0.022117062707379922, 0.020351096230109354,
+            0.01860512127578335, 0.016880083152595839, 0.015177088307982072, 0.013497450601780807,
+            0.011842757857943104, 0.0102149714397311, 0.0086165827694229171, 0.0070508754713921101,
+            0.005522403299264754, 0.0040379725933718715, 0.0026090727461063629, 0.001260285930498598,
+    };
+};
+
+}
+
+/**
+ * Normal distribution sampled with the ziggurat method from 64 random bits per draw, most draws only need a table
+ * lookup and a multiplication. Samples are computed in double precision. Draws that end inside a rectangle (98.5%)
+ * are bit-for-bit reproducible on any IEEE-754 platform, draws in a wedge or in the tail evaluate exp and log1p of
+ * the C library, which need not be correctly rounded, and may differ in the last bits between platforms.
+ */
+template<typename RealType = double>
+class normal_distribution {
+public:
+    using result_type = RealType;
+
+    class param_type {
+    public:
+        using distribution_type = normal_distribution;
+
+        explicit param_type(RealType mean = 0, RealType stddev = 1) : meanParam(mean), stddevParam(stddev) {}
+
+        RealType mean() const { return meanParam; }
+
+        RealType stddev() const { return stddevParam; }
+
+        bool operator==(const param_type &other) const {
+            return meanParam == other.meanParam && stddevParam == other.stddevParam;
+        }
+
+        bool operator!=(const param_type &other) const { return !(*this == other); }
+
+    private:
+        RealType meanParam, stddevParam;
+    };
+
+    explicit normal_distribution(RealType mean = 0, RealType stddev = 1) : normal_distribution(param_type(mean, stddev)) {}
+
+    explicit normal_distribution(const param_type &param) : p(param) {}
+
+    void reset() {}
+
+    param_type param() const { return p; }
+
+    void param(const param_type &param) { p = param; }
+
+    RealType mean() const { return p.mean(); }
+
+    RealType stddev() const { return p.stddev(); }
+
+    template<typename Generator>
+    result_type operator()(Generator &generator) {
+        return p.mean() + p.stddev() * static_cast<RealType>(standard(generator));
+    }
+
+    /**
+     * Fills [first, last) with samples.
+     */
+    template<typename Generator, typename OutputIterator>
+    void fill(Generator &generator, OutputIterator first, OutputIterator last) {
+        for (; first != last; ++first) {
+            *first = (*this)(generator);
+        }
+    }
+
+    /**
+     * Standard normal sample in double precision.
+     */
+    template<typename Generator>
+    double standard(Generator &generator) const {
+        using Tables = detail::ZigguratNormal;
+        for (;;) {
+            auto bits = bits64(generator);
+            auto layer = static_cast<int>(bits & 0xff);
+            bits >>= 8;
+            auto negative = (bits & 1) != 0;
+            auto magnitude = (bits >> 1) & 0x000fffffffffffffULL;
+            auto x = static_cast<double>(magnitude) * Tables::w[layer];
+            if (negative) {
+                x = -x;
+            }
+            if (magnitude < Tables::k[layer]) {
+                return x;  // inside the rectangle of the layer
+            }
+            if (layer == 0) {
+                // tail beyond r
+                for (;;) {
+                    auto xx = -Tables::invR * std::log1p(-uniform01<double>(generator));
+                    auto yy = -std::log1p(-uniform01<double>(generator));
+                    if (yy + yy > xx * xx) {
+                        return negative ? -(Tables::r + xx) : Tables::r + xx;
+                    }
+                }
+            }
+            auto u = uniform01<double>(generator);
+            if ((Tables::f[layer - 1] - Tables::f[layer]) * u + Tables::f[layer] < std::exp(-.5 * x * x)) {
+                return x;  // inside the wedge
+            }
+        }
+    }
+
+private:
+    param_type p;
+};
+
+/**
+ * Gamma distribution with shape alpha and scale beta, sampled with the method of Marsaglia and Tsang (2000) on top of
+ * the ziggurat normal distribution. Shapes below one are boosted by U^(1/alpha), a shape of zero yields zero. The boost
+ * and the rejection test beyond the squeeze evaluate exp and log of the C library, so unlike the normal fast path,
+ * gamma (and hence beta and Dirichlet) samples are only reproducible across platforms up to their rounding.
+ */
+template<typename RealType = double>
+class gamma_distribution {
+public:
+    using result_type = RealType;
+
+    class param_type {
+    public:
+        using distribution_type = gamma_distribution;
+
+        explicit param_type(RealType alpha = 1, RealType beta = 1) : alphaParam(alpha), betaParam(beta) {}
+
+        RealType alpha() const { return alphaParam; }
+
+        RealType beta() const { return betaParam; }
+
+        bool operator==(const param_type &other) const {
+            return alphaParam == other.alphaParam && betaParam == other.betaParam;
+        }
+
+        bool operator!=(const param_type &other) const { return !(*this == other); }
+
+    private:
+        RealType alphaParam, betaParam;
+    };
+
+    explicit gamma_distribution(RealType alpha = 1, RealType beta = 1) : gamma_distribution(param_type(alpha, beta)) {}
+
+    explicit gamma_distribution(const param_type &param) { this->param(param); }
+
+    void reset() {}
+
+    param_type param() const { return p; }
+
+    void param(const param_type &param) {
+        p = param;
+        boost = p.alpha() < 1;
+        d = (boost ? p.alpha() + 1 : p.alpha()) - static_cast<RealType>(1) / static_cast<RealType>(3);
+        c = static_cast<RealType>(1) / std::sqrt(static_cast<RealType>(9) * d);
+    }
+
+    RealType alpha() const { return p.alpha(); }
+
+    RealType beta() const { return p.beta(); }
+
+    template<typename Generator>
+    result_type operator()(Generator &generator) {
+        if (p.alpha() <= 0) {
+            return 0;
+        }
+        auto sample = d * standard(generator);
+        if (boost) {
+            auto u = static_cast<RealType>(1) - uniform01<RealType>(generator);  // in (0, 1]
+            sample *= std::exp(std::log(u) / p.alpha());
+        }
+        return sample * p.beta();
+    }
+
+    /**
+     * Fills [first, last) with samples.
+     */
+    template<typename Generator, typename OutputIterator>
+    void fill(Generator &generator, OutputIterator first, OutputIterator last) {
+        for (; first != last; ++first) {
+            *first = (*this)(generator);
+        }
+    }
+
+private:
+    /**
+     * Marsaglia-Tsang draw of v such that d * v is Gamma(d + 1/3, 1) distributed.
+     */
+    template<typename Generator>
+    RealType standard(Generator &generator) {
+        for (;;) {
+            RealType x, v;
+            do {
+                x = static_cast<RealType>(normal.standard(generator));
+                v = static_cast<RealType>(1) + c * x;
+            } while (v <= 0);
+            v = v * v * v;
+            auto u = uniform01<RealType>(generator);
+            auto x2 = x * x;
+            if (u < static_cast<RealType>(1) - static_cast<RealType>(.0331) * x2 * x2) {
+                return v;  // squeeze
+            }
+            if (std::log(u) < static_cast<RealType>(.5) * x2 + d * (static_cast<RealType>(1) - v + std::log(v))) {
+                return v;
+            }
+        }
+    }
+
+    param_type p;
+    bool boost {false};
+    RealType d {0};
+    RealType c {0};
+    normal_distribution<RealType> normal;
+};
+
+/**
+ * Dirichlet distribution with a fixed set of weights. Components with weight zero are zero in all samples.
+ */
 template<typename RealType>
 class dirichlet_distribution {
 public:
-    dirichlet_distribution() : gammas() {}
+    dirichlet_distribution() = default;
 
     template<typename InputIterator>
     dirichlet_distribution(InputIterator wbegin, InputIterator wend) {
         params(wbegin, wend);
     }
 
+    template<typename InputIterator>
+    void params(InputIterator wbegin, InputIterator wend) {
+        weights.assign(wbegin, wend);
+    }
+
+    std::size_t size() const {
+        return weights.size();
+    }
+
+    /**
+     * Draws a sample into the caller's buffer, which must hold size() elements.
+     */
     template<typename Generator>
-    std::vector<RealType> operator()(Generator &gen) {
-        std::vector<RealType> xs;
-        xs.reserve(gammas.size());
-        for (auto &gdist : gammas) {
-            // ignore zeros
-            xs.push_back(gdist(gen));
-            /*if(gdist.alpha() != 0) {
-            } else {
-                xs.push_back(0);
-            }*/
-        }
-        auto sum = std::accumulate(xs.begin(), xs.end(), 0.);
-        for (auto it = xs.begin(); it != xs.end(); ++it) {
-            *it /= sum;
+    void operator()(Generator &gen, RealType *out) {
+        auto sum = static_cast<RealType>(0);
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            gamma.param(typename gamma_distribution<RealType>::param_type(weights[i], 1));
+            out[i] = gamma(gen);
+            sum += out[i];
+        }
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            out[i] /= sum;
         }
-        return xs;
     }
 
-    template<typename InputIterator>
-    void params(InputIterator wbegin, InputIterator wend) {
-        gammas.resize(0);
-        std::transform(wbegin, wend, std::back_inserter(gammas), [](const auto &weight) {
-            return std::gamma_distribution<RealType>(weight, 1);
-        });
+    template<typename Generator>
+    std::vector<RealType> operator()(Generator &gen) {
+        std::vector<RealType> xs(weights.size());
+        (*this)(gen, xs.data());
+        return xs;
     }
 
 private:
-    std::vector<std::gamma_distribution<RealType>> gammas;
+    std::vector<RealType> weights;
+    gamma_distribution<RealType> gamma;
 };
 
+/**
+ * Beta distribution sampled as X / (X + Y) of two gamma variates X ~ Gamma(a, 1) and Y ~ Gamma(b, 1).
+ */
 template<typename RealType = double>
 class beta_distribution {
-    // from https://gist.github.com/sftrabbit/5068941
 public:
     typedef RealType result_type;
 
@@ -113,20 +758,30 @@ public:
     }
 
     void param(const param_type &param) {
-        a_gamma = gamma_dist_type(param.a());
-        b_gamma = gamma_dist_type(param.b());
+        a_gamma.param(typename gamma_dist_type::param_type(param.a()));
+        b_gamma.param(typename gamma_dist_type::param_type(param.b()));
     }
 
     template<typename URNG>
     result_type operator()(URNG &engine) {
-        return generate(engine, a_gamma, b_gamma);
+        auto x = a_gamma(engine);
+        return x / (x + b_gamma(engine));
     }
 
     template<typename URNG>
     result_type operator()(URNG &engine, const param_type &param) {
-        gamma_dist_type a_param_gamma(param.a()),
-                b_param_gamma(param.b());
-        return generate(engine, a_param_gamma, b_param_gamma);
+        this->param(param);
+        return (*this)(engine);
+    }
+
+    /**
+     * Fills [first, last) with samples.
+     */
+    template<typename URNG, typename OutputIterator>
+    void fill(URNG &engine, OutputIterator first, OutputIterator last) {
+        for (; first != last; ++first) {
+            *first = (*this)(engine);
+        }
     }
 
     result_type min() const { return 0.0; }
@@ -138,9 +793,7 @@ public:
     RealType b() const { return b_gamma.alpha(); }
 
     bool operator==(const beta_distribution<result_type> &other) const {
-        return (param() == other.param() &&
-                a_gamma == other.a_gamma &&
-                b_gamma == other.b_gamma);
+        return param() == other.param();
     }
 
     bool operator!=(const beta_distribution<result_type> &other) const {
@@ -148,19 +801,80 @@ public:
     }
 
 private:
-    typedef std::gamma_distribution<result_type> gamma_dist_type;
+    typedef gamma_distribution<result_type> gamma_dist_type;
 
     gamma_dist_type a_gamma, b_gamma;
+};
 
-    template<typename URNG>
-    result_type generate(URNG &engine,
-                         gamma_dist_type &x_gamma,
-                         gamma_dist_type &y_gamma) {
-        result_type x = x_gamma(engine);
-        auto denom = x + y_gamma(engine);
-        auto r = x / denom;
-        return r;
+/**
+ * Discrete distribution on {0, ..., n - 1} with given (not necessarily normalized) weights, sampled with Walker's alias
+ * method in Vose's construction: building the table takes O(n), every draw one uniform number and one table lookup.
+ * Unlike std::discrete_distribution, samples depend only on the generator output. Vanishing weights yield the uniform
+ * distribution.
+ */
+template<typename IntType = std::int64_t>
+class alias_distribution {
+public:
+    using result_type = IntType;
+
+    alias_distribution() : alias_distribution(std::vector<double>{1.}) {}
+
+    template<typename InputIterator>
+    alias_distribution(InputIterator first, InputIterator last) : alias_distribution(std::vector<double>(first, last)) {}
+
+    explicit alias_distribution(std::vector<double> weights) : probabilities(weights.size()), aliases(weights.size()) {
+        const auto n = weights.size();
+        if (n == 0) {
+            throw std::invalid_argument("alias_distribution needs at least one weight.");
+        }
+        auto sum = std::accumulate(weights.begin(), weights.end(), 0.);
+        if (sum <= 0) {
+            std::fill(weights.begin(), weights.end(), 1.);
+            sum = static_cast<double>(n);
+        }
+        // scaled so that the mean weight is one, columns below one are topped up from columns above one
+        std::vector<std::size_t> small, large;
+        for (std::size_t i = 0; i < n; ++i) {
+            weights[i] *= static_cast<double>(n) / sum;
+            (weights[i] < 1. ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            auto s = small.back();
+            auto l = large.back();
+            small.pop_back();
+            large.pop_back();
+            probabilities[s] = weights[s];
+            aliases[s] = static_cast<result_type>(l);
+            weights[l] = (weights[l] + weights[s]) - 1.;
+            (weights[l] < 1. ? small : large).push_back(l);
+        }
+        // whatever is left is one up to rounding
+        for (auto i : large) {
+            probabilities[i] = 1.;
+            aliases[i] = static_cast<result_type>(i);
+        }
+        for (auto i : small) {
+            probabilities[i] = 1.;
+            aliases[i] = static_cast<result_type>(i);
+        }
     }
+
+    template<typename Generator>
+    result_type operator()(Generator &generator) const {
+        const auto n = probabilities.size();
+        const auto u = uniform01<double>(generator) * static_cast<double>(n);
+        const auto column = std::min(static_cast<std::size_t>(u), n - 1);
+        return u - static_cast<double>(column) < probabilities[column] ? static_cast<result_type>(column)
+                                                                        : aliases[column];
+    }
+
+    result_type min() const { return 0; }
+
+    result_type max() const { return static_cast<result_type>(probabilities.size() - 1); }
+
+private:
+    std::vector<double> probabilities;
+    std::vector<result_type> aliases;
 };
 
 }
@@ -0,0 +1,407 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace deeptime {
+namespace fixed_point {
+
+/**
+ * Extrapolation scheme that is used on top of a plain fixed-point iteration x <- F(x).
+ */
+enum class Acceleration {
+    none, squarem, anderson
+};
+
+inline Acceleration parseAcceleration(const std::string &name) {
+    if (name == "none") {
+        return Acceleration::none;
+    } else if (name == "squarem") {
+        return Acceleration::squarem;
+    } else if (name == "anderson") {
+        return Acceleration::anderson;
+    }
+    throw std::invalid_argument("Unknown acceleration \"" + name + "\", must be one of \"none\", "
+                                                                   "\"squarem\", and \"anderson\".");
+}
+
+template<typename dtype>
+struct Result {
+    /**
+     * number of evaluations of the fixed-point map
+     */
+    std::size_t iterations {0};
+    /**
+     * whether the error dropped below the tolerance
+     */
+    bool converged {false};
+    /**
+     * error between argument and image of the fixed-point map, one entry per evaluation
+     */
+    std::vector<dtype> errors;
+};
+
+namespace detail {
+
+template<typename dtype>
+dtype norm(const std::vector<dtype> &x) {
+    dtype sum = 0;
+    for (auto v : x) {
+        sum += v * v;
+    }
+    return std::sqrt(sum);
+}
+
+template<typename dtype>
+dtype dot(const std::vector<dtype> &x, const std::vector<dtype> &y) {
+    dtype sum = 0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+/**
+ * Solves the (small) regularized normal equations M gamma = b by Gaussian elimination with partial pivoting.
+ * Returns false if the system is numerically singular.
+ */
+template<typename dtype>
+bool solveNormalEquations(std::vector<dtype> M, std::vector<dtype> b, std::size_t k, std::vector<dtype> &gamma) {
+    dtype trace = 0;
+    for (std::size_t i = 0; i < k; ++i) {
+        trace += M[i * k + i];
+    }
+    if (!(trace > 0)) {
+        return false;
+    }
+    const auto regularization = std::sqrt(std::numeric_limits<dtype>::epsilon()) * trace / k;
+    for (std::size_t i = 0; i < k; ++i) {
+        M[i * k + i] += regularization;
+    }
+    for (std::size_t col = 0; col < k; ++col) {
+        auto pivot = col;
+        for (std::size_t row = col + 1; row < k; ++row) {
+            if (std::abs(M[row * k + col]) > std::abs(M[pivot * k + col])) {
+                pivot = row;
+            }
+        }
+        if (!(std::abs(M[pivot * k + col]) > std::numeric_limits<dtype>::min())) {
+            return false;
+        }
+        if (pivot != col) {
+            for (std::size_t j = 0; j < k; ++j) {
+                std::swap(M[col * k + j], M[pivot * k + j]);
+            }
+            std::swap(b[col], b[pivot]);
+        }
+        for (std::size_t row = col + 1; row < k; ++row) {
+            auto factor = M[row * k + col] / M[col * k + col];
+            for (std::size_t j = col; j < k; ++j) {
+                M[row * k + j] -= factor * M[col * k + j];
+            }
+            b[row] -= factor * b[col];
+        }
+    }
+    gamma.resize(k);
+    for (std::size_t i = k; i-- > 0;) {
+        auto sum = b[i];
+        for (std::size_t j = i + 1; j < k; ++j) {
+            sum -= M[i * k + j] * gamma[j];
+        }
+        gamma[i] = sum / M[i * k + i];
+        if (!std::isfinite(gamma[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+/**
+ * Projection for iterates which have to be strictly positive, e.g., Lagrange multipliers.
+ */
+template<typename dtype>
+bool projectPositive(const dtype *x, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!(x[i] > 0) || !std::isfinite(x[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Projection for iterates which are probability vectors with entries larger than eps, normalizes x in place.
+ */
+template<typename dtype>
+bool projectNormalized(dtype *x, std::size_t n, dtype eps) {
+    if (!projectPositive(x, n)) {
+        return false;
+    }
+    dtype sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += x[i];
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        x[i] /= sum;
+        if (x[i] <= eps) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Iterates x <- F(x) until the error between two consecutive iterates drops below the tolerance, optionally
+ * accelerated by SQUAREM (Varadhan and Roland, 2008) or Anderson mixing (Walker and Ni, 2011).
+ *
+ * Extrapolated points are passed through the projection, which must map them onto the admissible set (e.g.,
+ * positive and normalized vectors) or reject them. Rejected extrapolations as well as extrapolations which
+ * increase the error are discarded in favor of the plain fixed-point step.
+ *
+ * @param x initial guess on input, last image of the fixed-point map on output
+ * @param map the fixed-point map, signature void(const dtype *x, dtype *out)
+ * @param project projection onto the admissible set, signature bool(dtype *x), returns false if not admissible
+ * @param error the error between two consecutive iterates, signature dtype(const dtype *x, const dtype *y)
+ * @param tolerance convergence tolerance
+ * @param maxIterations maximum number of evaluations of the fixed-point map
+ * @param acceleration the extrapolation scheme
+ * @param andersonDepth number of previous iterates used by Anderson mixing
+ * @return the number of iterations, whether the iteration converged, and the error history
+ */
+template<typename dtype, typename Map, typename Project, typename Error>
+Result<dtype> solve(std::vector<dtype> &x, Map &&map, Project &&project, Error &&error, dtype tolerance,
+                    std::size_t maxIterations, Acceleration acceleration, std::size_t andersonDepth = 5) {
+    const auto n = x.size();
+    Result<dtype> result;
+    std::vector<dtype> fx(n);
+
+    // evaluates fx = F(x) and returns true if the iteration is to be stopped
+    auto step = [&](const std::vector<dtype> &from, std::vector<dtype> &to) {
+        map(from.data(), to.data());
+        ++result.iterations;
+        auto err = error(from.data(), to.data());
+        result.errors.push_back(err);
+        result.converged = err <= tolerance;
+        return result.converged || result.iterations >= maxIterations;
+    };
+
+    switch (acceleration) {
+        case Acceleration::none: {
+            while (result.iterations < maxIterations) {
+                auto done = step(x, fx);
+                std::swap(x, fx);
+                if (done) break;
+            }
+            break;
+        }
+        case Acceleration::squarem: {
+            std::vector<dtype> x2(n), r(n), v(n), xExtrapolated(n);
+            dtype stepMax = 1;
+            while (result.iterations < maxIterations) {
+                if (step(x, fx)) {
+                    std::swap(x, fx);
+                    break;
+                }
+                const auto firstError = result.errors.back();
+                if (step(fx, x2)) {
+                    std::swap(x, x2);
+                    break;
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+                    r[i] = fx[i] - x[i];
+                    v[i] = x2[i] - 2 * fx[i] + x[i];
+                }
+                auto rNorm = detail::norm(r);
+                auto vNorm = detail::norm(v);
+                auto alpha = vNorm > 0 ? -rNorm / vNorm : static_cast<dtype>(-1);
+                alpha = std::max(std::min(alpha, static_cast<dtype>(-1)), -stepMax);
+                if (alpha == -stepMax) {
+                    stepMax *= 4;
+                }
+
+                bool extrapolated = false;
+                while (alpha < -1 && !extrapolated) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        xExtrapolated[i] = x[i] - 2 * alpha * r[i] + alpha * alpha * v[i];
+                    }
+                    extrapolated = project(xExtrapolated.data());
+                    if (!extrapolated) {
+                        // backtrack towards the plain step
+                        alpha = alpha > static_cast<dtype>(-1.01) ? static_cast<dtype>(-1) : (alpha - 1) / 2;
+                        stepMax = std::max(static_cast<dtype>(1), stepMax / 4);
+                    }
+                }
+                if (!extrapolated) {
+                    // plain step, alpha = -1 yields x2
+                    std::swap(xExtrapolated, x2);
+                }
+
+                // stabilizing step
+                auto done = step(xExtrapolated, fx);
+                if (extrapolated && !result.converged && !(result.errors.back() <= firstError)) {
+                    // the extrapolation increased the error, fall back to the plain step
+                    std::swap(x, x2);
+                    stepMax = 1;
+                } else {
+                    std::swap(x, fx);
+                }
+                if (done) break;
+            }
+            break;
+        }
+        case Acceleration::anderson: {
+            std::deque<std::vector<dtype>> dResiduals, dImages;
+            std::vector<dtype> residual(n), previousResidual(n), previousImage(n), gamma;
+            std::vector<dtype> M, b;
+            dtype previousResidualNorm = std::numeric_limits<dtype>::infinity();
+            bool hasPrevious = false, mixed = false;
+            while (result.iterations < maxIterations) {
+                if (step(x, fx)) {
+                    std::swap(x, fx);
+                    break;
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+                    residual[i] = fx[i] - x[i];
+                }
+                auto residualNorm = detail::norm(residual);
+                if (mixed && residualNorm > previousResidualNorm) {
+                    // the mixed iterate is worse than the previous one, continue with the plain step from there
+                    std::copy(previousImage.begin(), previousImage.end(), x.begin());
+                    hasPrevious = false;
+                    mixed = false;
+                    continue;
+                }
+
+                if (hasPrevious) {
+                    std::vector<dtype> dr(n), df(n);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        dr[i] = residual[i] - previousResidual[i];
+                        df[i] = fx[i] - previousImage[i];
+                    }
+                    dResiduals.push_back(std::move(dr));
+                    dImages.push_back(std::move(df));
+                    if (dResiduals.size() > andersonDepth) {
+                        dResiduals.pop_front();
+                        dImages.pop_front();
+                    }
+                }
+                std::copy(residual.begin(), residual.end(), previousResidual.begin());
+                std::copy(fx.begin(), fx.end(), previousImage.begin());
+                previousResidualNorm = residualNorm;
+                hasPrevious = true;
+
+                mixed = false;
+                if (!dResiduals.empty()) {
+                    const auto k = dResiduals.size();
+                    M.assign(k * k, 0);
+                    b.assign(k, 0);
+                    for (std::size_t i = 0; i < k; ++i) {
+                        b[i] = detail::dot(dResiduals[i], residual);
+                        for (std::size_t j = 0; j <= i; ++j) {
+                            M[i * k + j] = M[j * k + i] = detail::dot(dResiduals[i], dResiduals[j]);
+                        }
+                    }
+                    if (detail::solveNormalEquations(M, b, k, gamma)) {
+                        // x <- F(x) - dF gamma, reuse the residual buffer for the candidate
+                        std::copy(fx.begin(), fx.end(), residual.begin());
+                        for (std::size_t j = 0; j < k; ++j) {
+                            for (std::size_t i = 0; i < n; ++i) {
+                                residual[i] -= gamma[j] * dImages[j][i];
+                            }
+                        }
+                        mixed = project(residual.data());
+                    }
+                }
+                if (mixed) {
+                    std::swap(x, residual);
+                } else {
+                    dResiduals.clear();
+                    dImages.clear();
+                    std::swap(x, fx);
+                }
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+/**
+ * Fixed-point iteration over strictly positive vectors, e.g., stationary distributions or Lagrange multipliers.
+ * The plain iteration runs directly on x. Accelerated iterations run in log coordinates y = log(x): extrapolated
+ * iterates are positive by construction and the Anderson and SQUAREM models are much more accurate there, as the
+ * updates of positive vectors are multiplicative rather than additive.
+ *
+ * @param x positive initial guess on input, last image of the fixed-point map on output
+ * @param map the fixed-point map, signature void(const dtype *x, dtype *out)
+ * @param error the error between two consecutive iterates, signature dtype(const dtype *x, const dtype *y)
+ * @param normalized whether the iterates are probability vectors
+ * @param eps lower bound on the entries of extrapolated probability vectors, ignored if not normalized
+ */
+template<typename dtype, typename Map, typename Error>
+Result<dtype> solvePositive(std::vector<dtype> &x, Map &&map, Error &&error, bool normalized, dtype eps,
+                            dtype tolerance, std::size_t maxIterations, Acceleration acceleration,
+                            std::size_t andersonDepth = 5) {
+    const auto n = x.size();
+    if (acceleration == Acceleration::none) {
+        auto project = [](dtype *) { return true; };
+        return solve(x, map, project, error, tolerance, maxIterations, acceleration, andersonDepth);
+    }
+
+    std::vector<dtype> expFrom(n), expTo(n);
+    auto logMap = [&](const dtype *y, dtype *out) {
+        for (std::size_t i = 0; i < n; ++i) {
+            expFrom[i] = std::exp(y[i]);
+        }
+        map(expFrom.data(), expTo.data());
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = std::log(expTo[i]);
+        }
+    };
+    auto logError = [&](const dtype *y1, const dtype *y2) {
+        for (std::size_t i = 0; i < n; ++i) {
+            expFrom[i] = std::exp(y1[i]);
+            expTo[i] = std::exp(y2[i]);
+        }
+        return error(expFrom.data(), expTo.data());
+    };
+    auto logProject = [n, normalized, eps](dtype *y) {
+        for (std::size_t i = 0; i < n; ++i) {
+            if (!std::isfinite(y[i])) {
+                return false;
+            }
+        }
+        if (normalized) {
+            // log-sum-exp shift so that sum_i exp(y_i) = 1
+            auto max = *std::max_element(y, y + n);
+            dtype sum = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                sum += std::exp(y[i] - max);
+            }
+            auto shift = max + std::log(sum);
+            const auto logEps = std::log(eps);
+            for (std::size_t i = 0; i < n; ++i) {
+                y[i] -= shift;
+                if (y[i] <= logEps) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    std::transform(x.begin(), x.end(), x.begin(), [](auto v) { return std::log(v); });
+    auto result = solve(x, logMap, logProject, logError, tolerance, maxIterations, acceleration, andersonDepth);
+    std::transform(x.begin(), x.end(), x.begin(), [](auto v) { return std::exp(v); });
+    return result;
+}
+
+}
+}
@@ -90,6 +90,9 @@ class Build(build_ext):
                 ext.extra_compile_args += extra_compile_args
                 ext.extra_link_args += extra_link_args
                 ext.define_macros += define_macros
+                if self.compiler.compiler_type != 'msvc' and ext.name.endswith('kahandot'):
+                    # Dekker's TwoProduct is only error-free without contraction into fused multiply-adds
+                    ext.extra_compile_args.append('-ffp-contract=off')
 
         super(Build, self).build_extensions()
 
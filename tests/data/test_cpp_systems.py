@@ -56,6 +56,14 @@ def test_quadruple_well_asymmetric_sanity():
     assert_equal(traj[0], np.array([1., 1.]))
 
 
+def test_seeded_evaluation_independent_of_n_jobs():
+    system = dt.data.triple_well_2d(h=1e-3, n_steps=50)
+    test_points = np.random.RandomState(1).uniform(-1, 1, size=(100, 2))
+    reference = system(test_points, seed=53, n_jobs=1)
+    assert_equal(system(test_points, seed=53, n_jobs=4), reference)
+    assert np.any(system(test_points, seed=54, n_jobs=4) != reference)
+
+
 @pytest.mark.parametrize('dim', [1, 2, 3, 4, 5])
 def test_custom_sde(dim):
     def rhs(x):
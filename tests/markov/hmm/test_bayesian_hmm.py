@@ -329,6 +329,29 @@ class TestBHMMSpecialCases(unittest.TestCase):
             assert strajs[0][0] == 2
             assert strajs[0][6] == 2
 
+    def test_seeded_sampler(self):
+        dtrajs = [np.array([0, 0, 1, 0, 0, 1, 2, 2, 2, 2, 1, 2, 2, 0, 0, 0]),
+                  np.array([2, 2, 2, 1, 2, 2, 0, 0, 0, 0, 0, 1, 0])]
+        init_hmm = deeptime.markov.hmm.init.discrete.metastable_from_data(dtrajs, n_hidden_states=2, lagtime=1)
+
+        def sample(seed, n_burn_in=0, n_thin=1):
+            posterior = BayesianHMM(init_hmm, n_samples=20, store_hidden=True) \
+                .fit(dtrajs, n_burn_in=n_burn_in, n_thin=n_thin, seed=seed).fetch_model()
+            return np.array([s.transition_model.transition_matrix for s in posterior]), posterior
+
+        tmats1, posterior = sample(42)
+        tmats2, _ = sample(42)
+        np.testing.assert_equal(tmats1, tmats2)
+        assert np.any(tmats1 != sample(43)[0])
+        assert np.any(tmats1 != sample(42, n_burn_in=5, n_thin=2)[0])
+        for strajs in posterior.hidden_state_trajectories_samples:
+            np.testing.assert_equal([len(traj) for traj in strajs], [len(traj) for traj in dtrajs])
+            for traj in strajs:
+                np.testing.assert_(np.all((traj >= 0) & (traj < 2)))
+        for s in posterior:
+            np.testing.assert_allclose(s.transition_model.transition_matrix.sum(axis=1), 1)
+            np.testing.assert_allclose(s.output_probabilities.sum(axis=1), 1)
+
     # def test_initialized_bhmm_newstride(self):
     #     obs = np.random.randint(0, 2, size=1000)
     #
@@ -8,10 +8,11 @@ import deeptime.markov.hmm._hmm_bindings as _bindings
 from deeptime.markov.hmm import init, BayesianHMM
 from deeptime.data import DoubleWellDiscrete
 from deeptime.markov.hmm import MaximumLikelihoodHMM
-from deeptime.markov.hmm import viterbi, HiddenMarkovModel
-from deeptime.markov.hmm import DiscreteOutputModel
+from deeptime.markov.hmm import viterbi, viterbi_batch, HiddenMarkovModel, observation_log_likelihoods
+from deeptime.markov.hmm import DiscreteOutputModel, GaussianOutputModel
 from deeptime.markov.msm import MarkovStateModel
 from deeptime.markov import count_states
+from deeptime.markov._transition_matrix import estimate_P, stationary_distribution
 from tests.markov.msm.test_mlmsm import estimate_markov_model
 from tests.testing_utilities import assert_array_not_equal
 
@@ -29,6 +30,371 @@ def test_disconnected_dtraj_sanity(mode, reversible):
         BayesianHMM(hmm.submodel_largest(dtrajs=dtrajs), reversible=reversible).fit(dtrajs)
 
 
+@pytest.mark.parametrize('n_states', [3, 9, 50])
+@pytest.mark.parametrize('dtype', [np.float32, np.float64])
+def test_forward_backward_against_numpy(n_states, dtype):
+    state = np.random.RandomState(17)
+    P = state.uniform(.1, 1., size=(n_states, n_states))
+    P /= P.sum(axis=1, keepdims=True)
+    pobs = state.uniform(.01, 1., size=(100, n_states))
+    pi = np.full(n_states, 1. / n_states)
+
+    ref_alpha = np.empty_like(pobs)
+    ref_beta = np.empty_like(pobs)
+    ref_logprob = 0.
+    for t in range(len(pobs)):
+        ref_alpha[t] = (pi if t == 0 else ref_alpha[t - 1] @ P) * pobs[t]
+        ref_logprob += np.log(ref_alpha[t].sum())
+        ref_alpha[t] /= ref_alpha[t].sum()
+    ref_beta[-1] = 1. / n_states
+    for t in range(len(pobs) - 1, 0, -1):
+        ref_beta[t - 1] = P @ (pobs[t] * ref_beta[t])
+        ref_beta[t - 1] /= ref_beta[t - 1].sum()
+
+    P, pobs, pi = P.astype(dtype), pobs.astype(dtype), pi.astype(dtype)
+    alpha, beta = np.zeros_like(pobs), np.zeros_like(pobs)
+    logprob = _bindings.util.forward(P, pobs, pi, alpha_out=alpha)
+    _bindings.util.backward(P, pobs, beta_out=beta)
+    rtol = 1e-4 if dtype == np.float32 else 1e-10
+    np.testing.assert_allclose(logprob, ref_logprob, rtol=rtol)
+    np.testing.assert_allclose(alpha, ref_alpha, rtol=rtol)
+    np.testing.assert_allclose(beta, ref_beta, rtol=rtol)
+
+
+@pytest.mark.parametrize('dtype', [np.float32, np.float64])
+def test_forward_backward_batch(dtype):
+    state = np.random.RandomState(5)
+    n_states = 4
+    P = state.uniform(.1, 1., size=(n_states, n_states))
+    P = (P / P.sum(axis=1, keepdims=True)).astype(dtype)
+    pi = np.full(n_states, 1. / n_states, dtype=dtype)
+    pobs = [state.uniform(.01, 1., size=(length, n_states)).astype(dtype) for length in [1, 2, 50, 300] * 30]
+    gammas = [np.zeros_like(p) for p in pobs]
+    logprobs, counts, initial_counts = _bindings.util.forward_backward_batch(P, pobs, pi, gammas)
+
+    ref_counts = np.zeros((n_states, n_states), dtype=dtype)
+    for k, p in enumerate(pobs):
+        alpha, beta, gamma = np.zeros_like(p), np.zeros_like(p), np.zeros_like(p)
+        C = np.zeros((n_states, n_states), dtype=dtype)
+        logprob = _bindings.util.forward_backward(P, p, pi, alpha, beta, gamma, C, len(p))
+        np.testing.assert_allclose(logprobs[k], logprob, rtol=1e-5)
+        np.testing.assert_allclose(gammas[k], gamma, rtol=1e-5)
+        ref_counts += C
+    np.testing.assert_allclose(counts, ref_counts, rtol=1e-4)
+    np.testing.assert_allclose(initial_counts, np.sum([g[0] for g in gammas], axis=0), rtol=1e-5)
+
+    with np.testing.assert_raises(ValueError):
+        _bindings.util.forward_backward_batch(P, pobs, pi, [g.astype(np.float16) for g in gammas])
+
+
+@pytest.mark.parametrize('dtype', [np.float32, np.float64])
+def test_forward_backward_parallel_in_time(dtype):
+    state = np.random.RandomState(11)
+    n_states = 3
+    P = state.uniform(.1, 1., size=(n_states, n_states))
+    P = (P / P.sum(axis=1, keepdims=True)).astype(dtype)
+    pi = np.full(n_states, 1. / n_states, dtype=dtype)
+    pobs = [state.uniform(.01, 1., size=(length, n_states)).astype(dtype) for length in [1, 100, 20000]]
+    gammas = [np.zeros_like(p) for p in pobs]
+    ref_gammas = [np.zeros_like(p) for p in pobs]
+    logprobs, counts, initial_counts = _bindings.util.forward_backward_batch(P, pobs, pi, gammas,
+                                                                             parallel_in_time=True)
+    ref_logprobs, ref_counts, ref_initial_counts = _bindings.util.forward_backward_batch(P, pobs, pi, ref_gammas)
+    rtol = 1e-4 if dtype == np.float32 else 1e-10
+    np.testing.assert_allclose(logprobs, ref_logprobs, rtol=rtol)
+    np.testing.assert_allclose(counts, ref_counts, rtol=rtol)
+    np.testing.assert_allclose(initial_counts, ref_initial_counts, rtol=rtol)
+    for gamma, ref_gamma in zip(gammas, ref_gammas):
+        np.testing.assert_allclose(gamma, ref_gamma, rtol=rtol, atol=1e-6 if dtype == np.float32 else 1e-12)
+
+
+@pytest.mark.parametrize('n_segments', [2, 3, 7])
+@pytest.mark.parametrize('length', [1, 2, 5, 7, 50, 1000])
+@pytest.mark.parametrize('dtype', [np.float32, np.float64])
+def test_forward_backward_forced_segments(n_segments, length, dtype):
+    # the segment count is forced independently of the number of threads, also for segments shorter than the
+    # minimum segment length of the automatic split and for trajectories with fewer time steps than segments
+    state = np.random.RandomState(length)
+    n_states = 3
+    P = state.uniform(.1, 1., size=(n_states, n_states))
+    P = (P / P.sum(axis=1, keepdims=True)).astype(dtype)
+    pi = np.full(n_states, 1. / n_states, dtype=dtype)
+    pobs = state.uniform(.01, 1., size=(length, n_states)).astype(dtype)
+    alpha, beta, gamma = np.zeros_like(pobs), np.zeros_like(pobs), np.zeros_like(pobs)
+    counts = np.zeros((n_states, n_states), dtype=dtype)
+    logprob = _bindings.util.forward_backward(P, pobs, pi, alpha, beta, gamma, counts, length, n_segments=n_segments)
+    ref_alpha, ref_beta, ref_gamma = np.zeros_like(pobs), np.zeros_like(pobs), np.zeros_like(pobs)
+    ref_counts = np.zeros_like(counts)
+    ref_logprob = _bindings.util.forward_backward(P, pobs, pi, ref_alpha, ref_beta, ref_gamma, ref_counts, length)
+    rtol = 1e-4 if dtype == np.float32 else 1e-10
+    atol = 1e-6 if dtype == np.float32 else 1e-12
+    np.testing.assert_allclose(logprob, ref_logprob, rtol=rtol)
+    np.testing.assert_allclose(gamma, ref_gamma, rtol=rtol, atol=atol)
+    np.testing.assert_allclose(counts, ref_counts, rtol=rtol, atol=atol)
+
+
+def test_mlhmm_parallel_in_time():
+    dtraj = DoubleWellDiscrete().dtraj
+    init_hmm = init.discrete.metastable_from_data(dtraj, n_hidden_states=2, lagtime=1)
+    hmm = MaximumLikelihoodHMM(init_hmm).fit(dtraj).fetch_model()
+    hmm_pit = MaximumLikelihoodHMM(init_hmm, parallel_in_time=True).fit(dtraj).fetch_model()
+    np.testing.assert_allclose(hmm_pit.likelihood, hmm.likelihood, rtol=1e-6)
+    np.testing.assert_allclose(hmm_pit.transition_model.transition_matrix, hmm.transition_model.transition_matrix,
+                               rtol=1e-4)
+
+
+@pytest.mark.parametrize('parallel_in_time', [False, True])
+@pytest.mark.parametrize('output_model_type', ['discrete', 'gaussian'])
+def test_fused_e_step_statistics(output_model_type, parallel_in_time):
+    state = np.random.RandomState(13)
+    n_states = 3
+    P = state.uniform(.1, 1., size=(n_states, n_states))
+    P /= P.sum(axis=1, keepdims=True)
+    pi = np.full(n_states, 1. / n_states)
+    if output_model_type == 'discrete':
+        B = state.uniform(.1, 1., size=(n_states, 4))
+        output_model = DiscreteOutputModel(B / B.sum(axis=1, keepdims=True))
+        observations = [state.randint(0, 4, size=length) for length in [1, 50, 3000]]
+    else:
+        output_model = GaussianOutputModel(n_states, means=[-1., 0., 2.], sigmas=[.5, 1., .7])
+        observations = [state.normal(loc=5., size=length) for length in [1, 50, 3000]]
+    gammas = [np.zeros((len(obs), n_states)) for obs in observations]
+    logprobs, counts, initial_counts, statistics = output_model._forward_backward_batch(
+        P, pi, observations, gammas, parallel_in_time=parallel_in_time
+    )
+    pobs = [output_model.to_state_probability_trajectory(obs) for obs in observations]
+    ref_gammas = [np.zeros_like(g) for g in gammas]
+    ref_logprobs, ref_counts, ref_initial_counts = _bindings.util.forward_backward_batch(P, pobs, pi, ref_gammas)
+    np.testing.assert_allclose(logprobs, ref_logprobs, rtol=1e-10)
+    np.testing.assert_allclose(counts, ref_counts, rtol=1e-10)
+    np.testing.assert_allclose(initial_counts, ref_initial_counts, rtol=1e-10)
+    for gamma, ref_gamma in zip(gammas, ref_gammas):
+        np.testing.assert_allclose(gamma, ref_gamma, rtol=1e-10, atol=1e-14)
+
+    # statistics are also accumulated if the state probabilities are not stored
+    *_, statistics_no_gammas = output_model._forward_backward_batch(P, pi, observations, None,
+                                                                    parallel_in_time=parallel_in_time)
+    np.testing.assert_allclose(statistics_no_gammas, statistics, rtol=1e-10)
+
+    # the M-step from the statistics agrees with fitting from the state probabilities
+    ref_model = output_model.copy().fit(observations, ref_gammas)
+    output_model._fit_statistics(observations, gammas, statistics)
+    if output_model_type == 'discrete':
+        np.testing.assert_allclose(output_model.output_probabilities, ref_model.output_probabilities, rtol=1e-10)
+    else:
+        np.testing.assert_allclose(output_model.means, ref_model.means, rtol=1e-10)
+        np.testing.assert_allclose(output_model.sigmas, ref_model.sigmas, rtol=1e-8)
+
+
+@pytest.mark.parametrize('ignore_outliers', [False, True])
+def test_discrete_gathered_emissions_outliers(ignore_outliers):
+    state = np.random.RandomState(7)
+    P = np.array([[.9, .1], [.2, .8]])
+    pi = np.array([.5, .5])
+    B = np.array([[.5, .5, 0.], [.2, .8, 0.]])  # symbol 2 cannot be emitted
+    output_model = DiscreteOutputModel(B, ignore_outliers=ignore_outliers)
+    observations = [state.randint(0, 3, size=length) for length in [5, 300]]
+    for obs in observations:
+        obs[-1] = 2
+    gammas = [np.zeros((len(obs), 2)) for obs in observations]
+    logprobs, counts, *_ = output_model._forward_backward_batch(P, pi, observations, gammas)
+    pobs = [output_model.to_state_probability_trajectory(obs) for obs in observations]
+    ref_gammas = [np.zeros_like(g) for g in gammas]
+    ref_logprobs, ref_counts, _ = _bindings.util.forward_backward_batch(P, pobs, pi, ref_gammas)
+    np.testing.assert_equal(logprobs, ref_logprobs)
+    if ignore_outliers:
+        np.testing.assert_allclose(counts, ref_counts, rtol=1e-10)
+        for gamma, ref_gamma in zip(gammas, ref_gammas):
+            np.testing.assert_allclose(gamma, ref_gamma, rtol=1e-10, atol=1e-14)
+    else:
+        np.testing.assert_(np.all(np.isneginf(logprobs)))
+
+
+@pytest.mark.parametrize('reversible, stationary', [(True, True), (True, False), (False, False)])
+@pytest.mark.parametrize('output_model_type', ['discrete', 'gaussian'])
+def test_native_baum_welch(output_model_type, reversible, stationary, monkeypatch):
+    P = np.array([[.9, .08, .02], [.05, .9, .05], [.02, .08, .9]])
+    if output_model_type == 'discrete':
+        output_model = DiscreteOutputModel(np.array([[.7, .2, .1, 0.], [.1, .6, .2, .1], [0., .1, .2, .7]]))
+    else:
+        output_model = GaussianOutputModel(3, means=[-1., 0., 1.5], sigmas=[.5, .4, .6])
+    truth = HiddenMarkovModel(P, output_model)
+    observations = [truth.simulate(n_steps, seed=seed)[1] for seed, n_steps in enumerate([500, 2000])]
+    if output_model_type == 'discrete':
+        init_hmm = init.discrete.metastable_from_data(observations, n_hidden_states=3, lagtime=1)
+    else:
+        init_hmm = init.gaussian.from_data(observations, n_hidden_states=3, reversible=True)
+
+    iterations = []
+    estimator = MaximumLikelihoodHMM(init_hmm, reversible=reversible, stationary=stationary, accuracy=1e-6)
+    native = estimator.fit(observations, callback=lambda it, loglik: iterations.append((it, loglik))).fetch_model()
+    np.testing.assert_equal([it for it, _ in iterations], np.arange(1, len(native.likelihoods) + 1))
+    np.testing.assert_allclose([loglik for _, loglik in iterations], native.likelihoods)
+
+    # the same iteration in Python
+    monkeypatch.setattr(type(init_hmm.output_model), '_baum_welch', lambda *args, **kwargs: None)
+    reference = MaximumLikelihoodHMM(init_hmm, reversible=reversible, stationary=stationary, accuracy=1e-6) \
+        .fit(observations).fetch_model()
+
+    np.testing.assert_equal(len(native.likelihoods), len(reference.likelihoods))
+    np.testing.assert_allclose(native.likelihoods, reference.likelihoods, rtol=1e-8)
+    np.testing.assert_allclose(native.transition_model.transition_matrix,
+                               reference.transition_model.transition_matrix, rtol=1e-6, atol=1e-10)
+    np.testing.assert_allclose(native.initial_distribution, reference.initial_distribution, rtol=1e-6, atol=1e-10)
+    np.testing.assert_allclose(native.initial_count, reference.initial_count, rtol=1e-6)
+    np.testing.assert_allclose(native.transition_model.count_model.count_matrix,
+                               reference.transition_model.count_model.count_matrix, rtol=1e-6)
+    for gamma, ref_gamma in zip(native.state_probabilities, reference.state_probabilities):
+        np.testing.assert_allclose(gamma, ref_gamma, rtol=1e-6, atol=1e-10)
+    if output_model_type == 'discrete':
+        np.testing.assert_allclose(native.output_model.output_probabilities,
+                                   reference.output_model.output_probabilities, rtol=1e-6, atol=1e-10)
+    else:
+        np.testing.assert_allclose(native.output_model.means, reference.output_model.means, rtol=1e-6)
+        np.testing.assert_allclose(native.output_model.sigmas, reference.output_model.sigmas, rtol=1e-6)
+
+
+@pytest.mark.parametrize('case', ['disconnected', 'partially-reversible', 'fixed-stationary-distribution'])
+@pytest.mark.parametrize('reversible', [True, False], ids=lambda rev: f"reversible={rev}")
+def test_native_transition_matrix_estimation(case, reversible):
+    # the M-step of the native Baum-Welch iteration against estimate_P and stationary_distribution
+    fixed_statdist = None
+    if case == 'disconnected':
+        # two closed sets and an empty state
+        C = np.zeros((6, 6))
+        C[:2, :2] = [[10., 3.], [2., 8.]]
+        C[2:5, 2:5] = [[5., 1., 0.], [2., 7., 3.], [0., 4., 6.]]
+    elif case == 'partially-reversible':
+        # {0, 1} and {2} are left for the closed set {3, 4}
+        C = np.array([[6., 2., 0., 1., 0.],
+                      [3., 5., 1., 0., 2.],
+                      [0., 0., 4., 2., 0.],
+                      [0., 0., 0., 8., 3.],
+                      [0., 0., 0., 2., 9.]])
+    else:
+        if not reversible:
+            pytest.skip("A fixed stationary distribution implies reversibility.")
+        # weakly but not strongly connected
+        C = np.array([[7., 2., 0., 1.],
+                      [3., 6., 2., 0.],
+                      [0., 0., 5., 4.],
+                      [1., 0., 3., 8.]])
+        fixed_statdist = np.array([.1, .2, .3, .4])
+
+    P = _bindings.util.estimate_transition_matrix(C, reversible, fixed_statdist)
+    P_ref = estimate_P(C, reversible=reversible, fixed_statdist=fixed_statdist, maxerr=1e-12,
+                       mincount_connectivity=1e-16)
+    np.testing.assert_allclose(P, P_ref, rtol=1e-8, atol=1e-12)
+    pi_ref = stationary_distribution(P_ref, C=C, mincount_connectivity=1e-16)
+    np.testing.assert_allclose(_bindings.util.stationary_distribution(P_ref, C), pi_ref, rtol=1e-10, atol=1e-14)
+    pi32 = _bindings.util.stationary_distribution(P_ref.astype(np.float32), C.astype(np.float32))
+    np.testing.assert_equal(pi32.dtype, np.float32)
+    np.testing.assert_allclose(pi32, pi_ref, rtol=1e-5, atol=1e-6)
+
+
+@pytest.mark.parametrize('output_model_type', ['discrete', 'gaussian'])
+def test_observation_log_likelihoods(output_model_type):
+    state = np.random.RandomState(7)
+    models = []
+    for n_states in [2, 3, 9]:
+        P = state.uniform(.1, 1., size=(n_states, n_states))
+        P /= P.sum(axis=1, keepdims=True)
+        if output_model_type == 'discrete':
+            B = state.uniform(.1, 1., size=(n_states, 5))
+            output_model = DiscreteOutputModel(B / B.sum(axis=1, keepdims=True))
+        else:
+            output_model = GaussianOutputModel(n_states, means=state.normal(size=n_states),
+                                               sigmas=state.uniform(.5, 2., size=n_states))
+        models.append(HiddenMarkovModel(P, output_model, initial_distribution=state.dirichlet([1.] * n_states)))
+    if output_model_type == 'discrete':
+        observations = [state.randint(0, 5, size=length) for length in [1, 10, 1000]]
+    else:
+        observations = [state.normal(size=length) for length in [1, 10, 1000]]
+
+    log_likelihoods = observation_log_likelihoods(models, observations)
+    assert log_likelihoods.shape == (len(models), len(observations))
+    for m, model in enumerate(models):
+        for k, obs in enumerate(observations):
+            pobs = model.output_model.to_state_probability_trajectory(obs)
+            ref = _bindings.util.forward(model.transition_model.transition_matrix, pobs, model.initial_distribution,
+                                         alpha_out=np.zeros_like(pobs))
+            np.testing.assert_allclose(log_likelihoods[m, k], ref, rtol=1e-12)
+        np.testing.assert_allclose(model.compute_observation_likelihood(observations), np.sum(log_likelihoods[m]))
+
+
+@pytest.mark.parametrize('checkpoint_interval', [None, 1, 7, 1000])
+@pytest.mark.parametrize('output_model_type', ['discrete', 'gaussian'])
+def test_forward_backward_checkpointed(checkpoint_interval, output_model_type):
+    state = np.random.RandomState(3)
+    n_states, n_steps = 5, 500
+    P = state.uniform(.1, 1., size=(n_states, n_states))
+    P /= P.sum(axis=1, keepdims=True)
+    pi = np.full(n_states, 1. / n_states)
+    if output_model_type == 'discrete':
+        B = state.uniform(.1, 1., size=(n_states, 7))
+        output_model = DiscreteOutputModel(B / B.sum(axis=1, keepdims=True))
+        observations = state.randint(0, 7, size=n_steps)
+    else:
+        output_model = GaussianOutputModel(n_states, means=np.linspace(-2, 2, n_states),
+                                           sigmas=np.full(n_states, .7))
+        observations = state.normal(scale=2., size=n_steps)
+
+    pobs = output_model.to_state_probability_trajectory(observations)
+    alpha, beta, gamma = np.zeros_like(pobs), np.zeros_like(pobs), np.zeros_like(pobs)
+    ref_counts = np.zeros((n_states, n_states))
+    ref_logprob = _bindings.util.forward_backward(P, pobs, pi, alpha, beta, gamma, ref_counts, n_steps)
+
+    gamma_out = np.zeros_like(gamma)
+    logprob, counts, initial_counts, stats = output_model.forward_backward_checkpointed(
+        P, pi, observations, checkpoint_interval=checkpoint_interval, gamma_out=gamma_out
+    )
+    np.testing.assert_allclose(logprob, ref_logprob, rtol=1e-12)
+    np.testing.assert_allclose(counts, ref_counts, rtol=1e-10)
+    np.testing.assert_allclose(initial_counts, gamma[0], rtol=1e-10)
+    np.testing.assert_allclose(gamma_out, gamma, rtol=1e-10, atol=1e-14)
+    if output_model_type == 'discrete':
+        ref_stats = np.zeros_like(output_model.output_probabilities)
+        _bindings.output_models.discrete.update_p_out(observations, gamma, ref_stats)
+    else:
+        ref_stats = np.stack([gamma.sum(axis=0), gamma.T @ observations, gamma.T @ observations ** 2])
+    np.testing.assert_allclose(stats, ref_stats, rtol=1e-10)
+
+    # without gamma_out only the accumulated statistics are produced
+    logprob_no_gamma, *_ = output_model.forward_backward_checkpointed(P, pi, observations, checkpoint_interval)
+    assert logprob_no_gamma == logprob
+
+
+@pytest.mark.parametrize('checkpoint_interval', [None, 1, 5, 1000])
+@pytest.mark.parametrize('n_states', [1, 3, 300], ids=lambda n: f"n_states={n}")
+def test_viterbi_against_numpy(checkpoint_interval, n_states):
+    state = np.random.RandomState(5)
+    P = state.uniform(.1, 1., size=(n_states, n_states)) + 5 * np.eye(n_states)
+    P /= P.sum(axis=1, keepdims=True)
+    pi = np.full(n_states, 1. / n_states)
+    pobs_list = [state.uniform(.01, 1., size=(n_steps, n_states)) for n_steps in [1, 2, 50, 123]]
+
+    def viterbi_numpy(pobs):
+        delta = np.log(pi) + np.log(pobs[0])
+        backpointers = np.zeros(pobs.shape, dtype=int)
+        for t in range(1, len(pobs)):
+            scores = delta[:, None] + np.log(P)
+            backpointers[t] = np.argmax(scores, axis=0)
+            delta = np.max(scores, axis=0) + np.log(pobs[t])
+        path = np.empty(len(pobs), dtype=int)
+        path[-1] = np.argmax(delta)
+        for t in range(len(pobs) - 1, 0, -1):
+            path[t - 1] = backpointers[t, path[t]]
+        return path
+
+    references = [viterbi_numpy(pobs) for pobs in pobs_list]
+    for pobs, ref in zip(pobs_list, references):
+        np.testing.assert_array_equal(viterbi(P, pobs, pi, checkpoint_interval=checkpoint_interval), ref)
+    paths = viterbi_batch(P, pobs_list, pi, checkpoint_interval=checkpoint_interval)
+    assert len(paths) == len(pobs_list)
+    for path, ref in zip(paths, references):
+        np.testing.assert_array_equal(path, ref)
+
+
 class TestAlgorithmsAgainstReference(unittest.TestCase):
     """ Tests against example from Wikipedia: http://en.wikipedia.org/wiki/Forward-backward_algorithm#Example """
 
@@ -518,6 +884,13 @@ class TestMLHMM(unittest.TestCase):
         assert len(traj) <= N
         assert len(np.unique(traj)) <= len(hmsm.transition_model.transition_matrix)
 
+    def test_simulate_HMSM_seeded(self):
+        hmsm = self.hmm_lag10_largest
+        traj, obs = hmsm.simulate(n_steps=400, seed=17)
+        traj2, obs2 = hmsm.simulate(n_steps=400, seed=17)
+        np.testing.assert_equal(traj2, traj)
+        np.testing.assert_equal(obs2, obs)
+
     # ----------------------------------
     # MORE COMPLEX TESTS / SANITY CHECKS
     # ----------------------------------
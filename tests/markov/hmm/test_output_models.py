@@ -2,7 +2,17 @@ import unittest
 
 import numpy as np
 import deeptime
-from deeptime.markov.hmm import DiscreteOutputModel, GaussianOutputModel
+from deeptime.markov.hmm import DiscreteOutputModel, GaussianOutputModel, MultivariateGaussianOutputModel, \
+    HiddenMarkovModel, MaximumLikelihoodHMM, observation_log_likelihoods
+
+
+def check_seeded_observation_trajectory(model):
+    hidden = np.random.RandomState(3).randint(0, model.n_hidden_states, size=100000)
+    traj = model.generate_observation_trajectory(hidden, seed=7)
+    np.testing.assert_equal(model.generate_observation_trajectory(hidden, seed=7), traj)
+    # the random numbers of a time step do not depend on the trajectory length or the number of threads
+    np.testing.assert_equal(model.generate_observation_trajectory(hidden[:5000], seed=7), traj[:5000])
+    np.testing.assert_(np.any(model.generate_observation_trajectory(hidden, seed=8) != traj))
 
 
 class TestDiscrete(unittest.TestCase):
@@ -56,6 +66,16 @@ class TestDiscrete(unittest.TestCase):
         bc /= np.sum(bc)
         np.testing.assert_array_almost_equal(bc, np.array([0.1, 0.3, 0.1, 0.3, 0.2]), decimal=2)
 
+    def test_observation_trajectory_seeded(self):
+        check_seeded_observation_trajectory(DiscreteOutputModel(np.array([[0.1, 0.6, 0.3], [0.5, 0.2, 0.3]])))
+
+    def test_observation_trajectory_zero_probabilities(self):
+        m = DiscreteOutputModel(np.array([[0., 0.5, 0., 0.5], [1., 0., 0., 0.]]))
+        hidden = np.random.RandomState(5).randint(0, 2, size=50000)
+        traj = m.generate_observation_trajectory(hidden, seed=11)
+        np.testing.assert_equal(traj[hidden == 1], 0)
+        np.testing.assert_(np.all((traj[hidden == 0] == 1) | (traj[hidden == 0] == 3)))
+
     def test_output_probability_trajectory(self):
         output_probabilities = np.array([
             [0.1, 0.6, 0.1, 0.1, 0.1],
@@ -125,6 +145,10 @@ class TestGaussian(unittest.TestCase):
             np.testing.assert_almost_equal(np.mean(traj), m.means[state], decimal=2)
             np.testing.assert_almost_equal(np.sqrt(np.var(traj)), m.sigmas[state], decimal=3)
 
+    def test_observation_trajectory_seeded(self):
+        check_seeded_observation_trajectory(GaussianOutputModel(3, means=np.array([-1., 0., 1.]),
+                                                                sigmas=np.array([.5, .2, .1])))
+
     def test_output_probability_trajectory(self):
         m = GaussianOutputModel(3, means=np.array([-1., 0., 1.]), sigmas=np.array([.5, .2, .1]))
         m.ignore_outliers = True
@@ -169,3 +193,110 @@ class TestGaussian(unittest.TestCase):
             mean_ix = np.argmin(np.abs(expected_means-mean))
             np.testing.assert_almost_equal(mean, expected_means[mean_ix], decimal=1)
             np.testing.assert_almost_equal(sigma*sigma, expected_stds[mean_ix], decimal=1)
+
+
+class TestMultivariateGaussian(unittest.TestCase):
+
+    means = np.array([[-1., 0., 2.], [3., 1., -2.]])
+    covariances = np.array([[[1., .4, 0.], [.4, .8, .2], [0., .2, .5]],
+                            [[.3, 0., -.1], [0., 1.2, .3], [-.1, .3, .7]]])
+
+    def model(self, covariance_type):
+        covariances = self.covariances if covariance_type == 'full' \
+            else np.array([np.diag(c) for c in self.covariances])
+        return MultivariateGaussianOutputModel(2, self.means, covariances, covariance_type=covariance_type)
+
+    def test_log_densities(self):
+        from scipy.stats import multivariate_normal
+        obs = np.random.RandomState(5).normal(size=(500, 3)) * 3
+        for covariance_type in ['full', 'diag']:
+            m = self.model(covariance_type)
+            log_densities = m.to_log_state_probability_trajectory(obs)
+            for i in range(2):
+                cov = m.covariances[i] if covariance_type == 'full' else np.diag(m.covariances[i])
+                np.testing.assert_allclose(log_densities[:, i], multivariate_normal(m.means[i], cov).logpdf(obs),
+                                           rtol=1e-10)
+            np.testing.assert_allclose(m.to_state_probability_trajectory(obs), np.exp(log_densities))
+
+    def test_not_positive_definite(self):
+        with self.assertRaises(ValueError):
+            MultivariateGaussianOutputModel(1, [[0., 0.]], [[[1., 2.], [2., 1.]]]).to_log_state_probability_trajectory(
+                np.zeros((3, 2))
+            )
+
+    def test_observation_trajectory(self):
+        m = self.model('full')
+        for state in range(2):
+            traj = m.generate_observation_trajectory(np.array([state] * 200000), seed=state)
+            np.testing.assert_equal(traj.shape, (200000, 3))
+            np.testing.assert_allclose(np.mean(traj, axis=0), m.means[state], atol=2e-2)
+            np.testing.assert_allclose(np.cov(traj.T), m.covariances[state], atol=2e-2)
+        hidden = np.random.RandomState(3).randint(0, 2, size=1000)
+        np.testing.assert_equal(m.generate_observation_trajectory(hidden, seed=7),
+                                m.generate_observation_trajectory(hidden, seed=7))
+
+    def test_forward_backward_log_space(self):
+        P = np.array([[.9, .1], [.2, .8]])
+        pi = np.array([.5, .5])
+        for covariance_type in ['full', 'diag']:
+            m = self.model(covariance_type)
+            hmm = HiddenMarkovModel(P, m)
+            observations = [hmm.simulate(n, seed=n)[1] for n in [300, 1000]]
+            gammas = [np.zeros((len(obs), 2)) for obs in observations]
+            logprobs, counts, initial_counts, statistics = m._forward_backward_batch(P, pi, observations, gammas)
+
+            # dense reference, observations are close enough to the means for the densities not to underflow
+            ref_gammas = [np.zeros((len(obs), 2)) for obs in observations]
+            ref = deeptime.markov.hmm._hmm_bindings.util.forward_backward_batch(
+                P, [m.to_state_probability_trajectory(obs) for obs in observations], pi, ref_gammas
+            )
+            np.testing.assert_allclose(logprobs, ref[0], rtol=1e-10)
+            np.testing.assert_allclose(counts, ref[1], rtol=1e-8)
+            np.testing.assert_allclose(initial_counts, ref[2], rtol=1e-8)
+            for gamma, ref_gamma in zip(gammas, ref_gammas):
+                np.testing.assert_allclose(gamma, ref_gamma, rtol=1e-8, atol=1e-12)
+            np.testing.assert_allclose(logprobs, observation_log_likelihoods([hmm], observations)[0], rtol=1e-10)
+            pit = m._forward_backward_batch(P, pi, observations, None, parallel_in_time=True)
+            np.testing.assert_allclose(pit[0], logprobs, rtol=1e-10)
+            np.testing.assert_allclose(pit[3], statistics, rtol=1e-8)
+
+            # moments around the means
+            fitted = m.submodel().fit(observations, gammas)
+            refit = m.submodel()._fit_statistics(observations, gammas, statistics)
+            np.testing.assert_allclose(refit.means, fitted.means, rtol=1e-8)
+            np.testing.assert_allclose(refit.covariances, fitted.covariances, rtol=1e-8)
+            x, w = np.concatenate(observations), np.concatenate(gammas)
+            for i in range(2):
+                weights = w[:, i] / w[:, i].sum()
+                mean = weights @ x
+                cov = (x - mean).T @ ((x - mean) * weights[:, None])
+                np.testing.assert_allclose(fitted.means[i], mean, rtol=1e-8)
+                np.testing.assert_allclose(fitted.covariances[i], cov if covariance_type == 'full' else np.diag(cov),
+                                           rtol=1e-8, atol=1e-12)
+
+    def test_far_observations(self):
+        m = MultivariateGaussianOutputModel(2, [[0., 0.], [1., 1.]], [[.01, .01], [.01, .01]], covariance_type='diag')
+        obs = np.array([[0., 0.], [1000., 1000.], [1., 1.]])
+        gammas = [np.zeros((3, 2))]
+        logprobs, *_ = m._forward_backward_batch(np.array([[.9, .1], [.1, .9]]), np.array([.5, .5]), [obs], gammas)
+        np.testing.assert_(np.isfinite(logprobs[0]))
+        np.testing.assert_allclose(gammas[0][1], [0., 1.], atol=1e-10)
+
+    def test_sample_not_supported(self):
+        with self.assertRaises(NotImplementedError):
+            self.model('full').sample([np.zeros((5, 3)), np.zeros((5, 3))])
+
+    def test_fit(self):
+        for covariance_type in ['full', 'diag']:
+            truth = HiddenMarkovModel(np.array([[.95, .05], [.05, .95]]), self.model(covariance_type))
+            observations = [truth.simulate(20000, seed=seed)[1] for seed in range(2)]
+            init_model = MultivariateGaussianOutputModel(
+                2, self.means + .5, np.ones((2, 3)) if covariance_type == 'diag' else None,
+                covariance_type=covariance_type
+            )
+            init_hmm = HiddenMarkovModel(np.array([[.8, .2], [.2, .8]]), init_model)
+            hmm = MaximumLikelihoodHMM(init_hmm).fit(observations).fetch_model()
+            np.testing.assert_allclose(hmm.transition_model.transition_matrix, truth.transition_model.transition_matrix,
+                                       atol=1e-2)
+            np.testing.assert_allclose(hmm.output_model.means, truth.output_model.means, atol=5e-2)
+            np.testing.assert_allclose(hmm.output_model.covariances, truth.output_model.covariances, atol=5e-2)
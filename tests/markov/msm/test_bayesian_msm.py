@@ -32,6 +32,15 @@ class TestBMSMBasic(unittest.TestCase):
         posterior = BayesianMSM(n_samples=33).fit(count_matrix).fetch_model()
         np.testing.assert_equal(len(posterior.samples), 33)
 
+    def test_parallel_chains(self):
+        count_matrix = np.array([[5, 2, 0], [3, 10, 4], [0, 3, 7]], dtype=float)
+        posterior = BayesianMSM(n_samples=33, n_chains=4, n_burn_in=5).fit(count_matrix).fetch_model()
+        np.testing.assert_equal(len(posterior.samples), 33)
+        for sample in posterior:
+            np.testing.assert_(sample.reversible)
+            np.testing.assert_allclose(sample.stationary_distribution.dot(sample.transition_matrix),
+                                       sample.stationary_distribution, atol=1e-10)
+
     def test_with_count_model(self):
         dtraj = np.random.randint(0, 10, size=(10000,))
         with self.assertRaises(ValueError):
@@ -0,0 +1,85 @@
+import numpy as np
+import pytest
+from numpy.testing import assert_allclose, assert_equal
+from scipy import stats
+
+from deeptime.markov._markov_bindings import random as rnd
+
+
+@pytest.mark.parametrize('counter, key, expected', [
+    ([0, 0, 0, 0], [0, 0], [0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8]),
+    ([0xffffffff] * 4, [0xffffffff] * 2, [0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd]),
+    ([0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344], [0xa4093822, 0x299f31d0],
+     [0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1]),
+], ids=['zeros', 'ones', 'pi'])
+def test_philox4x32_known_answers(counter, key, expected):
+    # known-answer vectors of philox4x32-10 from Random123
+    out = rnd.philox4x32_block(np.array(counter, dtype=np.uint32), np.array(key, dtype=np.uint32))
+    assert_equal(out, np.array(expected, dtype=np.uint32))
+
+
+def test_philox4x32_stream_layout():
+    # block n of (seed, stream, substream) is the bijection of the counter (n, 0, substream, stream) under the key
+    # made of the low and high word of the seed
+    seed = 0x0123456789abcdef
+    out = rnd.philox4x32(12, seed, stream=5, substream=9)
+    key = np.array([seed & 0xffffffff, seed >> 32], dtype=np.uint32)
+    for n in range(3):
+        assert_equal(out[4 * n:4 * (n + 1)], rnd.philox4x32_block(np.array([n, 0, 9, 5], dtype=np.uint32), key))
+    assert np.any(rnd.philox4x32(4, seed, stream=5, substream=10) != out[:4])
+
+
+def test_normal():
+    samples = rnd.normal(200000, mean=1.5, stddev=2., seed=1)
+    assert stats.kstest(samples, 'norm', args=(1.5, 2.)).pvalue > 1e-3
+    assert_allclose([np.mean(samples), np.std(samples)], [1.5, 2.], rtol=1e-2)
+
+
+def test_normal_tail():
+    # draws beyond the base strip of the ziggurat take the separate tail branch
+    r = 3.6541528853610087963519472518
+    samples = rnd.normal(2000000, seed=2)
+    assert stats.kstest(samples, 'norm').pvalue > 1e-3
+    assert_allclose(np.mean(np.abs(samples) > r), 2 * stats.norm.sf(r), rtol=.1)
+
+
+def test_normal_seeded():
+    assert_equal(rnd.normal(1000, seed=7), rnd.normal(1000, seed=7))
+    assert np.any(rnd.normal(1000, seed=7) != rnd.normal(1000, seed=8))
+
+
+@pytest.mark.parametrize('alpha', [.05, .3, .9, 1., 2.5, 20.])
+def test_gamma(alpha):
+    # shapes below one go through the U^(1/alpha) boost
+    samples = rnd.gamma(200000, alpha, beta=1.5, seed=3)
+    assert np.all(samples >= 0)
+    assert stats.kstest(samples, 'gamma', args=(alpha, 0, 1.5)).pvalue > 1e-3
+    assert_allclose(np.mean(samples), alpha * 1.5, rtol=3e-2)
+    assert_allclose(np.var(samples), alpha * 1.5 ** 2, rtol=1e-1)
+
+
+def test_gamma_zero_shape():
+    assert_equal(rnd.gamma(100, 0., seed=3), 0.)
+
+
+@pytest.mark.parametrize('a, b', [(.5, .5), (2., 5.), (.2, 3.), (10., 10.)])
+def test_beta(a, b):
+    samples = rnd.beta(200000, a, b, seed=4)
+    assert np.all((samples >= 0) & (samples <= 1))
+    assert stats.kstest(samples, 'beta', args=(a, b)).pvalue > 1e-3
+    assert_allclose(np.mean(samples), a / (a + b), rtol=1e-2)
+
+
+def test_dirichlet():
+    weights = np.array([.3, 1., 2.5, 0.])
+    samples = rnd.dirichlet(100000, weights, seed=5)
+    assert_equal(samples.shape, (100000, 4))
+    assert_allclose(samples.sum(axis=1), 1.)
+    assert_equal(samples[:, 3], 0.)
+    alpha0 = weights.sum()
+    for k in range(3):
+        # the marginals are beta distributed
+        assert stats.kstest(samples[:, k], 'beta', args=(weights[k], alpha0 - weights[k])).pvalue > 1e-3
+    mean = weights / alpha0
+    cov = (np.diag(mean) - np.outer(mean, mean)) / (alpha0 + 1)
+    assert_allclose(np.cov(samples.T), cov, atol=2e-3)
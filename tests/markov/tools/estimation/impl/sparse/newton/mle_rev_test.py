@@ -10,9 +10,10 @@ from os.path import abspath, join
 from os import pardir
 
 import numpy as np
-from scipy.sparse import csr_matrix
+from scipy.sparse import csr_matrix, random as sparse_random
 
 from tests.markov.tools.numeric import assert_allclose
+from deeptime.markov.tools.estimation.sparse.mle import mle_trev
 from deeptime.markov.tools.estimation.sparse.mle.newton.mle_rev import solve_mle_rev
 
 testpath = abspath(join(abspath(__file__), pardir)) + '/testfiles/'
@@ -27,3 +28,22 @@ class TestReversibleEstimatorNewton(unittest.TestCase):
     def test_estimator(self):
         P, pi = solve_mle_rev(csr_matrix(self.C))
         assert_allclose(P.toarray(), self.P_ref)
+
+    def test_full_output(self):
+        P, pi, info = solve_mle_rev(csr_matrix(self.C), full_output=True)
+        M = self.C.shape[0]
+        assert_allclose(info['z'][-1][M:2 * M] - np.log(pi), -np.log(pi[0]))
+        assert_allclose(P.toarray(), self.P_ref)
+
+    def test_against_fixed_point(self):
+        state = np.random.RandomState(17)
+        M = 300
+        C = sparse_random(M, M, density=0.01, random_state=state, data_rvs=lambda n: state.randint(1, 100, n))
+        # a ring of transitions keeps C connected
+        C = (C + csr_matrix((state.randint(1, 100, 2 * M).astype(float),
+                             (np.r_[np.arange(M), (np.arange(M) + 1) % M],
+                              np.r_[(np.arange(M) + 1) % M, np.arange(M)])), shape=(M, M))).tocsr()
+        P, pi = solve_mle_rev(C)
+        P_ref, pi_ref = mle_trev(C, maxerr=1e-14, return_statdist=True)
+        assert_allclose(P.toarray(), P_ref.toarray(), atol=1e-8)
+        assert_allclose(pi, pi_ref, rtol=1e-8)
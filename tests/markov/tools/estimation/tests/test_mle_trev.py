@@ -1,3 +1,5 @@
+import os
+import time
 import unittest
 import numpy as np
 
@@ -12,6 +14,7 @@ from os.path import abspath, join
 from os import pardir
 
 from deeptime.markov.tools.estimation.sparse.mle import mle_trev as impl_sparse
+from deeptime.markov.tools.estimation.sparse.mle import mle_trev_batch as impl_batch
 from deeptime.markov.tools.estimation.dense.mle import mle_trev as impl_dense
 from deeptime.markov.tools.estimation import transition_matrix as apicall
 
@@ -78,3 +81,124 @@ class Test_mle_trev(unittest.TestCase):
         T, mu = apicall(C, reversible=True, method='sparse', return_statdist=True)
         mu_manual = stationary_distribution(T)
         np.testing.assert_allclose(mu, mu_manual)
+
+    def test_mostly_zero_dense_counts(self):
+        # banded count matrix, the dense implementation only visits the nonzero counts
+        state = np.random.RandomState(53)
+        n = 200
+        C = np.zeros((n, n))
+        for offset in (-1, 0, 1):
+            C += np.diag(state.randint(1, 100, size=n - abs(offset)).astype(float), k=offset)
+        T_dense = impl_dense(C)
+        T_sparse = impl_sparse(scipy.sparse.csr_matrix(C)).toarray()
+        assert_allclose(T_dense, T_sparse)
+        assert_allclose(T_dense.sum(axis=1), np.ones(n))
+
+    def test_acceleration(self):
+        C = np.loadtxt(testpath + 'C_1_lag.dat')
+        T_ref, mu_ref, errors_ref = impl_dense(C, return_statdist=True, return_error_history=True)
+        assert errors_ref[-1] <= 1e-12
+        for acceleration in ['squarem', 'anderson']:
+            T, mu, errors = impl_dense(C, acceleration=acceleration, return_statdist=True,
+                                       return_error_history=True)
+            assert_allclose(T, T_ref)
+            assert_allclose(mu, mu_ref)
+            assert len(errors) < len(errors_ref)
+            T, errors = impl_sparse(scipy.sparse.csr_matrix(C), acceleration=acceleration, return_error_history=True)
+            assert_allclose(T.toarray(), T_ref)
+            assert len(errors) < len(errors_ref)
+            T = apicall(C, reversible=True, acceleration=acceleration)
+            assert_allclose(T, T_ref)
+
+    def test_invalid_acceleration(self):
+        C = np.loadtxt(testpath + 'C_1_lag.dat')
+        with self.assertRaises(ValueError):
+            impl_dense(C, acceleration='aitken')
+
+    def test_sparse_random_pattern(self):
+        state = np.random.RandomState(17)
+        n = 500
+        C = scipy.sparse.random(n, n, density=.01, random_state=state, format='csr') * 100.
+        C = C + scipy.sparse.diags(state.uniform(1, 10, size=n)) + scipy.sparse.diags(np.ones(n - 1), 1) \
+            + scipy.sparse.diags(np.ones(n - 1), -1)
+        T_sparse, mu_sparse = impl_sparse(scipy.sparse.csr_matrix(C), return_statdist=True)
+        T_dense, mu_dense = impl_dense(C.toarray(), return_statdist=True)
+        assert_allclose(T_sparse.toarray(), T_dense)
+        assert_allclose(mu_sparse, mu_dense)
+
+    def test_batch(self):
+        C = np.loadtxt(testpath + 'C_1_lag.dat')
+        state = np.random.RandomState(5)
+        Cs = [C + state.randint(0, 3, size=C.shape) * (C > 0) for _ in range(6)]
+        Cs[1] = scipy.sparse.csr_matrix(Cs[1])
+        for warm_start in [None, 'neighbor', 'pairs', [-1, 0, 1, 2, 3, 4]]:
+            Ts, mus, codes = impl_batch(Cs, warm_start=warm_start)
+            np.testing.assert_equal(codes, 0)
+            np.testing.assert_equal(mus.shape, (len(Cs), C.shape[0]))
+            assert scipy.sparse.issparse(Ts[1]) and not scipy.sparse.issparse(Ts[0])
+            for k, Ck in enumerate(Cs):
+                T_ref, mu_ref = impl_sparse(scipy.sparse.csr_matrix(Ck), return_statdist=True)
+                T = Ts[k].toarray() if scipy.sparse.issparse(Ts[k]) else Ts[k]
+                assert_allclose(T, T_ref.toarray())
+                assert_allclose(mus[k], mu_ref)
+
+    def test_batch_warm_start_saves_iterations(self):
+        # non-equilibrium counts of a metastable system at consecutive lag times: the row sums are a poor initial
+        # guess, the solution of the previous lag time a good one
+        state = np.random.RandomState(13)
+        n = 40
+        P = state.uniform(0, 1, size=(n, n)) * (state.uniform(size=(n, n)) < .3)
+        P[:n // 2, n // 2:] *= 1e-2
+        P[n // 2:, :n // 2] *= 1e-2
+        P += np.eye(n)
+        P /= P.sum(axis=1, keepdims=True)
+        x = np.full(n, 1. / n)
+        x[:n // 2] *= 5
+        Cs = [1e4 * x[:, None] * np.linalg.matrix_power(P, lag) * state.uniform(.95, 1.05, size=(n, n))
+              for lag in range(1, 7)]
+        _, mus_cold, _, iterations_cold = impl_batch(Cs, return_iterations=True)
+        _, mus, codes, iterations = impl_batch(Cs, warm_start='neighbor', return_iterations=True)
+        np.testing.assert_equal(codes, 0)
+        assert_allclose(mus, mus_cold)
+        np.testing.assert_equal(iterations[0], iterations_cold[0])
+        np.testing.assert_array_less(iterations[1:], iterations_cold[1:])
+        _, _, _, iterations = impl_batch(Cs, warm_start='pairs', return_iterations=True)
+        np.testing.assert_equal(iterations[::2], iterations_cold[::2])
+        np.testing.assert_array_less(iterations[1::2], iterations_cold[1::2])
+
+    def test_batch_neighbor_scales_with_threads(self):
+        # with warm_start='neighbor' every problem is solved on its own, its row-parallel kernels must still get all
+        # threads instead of running inside a problem-parallel region
+        try:
+            from threadpoolctl import threadpool_limits
+        except ImportError:
+            raise unittest.SkipTest("threadpoolctl is required to limit the number of OpenMP threads")
+        if (os.cpu_count() or 1) < 4:
+            raise unittest.SkipTest("Needs at least four cores")
+        state = np.random.RandomState(19)
+        n = 200000
+        Cs = []
+        for _ in range(4):
+            C = scipy.sparse.diags([state.uniform(1, 10, size=n - 1), state.uniform(1, 10, size=n),
+                                    state.uniform(1, 10, size=n - 1)], offsets=[-1, 0, 1], format='csr')
+            Cs.append(C + scipy.sparse.random(n, n, density=5. / n, random_state=state, format='csr'))
+
+        def timing():
+            times = []
+            for _ in range(2):
+                t0 = time.perf_counter()
+                impl_batch(Cs, maxiter=30, warn_not_converged=False, warm_start='neighbor')
+                times.append(time.perf_counter() - t0)
+            return min(times)
+
+        with threadpool_limits(limits=1, user_api='openmp'):
+            serial = timing()
+        parallel = timing()
+        assert serial > 1.5 * parallel, f"no speedup with {os.cpu_count()} cores: {serial:.3f}s vs {parallel:.3f}s"
+
+    def test_batch_invalid_warm_start(self):
+        C = np.loadtxt(testpath + 'C_1_lag.dat')
+        with self.assertRaises(ValueError):
+            impl_batch([C, C], warm_start=[1, -1])
+        with self.assertRaises(ValueError):
+            impl_batch([C, C], warm_start='previous')
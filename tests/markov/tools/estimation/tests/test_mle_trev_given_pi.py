@@ -160,3 +160,19 @@ class Test_mle_trev_given_pi(unittest.TestCase):
             impl_dense(C, pi, maxiter=1)
             assert len(w) == 2
             assert issubclass(w[-1].category, ncw)
+
+    def test_acceleration(self):
+        C = np.loadtxt(testpath + 'C_1_lag.dat')
+        pi = np.loadtxt(testpath + 'pi.dat')
+        T_ref, errors_ref = impl_dense(C, pi, return_error_history=True)
+        for acceleration in ['squarem', 'anderson']:
+            T, errors = impl_dense(C, pi, acceleration=acceleration, return_error_history=True)
+            assert_allclose(T, T_ref)
+            assert len(errors) <= len(errors_ref)
+            assert errors[-1] <= 1e-12
+            T, errors = impl_sparse(scipy.sparse.csr_matrix(C), pi, acceleration=acceleration,
+                                    return_error_history=True)
+            assert_allclose(T.toarray(), T_ref)
+            assert errors[-1] <= 1e-12
+            T = apicall(C, reversible=True, mu=pi, acceleration=acceleration)
+            assert_allclose(T, T_ref)
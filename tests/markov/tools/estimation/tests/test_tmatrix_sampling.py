@@ -5,15 +5,21 @@ r"""Unit tests for the transition_matrix module
 
 """
 
+import itertools
 import unittest
 
 import numpy as np
 
+from scipy.sparse import csr_matrix, issparse
 from scipy.special import betainc
 from scipy.integrate import quad
 
-from deeptime.markov.tools.estimation import sample_tmatrix, tmatrix_sampler
-from deeptime.markov.tools.analysis import is_transition_matrix
+from deeptime.markov.tools.estimation import sample_tmatrix, tmatrix_sampler, transition_matrix
+from deeptime.markov.tools.estimation.dense.tmat_sampling.sampler_nrev import SamplerNonRev
+from deeptime.markov.tools.estimation.dense.tmat_sampling.sampler_rev import SamplerRev
+from deeptime.markov.tools.estimation.dense.tmat_sampling.sampler_revpi import SamplerRevPi
+from deeptime.markov.tools.estimation.dense.tmat_sampling.tmatrix_sampler import TransitionMatrixSampler
+from deeptime.markov.tools.analysis import is_transition_matrix, stationary_distribution
 
 
 class TestTransitionMatrixSampling(unittest.TestCase):
@@ -40,6 +46,92 @@ class TestTransitionMatrixSampling(unittest.TestCase):
             assert np.all(Ps[i].shape == self.C.shape)
             assert is_transition_matrix(Ps[i])
 
+    def test_sample_nonrev_batch(self):
+        C = np.array([[7, 0, 3], [2, 2, 0], [0, 1, 5]], dtype=float)
+        Ps = SamplerNonRev(C - 1.0, seed=3).sample_batch(20000)
+        np.testing.assert_equal(Ps[:, C == 0], 0.)
+        np.testing.assert_allclose(Ps.sum(axis=2), 1.)
+        np.testing.assert_allclose(Ps.mean(axis=0), C / C.sum(axis=1, keepdims=True), atol=5e-3)
+        np.testing.assert_equal(SamplerNonRev(C - 1.0, seed=3).sample_batch(20000), Ps)
+
+    def test_sample_rev_sparse(self):
+        Ps, pis = sample_tmatrix(csr_matrix(self.C, dtype=float), nsample=10, reversible=True,
+                                 return_statdist=True)
+        assert len(Ps) == 10
+        for P, pi in zip(Ps, pis):
+            assert issparse(P)
+            assert is_transition_matrix(P)
+            np.testing.assert_allclose(pi.dot(P.toarray()), pi)
+
+    def test_sparse_rev_sampler_same_chain_as_dense(self):
+        state = np.random.RandomState(5)
+        n = 15
+        C = state.randint(0, 20, size=(n, n)) * (state.uniform(size=(n, n)) < .3)
+        C += np.diag(state.randint(1, 20, size=n))
+        C[np.arange(n), (np.arange(n) + 1) % n] += 1
+        C = C.astype(float)
+        P0 = transition_matrix(C, reversible=True)
+        dense = SamplerRev(C, P0=P0, seed=17)
+        sparse = SamplerRev(csr_matrix(C), P0=P0, seed=17)
+        for _ in range(5):
+            P, pi = dense.sample(N=3, return_statdist=True)
+            P_sparse, pi_sparse = sparse.sample(N=3, return_statdist=True)
+            np.testing.assert_allclose(P_sparse.toarray(), P, rtol=1e-6, atol=1e-12)
+            np.testing.assert_allclose(pi_sparse, pi, rtol=1e-6)
+
+    def test_sparse_revpi_sampler_same_chain_as_dense(self):
+        state = np.random.RandomState(7)
+        n = 12
+        C = state.randint(0, 20, size=(n, n)) * (state.uniform(size=(n, n)) < .3)
+        C += np.diag(state.randint(1, 20, size=n))
+        C[np.arange(n), (np.arange(n) + 1) % n] += 1  # one-directional counts on the ring
+        C = C.astype(float)
+        pi = stationary_distribution(transition_matrix(C, reversible=True))
+        P0 = transition_matrix(C, reversible=True, mu=pi)
+        dense = SamplerRevPi(C, pi, P0=P0, seed=17)
+        sparse = SamplerRevPi(csr_matrix(C), pi, P0=P0, seed=17)
+        for _ in range(5):
+            P = dense.sample(N=2)
+            P_sparse = sparse.sample(N=2)
+            self.assertTrue(issparse(P_sparse))
+            np.testing.assert_allclose(P_sparse.toarray(), P, rtol=1e-6, atol=1e-12)
+            np.testing.assert_allclose(pi.dot(P_sparse.toarray()), pi, rtol=1e-6)
+
+    def test_sample_chains_single_chain_same_as_sequential(self):
+        C = np.array([[5, 2, 0], [3, 10, 4], [0, 3, 7]], dtype=float)
+        P0 = transition_matrix(C, reversible=True)
+        sequential = SamplerRev(C, P0=P0, seed=23)
+        P_samples, pi_samples = SamplerRev(C, P0=P0, seed=23).sample_chains(5, N=3)
+        for P_chain, pi_chain in zip(P_samples, pi_samples):
+            P, pi = sequential.sample(N=3, return_statdist=True)
+            np.testing.assert_allclose(P_chain, P, rtol=1e-12)
+            np.testing.assert_allclose(pi_chain, pi, rtol=1e-12)
+
+    def test_sample_chains(self):
+        C = np.array([[5, 2, 0], [3, 10, 4], [0, 3, 7]], dtype=float)
+        sampler = tmatrix_sampler(C, reversible=True, nsteps=2)
+        P_samples, pi_samples = sampler.sample(nsamples=20, return_statdist=True, n_chains=4, n_burn_in=5)
+        self.assertEqual(P_samples.shape, (20, 3, 3))
+        for P, pi in zip(P_samples, pi_samples):
+            self.assertTrue(is_transition_matrix(P))
+            np.testing.assert_allclose(pi.dot(P), pi, atol=1e-12)
+            np.testing.assert_allclose(pi[:, None] * P, (pi[:, None] * P).T, atol=1e-12)
+            np.testing.assert_equal(P[0, 2], 0.)
+        # the chains draw from different streams
+        self.assertFalse(np.allclose(P_samples[0], P_samples[5]))
+
+    def test_sample_continues_chain(self):
+        C = np.array([[5, 2, 0], [3, 10, 4], [0, 3, 7]], dtype=float)
+        pi = stationary_distribution(transition_matrix(C, reversible=True))
+        for mu, n_burn_in in itertools.product([None, pi], [0, 3]):
+            sampler = TransitionMatrixSampler(C, reversible=True, mu=mu, n_steps=2, seed=31)
+            first = sampler.sample(nsamples=5, n_burn_in=n_burn_in)
+            second = sampler.sample(nsamples=5, n_burn_in=n_burn_in)
+            self.assertFalse(np.allclose(first, second))
+            # the continued chain is only burnt in once
+            reference = TransitionMatrixSampler(C, reversible=True, mu=mu, n_steps=2, seed=31)
+            np.testing.assert_equal(np.concatenate([first, second]), reference.sample(nsamples=10, n_burn_in=n_burn_in))
+
 
 class TestAnalyticalDistribution(unittest.TestCase):
 
@@ -102,6 +194,39 @@ class TestAnalyticalDistribution(unittest.TestCase):
 
         self.assertTrue(np.all(np.abs(P_sampled - P_analytical) < 0.01))
 
+    def test_rev_chains(self):
+        sampler = tmatrix_sampler(self.C, reversible=True)
+        T_sample = sampler.sample(nsamples=self.N, n_chains=4, n_burn_in=10)
+        H, xed, yed = np.histogram2d(T_sample[:, 0, 1], T_sample[:, 1, 0], bins=(self.xedges, self.yedges))
+        P_sampled = H / self.N
+        P_analytical = self.probabilities_rev(self.xedges, self.yedges)
+        self.assertTrue(np.all(np.abs(P_sampled - P_analytical) < 0.01))
+
+    def test_revpi_sparse(self):
+        sampler = tmatrix_sampler(csr_matrix(self.C, dtype=float), reversible=True, mu=self.pi)
+        T_sample = np.array([sampler.sample().toarray() for _ in range(self.N)])
+        H, xed = np.histogram(T_sample[:, 0, 1], self.xedges)
+        P_sampled = 1.0 * H / self.N
+        P_analytical = self.probabilities_revpi(self.xedges)
+        self.assertTrue(np.all(np.abs(P_sampled - P_analytical) < 0.02))
+
+    def test_revpi_chains(self):
+        sampler = tmatrix_sampler(self.C, reversible=True, mu=self.pi)
+        T_sample = sampler.sample(nsamples=self.N, n_chains=4, n_burn_in=10)
+        H, xed = np.histogram(T_sample[:, 0, 1], self.xedges)
+        P_sampled = 1.0 * H / self.N
+        P_analytical = self.probabilities_revpi(self.xedges)
+        self.assertTrue(np.all(np.abs(P_sampled - P_analytical) < 0.02))
+
+    def test_rev_sparse(self):
+        N = self.N
+        sampler = tmatrix_sampler(csr_matrix(self.C, dtype=float), reversible=True)
+        T_sample = np.array([sampler.sample().toarray() for _ in range(N)])
+        H, xed, yed = np.histogram2d(T_sample[:, 0, 1], T_sample[:, 1, 0], bins=(self.xedges, self.yedges))
+        P_sampled = H / self.N
+        P_analytical = self.probabilities_rev(self.xedges, self.yedges)
+        self.assertTrue(np.all(np.abs(P_sampled - P_analytical) < 0.01))
+
     def test_revpi(self):
         N = self.N
         sampler = tmatrix_sampler(self.C, reversible=True, mu=self.pi)
@@ -101,6 +101,8 @@ class TestTransitionRevPiSym(unittest.TestCase):
         P, pi = transition_matrix(self.Cs, method='sparse', return_statdist=True, sparse_newton=True, reversible=True)
         assert_allclose(P.T.dot(pi), pi)
         P = transition_matrix(self.Cs, method='sparse', return_statdist=False, sparse_newton=True, reversible=True)
+        with self.assertRaises(ValueError):
+            transition_matrix(self.Cs, method='sparse', sparse_newton=True, reversible=True, acceleration='anderson')
 
         # reversible maximum likelihood
         P = transition_matrix(self.Cs, reversible=True).toarray()
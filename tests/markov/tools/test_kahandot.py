@@ -0,0 +1,75 @@
+import numpy as np
+import pytest
+from numpy.testing import assert_allclose, assert_equal
+
+from deeptime.markov.tools.kahandot import kdot, ksum
+
+
+@pytest.mark.parametrize("dtype", [np.float32, np.float64, np.longdouble])
+@pytest.mark.parametrize("shape", [(1, 7, 1), (13, 1, 5), (50, 300, 170), (129, 257, 33)])
+def test_kdot_against_numpy(dtype, shape):
+    n, m, l = shape
+    state = np.random.RandomState(42)
+    a = state.uniform(-1, 1, size=(n, m)).astype(dtype)
+    b = state.uniform(-1, 1, size=(m, l)).astype(dtype)
+    rtol = 1e-4 if dtype == np.float32 else 1e-10
+    assert_allclose(kdot(a, b), a.astype(np.longdouble) @ b.astype(np.longdouble), rtol=rtol, atol=rtol)
+
+
+def test_kdot_ill_conditioned():
+    # x^T y = 1 exactly, but the partial sums cancel catastrophically in double precision
+    x = np.array([[1e16, 1., -1e16, 1.]])
+    y = np.array([[1.], [1.], [1.], [-0.]])
+    assert_equal(kdot(x, y), [[1.]])
+    assert_equal(kdot(np.ascontiguousarray(y.T), np.ascontiguousarray(x.T)), [[1.]])
+
+
+def test_kdot_shape_mismatch():
+    with pytest.raises(ValueError):
+        kdot(np.ones((3, 4)), np.ones((3, 4)))
+
+
+def test_kdot_empty_inner_dimension():
+    assert_equal(kdot(np.ones((3, 0)), np.ones((0, 2))), np.zeros((3, 2)))
+
+
+@pytest.mark.parametrize("dtype", [np.float32, np.float64, np.longdouble])
+def test_ksum(dtype):
+    x = np.arange(1000).astype(dtype)
+    assert_equal(ksum(x), dtype(999 * 1000 / 2))
+
+
+@pytest.mark.parametrize("dtype", [np.float32, np.float64, np.longdouble])
+@pytest.mark.parametrize("axis", [None, 0, 1, -1])
+@pytest.mark.parametrize("layout", ["c", "f", "strided", "reversed"])
+def test_ksum_axis(dtype, axis, layout):
+    state = np.random.RandomState(13)
+    x = state.uniform(-1, 1, size=(67, 131)).astype(dtype)
+    if layout == "f":
+        x = np.asfortranarray(x)
+    elif layout == "strided":
+        x = np.repeat(x, 3, axis=1)[:, ::3]
+    elif layout == "reversed":
+        x = x[::-1, ::-1]
+    reference = x.astype(np.longdouble).sum(axis=axis)
+    rtol = 1e-5 if dtype == np.float32 else 1e-12
+    assert_allclose(ksum(x, axis=axis), reference, rtol=rtol)
+
+
+def test_ksum_axis_ill_conditioned():
+    x = np.array([[1e16, 1., -1e16, 1.],
+                  [1., 1e16, 1., -1e16]])
+    assert_equal(ksum(x), 4.)
+    assert_equal(ksum(x, axis=1), [2., 2.])
+    assert_equal(ksum(np.ascontiguousarray(x.T), axis=0), [2., 2.])
+
+
+def test_ksum_long_column():
+    x = np.full((2 ** 17, 3), .1)
+    x[0] = 1e10
+    assert_allclose(ksum(x, axis=0), np.full(3, 1e10 + (2 ** 17 - 1) * .1), rtol=1e-15)
+
+
+def test_ksum_invalid_axis():
+    with pytest.raises(ValueError):
+        ksum(np.ones((3, 3)), axis=2)